@@ -0,0 +1,333 @@
+/*
+   Description::
+
+   Batch mode.  The graphs are collected first, then a pool of worker
+   threads takes them in order.  Each worker keeps its own search
+   context for the whole batch, so the dictionary is allocated once
+   per worker and just emptied between graphs.  The main thread prints
+   the results in input order, as soon as they are available.
+
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+/* Preamble */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#include "common.h"
+#include "dag.h"
+#include "kthparser.h"
+#include "libpebble.h"
+#include "cache.h"
+#include "batch.h"
+
+#define MANIFEST_LINE 4096
+
+/* A graph of the batch, and its result */
+typedef struct {
+
+  char        *filename;        /* NULL if read from the stream */
+  DAG         *graph;
+
+  SearchResult result;
+  unsigned int cost;
+  size_t       length;
+  Counter      processed;
+  Counter      unique;
+  const char  *error;
+
+  Boolean      done;
+
+} BatchJob;
+
+typedef struct {
+
+  const BatchOptions *opts;
+
+  BatchJob   *jobs;
+  size_t      count;
+  size_t      next;             /* Next job to be taken */
+
+  Counter     cache_hits;       /* Summed over the workers */
+  Counter     cache_misses;
+  Counter     cache_stores;
+
+  pthread_mutex_t lock;
+  pthread_cond_t  finished;
+
+} Batch;
+
+
+void init_BatchOptions(BatchOptions *opts) {
+
+  assert(opts);
+
+  opts->variant         = VARIANT_BLACK;
+  opts->engine          = SEARCH_EXPLICIT;
+  opts->visited         = VISITED_DICT;
+  opts->bitstate_memory = BITSTATE_DEFAULT_MEMORY;
+  opts->dict_size       = BATCH_DEFAULT_DICT_SIZE;
+  opts->beam_width      = BEAM_DEFAULT_WIDTH;
+
+  opts->bound      = 0;
+  opts->persistent = FALSE;
+  opts->shortest   = FALSE;
+  opts->cache_dir  = NULL;
+
+  opts->workers    = 1;
+}
+
+
+static BatchJob *addjob(Batch *b,size_t *allocation) {
+
+  if (b->count == *allocation) {
+    *allocation = *allocation ? 2 * *allocation : 64;
+    b->jobs = (BatchJob*)realloc(b->jobs,*allocation * sizeof(BatchJob));
+    assert(b->jobs);
+  }
+  BatchJob *job = b->jobs + b->count++;
+  memset(job,0,sizeof(BatchJob));
+  job->result = SEARCH_NOT_RUN;
+  return job;
+}
+
+/* Skip blanks and comment lines. Return FALSE at the end of file. */
+static Boolean skipcomments(FILE *input) {
+
+  int c;
+  for(;;) {
+    c=getc(input);
+    if (c==EOF) return FALSE;
+    if (c==' ' || c=='\t' || c=='\r' || c=='\n') continue;
+    if (c=='c') {
+      do { c=getc(input); } while(c!=EOF && c!='\n');
+      continue;
+    }
+    ungetc(c,input);
+    return TRUE;
+  }
+}
+
+/* Collect the jobs from a manifest or a stream of graphs. The graphs
+   in the stream are parsed here, the files in the manifest are parsed
+   by the workers. */
+static void readjobs(Batch *b,FILE *input,Boolean manifest) {
+
+  size_t   allocation=0;
+  BatchJob *job;
+  char     line[MANIFEST_LINE];
+
+  if (manifest) {
+    while (fgets(line,MANIFEST_LINE,input)) {
+      size_t len=strlen(line);
+      while (len>0 && (line[len-1]=='\n' || line[len-1]=='\r' ||
+                       line[len-1]==' '  || line[len-1]=='\t')) line[--len]='\0';
+      if (len==0) continue;
+      job = addjob(b,&allocation);
+      job->filename = (char*)malloc(len+1);
+      assert(job->filename);
+      strcpy(job->filename,line);
+    }
+  } else {
+    while (skipcomments(input)) {
+      job = addjob(b,&allocation);
+      job->graph = kthparser_next(input);
+      if (job->graph==NULL) {
+        job->result = SEARCH_ERROR;
+        job->error  = "malformed graph";
+        job->done   = TRUE;
+        break;                  /* The rest of the stream is unreliable */
+      }
+    }
+  }
+}
+
+
+static void solve(PebbleSearch **search,ResultCache *cache,
+                  const BatchOptions *opts,BatchJob *job) {
+
+  if (job->graph==NULL) {
+    FILE *f=fopen(job->filename,"r");
+    if (f==NULL) {
+      job->result=SEARCH_ERROR;
+      job->error="unable to open the file";
+      return;
+    }
+    job->graph=kthparser(f);
+    fclose(f);
+    if (job->graph==NULL) {
+      job->result=SEARCH_ERROR;
+      job->error="malformed graph";
+      return;
+    }
+  }
+
+  PebbleSearch *s=*search;
+  if (s==NULL) {
+    s=*search=new_PebbleSearch(job->graph);
+    setoption_PebbleSearch(s,OPTION_VARIANT,opts->variant);
+    setoption_PebbleSearch(s,OPTION_ENGINE,opts->engine);
+    setoption_PebbleSearch(s,OPTION_VISITED,opts->visited);
+    setoption_PebbleSearch(s,OPTION_BITSTATE_MEMORY,(long)opts->bitstate_memory);
+    setoption_PebbleSearch(s,OPTION_DICT_SIZE,(long)opts->dict_size);
+    setoption_PebbleSearch(s,OPTION_PERSISTENT,opts->persistent);
+    setoption_PebbleSearch(s,OPTION_BEAM_WIDTH,(long)opts->beam_width);
+    setcache_PebbleSearch(s,cache);
+  } else {
+    setgraph_PebbleSearch(s,job->graph);
+  }
+
+  unsigned int cost = (opts->shortest || opts->engine==SEARCH_BEAM) ? opts->bound : 1;
+  for(; cost <= opts->bound; cost++) {
+    setoption_PebbleSearch(s,OPTION_BOUND,cost);
+    job->result=run_PebbleSearch(s);
+    job->processed += stats_PebbleSearch(s)->processed_T;
+    job->unique    += stats_PebbleSearch(s)->first_queuing_T;
+    if (job->result==SEARCH_FOUND || job->result==SEARCH_ERROR) break;
+  }
+
+  if (job->result==SEARCH_FOUND) {
+    job->cost   = (unsigned int)pebbling_PebbleSearch(s)->cost;
+    job->length = pebbling_PebbleSearch(s)->length;
+  } else if (job->result==SEARCH_ERROR) {
+    job->error  = error_PebbleSearch(s);
+  }
+}
+
+
+static void *worker(void *arg) {
+
+  Batch *b=(Batch*)arg;
+  PebbleSearch *search=NULL;
+  ResultCache  *cache=NULL;
+  BatchJob *job;
+
+  /* One cache object per worker, on the same directory */
+  if (b->opts->cache_dir) cache=new_ResultCache(b->opts->cache_dir);
+
+  for(;;) {
+
+    pthread_mutex_lock(&b->lock);
+    while (b->next < b->count && b->jobs[b->next].done) b->next++;
+    job = (b->next < b->count) ? b->jobs + b->next++ : NULL;
+    pthread_mutex_unlock(&b->lock);
+
+    if (job==NULL) break;
+
+    solve(&search,cache,b->opts,job);
+
+    /* The search context must not refer to a disposed graph */
+    if (search) setgraph_PebbleSearch(search,NULL);
+    if (job->graph) {
+      dispose_DAG(job->graph);
+      job->graph=NULL;
+    }
+
+    pthread_mutex_lock(&b->lock);
+    job->done=TRUE;
+    pthread_cond_broadcast(&b->finished);
+    pthread_mutex_unlock(&b->lock);
+  }
+
+  dispose_PebbleSearch(search);
+  if (cache) {
+    pthread_mutex_lock(&b->lock);
+    b->cache_hits   += cache->hits;
+    b->cache_misses += cache->misses;
+    b->cache_stores += cache->stores;
+    pthread_mutex_unlock(&b->lock);
+    dispose_ResultCache(cache);
+  }
+  return NULL;
+}
+
+
+static void printjob(FILE *output,size_t index,const BatchJob *job) {
+
+  static const char *status[] = {
+    [SEARCH_NOT_RUN]   = "ERROR",
+    [SEARCH_FOUND]     = "SATISFIABLE",
+    [SEARCH_NOT_FOUND] = "UNSATISFIABLE",
+    [SEARCH_UNKNOWN]   = "UNKNOWN",
+    [SEARCH_ERROR]     = "ERROR"
+  };
+
+  fprintf(output,"b %zu %s %s",index+1,
+          job->filename ? job->filename : "-",status[job->result]);
+
+  if (job->result==SEARCH_FOUND) {
+    fprintf(output," cost=%u length=%zu",job->cost,job->length);
+  } else if (job->result!=SEARCH_ERROR) {
+    fprintf(output," cost=- length=-");
+  }
+
+  if (job->result==SEARCH_ERROR) {
+    fprintf(output," %s\n",job->error ? job->error : "");
+  } else {
+    fprintf(output," processed=%llu unique=%llu\n",job->processed,job->unique);
+  }
+  fflush(output);
+}
+
+
+size_t batch_pebbling(FILE *input,Boolean manifest,
+                      const BatchOptions *opts,FILE *output) {
+
+  assert(input);
+  assert(opts);
+  assert(output);
+
+  Batch b;
+  b.opts  = opts;
+  b.jobs  = NULL;
+  b.count = 0;
+  b.next  = 0;
+  b.cache_hits   = 0;
+  b.cache_misses = 0;
+  b.cache_stores = 0;
+  pthread_mutex_init(&b.lock,NULL);
+  pthread_cond_init(&b.finished,NULL);
+
+  readjobs(&b,input,manifest);
+
+  unsigned int workers = opts->workers > 0 ? opts->workers : 1;
+  if (workers > b.count) workers = b.count > 0 ? (unsigned int)b.count : 1;
+
+  fprintf(output,"c Batch of %zu graphs on %u workers\n",b.count,workers);
+
+  pthread_t *tid=(pthread_t*)malloc(workers*sizeof(pthread_t));
+  assert(tid);
+  for(unsigned int t=0;t<workers;t++) pthread_create(tid+t,NULL,worker,&b);
+
+  /* Results in input order */
+  size_t failures=0;
+  for(size_t i=0;i<b.count;i++) {
+    pthread_mutex_lock(&b.lock);
+    while (!b.jobs[i].done) pthread_cond_wait(&b.finished,&b.lock);
+    pthread_mutex_unlock(&b.lock);
+    printjob(output,i,b.jobs+i);
+    if (b.jobs[i].result==SEARCH_ERROR) failures++;
+  }
+
+  for(unsigned int t=0;t<workers;t++) pthread_join(tid[t],NULL);
+  free(tid);
+
+  if (opts->cache_dir) {
+    fprintf(stderr,"c Result cache: %llu hits, %llu misses, %llu stored\n",
+            b.cache_hits,b.cache_misses,b.cache_stores);
+  }
+
+  for(size_t i=0;i<b.count;i++) {
+    if (b.jobs[i].graph) dispose_DAG(b.jobs[i].graph);
+    free(b.jobs[i].filename);
+  }
+  free(b.jobs);
+  pthread_mutex_destroy(&b.lock);
+  pthread_cond_destroy(&b.finished);
+
+  return failures;
+}
@@ -0,0 +1,56 @@
+/*
+   Description::
+
+   Batch mode: many graphs solved in the same process by a pool of
+   worker threads. Header for batch.c
+
+*/
+
+
+/* Preamble */
+#ifndef  BATCH_H
+#define  BATCH_H
+
+#include <stdio.h>
+
+#include "common.h"
+#include "libpebble.h"
+
+
+/* Code */
+
+/* Buckets of the dictionary of each worker. The default is much
+   smaller than CONFIG_HASHSIZE, since there is one dictionary per
+   worker and batches are usually made of small graphs. */
+#define BATCH_DEFAULT_DICT_SIZE 0x3FFFF
+
+typedef struct {
+
+  PebblingVariant variant;
+  SearchEngine    engine;
+  VisitedSet      visited;
+  size_t          bitstate_memory;
+  size_t          dict_size;
+  unsigned int    beam_width;
+
+  unsigned int    bound;
+  Boolean         persistent;
+  Boolean         shortest;       /* Only search at the bound (-t) */
+
+  const char     *cache_dir;      /* Result cache, or NULL */
+
+  unsigned int    workers;
+
+} BatchOptions;
+
+extern void init_BatchOptions(BatchOptions *opts);
+
+/* Read the graphs from `input', either a manifest with one KTH file
+   name per line, or a stream of concatenated KTH graphs.  A result
+   line per graph is printed on `output', in input order.
+
+   @return the number of graphs which could not be solved. */
+extern size_t batch_pebbling(FILE *input,Boolean manifest,
+                             const BatchOptions *opts,FILE *output);
+
+#endif /* BATCH_H */
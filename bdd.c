@@ -0,0 +1,389 @@
+/*
+   Description::
+
+   Reduced ordered binary decision diagrams (Bryant), with a unique
+   table and an operation cache.  The package implements the few
+   operations needed by the symbolic search: boolean connectives,
+   cofactors, existential quantification of a single variable, and
+   extraction and counting of satisfying assignments.
+
+*/
+
+/* Preamble */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "common.h"
+#include "bdd.h"
+
+
+/* Terminals are below every variable */
+#define BDD_TERMINAL_VAR  UINT_MAX
+
+/* Operations in the cache */
+#define BDD_OP_NONE      0
+#define BDD_OP_AND       1
+#define BDD_OP_OR        2
+#define BDD_OP_NOT       3
+#define BDD_OP_RESTRICT  4
+
+#define BDD_CACHE_SIZE  0x100000
+#define BDD_MIN_ALLOCATION 0x400
+
+
+/* Code */
+
+static inline size_t hash_triple(unsigned int x,BNode y,BNode z) {
+  BitTuple h = ((BitTuple)x << 32) ^ ((BitTuple)y * 0x9E3779B97F4A7C15ULL) ^ z;
+  h ^= h >> 31; h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 29;
+  return (size_t)h;
+}
+
+static inline Boolean isterminal(BNode f) {
+  return f==BDD_FALSE || f==BDD_TRUE;
+}
+
+
+/* Rebuild the unique table, with at least one bucket per node slot. */
+static void rehash(BDD *m) {
+
+  size_t buckets=BDD_MIN_ALLOCATION;
+  while(buckets < m->allocation) buckets <<= 1;
+
+  free(m->buckets);
+  m->buckets = (BNode*)calloc(buckets,sizeof(BNode));
+  assert(m->buckets);
+  m->buckets_mask = buckets-1;
+
+  /* BDD_FALSE terminates the chains */
+  for(BNode f=2;f<m->size;f++) {
+    BDDNode *n=m->nodes+f;
+    size_t   b=hash_triple(n->var,n->lo,n->hi) & m->buckets_mask;
+    n->next = m->buckets[b];
+    m->buckets[b] = f;
+  }
+}
+
+
+BDD *newBDD(unsigned int variables,size_t allocation) {
+
+  BDD *m=(BDD*)malloc(sizeof(BDD));
+  assert(m);
+
+  m->variables = variables;
+
+  if (allocation < BDD_MIN_ALLOCATION) allocation=BDD_MIN_ALLOCATION;
+  m->allocation = allocation;
+  m->nodes      = (BDDNode*)malloc(allocation*sizeof(BDDNode));
+  assert(m->nodes);
+
+  m->nodes[BDD_FALSE].var = BDD_TERMINAL_VAR;
+  m->nodes[BDD_FALSE].lo  = m->nodes[BDD_FALSE].hi = m->nodes[BDD_FALSE].next = BDD_FALSE;
+  m->nodes[BDD_TRUE].var  = BDD_TERMINAL_VAR;
+  m->nodes[BDD_TRUE].lo   = m->nodes[BDD_TRUE].hi  = m->nodes[BDD_TRUE].next  = BDD_FALSE;
+  m->size = 2;
+  m->peak = 2;
+
+  m->buckets = NULL;
+  rehash(m);
+
+  m->cache_mask = BDD_CACHE_SIZE - 1;
+  m->cache      = (BDDCacheEntry*)calloc(BDD_CACHE_SIZE,sizeof(BDDCacheEntry));
+  assert(m->cache);
+
+  m->collections = 0;
+
+  return m;
+}
+
+void disposeBDD(BDD *m) {
+  assert(m);
+  free(m->nodes);
+  free(m->buckets);
+  free(m->cache);
+  free(m);
+}
+
+
+/* Nodes are ordered, reduced (lo!=hi) and unique. */
+Boolean isconsistentBDD(BDD *m) {
+
+  if (m->size > m->allocation) return FALSE;
+
+  for(BNode f=2;f<m->size;f++) {
+    BDDNode *n=m->nodes+f;
+    if (n->lo >= f || n->hi >= f) return FALSE;
+    if (n->lo == n->hi) return FALSE;
+    if (n->var >= m->variables) return FALSE;
+    if (n->var >= m->nodes[n->lo].var) return FALSE;
+    if (n->var >= m->nodes[n->hi].var) return FALSE;
+
+    /* It must be the node found in the unique table */
+    BNode g=m->buckets[hash_triple(n->var,n->lo,n->hi) & m->buckets_mask];
+    while(g!=BDD_FALSE &&
+          (m->nodes[g].var!=n->var || m->nodes[g].lo!=n->lo || m->nodes[g].hi!=n->hi))
+      g=m->nodes[g].next;
+    if (g!=f) return FALSE;
+  }
+  return TRUE;
+}
+
+
+/* The node for (var ? hi : lo), reduced. */
+BNode getnodeBDD(BDD *m,unsigned int var,BNode lo,BNode hi) {
+
+  assert(var < m->variables);
+  assert(var < m->nodes[lo].var);
+  assert(var < m->nodes[hi].var);
+
+  if (lo==hi) return lo;
+
+  size_t b=hash_triple(var,lo,hi) & m->buckets_mask;
+  for(BNode f=m->buckets[b]; f!=BDD_FALSE; f=m->nodes[f].next) {
+    BDDNode *n=m->nodes+f;
+    if (n->var==var && n->lo==lo && n->hi==hi) return f;
+  }
+
+  if (m->size == m->allocation) {
+    m->allocation *= 2;
+    m->nodes = (BDDNode*)realloc(m->nodes,m->allocation*sizeof(BDDNode));
+    assert(m->nodes);
+    rehash(m);
+    b=hash_triple(var,lo,hi) & m->buckets_mask;
+  }
+
+  BNode f=(BNode)m->size++;
+  m->nodes[f].var  = var;
+  m->nodes[f].lo   = lo;
+  m->nodes[f].hi   = hi;
+  m->nodes[f].next = m->buckets[b];
+  m->buckets[b]    = f;
+  if (m->size > m->peak) m->peak=m->size;
+  return f;
+}
+
+BNode varBDD(BDD *m,unsigned int var)  { return getnodeBDD(m,var,BDD_FALSE,BDD_TRUE); }
+BNode nvarBDD(BDD *m,unsigned int var) { return getnodeBDD(m,var,BDD_TRUE,BDD_FALSE); }
+
+
+/* Operation cache */
+static inline BDDCacheEntry *cacheentry(BDD *m,unsigned int op,BNode a,BNode b) {
+  return m->cache + (hash_triple(op,a,b) & m->cache_mask);
+}
+
+static inline Boolean cachelookup(BDD *m,unsigned int op,BNode a,BNode b,BNode *result) {
+  BDDCacheEntry *e=cacheentry(m,op,a,b);
+  if (e->op==op && e->a==a && e->b==b) { *result=e->result; return TRUE; }
+  return FALSE;
+}
+
+static inline void cachestore(BDD *m,unsigned int op,BNode a,BNode b,BNode result) {
+  BDDCacheEntry *e=cacheentry(m,op,a,b);
+  e->op=op; e->a=a; e->b=b; e->result=result;
+}
+
+
+BNode notBDD(BDD *m,BNode a) {
+
+  if (a==BDD_FALSE) return BDD_TRUE;
+  if (a==BDD_TRUE)  return BDD_FALSE;
+
+  BNode r;
+  if (cachelookup(m,BDD_OP_NOT,a,0,&r)) return r;
+
+  /* The node array may move during the recursion */
+  BDDNode na=m->nodes[a];
+  BNode lo=notBDD(m,na.lo);
+  BNode hi=notBDD(m,na.hi);
+  r=getnodeBDD(m,na.var,lo,hi);
+
+  cachestore(m,BDD_OP_NOT,a,0,r);
+  return r;
+}
+
+
+/* Shannon expansion of a binary operation on the top variable */
+static BNode apply(BDD *m,unsigned int op,BNode a,BNode b) {
+
+  if (op==BDD_OP_AND) {
+    if (a==BDD_FALSE || b==BDD_FALSE) return BDD_FALSE;
+    if (a==BDD_TRUE) return b;
+    if (b==BDD_TRUE || a==b) return a;
+  } else {
+    if (a==BDD_TRUE || b==BDD_TRUE) return BDD_TRUE;
+    if (a==BDD_FALSE) return b;
+    if (b==BDD_FALSE || a==b) return a;
+  }
+  if (a > b) { BNode t=a; a=b; b=t; }
+
+  BNode r;
+  if (cachelookup(m,op,a,b,&r)) return r;
+
+  BDDNode na=m->nodes[a];
+  BDDNode nb=m->nodes[b];
+  BNode lo,hi;
+  unsigned int var;
+
+  if (na.var < nb.var) {
+    var=na.var;
+    lo=apply(m,op,na.lo,b);
+    hi=apply(m,op,na.hi,b);
+  } else if (na.var > nb.var) {
+    var=nb.var;
+    lo=apply(m,op,a,nb.lo);
+    hi=apply(m,op,a,nb.hi);
+  } else {
+    var=na.var;
+    lo=apply(m,op,na.lo,nb.lo);
+    hi=apply(m,op,na.hi,nb.hi);
+  }
+  r=getnodeBDD(m,var,lo,hi);
+
+  cachestore(m,op,a,b,r);
+  return r;
+}
+
+BNode andBDD(BDD *m,BNode a,BNode b) { return apply(m,BDD_OP_AND,a,b); }
+BNode orBDD (BDD *m,BNode a,BNode b) { return apply(m,BDD_OP_OR ,a,b); }
+
+
+/* Cofactor of a with respect to var=value */
+BNode restrictBDD(BDD *m,BNode a,unsigned int var,Boolean value) {
+
+  if (m->nodes[a].var > var) return a;
+  if (m->nodes[a].var == var) return value ? m->nodes[a].hi : m->nodes[a].lo;
+
+  BNode r;
+  BNode key=(BNode)(2*var + (value ? 1 : 0));
+  if (cachelookup(m,BDD_OP_RESTRICT,a,key,&r)) return r;
+
+  BDDNode na=m->nodes[a];
+  BNode lo=restrictBDD(m,na.lo,var,value);
+  BNode hi=restrictBDD(m,na.hi,var,value);
+  r=getnodeBDD(m,na.var,lo,hi);
+
+  cachestore(m,BDD_OP_RESTRICT,a,key,r);
+  return r;
+}
+
+BNode existsBDD(BDD *m,BNode a,unsigned int var) {
+  BNode lo=restrictBDD(m,a,var,FALSE);
+  BNode hi=restrictBDD(m,a,var,TRUE);
+  return orBDD(m,lo,hi);
+}
+
+
+Boolean evalBDD(const BDD *m,BNode a,const BitTuple *assignment) {
+  while(!isterminal(a)) {
+    unsigned int var=m->nodes[a].var;
+    a = GETBIT(assignment[var / BITTUPLE_SIZE],var % BITTUPLE_SIZE) ? m->nodes[a].hi : m->nodes[a].lo;
+  }
+  return a==BDD_TRUE;
+}
+
+
+/* A satisfying assignment, with variables set to false when possible.
+   The assignment must be cleared by the caller. */
+Boolean anysatBDD(const BDD *m,BNode a,BitTuple *assignment) {
+  if (a==BDD_FALSE) return FALSE;
+  while(!isterminal(a)) {
+    unsigned int var=m->nodes[a].var;
+    if (m->nodes[a].lo!=BDD_FALSE) {
+      a=m->nodes[a].lo;
+    } else {
+      SETBIT(assignment[var / BITTUPLE_SIZE],var % BITTUPLE_SIZE);
+      a=m->nodes[a].hi;
+    }
+  }
+  return TRUE;
+}
+
+
+/* Number of satisfying assignments over all the variables */
+static double satcount(const BDD *m,BNode a,double *memo) {
+  if (a==BDD_FALSE) return 0.0;
+  if (a==BDD_TRUE)  return 1.0;
+  if (memo[a]>=0.0) return memo[a];
+
+  const BDDNode *n=m->nodes+a;
+  unsigned int lovar= isterminal(n->lo) ? m->variables : m->nodes[n->lo].var;
+  unsigned int hivar= isterminal(n->hi) ? m->variables : m->nodes[n->hi].var;
+
+  memo[a] = satcount(m,n->lo,memo) * ldexp(1.0,(int)(lovar - n->var - 1)) +
+            satcount(m,n->hi,memo) * ldexp(1.0,(int)(hivar - n->var - 1));
+  return memo[a];
+}
+
+double satcountBDD(const BDD *m,BNode a) {
+
+  double *memo=(double*)malloc(m->size*sizeof(double));
+  assert(memo);
+  for(size_t i=0;i<m->size;i++) memo[i]=-1.0;
+
+  unsigned int top= isterminal(a) ? m->variables : m->nodes[a].var;
+  double r = satcount(m,a,memo) * ldexp(1.0,(int)top);
+
+  free(memo);
+  return r;
+}
+
+
+/*
+   Mark the nodes reachable from a.  Since children come before their
+   parents, compaction preserves that order.
+ */
+static void mark(const BDD *m,BNode a,BNode *forward) {
+  while(!forward[a]) {
+    forward[a]=1;
+    mark(m,m->nodes[a].hi,forward);
+    a=m->nodes[a].lo;
+  }
+}
+
+size_t nodecountBDD(const BDD *m,BNode a) {
+
+  BNode *forward=(BNode*)calloc(m->size,sizeof(BNode));
+  assert(forward);
+
+  forward[BDD_FALSE]=forward[BDD_TRUE]=1;
+  mark(m,a,forward);
+
+  size_t count=0;
+  for(BNode f=2;f<m->size;f++) if (forward[f]) count++;
+  free(forward);
+  return count;
+}
+
+
+/* Keep only the nodes reachable from the roots, which are updated. */
+void collectBDD(BDD *m,BNode **roots,size_t count) {
+
+  BNode *forward=(BNode*)calloc(m->size,sizeof(BNode));
+  assert(forward);
+
+  forward[BDD_FALSE]=forward[BDD_TRUE]=1;
+  for(size_t i=0;i<count;i++) mark(m,*roots[i],forward);
+
+  forward[BDD_FALSE]=BDD_FALSE;
+  forward[BDD_TRUE] =BDD_TRUE;
+
+  BNode live=2;
+  for(BNode f=2;f<m->size;f++) {
+    if (!forward[f]) continue;
+    m->nodes[live].var = m->nodes[f].var;
+    m->nodes[live].lo  = forward[m->nodes[f].lo];
+    m->nodes[live].hi  = forward[m->nodes[f].hi];
+    forward[f]=live++;
+  }
+  for(size_t i=0;i<count;i++) *roots[i]=forward[*roots[i]];
+  m->size=live;
+  free(forward);
+
+  rehash(m);
+  memset(m->cache,0,(m->cache_mask+1)*sizeof(BDDCacheEntry));
+  m->collections++;
+}
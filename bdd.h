@@ -0,0 +1,92 @@
+/*
+   Description::
+
+   Reduced ordered binary decision diagrams, for the symbolic search
+   of pebblings. Header for bdd.c
+
+*/
+
+
+/* Preamble */
+#ifndef  BDD_H
+#define  BDD_H
+
+#include <stdlib.h>
+#include "common.h"
+
+/* Code */
+
+/* A BDD represents a boolean function over numbered variables, where
+   variable 0 is tested first.  Nodes are numbered, and the two
+   terminals are node 0 (false) and node 1 (true).  Nodes are shared
+   through a unique table, and the results of operations are memoized
+   in a lossy cache.  A node is always created after its children.
+
+   Nodes are never freed during an operation: the caller decides when
+   to collect garbage, by giving the list of the functions in use. */
+typedef unsigned int BNode;
+
+#define BDD_FALSE  0
+#define BDD_TRUE   1
+
+typedef struct {
+
+  unsigned int var;             /* Variable tested in the node */
+  BNode        lo;              /* Cofactor for the variable false */
+  BNode        hi;              /* Cofactor for the variable true */
+  BNode        next;            /* Chain in the unique table */
+
+} BDDNode;
+
+typedef struct {
+
+  unsigned int op;
+  BNode        a;
+  BNode        b;
+  BNode        result;
+
+} BDDCacheEntry;
+
+typedef struct {
+
+  unsigned int variables;       /* Number of variables */
+
+  size_t   allocation;          /* Capacity of the node array */
+  size_t   size;                /* Nodes in use, terminals included */
+  BDDNode *nodes;
+
+  size_t   buckets_mask;        /* Unique table */
+  BNode   *buckets;
+
+  size_t         cache_mask;    /* Operation cache */
+  BDDCacheEntry *cache;
+
+  size_t   peak;                /* Largest number of nodes in use */
+  Counter  collections;
+
+} BDD;
+
+extern BDD    *newBDD(unsigned int variables,size_t allocation);
+extern void    disposeBDD(BDD *m);
+
+extern Boolean isconsistentBDD(BDD *m);
+
+extern BNode   getnodeBDD(BDD *m,unsigned int var,BNode lo,BNode hi);
+extern BNode   varBDD(BDD *m,unsigned int var);
+extern BNode   nvarBDD(BDD *m,unsigned int var);
+
+extern BNode   notBDD(BDD *m,BNode a);
+extern BNode   andBDD(BDD *m,BNode a,BNode b);
+extern BNode   orBDD(BDD *m,BNode a,BNode b);
+extern BNode   restrictBDD(BDD *m,BNode a,unsigned int var,Boolean value);
+extern BNode   existsBDD(BDD *m,BNode a,unsigned int var);
+
+/* Assignments are bitsets over the variables */
+extern Boolean evalBDD(const BDD *m,BNode a,const BitTuple *assignment);
+extern Boolean anysatBDD(const BDD *m,BNode a,BitTuple *assignment);
+extern double  satcountBDD(const BDD *m,BNode a);
+extern size_t  nodecountBDD(const BDD *m,BNode a);
+
+extern void    collectBDD(BDD *m,BNode **roots,size_t count);
+
+#endif /* BDD_H */
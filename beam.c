@@ -0,0 +1,353 @@
+/*
+   Description::
+
+   Beam search for pebblings.  The search goes layer by layer as the
+   breadth-first search, over the same moves, but only the `width'
+   most promising configurations of each layer are expanded.  It finds
+   pebblings of graphs whose configuration space is far too large for
+   the exact search, with no guarantee of optimality.
+
+   The configurations are ranked by a measure of the pebble pressure:
+   first the progress towards the goal (reach the sink, then remove
+   the pebbles which are hard to remove), then the number of pebbles
+   on the graph.
+
+*/
+
+/* Preamble */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+#include "dag.h"
+#include "hashtable.h"
+#include "pebbling.h"
+#include "bfs.h"
+#include "config.h"
+#include "beam.h"
+
+extern size_t  hashPebbleConfiguration(void *data);
+extern Boolean samePebbleConfiguration(void *A,void *B);
+extern void    freePebbleConfiguration(void *data);
+
+
+/* Code */
+
+/* A configuration produced by a layer, with its rank */
+typedef struct {
+
+  double       highest;       /* Main measure of the progress */
+  double       progress;      /* Tie breaker, after the pebbles */
+  unsigned int pebbles;
+  Boolean      touched;       /* The sink has been touched */
+  BitTuple     black;         /* Pebbles of the configuration, which */
+  BitTuple     white;         /* may be disposed while sorted */
+  PebbleConfiguration *c;
+
+} Candidate;
+
+/* Weight of the pebble on each vertex: (n+1)^h where h is the length
+   of the longest path from a source to the vertex */
+static void vertexweights(const DAG *g,double *weight) {
+
+  unsigned int *height=(unsigned int*)calloc(g->size,sizeof(unsigned int));
+  Boolean changed=TRUE;
+
+  assert(height);
+  while(changed) {
+    changed=FALSE;
+    for(Vertex v=0;v<g->size;v++)
+      for(size_t i=0;i<g->indegree[v];i++)
+        if (height[g->in[v][i]]+1 > height[v]) {
+          height[v]=height[g->in[v][i]]+1;
+          changed=TRUE;
+        }
+  }
+  for(Vertex v=0;v<g->size;v++) {
+    weight[v]=1.0;
+    for(unsigned int h=0;h<height[v];h++) weight[v] *= (double)(g->size+1);
+  }
+  free(height);
+}
+
+/* Pebbles which the pebbling must remove before its end */
+static inline BitTuple hardpebbles(const PebbleConfiguration *c,Boolean persistent) {
+#if BLACK_WHITE_PEBBLING
+  (void)persistent;
+  return c->white_pebbled;
+#elif REVERSIBLE_PEBBLING
+  return persistent ? c->black_pebbled : 0;
+#else
+  (void)c;
+  (void)persistent;
+  return 0;
+#endif
+}
+
+/* Before the sink is touched, the progress is the weight of the
+   highest black pebble, and then of all of them, where a pebble
+   outweighs all the pebbles below it.  After the sink is touched, the
+   pebbles still to be removed weigh against the progress, the highest
+   one first. */
+static void rank(const DAG *g,const double *weight,Boolean persistent,
+                 Candidate *x) {
+
+  const PebbleConfiguration *c=x->c;
+
+  x->touched  = c->sink_touched;
+  x->pebbles  = c->pebbles;
+  x->black    = c->black_pebbled;
+#if BLACK_WHITE_PEBBLING
+  x->white    = c->white_pebbled;
+#else
+  x->white    = 0;
+#endif
+  x->highest  = 0.0;
+  x->progress = 0.0;
+
+  if (!c->sink_touched) {
+    for(BitTuple b=c->black_pebbled; b; b &= b-1) {
+      x->progress += weight[LOWESTBIT(b)];
+      if (weight[LOWESTBIT(b)] > x->highest) x->highest=weight[LOWESTBIT(b)];
+    }
+  } else {
+    for(BitTuple b=hardpebbles(c,persistent); b; b &= b-1) {
+      x->progress -= weight[LOWESTBIT(b)];
+      if (weight[LOWESTBIT(b)] > -x->highest) x->highest=-weight[LOWESTBIT(b)];
+    }
+  }
+}
+
+/* Touched first, then the most progress, with fewer pebbles as the
+   first tie breaker.  Equal configurations end up next to each other. */
+static int comparecandidates(const void *A,const void *B) {
+
+  const Candidate *a=(const Candidate*)A;
+  const Candidate *b=(const Candidate*)B;
+
+  if (a->touched  != b->touched)  return a->touched ? -1 : 1;
+  if (a->highest  != b->highest)  return a->highest  > b->highest  ? -1 : 1;
+  if (a->pebbles  != b->pebbles)  return a->pebbles  < b->pebbles  ? -1 : 1;
+  if (a->progress != b->progress) return a->progress > b->progress ? -1 : 1;
+  if (a->black    != b->black)    return a->black    < b->black    ? -1 : 1;
+  if (a->white    != b->white)    return a->white    < b->white    ? -1 : 1;
+  return 0;
+}
+
+
+/*
+ * One beam search with a fixed bound and width.  The visited
+ * configurations are kept in a dictionary, which owns them, so that
+ * the beam never goes back to a configuration already expanded.
+ */
+static Pebbling *beamsearch(const DAG *g,
+                            unsigned int upper_bound,
+                            Boolean persistent_pebbling,
+                            unsigned int width,
+                            const double *weight,
+                            BFSOptions *opts,
+                            Counter *visited_count) {
+
+  Boolean (*isfinal)(const DAG *, const PebbleConfiguration *) =
+    persistent_pebbling ? isfinal_persistent : isfinal_visiting;
+
+  Dict *D=newDict(width*64);
+  D->key_function     = hashPebbleConfiguration;
+  D->eq_function      = samePebbleConfiguration;
+  D->dispose_function = freePebbleConfiguration;
+
+  DictQueryResult res;
+
+  PebbleConfiguration **layer=(PebbleConfiguration**)malloc(width*sizeof(PebbleConfiguration*));
+  size_t     layer_size=0;
+  size_t     allocated=width*g->size;
+  Candidate *candidates=(Candidate*)malloc(allocated*sizeof(Candidate));
+  size_t     count;
+  PebbleConfiguration *final=NULL;
+
+  assert(layer && candidates);
+
+  PebbleConfiguration *initial=new_PebbleConfiguration();
+  reset_active_PebbleConfiguration(g,initial);
+#if BLACK_WHITE_PEBBLING || REVERSIBLE_PEBBLING
+  if (persistent_pebbling) {  init_persistent_pebbling(g, initial); }
+#endif
+  writeDict(D,&res,initial);
+  layer[layer_size++]=initial;
+
+  while(layer_size>0 && final==NULL) {
+
+    opts->limit=exceeded_ResourceLimits(&opts->limits,*visited_count);
+    if (opts->limit) break;
+
+    /* All the new configurations reachable from the layer */
+    count=0;
+    for(size_t i=0;i<layer_size;i++) {
+
+      PebbleConfiguration *ptr=layer[i];
+
+      for(BitTuple moves=enabled_PebbleConfiguration(g,ptr,upper_bound); moves; moves &= moves-1) {
+
+        Vertex v=LOWESTBIT(moves);
+        PebbleConfiguration *nptr=next_PebbleConfiguration(v,g,ptr,upper_bound);
+        if (nptr==NULL) continue;
+
+        queryDict(D,&res,nptr);
+        if (res.value!=NULL) {
+          dispose_PebbleConfiguration(nptr);
+          continue;
+        }
+        nptr->previous_configuration = ptr;
+        nptr->last_changed_vertex = v;
+
+        if (count==allocated) {
+          allocated *= 2;
+          candidates=(Candidate*)realloc(candidates,allocated*sizeof(Candidate));
+          assert(candidates);
+        }
+        candidates[count].c=nptr;
+        rank(g,weight,persistent_pebbling,candidates+count);
+        count++;
+      }
+    }
+
+    /* The best ones, without repetitions, form the next layer */
+    qsort(candidates,count,sizeof(Candidate),comparecandidates);
+    layer_size=0;
+    for(size_t i=0;i<count;i++) {
+      PebbleConfiguration *nptr=candidates[i].c;
+      if (final || layer_size==width ||
+          (i>0 && comparecandidates(candidates+i-1,candidates+i)==0)) {
+        dispose_PebbleConfiguration(nptr);
+        continue;
+      }
+      writeDict(D,&res,nptr);
+      (*visited_count)++;
+      if (isfinal(g,nptr)) final=nptr;
+      else layer[layer_size++]=nptr;
+    }
+  }
+
+  Pebbling *solution=NULL;
+  if (final) {
+    if (persistent_pebbling) {
+      solution = finalize_persistent_pebbling(g,final);
+    } else {
+#if REVERSIBLE_PEBBLING
+      solution = finalize_reversible_pebbling(g,final);
+#else
+      solution = finalize_pebbling(g,final);
+#endif
+    }
+    assert(isvalid_Pebbling(g,solution,persistent_pebbling));
+  }
+
+  free(candidates);
+  free(layer);
+  disposeDict(D);
+  return solution;
+}
+
+
+/**
+   Anytime heuristic search of a pebbling.
+
+   A beam search looks for a pebbling within the bound.  When it finds
+   one, the search starts again, with the initial width and with a
+   bound smaller than its cost; when it fails, it starts again with a
+   beam twice as wide.  It stops at the deadline or at the first limit
+   of `opts->limits' which is exceeded, after the failure of the
+   widest beam, or when the pebbling cannot be improved.
+
+   @param g the graph to pebble (with few vertices and a single sink).
+
+   @param upper_bound the maximum number of pebbles.
+
+   @param persistent_pebbling whether the pebbling must leave a black
+   pebble on the sink.
+
+   @param opts the options of the search, in particular the initial
+   width of the beam (NULL for defaults).
+
+   @return the cheapest pebbling found, or NULL.
+*/
+Pebbling *beam_pebbling_strategy(const DAG *g,
+                                 unsigned int upper_bound,
+                                 Boolean persistent_pebbling,
+                                 BFSOptions *opts) {
+
+  /* PROLOGUE ----------------------------------- */
+  assert(isconsistent_DAG(g));
+
+  BFSOptions default_opts;
+  if (opts==NULL) {
+    init_BFSOptions(&default_opts);
+    opts=&default_opts;
+  }
+  opts->approximate = TRUE;         /* A failure is not a proof */
+  opts->omission_probability = 0.0;
+  opts->expected_omissions   = 0.0;
+  opts->error = NULL;
+  opts->limit = NULL;
+  opts->depth = -1;
+
+  if (g->size > BITTUPLE_SIZE) {
+    opts->error = "the graph is too big for the optimized data structures";
+    return NULL;
+  }
+
+  if (g->sink_number!=1) {
+    opts->error = "the graph has more than one sink vertex";
+    return NULL;
+  }
+
+  if (opts->beam_width < 1) {
+    opts->error = "the beam must have positive width";
+    return NULL;
+  }
+
+  if (upper_bound < 1) { return NULL; } /* No pebbling with zero pebbles */
+
+#if (!BLACK_WHITE_PEBBLING && !REVERSIBLE_PEBBLING)
+  persistent_pebbling = 0;
+#endif
+
+  /* END OF PROLOGUE ----------------------------------- */
+
+  double *weight=(double*)malloc(g->size*sizeof(double));
+  assert(weight);
+  vertexweights(g,weight);
+
+  Pebbling    *best=NULL;
+  unsigned int bound=upper_bound;
+  unsigned int width=opts->beam_width;
+  unsigned int widest=opts->beam_width << BEAM_WIDENINGS;
+  Counter      visited_count=0;
+
+  while(bound>0 && width<=widest) {
+
+    Pebbling *p=beamsearch(g,bound,persistent_pebbling,width,weight,opts,&visited_count);
+
+    if (p) {
+      if (best) dispose_Pebbling(best);
+      best=p;
+      if (opts->report)
+        fprintf(opts->report,"c Beam search (width %u): %s of cost %d and length %zu\n",
+                width,pebbling_type(),best->cost,best->length);
+      bound=(unsigned int)best->cost-1;
+      width=opts->beam_width;               /* The narrow beams are faster */
+    } else if (opts->limit) {
+      break;
+    } else {
+      width *= 2;
+    }
+  }
+
+  if (opts->limit && opts->report)
+    fprintf(opts->report,"c Beam search stopped: %s limit exceeded\n",opts->limit);
+
+  free(weight);
+  return best;
+}
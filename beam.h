@@ -0,0 +1,36 @@
+/*
+   Description::
+
+   Beam search for pebblings, a heuristic for the graphs out of reach
+   of the exact search. Header for beam.c
+
+*/
+
+
+/* Preamble */
+#ifndef  BEAM_H
+#define  BEAM_H
+
+#include "common.h"
+#include "variant.h"
+#include "dag.h"
+#include "pebbling.h"
+#include "bfs.h"
+
+
+/* Code */
+
+/* Times the width of the beam is doubled after a failure */
+#define BEAM_WIDENINGS 6
+
+/* Anytime search: the best pebbling found within the bound is
+   improved, by searching again below its cost, until the deadline in
+   `opts->limits' or until the widest beam fails.  Each improvement is
+   reported on `opts->report'.  The absence of a pebbling is not a
+   proof, so the search is always marked as approximate. */
+extern Pebbling* beam_pebbling_strategy(const DAG *digraph,
+                                        unsigned int upper_bound,
+                                        Boolean persistent_pebbling,
+                                        BFSOptions *opts);
+
+#endif /* BEAM_H */
@@ -18,7 +18,11 @@
 #include "dsbasic.h"
 #include "pebbling.h"
 #include "hashtable.h"
+#include "bitstate.h"
+#include "zdd.h"
 #include "statistics.h"
+#include "checkpoint.h"
+#include "bfs.h"
 
 extern void print_dot_PebbleConfiguration(const DAG *g, const PebbleConfiguration *peb,
                                           char *name,char* options);
@@ -85,6 +89,95 @@ void  freePebbleConfiguration(void *data) {
 }
 
 
+/*
+ * Configurations which are not owned by the dictionary (e.g. with
+ * bitstate hashing) are freed as soon as they have been processed and
+ * no queued configuration descends from them.  The reference counter
+ * of a configuration is the number of its queued descendants which
+ * point to it, plus one while the configuration is queued itself.
+ */
+static void releasePebbleConfiguration(PebbleConfiguration *ptr) {
+
+  PebbleConfiguration *prev=NULL;
+
+  while(ptr!=NULL) {
+    assert(ptr->references>0);
+    ptr->references--;
+    if (ptr->references>0) return;
+    prev=ptr->previous_configuration;
+    dispose_PebbleConfiguration(ptr);
+    ptr=prev;
+  }
+}
+
+
+/*
+ * Counting the shortest pebblings.  The number of shortest paths to a
+ * configuration is the sum of the numbers of its predecessors in the
+ * previous level, so only the counts of two levels are needed: the
+ * one being processed, and the next one.  The records hold a copy of
+ * the pebbles, since without the dictionary the configurations of the
+ * processed level may be freed before the level is over.
+ */
+#define LAYER_HASHSIZE  (HASH_TABLE_SPACE_SIZE>>3)
+
+typedef struct {
+
+#if BLACK_WHITE_PEBBLING
+  BitTuple white_pebbled;
+#endif
+  BitTuple black_pebbled;
+  Boolean  sink_touched;
+
+  PebblingCount paths;
+
+} PathCount;
+
+static size_t hashPathCount(void *data) {
+  assert(data);
+  PathCount *ptr=(PathCount *)data;
+
+#if BLACK_WHITE_PEBBLING
+  return  (size_t)(ptr->white_pebbled * 0x9e3779b9 + ptr->black_pebbled);
+#else
+  return  (size_t)(ptr->black_pebbled * 0x9e3779b9);
+#endif
+}
+
+static Boolean samePathCount(void *A,void *B) {
+
+  PathCount *pA=(PathCount*)A;
+  PathCount *pB=(PathCount*)B;
+
+#if BLACK_WHITE_PEBBLING
+  if (pA->white_pebbled != pB->white_pebbled) return FALSE;
+#endif
+  return pA->black_pebbled==pB->black_pebbled && pA->sink_touched==pB->sink_touched;
+}
+
+static void setPathCount(PathCount *record,const PebbleConfiguration *c) {
+#if BLACK_WHITE_PEBBLING
+  record->white_pebbled = c->white_pebbled;
+#endif
+  record->black_pebbled = c->black_pebbled;
+  record->sink_touched  = c->sink_touched;
+}
+
+static Dict *newPathCountDict(void) {
+  Dict *d=newDict(LAYER_HASHSIZE);
+  d->key_function     = hashPathCount;
+  d->eq_function      = samePathCount;
+  d->dispose_function = free;
+  return d;
+}
+
+static inline void addPebblingCount(PebblingCount *a,const PebblingCount *b) {
+  a->residue  += b->residue;
+  a->overflow |= b->overflow || a->residue < b->residue;
+  a->estimate += b->estimate;
+}
+
+
 /*
  * Runtime consistency checks. 
  *
@@ -361,6 +454,266 @@ Pebbling *finalize_reversible_pebbling(const DAG *graph,
 
 
 
+/*
+ * Memory used by the set of visited configurations.  The dictionary
+ * owns the configurations, each of them in a list handle, in the
+ * lists of the buckets in use.  The empty buckets, allocated once for
+ * all the searches, are not counted, and neither is the free part of
+ * the tables of the ZDD.  The bitstate table is all in use.
+ */
+static inline size_t visited_memory(const Dict *D,const BitState *B,const ZDD *Z,
+                                    Counter configurations) {
+  if (D) return D->used_count * sizeof(LinkedList) +
+           configurations * (sizeof(PebbleConfiguration) + sizeof(struct LinkedListHandle));
+  if (B) return B->bits / CHAR_BIT;
+  if (Z) return memoryZDD(Z);
+  return 0;
+}
+
+
+/**************************************
+ * Checkpoints
+ **************************************/
+
+#if REVERSIBLE_PEBBLING
+#define CHECKPOINT_VARIANT "rev"
+#elif BLACK_WHITE_PEBBLING
+#define CHECKPOINT_VARIANT "bw"
+#else
+#define CHECKPOINT_VARIANT "black"
+#endif
+
+/*
+ * After the header, a checkpoint contains the statistics, the visited
+ * configurations and the queue, as indices of the configurations.
+ * The configurations are listed bucket by bucket, in the order of
+ * the buckets, so that the dictionary rebuilt with the same size has
+ * the same lists, and the search continues exactly as before.
+ */
+typedef struct {
+
+  BitTuple white_pebbled;
+  BitTuple black_pebbled;
+  BitTuple used_pebbles;
+  Counter  previous;            /* Index plus one, 0 for none */
+  Counter  last_changed_vertex;
+  Counter  pebbles;
+  Counter  sink_touched;
+
+} CheckpointRecord;
+
+typedef struct {
+  const PebbleConfiguration *ptr;
+  Counter index;
+} CheckpointIndex;
+
+static int compareindices(const void *a,const void *b) {
+  const PebbleConfiguration *x=((const CheckpointIndex*)a)->ptr;
+  const PebbleConfiguration *y=((const CheckpointIndex*)b)->ptr;
+  return (x>y) - (x<y);
+}
+
+static Counter findindex(const CheckpointIndex *map,Counter n,const PebbleConfiguration *ptr) {
+  CheckpointIndex key;
+  key.ptr=ptr;
+  const CheckpointIndex *r=(const CheckpointIndex*)bsearch(&key,map,n,sizeof(CheckpointIndex),compareindices);
+  assert(r);
+  return r->index;
+}
+
+static void initheader(CheckpointHeader *h,const DAG *g,Dict *D,
+                       unsigned int upper_bound,Boolean persistent_pebbling) {
+
+  memset(h,0,sizeof(CheckpointHeader));
+  strcpy(h->variant,CHECKPOINT_VARIANT);
+  h->vertices        = g->size;
+  h->graph           = hash_DAG(g);
+  h->bound           = upper_bound;
+  h->persistent      = persistent_pebbling;
+  h->dict_allocation = D->allocation;
+  h->dict_size       = D->size;
+}
+
+/* Number of moves from the initial configuration */
+static long configurationdepth(const PebbleConfiguration *c) {
+  long d=-1;
+  for(;c;c=c->previous_configuration) d++;
+  return d;
+}
+
+/*
+ * Save the state of the search, at the beginning of the processing
+ * of the head of the queue.  The file is replaced only when the new
+ * checkpoint is complete.
+ */
+static Boolean writecheckpoint(const char *path,const DAG *g,Dict *D,Queue *Q,
+                               const Statistic *Stat,
+                               unsigned int upper_bound,Boolean persistent_pebbling) {
+
+  CheckpointHeader h;
+  LinkedList       cur;
+  initheader(&h,g,D,upper_bound,persistent_pebbling);
+
+  for(size_t b=0;b<D->used_count;b++) {
+    LinkedList *l=D->buckets[D->used[b]];
+    for(forkcursorSL(l,&cur),resetSL(&cur);iscursorvalidSL(&cur);nextSL(&cur)) h.configurations++;
+  }
+  for(forkcursorSL(Q,&cur),resetSL(&cur);iscursorvalidSL(&cur);nextSL(&cur)) h.queued++;
+
+  /* Index of each configuration */
+  CheckpointIndex *map=(CheckpointIndex*)malloc((h.configurations+1)*sizeof(CheckpointIndex));
+  assert(map);
+  Counter n=0;
+  for(size_t b=0;b<D->used_count;b++) {
+    LinkedList *l=D->buckets[D->used[b]];
+    for(forkcursorSL(l,&cur),resetSL(&cur);iscursorvalidSL(&cur);nextSL(&cur)) {
+      map[n].ptr=(const PebbleConfiguration*)getSL(&cur);
+      map[n].index=n;
+      n++;
+    }
+  }
+  qsort(map,n,sizeof(CheckpointIndex),compareindices);
+
+  size_t len=strlen(path)+5;
+  char  *temp=(char*)malloc(len);
+  assert(temp);
+  snprintf(temp,len,"%s.tmp",path);
+
+  FILE *f=fopen(temp,"wb");
+  Boolean ok = (f!=NULL);
+
+  if (ok) {
+    CheckpointRecord r;
+    ok = write_CheckpointHeader(f,&h);
+    ok = ok && fwrite(Stat,sizeof(Statistic),1,f)==1;
+
+    for(size_t b=0;ok && b<D->used_count;b++) {
+      LinkedList *l=D->buckets[D->used[b]];
+      for(forkcursorSL(l,&cur),resetSL(&cur);ok && iscursorvalidSL(&cur);nextSL(&cur)) {
+        const PebbleConfiguration *c=(const PebbleConfiguration*)getSL(&cur);
+        memset(&r,0,sizeof(r));
+#if BLACK_WHITE_PEBBLING
+        r.white_pebbled = c->white_pebbled;
+#endif
+        r.black_pebbled = c->black_pebbled;
+        r.used_pebbles  = c->used_pebbles;
+        r.previous      = c->previous_configuration ?
+          findindex(map,n,c->previous_configuration)+1 : 0;
+        r.last_changed_vertex = c->last_changed_vertex;
+        r.pebbles       = c->pebbles;
+        r.sink_touched  = c->sink_touched;
+        ok = fwrite(&r,sizeof(r),1,f)==1;
+      }
+    }
+    for(forkcursorSL(Q,&cur),resetSL(&cur);ok && iscursorvalidSL(&cur);nextSL(&cur)) {
+      Counter index=findindex(map,n,(const PebbleConfiguration*)getSL(&cur));
+      ok = fwrite(&index,sizeof(index),1,f)==1;
+    }
+    ok = ok && fwrite(&h.configurations,sizeof(Counter),1,f)==1;  /* Trailer */
+    ok = (fclose(f)==0) && ok;
+    ok = ok && rename(temp,path)==0;
+    if (!ok) remove(temp);
+  }
+
+  free(temp);
+  free(map);
+  return ok;
+}
+
+/*
+ * Rebuild the dictionary and the queue of a checkpoint.  Return NULL
+ * and set the error if the checkpoint does not fit the search.
+ */
+static Dict *readcheckpoint(const char *path,const DAG *g,Dict *reuse,Queue *Q,
+                            Statistic *Stat,unsigned int upper_bound,Boolean persistent_pebbling,
+                            Counter *configurations,const char **error) {
+
+  CheckpointHeader h,expected;
+  FILE *f=fopen(path,"rb");
+  if (f==NULL) { *error="unable to open the checkpoint"; return NULL; }
+
+  if (!read_CheckpointHeader(f,&h)) {
+    fclose(f);
+    *error="invalid checkpoint";
+    return NULL;
+  }
+
+  /* Same search, and a dictionary with the same layout */
+  Dict *D = (reuse && reuse->size==h.dict_size) ? reuse
+    : newDictWithSize(h.dict_allocation,h.dict_size);
+  initheader(&expected,g,D,upper_bound,persistent_pebbling);
+  if (strcmp(h.variant,expected.variant)!=0 || h.vertices!=expected.vertices ||
+      h.graph!=expected.graph || h.bound!=expected.bound ||
+      h.persistent!=expected.persistent) {
+    fclose(f);
+    if (D!=reuse) disposeDict(D);
+    *error="the checkpoint is for another graph or another search";
+    return NULL;
+  }
+  D->key_function = hashPebbleConfiguration;
+  D->eq_function  = samePebbleConfiguration;
+  D->dispose_function = freePebbleConfiguration;
+
+  Boolean ok = fread(Stat,sizeof(Statistic),1,f)==1;
+
+  PebbleConfiguration **conf=(PebbleConfiguration**)malloc((h.configurations+1)*sizeof(PebbleConfiguration*));
+  Counter *previous=(Counter*)malloc((h.configurations+1)*sizeof(Counter));
+  assert(conf && previous);
+
+  CheckpointRecord r;
+  Counter n=0;
+  for(;ok && n<h.configurations;n++) {
+    ok = fread(&r,sizeof(r),1,f)==1 && r.previous<=h.configurations &&
+      r.last_changed_vertex<g->size;
+    if (!ok) break;
+    PebbleConfiguration *c=new_PebbleConfiguration();
+#if BLACK_WHITE_PEBBLING
+    c->white_pebbled = r.white_pebbled;
+#endif
+    c->black_pebbled = r.black_pebbled;
+    c->used_pebbles  = r.used_pebbles;
+    c->last_changed_vertex = r.last_changed_vertex;
+    c->pebbles       = (unsigned int)r.pebbles;
+    c->sink_touched  = r.sink_touched ? TRUE : FALSE;
+    c->previous_configuration = NULL;
+    reset_active_PebbleConfiguration(g,c);
+    conf[n]=c;
+    previous[n]=r.previous;
+  }
+
+  DictQueryResult res;
+  for(Counter i=0;i<n;i++) {
+    if (previous[i]) conf[i]->previous_configuration=conf[previous[i]-1];
+    if (ok) {
+      queryDict(D,&res,conf[i]);
+      ok = (res.value==NULL);
+    }
+    if (ok) unsafe_noquery_writeDict(D,&res,conf[i]);
+    else    dispose_PebbleConfiguration(conf[i]);
+  }
+
+  Counter index;
+  for(Counter i=0;ok && i<h.queued;i++) {
+    ok = fread(&index,sizeof(index),1,f)==1 && index<h.configurations;
+    if (ok) enqueue(Q,conf[index]);
+  }
+  ok = ok && fread(&index,sizeof(index),1,f)==1 && index==h.configurations;
+  fclose(f);
+  free(conf);
+  free(previous);
+
+  if (!ok) {
+    /* The configurations are all in the dictionary, or disposed */
+    while(!isemptySL(Q)) { resetSL(Q); pop(Q); }
+    if (D==reuse) clearDict(D); else disposeDict(D);
+    *error="the checkpoint is truncated or corrupted";
+    return NULL;
+  }
+  *configurations=h.configurations;
+  return D;
+}
+
+
 /**
    Explore the space of pebbling strategies.
 
@@ -380,8 +733,22 @@ Pebbling *finalize_reversible_pebbling(const DAG *graph,
    configurations, thus we produce configurations on demand.  We use a
    dictionary to keep track of previously visited configurations.
 
-   N.B. As a future option: we could use a ZDD  for keeping track of
-   visited configurations.
+   When the dictionary would not fit in memory, visited configurations
+   can be recorded with bitstate hashing instead (see bitstate.c). The
+   search is then approximate: a configuration may be wrongly
+   considered as visited, so the search may miss every pebbling within
+   the bound.  A pebbling which is found is checked by replaying it.
+
+   Visited configurations can also be kept in a ZDD (see zdd.c), which
+   is exact and shares the structure among similar configurations.
+
+   On request the search counts the shortest pebblings: the number of
+   shortest paths to each configuration is accumulated level by level,
+   and the search completes the level of the first final configuration
+   before stopping.  The heuristic cuts of the moves depend on the path
+   to a configuration, so the counting search explores all the legal
+   moves.  The count is on the moves of the search, before the final
+   clean up of the pebbling.
    
    INPUT:
 
@@ -396,6 +763,10 @@ Pebbling *finalize_reversible_pebbling(const DAG *graph,
    pebbling number for a pebbling which leaves a black pebble in the
    sink.
 
+   @param opts: the options of the search (NULL for defaults).  On
+   return it tells whether the search was approximate, and the
+   estimated probability of omissions.
+
    OUTPUT:
 
    The output is given as a sequence of vertices, because at any point
@@ -415,55 +786,148 @@ Pebbling *finalize_reversible_pebbling(const DAG *graph,
    @return a pebbling if exists, NULL otherwise.
 
  */
-Pebbling *bfs_pebbling_strategy(DAG *g,
-                                           unsigned int upper_bound,
-                                           Boolean persistent_pebbling) {
+Pebbling *bfs_pebbling_strategy(const DAG *g,
+                                unsigned int upper_bound,
+                                Boolean persistent_pebbling,
+                                BFSOptions *opts) {
 
   /* PROLOGUE ----------------------------------- */
+  BFSOptions default_opts;
+  if (opts==NULL) {
+    init_BFSOptions(&default_opts);
+    opts=&default_opts;
+  }
+  opts->approximate = (opts->visited==VISITED_BITSTATE);
+  opts->omission_probability = 0.0;
+  opts->expected_omissions   = 0.0;
+  opts->error = NULL;
+  opts->limit = NULL;
+  opts->depth = -1;
+  opts->pebblings.residue  = 0;
+  opts->pebblings.estimate = 0.0;
+  opts->pebblings.overflow = FALSE;
+
   if (g->size > BITTUPLE_SIZE) {
-    fprintf(stderr,
-            "Error in search procedure: the graph is too "
-            "big for the optimized data structures.");
-    exit(EXIT_FAILURE);
+    opts->error = "the graph is too big for the optimized data structures";
+    return NULL;
   }
 
   if (g->sink_number!=1) {
-    fprintf(stderr,
-            "Error in search procedure: the graph has more than "
-            "one sink vertex.");
-    exit(EXIT_FAILURE);
+    opts->error = "the graph has more than one sink vertex";
+    return NULL;
   }
 
   if (upper_bound < 1) { return NULL; } /* No pebbling with zero pebbles */
 
+  if ((opts->checkpoint || opts->resume) && opts->visited!=VISITED_DICT) {
+    opts->error = "checkpoints need the dictionary of visited configurations";
+    return NULL;
+  }
+
+  if (opts->count && opts->visited==VISITED_BITSTATE) {
+    opts->error = "counting the pebblings needs an exact set of visited configurations";
+    return NULL;
+  }
+
+  if (opts->count && (opts->checkpoint || opts->resume)) {
+    opts->error = "checkpoints do not keep the counts of the pebblings";
+    return NULL;
+  }
+
   
 #if (!BLACK_WHITE_PEBBLING && !REVERSIBLE_PEBBLING)
   persistent_pebbling = 0;
 #endif
   
   /* Collect statistic on the running */
-  STATS_CREATE(Stat);
+  Statistic  local_stats;
+  Statistic *Stat = opts->stats ? opts->stats : &local_stats;
+  STATS_RESET(*Stat);
+  (void)Stat;
 
   /* END OF PROLOGUE ----------------------------------- */
   
 
   /* Data structures for BFS */
-  PebbleConfiguration *initial=new_PebbleConfiguration();
+  PebbleConfiguration *initial=NULL;
   Queue               *Q=newSL();
-  Dict *D = newDict(HASH_TABLE_SPACE_SIZE);
+  Dict                *D=NULL;
+  BitState            *B=NULL;
+  ZDD                 *Z=NULL;
 
-  /* Dictionary setup */
   DictQueryResult res;
-  D->key_function = hashPebbleConfiguration;
-  D->eq_function  = samePebbleConfiguration;
-  D->dispose_function = freePebbleConfiguration;
-  
+  BitTuple        key[2];
+  unsigned int    width=packedwidth_PebbleConfiguration(g);
+  Boolean         visited;
+
+  /* Levels of the search: the configurations of the current level are
+     the ones queued before the `level_end'-th, and the resource limits
+     are checked on the number of visited configurations. */
+  long    level=0;
+  Counter processed_count=0,queued_count=1,level_end=1;
+  Counter visited_count=1;
+
+  /* Counts of the shortest paths to the configurations of the current
+     and of the next level, and the records of the final ones */
+  Dict          *current=NULL,*next=NULL;
+  LinkedList    *finals=NULL;
+  PathCount      pathkey,*record=NULL;
+  PebblingCount  paths;
+  DictQueryResult pres;
+
+  if (opts->visited==VISITED_BITSTATE) {
+    /* Bitstate setup */
+    B = newBitState(opts->bitstate_memory,opts->bitstate_hashes);
+  } else if (opts->visited==VISITED_ZDD) {
+    /* Decision diagram setup */
+    Z = newZDD(ZDD_DEFAULT_NODES);
+  } else if (opts->resume) {
+    /* Dictionary and queue of the checkpoint */
+    D = readcheckpoint(opts->resume,g,opts->dict,Q,Stat,
+                       upper_bound,persistent_pebbling,&visited_count,&opts->error);
+    if (D==NULL) {
+      disposeSL(Q);
+      return NULL;
+    }
+  } else {
+    /* Dictionary setup, or reuse of the one given by the caller */
+    D = opts->dict ? opts->dict : newDict(HASH_TABLE_SPACE_SIZE);
+    assert(D->used_count==0);
+    D->key_function = hashPebbleConfiguration;
+    D->eq_function  = samePebbleConfiguration;
+    D->dispose_function = freePebbleConfiguration;
+  }
+
   /* Initial configuration for the BFS */
-  enqueue  (Q,initial);
-  writeDict(D,&res,initial);
+  if (!opts->resume) {
+    initial=new_PebbleConfiguration();
+    reset_active_PebbleConfiguration(g,initial);
 #if BLACK_WHITE_PEBBLING || REVERSIBLE_PEBBLING
-  if (persistent_pebbling) {  init_persistent_pebbling(g, initial); }
+    if (persistent_pebbling) {  init_persistent_pebbling(g, initial); }
 #endif
+    enqueue  (Q,initial);
+    if (D) {
+      writeDict(D,&res,initial);
+    } else {
+      pack_PebbleConfiguration(g,initial,key);
+      if (B) testandsetBitState(B,key,width);
+      if (Z) testandsetZDD(Z,key,width);
+      initial->references=1;
+    }
+  }
+
+  if (opts->count) {
+    current = newPathCountDict();
+    next    = newPathCountDict();
+    finals  = newSL();
+    record  = (PathCount*)malloc(sizeof(PathCount));
+    assert(record);
+    setPathCount(record,initial);
+    record->paths.residue  = 1;
+    record->paths.estimate = 1.0;
+    record->paths.overflow = FALSE;
+    writeDict(current,&pres,record);
+  }
 
 
   PebbleConfiguration *ptr  =NULL;    /* Configuration to be processed */
@@ -478,51 +942,131 @@ Pebbling *bfs_pebbling_strategy(DAG *g,
     isfinal = isfinal_visiting;
   
   /* Consistency test of data structures */
-  assert(isconsistentDict(D));
+  assert(D==NULL || isconsistentDict(D));
   assert(isconsistentSL(Q));
 
-  STATS_SET(Stat,first_queuing,1);
-  STATS_SET(Stat,queued,1);
-  STATS_SET(Stat,dict_size,D->size);
+  if (!opts->resume) {
+    STATS_SET(*Stat,first_queuing,1);
+    STATS_SET(*Stat,queued,1);
+    STATS_SET(*Stat,dict_size,D ? D->size : 0);
+  } else {
+    /* The queue holds the end of a level, and maybe the beginning of
+       the next one */
+    LinkedList cur;
+    queued_count=level_end=0;
+    level=configurationdepth((PebbleConfiguration*)Q->head->data);
+    for(forkcursorSL(Q,&cur),resetSL(&cur);iscursorvalidSL(&cur);nextSL(&cur)) {
+      queued_count++;
+      if (level_end+1==queued_count &&
+          configurationdepth((PebbleConfiguration*)getSL(&cur))==level) level_end++;
+    }
+  }
 
   /* The breadth-first-search on the space of pebbling configurations.*/
   for(resetSL(Q); !isemptySL(Q); pop(Q)) {
 
-    if (STATS_TIMER_OFF) {
-      STATS_CLOCK_UPDATE(Stat);
-      STATS_REPORT(Stat,
+    if (STATS_TIMER_OFF(opts->report_flag)) {
+      STATS_CLOCK_UPDATE(*Stat,opts->report_interval);
+      STATS_SET(*Stat,zdd_nodes,Z ? Z->size : 0);
+      STATS_SET(*Stat,visited_memory,
+                visited_memory(D,B,Z,STATS_GET(*Stat,first_queuing_T)+STATS_GET(*Stat,first_queuing)));
+      STATS_REPORT(opts->report,*Stat,
                    "\nClock %llu: Report for graph on %zu vertices, upper bound=%u:\n",
-                   STATS_GET(Stat,clock),
+                   STATS_GET(*Stat,clock),
                    g->size,
                    upper_bound);
-      STATS_TIMER_RESET();
+      STATS_TIMER_RESET(opts->report_flag);
+    }
+
+    if (opts->checkpoint && opts->checkpoint_flag && *opts->checkpoint_flag) {
+      *opts->checkpoint_flag=0;
+      Boolean saved=writecheckpoint(opts->checkpoint,g,D,Q,Stat,upper_bound,persistent_pebbling);
+      if (opts->report) fprintf(opts->report,
+                                saved ? "c Checkpoint saved in %s\n"
+                                      : "c Checkpoint: unable to write %s\n",
+                                opts->checkpoint);
+    }
+
+    if ((processed_count & GOVERNOR_PERIOD)==0 &&
+        (opts->limit=exceeded_ResourceLimits(&opts->limits,visited_count))) {
+      break;
+    }
+
+    if (processed_count==level_end) {     /* The previous level is complete */
+      if (final) goto epilogue;           /* ...and all its paths to the final ones */
+      level++;
+      level_end=queued_count;
+      if (opts->count) {
+        Dict *swap=current;
+        clearDict(current);
+        current=next;
+        next=swap;
+      }
     }
 
     /* Get an element from the queue */
     ptr=(PebbleConfiguration*)getSL(Q);
     assert(isconsistent_PebbleConfiguration(g,ptr));
     assert(!isfinal(g,ptr));
-    STATS_INC(Stat,processed);
+    STATS_INC(*Stat,processed);
+    processed_count++;
+
+    if (opts->count) {
+      setPathCount(&pathkey,ptr);
+      queryDict(current,&pres,&pathkey);
+      assert(pres.value);
+      paths=((PathCount*)pres.value)->paths;
+    }
 
     /* Explore all configurations reachable in one step.  */
-    for(Vertex v=0;v<g->size;v++) {
+    for(BitTuple moves=enabled_PebbleConfiguration(g,ptr,upper_bound); moves; moves &= moves-1) {
 
-      nptr=next_PebbleConfiguration(v,g,ptr,upper_bound);
+      Vertex v=LOWESTBIT(moves);
+      nptr=opts->count ? nextall_PebbleConfiguration(v,g,ptr,upper_bound)
+                       : next_PebbleConfiguration(v,g,ptr,upper_bound);
       if (nptr==NULL) continue; /* Step corresponding to vertex v is invalid/useless */
 
-      STATS_INC(Stat,offspring);
-
-      /* Find out if it has already been encountered (check in the dictionary) */
-      queryDict(D,&res,nptr);
-      STATS_INC(Stat,dict_queries);
-      STATS_ADD(Stat,dict_hops,res.hops);
+      STATS_INC(*Stat,offspring);
+
+      /* Find out if it has already been encountered (check in the
+         dictionary, or in the bitstate table) */
+      if (D) {
+        queryDict(D,&res,nptr);
+        STATS_ADD(*Stat,dict_hops,res.hops);
+        visited = (res.value!=NULL);
+      } else {
+        pack_PebbleConfiguration(g,nptr,key);
+        visited = B ? testandsetBitState(B,key,width) : testandsetZDD(Z,key,width);
+      }
+      STATS_INC(*Stat,dict_queries);
 
-      if (res.value==NULL)  {  /* A configuration never encountered before */
+      if (!visited)  {  /* A configuration never encountered before */
 
         nptr->previous_configuration = ptr;  /* It's origin */
         nptr->last_changed_vertex = v;
 
-        unsafe_noquery_writeDict(D,&res,nptr); /* Mark as encountered (put in the dictionary) */
+        visited_count++;
+        if (D) {
+          unsafe_noquery_writeDict(D,&res,nptr); /* Mark as encountered (put in the dictionary) */
+        } else {
+          ptr->references++;                     /* Keep the origin alive */
+          nptr->references=1;
+        }
+
+        if (opts->count) {                     /* First path to the configuration */
+          record=(PathCount*)malloc(sizeof(PathCount));
+          assert(record);
+          setPathCount(record,nptr);
+          record->paths=paths;
+          writeDict(next,&pres,record);
+        }
+
+        if (isfinal(g,nptr) && opts->count) { /* The level must be completed */
+          enqueue(finals,record);
+          if (final==NULL)  final=nptr;
+          else if (!D)      releasePebbleConfiguration(nptr);
+          continue;
+        }
 
         if (isfinal(g,nptr)) {               /* Is it the end of the search? */
           final=nptr;
@@ -530,25 +1074,49 @@ Pebbling *bfs_pebbling_strategy(DAG *g,
         }
 
         enqueue(Q,nptr);                       /* Put in queue for later processing */
-        STATS_INC(Stat,queued);
-        STATS_INC(Stat,first_queuing);
+        queued_count++;
+        STATS_INC(*Stat,queued);
+        STATS_INC(*Stat,first_queuing);
 
-        STATS_INC(Stat,dict_misses);
-        STATS_INC(Stat,dict_writes);
+        STATS_INC(*Stat,dict_misses);
+        STATS_INC(*Stat,dict_writes);
 
       } else {                                 /* Already encountered. No new information. */
-        STATS_INC(Stat,suboptimal);
+        if (opts->count) {                     /* ...but maybe another shortest path */
+          setPathCount(&pathkey,nptr);
+          queryDict(next,&pres,&pathkey);
+          if (pres.value) addPebblingCount(&((PathCount*)pres.value)->paths,&paths);
+        }
+        STATS_INC(*Stat,suboptimal);
         dispose_PebbleConfiguration(nptr);
       }
 
     } /* End of neighborhood exploration */
 
+    if (!D) releasePebbleConfiguration(ptr);
+
   }/* queue of configurations is empty, end of BFS */
 
+  if (opts->limit==NULL && final==NULL) level++;  /* The last level is complete too */
 
   Pebbling *solution=NULL;
   
 epilogue:
+
+  opts->depth=level-1;
+  if (opts->limit && opts->report)
+    fprintf(opts->report,"c Search stopped: %s limit exceeded, "
+            "levels up to %ld fully explored\n",opts->limit,opts->depth);
+
+  if (opts->count) {
+    if (opts->limit==NULL)
+      for(resetSL(finals); !isemptySL(finals); pop(finals))
+        addPebblingCount(&opts->pebblings,&((PathCount*)getSL(finals))->paths);
+    while(!isemptySL(finals)) { resetSL(finals); pop(finals); }
+    disposeSL(finals);
+    disposeDict(current);
+    disposeDict(next);
+  }
   
   /* To get a formally correct pebbling we need to give final touch. */
   if (persistent_pebbling) {
@@ -563,19 +1131,51 @@ epilogue:
 #endif
   }
 
-  
-  STATS_REPORT(Stat,"\nFINAL REPORT (clk. %llu): upper bound=%u:\n\n",
-               STATS_GET(Stat,clock),
+
+  STATS_SET(*Stat,zdd_nodes,Z ? Z->size : 0);
+  STATS_SET(*Stat,visited_memory,
+            visited_memory(D,B,Z,STATS_GET(*Stat,first_queuing_T)+STATS_GET(*Stat,first_queuing)));
+  STATS_REPORT(opts->report,*Stat,"\nFINAL REPORT (clk. %llu): upper bound=%u:\n\n",
+               STATS_GET(*Stat,clock),
                upper_bound);
 
+  /* A pebbling found with bitstate hashing is checked before being
+     reported. Exact search must always give valid pebblings. */
+  if (B && solution && !isvalid_Pebbling(g,solution,persistent_pebbling)) {
+    if (opts->report) fprintf(opts->report,"Error in search procedure: the pebbling found "
+                              "with bitstate hashing is not valid, discarded.\n");
+    dispose_Pebbling(solution);
+    solution=NULL;
+  }
+  assert(solution==NULL || isvalid_Pebbling(g,solution,persistent_pebbling));
+
+  if (B) {
+    opts->omission_probability = falsepositiveBitState(B);
+    opts->expected_omissions   = B->omissions;
+  }
+
 #ifdef HASHTABLE_DEBUG
-  assert(!CheckRuntimeConsistency(g,D));
+  assert(D==NULL || !CheckRuntimeConsistency(g,D));
 #endif
 
 
   /* Free the memory of the data structures */
+  if (D && D==opts->dict) {
+    clearDict(D);
+  } else if (D) {
+    disposeDict(D);
+  } else {
+    if (final) {
+      final->references=1;
+      releasePebbleConfiguration(final);
+    }
+    for(resetSL(Q); !isemptySL(Q); pop(Q)) {
+      releasePebbleConfiguration((PebbleConfiguration*)getSL(Q));
+    }
+    if (B) disposeBitState(B);
+    if (Z) disposeZDD(Z);
+  }
   if (Q) disposeSL(Q);
-  disposeDict(D);
 
   return solution;
 }
@@ -16,14 +16,135 @@
 #ifndef  BFS_H
 #define  BFS_H
 
+#include <stdio.h>
+#include <signal.h>
+#include <assert.h>
+
 #include "common.h"
+#include "variant.h"
 #include "dag.h"
 #include "pebbling.h"
+#include "statistics.h"
+#include "hashtable.h"
+#include "governor.h"
 
 
 /* Code */
-extern Pebbling* bfs_pebbling_strategy(DAG *digraph,
+
+/* Data structure keeping track of visited configurations */
+typedef enum {
+  VISITED_DICT,          /* Exact: dictionary of configurations */
+  VISITED_BITSTATE,      /* Approximate: bitstate hashing */
+  VISITED_ZDD            /* Exact: zero-suppressed decision diagram */
+} VisitedSet;
+
+#define BITSTATE_DEFAULT_MEMORY (512*1024*1024)
+#define BITSTATE_DEFAULT_HASHES 3
+#define ZDD_DEFAULT_NODES       0x100000
+#define BEAM_DEFAULT_WIDTH      64
+
+/* Number of shortest pebblings.  The exact number is kept modulo 2^64
+   in `residue', and is exactly `residue' when there is no `overflow'.
+   The `estimate' is its floating point value.  */
+typedef struct {
+
+  Counter residue;
+  double  estimate;
+  Boolean overflow;
+
+} PebblingCount;
+
+/* Options for the search.  The last fields are filled by the search
+   and tell how reliable is a negative answer, or why the search could
+   not be performed.
+
+   The search has no global state: the statistics go in `stats' (if
+   not NULL), and a report of them is printed on `report' (if not
+   NULL) whenever `*report_flag' is set, e.g. by the timer in
+   timedflags.c.  */
+typedef struct {
+
+  VisitedSet   visited;
+  size_t       bitstate_memory;   /* Bytes for the bitstate table */
+  unsigned int bitstate_hashes;   /* Bits set for each configuration */
+  Dict        *dict;              /* Empty dictionary to be reused, or NULL */
+  unsigned int beam_width;        /* Initial width of the beam search */
+
+  Statistic    *stats;
+  FILE         *report;
+  volatile sig_atomic_t *report_flag;
+  unsigned int  report_interval;  /* Seconds between two reports */
+
+  Boolean      approximate;            /* Configurations may be omitted */
+  double       omission_probability;   /* For a single configuration */
+  double       expected_omissions;     /* Over the whole search */
+
+  /* Checkpoints of the search with the dictionary: the state is saved
+     in `checkpoint' whenever `*checkpoint_flag' is set, and the search
+     starts from the state saved in `resume', if not NULL. */
+  const char  *checkpoint;
+  volatile sig_atomic_t *checkpoint_flag;
+  const char  *resume;
+
+  /* Count the shortest pebblings, in the explicit search with the
+     dictionary or the ZDD.  The count is zero when the search finds no
+     pebbling, or exceeds a limit before completing the count. */
+  Boolean      count;
+  PebblingCount pebblings;
+
+  /* The search stops when a limit is exceeded, and tells which one */
+  ResourceLimits limits;
+  const char  *limit;                  /* NULL if no limit exceeded */
+  long         depth;                  /* Deepest level fully explored */
+
+  const char  *error;                  /* NULL if no error */
+
+} BFSOptions;
+
+/* Default options: exact search with the dictionary. It does not
+   depend on the pebbling variant. */
+static inline void init_BFSOptions(BFSOptions *opts) {
+
+  assert(opts);
+
+  opts->visited          = VISITED_DICT;
+  opts->bitstate_memory  = BITSTATE_DEFAULT_MEMORY;
+  opts->bitstate_hashes  = BITSTATE_DEFAULT_HASHES;
+  opts->dict             = NULL;
+  opts->beam_width       = BEAM_DEFAULT_WIDTH;
+
+  opts->stats            = NULL;
+  opts->report           = NULL;
+  opts->report_flag      = NULL;
+  opts->report_interval  = 0;
+
+  opts->checkpoint       = NULL;
+  opts->checkpoint_flag  = NULL;
+  opts->resume           = NULL;
+
+  opts->count                = FALSE;
+  opts->pebblings.residue    = 0;
+  opts->pebblings.estimate   = 0.0;
+  opts->pebblings.overflow   = FALSE;
+
+  init_ResourceLimits(&opts->limits);
+  opts->limit            = NULL;
+  opts->depth            = -1;
+
+  opts->approximate          = FALSE;
+  opts->omission_probability = 0.0;
+  opts->expected_omissions   = 0.0;
+  opts->error                = NULL;
+}
+
+/* Turn the path to a final configuration into a complete pebbling */
+extern Pebbling* finalize_pebbling(const DAG *graph,PebbleConfiguration *final);
+extern Pebbling* finalize_persistent_pebbling(const DAG *graph,PebbleConfiguration *final);
+extern Pebbling* finalize_reversible_pebbling(const DAG *graph,PebbleConfiguration *final);
+
+extern Pebbling* bfs_pebbling_strategy(const DAG *digraph,
                                        unsigned int upper_bound,
-                                       Boolean persistent_pebbling);
+                                       Boolean persistent_pebbling,
+                                       BFSOptions *opts);
 
 #endif /* BFS_H */
@@ -0,0 +1,106 @@
+/*
+   Description::
+
+   Bitstate hashing, as in the supertrace mode of SPIN.  A set of keys
+   is represented by a bitmap where each key sets a small number of
+   bits.  Membership queries may have false positives, and never false
+   negatives.
+
+*/
+
+/* Preamble */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "common.h"
+#include "bitstate.h"
+
+
+#define BITSTATE_RATE_UPDATE 0xFFF
+
+
+/* An invertible mixing function on 64 bits (splitmix64 finalizer) */
+static inline BitTuple mix(BitTuple x) {
+  x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+
+/* Allocates the largest bitmap which fits in the given amount of
+   bytes. */
+BitState *newBitState(size_t bytes,unsigned int hashes) {
+
+  BitState *b=(BitState*)malloc(sizeof(BitState));
+  assert(b);
+  assert(hashes>0);
+
+  size_t bits=BITTUPLE_SIZE;
+  while( (bits << 1) / CHAR_BIT <= bytes ) bits <<= 1;
+
+  b->bits      = bits;
+  b->hashes    = hashes;
+  b->marked    = 0;
+  b->omissions = 0.0;
+  b->fprate    = 0.0;
+  b->table     = (BitTuple*)calloc(bits / BITTUPLE_SIZE,sizeof(BitTuple));
+  assert(b->table);
+
+  return b;
+}
+
+void disposeBitState(BitState *b) {
+  assert(b);
+  free(b->table);
+  free(b);
+}
+
+
+/* Probability that a key never recorded has all its bits set, given
+   the number of recorded keys:  (1 - e^(-kn/m))^k  */
+double falsepositiveBitState(const BitState *b) {
+  assert(b);
+  double fill = 1.0 - exp( -((double)b->hashes * (double)b->marked) / (double)b->bits );
+  return pow(fill,(double)b->hashes);
+}
+
+
+/*
+   Check if the key is (probably) present, and record it anyway.  The
+   bits are chosen by double hashing.
+
+   If the key is reported absent, it was certainly absent.  Each time
+   a key is reported absent we account for the keys which, in the
+   same conditions, would have been wrongly reported present.  The
+   false positive rate is recomputed only once in a while.
+ */
+Boolean testandsetBitState(BitState *b,const BitTuple *key,unsigned int width) {
+
+  assert(b);
+  assert(key);
+  assert(width==1 || width==2);
+
+  BitTuple h1 = mix(key[0] ^ (width==2 ? mix(key[1]) : BITTUPLE_ZERO));
+  BitTuple h2 = mix(h1 ^ 0x9E3779B97F4A7C15ULL) | BITTUPLE_UNIT;
+  BitTuple mask = b->bits - 1;
+  Boolean present = TRUE;
+
+  for(unsigned int i=0;i<b->hashes;i++) {
+    BitTuple bit  = (h1 + i*h2) & mask;
+    BitTuple *word = b->table + (bit / BITTUPLE_SIZE);
+    if (!GETBIT(*word,bit % BITTUPLE_SIZE)) {
+      present=FALSE;
+      SETBIT(*word,bit % BITTUPLE_SIZE);
+    }
+  }
+
+  if (!present) {
+    if ((b->marked & BITSTATE_RATE_UPDATE)==0) b->fprate = falsepositiveBitState(b);
+    b->omissions += b->fprate / (1.0 - b->fprate);
+    b->marked++;
+  }
+  return present;
+}
@@ -0,0 +1,43 @@
+/*
+   Description::
+
+   Bitstate hashing (i.e. a Bloom filter) for approximate sets of
+   visited configurations. Header for bitstate.c
+
+*/
+
+
+/* Preamble */
+#ifndef  BITSTATE_H
+#define  BITSTATE_H
+
+#include <stdlib.h>
+#include "common.h"
+
+/* Code */
+
+/* A configuration is recorded by setting `hashes' bits in a large
+   bitmap.  A configuration never recorded may be reported as present
+   if all its bits are set by other configurations: the search then
+   drops it, and may miss a pebbling.  We keep track of the
+   probability of such omissions. */
+typedef struct {
+
+  size_t        bits;          /* Size of the bitmap (a power of two) */
+  unsigned int  hashes;        /* Bits set for each key */
+  BitTuple     *table;
+
+  Counter       marked;        /* Keys recorded so far */
+  double        omissions;     /* Expected number of omitted keys */
+  double        fprate;        /* Last computed false positive rate */
+
+} BitState;
+
+extern BitState *newBitState(size_t bytes,unsigned int hashes);
+extern void      disposeBitState(BitState *b);
+
+extern Boolean   testandsetBitState(BitState *b,const BitTuple *key,unsigned int width);
+
+extern double    falsepositiveBitState(const BitState *b);
+
+#endif /* BITSTATE_H */
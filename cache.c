@@ -0,0 +1,247 @@
+/*
+   Description::
+
+   Persistent cache of search results.  The key of an entry is a hash
+   of the canonical form of the graph and of the query, so that the
+   result is found again for any relabelling of the graph.  The
+   pebblings are stored with the canonical names of the vertices.
+
+   Each entry is a text file named after the key
+
+       c Pebbling result cache
+       q <variant> <bound> <persistent>
+       g <vertices> <certificate length>
+       <certificate>
+       s SATISFIABLE | UNSATISFIABLE
+       p <cost> <length>
+       <steps>
+
+   where the last two lines are only in satisfiable entries.  The
+   whole certificate is stored, so that a collision of the hash is
+   not mistaken for a hit.  Entries are written in a temporary file
+   and then renamed, so a reader never sees a partial entry.
+
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+/* Preamble */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "common.h"
+#include "dag.h"
+#include "pebbling.h"
+#include "cache.h"
+
+#define CACHE_MAGIC "c Pebbling result cache"
+
+/* Code */
+
+static inline BitTuple fnv1a(BitTuple h,BitTuple x) {
+  for(int i=0;i<8;i++) {
+    h ^= (x >> (8*i)) & 0xFF;
+    h *= 0x100000001B3ULL;
+  }
+  return h;
+}
+
+
+CanonicalDAG *new_CanonicalDAG(const DAG *g) {
+
+  assert(isconsistent_DAG(g));
+
+  CanonicalDAG *c=(CanonicalDAG*)malloc(sizeof(CanonicalDAG));
+  assert(c);
+  c->graph=g;
+  c->label=(Vertex*)malloc(g->size*sizeof(Vertex));
+  c->inverse=(Vertex*)malloc(g->size*sizeof(Vertex));
+  assert(c->label && c->inverse);
+
+  if (!canonical_labelling_DAG(g,c->label)) {
+    free(c->label);
+    free(c->inverse);
+    free(c);
+    return NULL;
+  }
+  for(Vertex v=0;v<g->size;v++) c->inverse[c->label[v]]=v;
+
+  c->certificate=certificate_DAG(g,c->label,&c->length);
+  c->hash=0xCBF29CE484222325ULL;
+  c->hash=fnv1a(c->hash,g->size);
+  for(size_t i=0;i<c->length;i++) c->hash=fnv1a(c->hash,c->certificate[i]);
+
+  return c;
+}
+
+void dispose_CanonicalDAG(CanonicalDAG *c) {
+
+  if (c==NULL) return;
+  free(c->label);
+  free(c->inverse);
+  free(c->certificate);
+  free(c);
+}
+
+
+ResultCache *new_ResultCache(const char *directory) {
+
+  assert(directory);
+
+  struct stat info;
+  if (mkdir(directory,S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH)!=0 && errno!=EEXIST)
+    return NULL;
+  if (stat(directory,&info)!=0 || !S_ISDIR(info.st_mode))
+    return NULL;
+
+  ResultCache *cache=(ResultCache*)malloc(sizeof(ResultCache));
+  assert(cache);
+  cache->directory=(char*)malloc(strlen(directory)+1);
+  assert(cache->directory);
+  strcpy(cache->directory,directory);
+  cache->hits=0;
+  cache->misses=0;
+  cache->stores=0;
+  return cache;
+}
+
+void dispose_ResultCache(ResultCache *cache) {
+
+  if (cache==NULL) return;
+  free(cache->directory);
+  free(cache);
+}
+
+
+/* File name of the entry, to be freed by the caller */
+static char *entrypath(const ResultCache *cache,const CanonicalDAG *c,const CacheQuery *q) {
+
+  BitTuple key=c->hash;
+  key=fnv1a(key,q->variant);
+  key=fnv1a(key,q->bound);
+  key=fnv1a(key,q->persistent);
+
+  size_t len=strlen(cache->directory)+32;
+  char *path=(char*)malloc(len);
+  assert(path);
+  snprintf(path,len,"%s/%016llx.peb",cache->directory,key);
+  return path;
+}
+
+/* Read an entry and check that it matches the graph and the query */
+static Boolean readentry(FILE *f,const CanonicalDAG *c,const CacheQuery *q,
+                         Boolean *found,int *cost,size_t *length,Vertex **steps) {
+
+  char   line[64];
+  int    variant,persistent;
+  unsigned int bound;
+  size_t n,len,x;
+
+  if (fgets(line,sizeof(line),f)==NULL || strncmp(line,CACHE_MAGIC,strlen(CACHE_MAGIC))!=0)
+    return FALSE;
+
+  if (fscanf(f," q %d %u %d",&variant,&bound,&persistent)!=3) return FALSE;
+  if (variant!=(int)q->variant || bound!=q->bound || persistent!=(int)q->persistent)
+    return FALSE;
+
+  if (fscanf(f," g %zu %zu",&n,&len)!=2) return FALSE;
+  if (n!=c->graph->size || len!=c->length) return FALSE;
+  for(size_t i=0;i<len;i++)
+    if (fscanf(f,"%zu",&x)!=1 || x!=c->certificate[i]) return FALSE;
+
+  if (fscanf(f," s %63s",line)!=1) return FALSE;
+  if (strcmp(line,"UNSATISFIABLE")==0) {
+    *found=FALSE;
+    return TRUE;
+  }
+  if (strcmp(line,"SATISFIABLE")!=0) return FALSE;
+
+  if (fscanf(f," p %d %zu",cost,length)!=2 || *length==0) return FALSE;
+  *steps=(Vertex*)malloc(*length*sizeof(Vertex));
+  assert(*steps);
+  for(size_t i=0;i<*length;i++) {
+    if (fscanf(f,"%zu",&x)!=1 || x>=n) {
+      free(*steps);
+      *steps=NULL;
+      return FALSE;
+    }
+    (*steps)[i]=c->inverse[x];
+  }
+  *found=TRUE;
+  return TRUE;
+}
+
+
+Boolean lookup_ResultCache(ResultCache *cache,
+                           const CanonicalDAG *c,
+                           const CacheQuery *q,
+                           Boolean *found,
+                           int *cost,
+                           size_t *length,
+                           Vertex **steps) {
+
+  assert(cache && c && q);
+  assert(found && cost && length && steps);
+
+  *steps=NULL;
+
+  char *path=entrypath(cache,c,q);
+  FILE *f=fopen(path,"r");
+  free(path);
+
+  Boolean hit = f ? readentry(f,c,q,found,cost,length,steps) : FALSE;
+  if (f) fclose(f);
+
+  if (hit) cache->hits++; else cache->misses++;
+  return hit;
+}
+
+
+Boolean store_ResultCache(ResultCache *cache,
+                          const CanonicalDAG *c,
+                          const CacheQuery *q,
+                          const Pebbling *p) {
+
+  assert(cache && c && q);
+
+  char *path=entrypath(cache,c,q);
+  size_t len=strlen(path)+64;
+  char *temp=(char*)malloc(len);
+  assert(temp);
+  snprintf(temp,len,"%s.%ld.%p",path,(long)getpid(),(void*)cache);
+
+  FILE *f=fopen(temp,"w");
+  Boolean ok = (f!=NULL);
+
+  if (ok) {
+    fprintf(f,CACHE_MAGIC "\n");
+    fprintf(f,"q %d %u %d\n",(int)q->variant,q->bound,(int)q->persistent);
+    fprintf(f,"g %zu %zu\n",c->graph->size,c->length);
+    for(size_t i=0;i<c->length;i++)
+      fprintf(f,"%zu%c",c->certificate[i],(i+1)%32==0 || i+1==c->length ? '\n' : ' ');
+    if (p) {
+      fprintf(f,"s SATISFIABLE\n");
+      fprintf(f,"p %d %zu\n",p->cost,p->length);
+      for(size_t i=0;i<p->length;i++)
+        fprintf(f,"%zu%c",(size_t)c->label[p->steps[i]],
+                (i+1)%32==0 || i+1==p->length ? '\n' : ' ');
+    } else {
+      fprintf(f,"s UNSATISFIABLE\n");
+    }
+    ok = !ferror(f);
+    ok = (fclose(f)==0) && ok;
+    ok = ok && rename(temp,path)==0;
+    if (!ok) remove(temp);
+  }
+
+  free(temp);
+  free(path);
+  if (ok) cache->stores++;
+  return ok;
+}
@@ -0,0 +1,88 @@
+/*
+   Description::
+
+   Persistent cache of search results, kept in a directory on disk.
+   Header for cache.c
+
+*/
+
+
+/* Preamble */
+#ifndef  CACHE_H
+#define  CACHE_H
+
+#include "common.h"
+#include "dag.h"
+#include "pebbling.h"
+#include "config.h"
+
+
+/* Code */
+
+/* A graph with its canonical labelling. Isomorphic graphs have the
+   same certificate and the same hash. */
+typedef struct {
+
+  const DAG *graph;
+  Vertex    *label;             /* Canonical name of each vertex */
+  Vertex    *inverse;           /* Vertex of each canonical name */
+  size_t    *certificate;       /* See certificate_DAG */
+  size_t     length;
+  BitTuple   hash;
+
+} CanonicalDAG;
+
+/* The parameters of a search which determine its result */
+typedef struct {
+
+  PebblingVariant variant;
+  unsigned int    bound;
+  Boolean         persistent;
+
+} CacheQuery;
+
+/* Entries are files in `directory', one per graph and query, so that
+   several processes and threads may share the directory.  A cache
+   object counts the hits and misses of its user, and must not be
+   shared between threads. */
+typedef struct {
+
+  char   *directory;
+
+  Counter hits;
+  Counter misses;
+  Counter stores;
+
+} ResultCache;
+
+/* Return NULL if the graph has no canonical form within the budget
+   of canonical_labelling_DAG */
+extern CanonicalDAG *new_CanonicalDAG(const DAG *g);
+extern void      dispose_CanonicalDAG(CanonicalDAG *c);
+
+/* The directory is created if needed. Return NULL if it can't be. */
+extern ResultCache *new_ResultCache(const char *directory);
+extern void     dispose_ResultCache(ResultCache *cache);
+
+/* Look for the result of a query on a graph. On a hit `*found' tells
+   whether there is a pebbling, and if so its steps are returned in
+   `*steps', relabelled for the graph, and must be freed by the caller.
+
+   @return TRUE on a hit, FALSE on a miss. */
+extern Boolean lookup_ResultCache(ResultCache *cache,
+                                  const CanonicalDAG *c,
+                                  const CacheQuery *q,
+                                  Boolean *found,
+                                  int *cost,
+                                  size_t *length,
+                                  Vertex **steps);
+
+/* Store the result of a query, `p' is NULL if there is no pebbling.
+
+   @return FALSE if the entry could not be written. */
+extern Boolean store_ResultCache(ResultCache *cache,
+                                 const CanonicalDAG *c,
+                                 const CacheQuery *q,
+                                 const Pebbling *p);
+
+#endif /* CACHE_H */
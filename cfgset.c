@@ -0,0 +1,506 @@
+/*
+   Description::
+
+   Concurrent set of packed configuration keys.  Insertions and
+   queries can be executed by several threads at the same time: the
+   only synchronization primitive is compare-and-swap on the slots of
+   an open addressing table.
+
+   Keys are not stored as they are, but mixed with an invertible
+   function, so that the value in a slot is also a good hash of the
+   key.  Two slot values are reserved: EMPTY (all words zero) and
+   MOVED (all words one), the latter marks free slots of sealed
+   levels.  The two keys which would be mixed to these values are
+   recorded apart.
+
+   A sealed level is copied into the next one by the inserting
+   threads: each claims a chunk of slots, turns the free ones into
+   MOVED and inserts the keys in the next level.  Afterwards no
+   thread can add a key to the level, and the head of the set moves
+   past it.
+
+   Two-word keys need a 128-bit compare-and-swap.  Where the compiler
+   does not provide it we emulate it with striped spin locks, so the
+   set is correct but not lock-free on such platforms.
+
+*/
+
+/* Preamble */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+#include "cfgset.h"
+
+
+#define LOAD(p)       __atomic_load_n((p),__ATOMIC_ACQUIRE)
+#define STORE(p,v)    __atomic_store_n((p),(v),__ATOMIC_RELEASE)
+#define CAS(p,o,n)    __sync_bool_compare_and_swap((p),(o),(n))
+#define FETCHINC(p)   __sync_add_and_fetch((p),1)
+#define FETCHADD(p,v) __sync_fetch_and_add((p),(v))
+
+#define CSET_MIN_CAPACITY   16
+#define CSET_MIGRATE_CHUNK 256
+
+/* Reserved slot values, the same on each word of the slot */
+#define SLOT_EMPTY BITTUPLE_ZERO
+#define SLOT_MOVED BITTUPLE_UNIT
+
+static const BitTuple EMPTY_KEY[2] = { SLOT_EMPTY, SLOT_EMPTY };
+static const BitTuple MOVED_KEY[2] = { SLOT_MOVED, SLOT_MOVED };
+
+
+/********************************************************************************
+                     DOUBLE WORD COMPARE AND SWAP
+ ********************************************************************************/
+
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+
+__extension__ typedef unsigned __int128 WordPair;
+
+static inline WordPair topair(const BitTuple *w) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return ((WordPair)w[0] << 64) | w[1];
+#else
+  return ((WordPair)w[1] << 64) | w[0];
+#endif
+}
+
+static inline void frompair(WordPair p,BitTuple *w) {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  w[0]=(BitTuple)(p >> 64); w[1]=(BitTuple)p;
+#else
+  w[0]=(BitTuple)p; w[1]=(BitTuple)(p >> 64);
+#endif
+}
+
+static inline Boolean caspair(BitTuple *slot,const BitTuple *old,const BitTuple *new) {
+  return __sync_bool_compare_and_swap((WordPair*)slot,topair(old),topair(new));
+}
+
+/* A CAS which never succeeds, just to read atomically the slot */
+static inline void snapshotpair(BitTuple *slot,BitTuple *w) {
+  frompair(__sync_val_compare_and_swap((WordPair*)slot,(WordPair)0,(WordPair)0),w);
+}
+
+#else /* no 128 bit compare and swap */
+
+#define PAIR_LOCKS 64
+static volatile int pairlocks[PAIR_LOCKS];
+
+static inline volatile int *pairlock(BitTuple *slot) {
+  return pairlocks + (((size_t)slot >> 4) % PAIR_LOCKS);
+}
+
+static inline Boolean caspair(BitTuple *slot,const BitTuple *old,const BitTuple *new) {
+  volatile int *l=pairlock(slot);
+  Boolean res=FALSE;
+  while(__sync_lock_test_and_set(l,1)) ;
+  if (slot[0]==old[0] && slot[1]==old[1]) {
+    STORE(slot  ,new[0]);
+    STORE(slot+1,new[1]);
+    res=TRUE;
+  }
+  __sync_lock_release(l);
+  return res;
+}
+
+static inline void snapshotpair(BitTuple *slot,BitTuple *w) {
+  volatile int *l=pairlock(slot);
+  while(__sync_lock_test_and_set(l,1)) ;
+  w[0]=slot[0];
+  w[1]=slot[1];
+  __sync_lock_release(l);
+}
+
+#endif
+
+
+/********************************************************************************
+                     SLOT OPERATIONS
+ ********************************************************************************/
+
+/* An invertible mixing function on 64 bits (splitmix64 finalizer) */
+static inline BitTuple mix(BitTuple x) {
+  x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27; x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+/* Two rounds of a Feistel network make an invertible mix of two
+   words, where the first word depends on the whole key. */
+static inline void mixkey(const CSet *s,const BitTuple *key,BitTuple *m) {
+  if (s->width==1) {
+    m[0]=mix(key[0]);
+    m[1]=SLOT_EMPTY;
+  } else {
+    m[1]=key[1] ^ mix(key[0]);
+    m[0]=key[0] ^ mix(m[1]);
+  }
+}
+
+static inline Boolean sameslot(const CSet *s,const BitTuple *a,const BitTuple *b) {
+  return (a[0]==b[0]) && (s->width==1 || a[1]==b[1]);
+}
+
+/* Reads a slot. A double word slot is read one word at the time,
+   which is fine unless the slot is being filled at the same time: in
+   that case one of the two words is still zero, and we read again
+   the slot atomically. */
+static inline void readslot(const CSet *s,BitTuple *slot,BitTuple *v) {
+  v[0]=LOAD(slot);
+  if (s->width==1) { v[1]=SLOT_EMPTY; return; }
+  v[1]=LOAD(slot+1);
+  if ((v[0]==SLOT_EMPTY) != (v[1]==SLOT_EMPTY)) snapshotpair(slot,v);
+}
+
+static inline Boolean casslot(const CSet *s,BitTuple *slot,const BitTuple *old,const BitTuple *new) {
+  if (s->width==1) return CAS(slot,old[0],new[0]);
+  return caspair(slot,old,new);
+}
+
+/* Index of the reserved value matching the mixed key, or -1 */
+static inline int specialkey(const CSet *s,const BitTuple *m) {
+  if (sameslot(s,m,EMPTY_KEY)) return 0;
+  if (sameslot(s,m,MOVED_KEY)) return 1;
+  return -1;
+}
+
+
+/********************************************************************************
+                     LEVELS
+ ********************************************************************************/
+
+static CSetLevel *newCSetLevel(size_t capacity,unsigned int width) {
+
+  CSetLevel *l=(CSetLevel*)malloc(sizeof(CSetLevel));
+  void *mem=NULL;
+  assert(l);
+
+  l->capacity  = capacity;
+  l->threshold = capacity - (capacity >> 2);
+  l->used      = 0;
+  l->sealed    = 0;
+  l->next      = NULL;
+
+  l->migrate_next = 0;
+  l->migrated     = 0;
+
+  if (posix_memalign(&mem,2*sizeof(BitTuple),capacity*width*sizeof(BitTuple))!=0) mem=NULL;
+  assert(mem);
+  memset(mem,0,capacity*width*sizeof(BitTuple));
+  l->slots = (BitTuple*)mem;
+  return l;
+}
+
+static void disposeCSetLevel(CSetLevel *l) {
+  assert(l);
+  free(l->slots);
+  free(l);
+}
+
+/* Get the level after `l', allocating it if needed.  Several threads
+   may allocate it at the same time, only one succeeds in linking it. */
+static CSetLevel *nextCSetLevel(CSet *s,CSetLevel *l) {
+
+  CSetLevel *n=LOAD(&l->next);
+  if (n) return n;
+
+  n=newCSetLevel(2*l->capacity,s->width);
+  if (!CAS(&l->next,(CSetLevel*)NULL,n)) {
+    disposeCSetLevel(n);
+    n=LOAD(&l->next);
+  }
+  assert(n);
+  return n;
+}
+
+
+/********************************************************************************
+                     SET OPERATIONS
+ ********************************************************************************/
+
+CSet *newCSet(size_t capacity,unsigned int width,Boolean growable) {
+
+  assert(width==1 || width==2);
+
+  CSet *s=(CSet*)malloc(sizeof(CSet));
+  assert(s);
+
+  size_t c=CSET_MIN_CAPACITY;
+  while(c < capacity) c <<= 1;
+
+  s->width      = width;
+  s->growable   = growable;
+  s->count      = 0;
+  s->special[0] = 0;
+  s->special[1] = 0;
+  s->first      = newCSetLevel(c,width);
+  s->head       = s->first;
+
+  return s;
+}
+
+
+void disposeCSet(CSet *s) {
+
+  CSetLevel *l,*n;
+  assert(s);
+
+  l=s->first;
+  while(l) {
+    n=l->next;
+    disposeCSetLevel(l);
+    l=n;
+  }
+  free(s);
+}
+
+
+/*
+   Insert the mixed key if absent, starting from level `l'.  The
+   result is CSET_INSERTED if and only if the caller is the one who
+   put the key in the set: among threads inserting the same key
+   exactly one wins.
+
+   Slots only go from EMPTY to a key or to MOVED, never back. For a
+   given key all threads probe the same sequence of slots, so they
+   all compete with compare-and-swap on the first free slot of the
+   sequence.  In a sealed level the free slot is turned into MOVED,
+   and everybody continues on the next level.
+ */
+static int insertlevel(CSet *s,CSetLevel *l,const BitTuple *m) {
+
+  BitTuple v[2];
+  size_t idx,probes;
+
+  for(; l!=NULL; l=nextCSetLevel(s,l)) {
+
+    BitTuple *slot=NULL;
+    size_t mask = l->capacity - 1;
+
+    idx=m[0] & mask;
+    for(probes=0; probes < l->capacity; ) {
+
+      slot=l->slots + idx*s->width;
+      readslot(s,slot,v);
+
+      if (sameslot(s,v,m)) return CSET_PRESENT;
+
+      if (sameslot(s,v,MOVED_KEY)) break;
+
+      if (sameslot(s,v,EMPTY_KEY)) {
+
+        if (LOAD(&l->sealed)) {
+          if (casslot(s,slot,EMPTY_KEY,MOVED_KEY)) break;
+          continue;  /* The slot changed: read it again */
+        }
+
+        if (casslot(s,slot,EMPTY_KEY,m)) {
+          if (FETCHINC(&l->used) >= l->threshold && s->growable && !LOAD(&l->sealed)) {
+            STORE(&l->sealed,1);
+            nextCSetLevel(s,l);
+          }
+          return CSET_INSERTED;
+        }
+        continue;    /* The slot changed: read it again */
+      }
+
+      probes++;
+      idx = (idx+1) & mask;
+    }
+
+    if (probes == l->capacity) {  /* No free slot in this level */
+      if (!s->growable) return CSET_FULL;
+      STORE(&l->sealed,1);
+    }
+  }
+
+  assert(0);  /* Not reachable: a growable set always has a next level */
+  return CSET_FULL;
+}
+
+
+/*
+   Copy a chunk of the head level, if it is sealed, into the next
+   level.  The thread which completes the copy of a level moves the
+   head forward, past every level which is completely copied.
+ */
+static void migrateCSet(CSet *s) {
+
+  BitTuple v[2];
+  CSetLevel *l=LOAD(&s->head);
+  CSetLevel *n=NULL;
+  size_t start,end;
+
+  if (!LOAD(&l->sealed) || LOAD(&l->migrate_next) >= l->capacity) return;
+
+  start=FETCHADD(&l->migrate_next,CSET_MIGRATE_CHUNK);
+  if (start >= l->capacity) return;
+  end = start + CSET_MIGRATE_CHUNK;
+  if (end > l->capacity) end = l->capacity;
+
+  n=nextCSetLevel(s,l);
+  for(size_t i=start; i<end; i++) {
+
+    BitTuple *slot=l->slots + i*s->width;
+    readslot(s,slot,v);
+
+    while (sameslot(s,v,EMPTY_KEY) && !casslot(s,slot,EMPTY_KEY,MOVED_KEY))
+      readslot(s,slot,v);
+
+    if (sameslot(s,v,EMPTY_KEY) || sameslot(s,v,MOVED_KEY)) continue;
+    insertlevel(s,n,v);
+  }
+
+  if (FETCHADD(&l->migrated,end-start) + (end-start) < l->capacity) return;
+
+  for(l=LOAD(&s->head); LOAD(&l->migrated)==l->capacity; l=LOAD(&s->head))
+    CAS(&s->head,l,LOAD(&l->next));
+}
+
+
+/*
+   Insert the key if absent.  The result is CSET_INSERTED if and only
+   if the caller is the one who put the key in the set.
+
+   In a growable set each insertion first helps to copy the oldest
+   sealed level, so that the copy proceeds in parallel, and no thread
+   waits for it.
+ */
+int insertCSet(CSet *s,const BitTuple *key) {
+
+  BitTuple m[2];
+  int sp,res;
+
+  assert(s);
+  assert(key);
+
+  mixkey(s,key,m);
+
+  sp=specialkey(s,m);
+  if (sp>=0) {
+    if (!CAS(&s->special[sp],0,1)) return CSET_PRESENT;
+    FETCHINC(&s->count);
+    return CSET_INSERTED;
+  }
+
+  if (s->growable) migrateCSet(s);
+
+  res=insertlevel(s,LOAD(&s->head),m);
+  if (res==CSET_INSERTED) FETCHINC(&s->count);
+  return res;
+}
+
+
+/* Check if the mixed key is in level `l' or in the ones after it */
+static Boolean querylevel(const CSet *s,CSetLevel *l,const BitTuple *m) {
+
+  BitTuple v[2];
+  size_t idx,probes;
+
+  for(; l!=NULL; l=LOAD(&l->next)) {
+
+    size_t mask = l->capacity - 1;
+
+    idx=m[0] & mask;
+    for(probes=0; probes < l->capacity; probes++) {
+
+      readslot(s,l->slots + idx*s->width,v);
+
+      if (sameslot(s,v,m)) return TRUE;
+      if (sameslot(s,v,EMPTY_KEY) || sameslot(s,v,MOVED_KEY)) break;
+
+      idx = (idx+1) & mask;
+    }
+  }
+  return FALSE;
+}
+
+
+/*
+   Check if the key is in the set.  A key inserted concurrently may or
+   may not be found.
+ */
+Boolean queryCSet(CSet *s,const BitTuple *key) {
+
+  BitTuple m[2];
+  int sp;
+
+  assert(s);
+  assert(key);
+
+  mixkey(s,key,m);
+
+  sp=specialkey(s,m);
+  if (sp>=0) return LOAD(&s->special[sp]) ? TRUE : FALSE;
+
+  return querylevel(s,LOAD(&s->head),m);
+}
+
+
+size_t sizeCSet(const CSet *s) {
+  assert(s);
+  return s->count;
+}
+
+/* Number of allocated slots in all levels */
+size_t allocationCSet(const CSet *s) {
+  size_t tot=0;
+  assert(s);
+  for(CSetLevel *l=s->first; l!=NULL; l=l->next) tot += l->capacity;
+  return tot;
+}
+
+size_t levelsCSet(const CSet *s) {
+  size_t tot=0;
+  assert(s);
+  for(CSetLevel *l=s->first; l!=NULL; l=l->next) tot++;
+  return tot;
+}
+
+
+/*
+   Consistency check, which must not run concurrently with
+   insertions.  Only sealed levels can have a next level, and the
+   levels before the head must be copied.  The number of keys, not
+   counting the copies in later levels of the ones being copied, must
+   match the counter.
+ */
+Boolean isconsistentCSet(CSet *s) {
+
+  BitTuple v[2];
+  size_t occupied=0;
+
+  assert(s);
+  assert(s->width==1 || s->width==2);
+  assert(s->first);
+
+  if (s->special[0]) occupied++;
+  if (s->special[1]) occupied++;
+
+  Boolean copied=(s->head!=s->first);
+
+  for(CSetLevel *l=s->first; l!=NULL; l=l->next) {
+
+    if (l->next!=NULL && !l->sealed) return FALSE;
+    if (!s->growable && l->next!=NULL) return FALSE;
+    if (l==s->head) copied=FALSE;
+    if (copied && l->migrated!=l->capacity) return FALSE;
+
+    size_t used=0;
+    for(size_t i=0;i<l->capacity;i++) {
+      readslot(s,l->slots + i*s->width,v);
+      if (sameslot(s,v,EMPTY_KEY) || sameslot(s,v,MOVED_KEY)) continue;
+      used++;
+      if (!copied && !querylevel(s,l->next,v)) occupied++;
+    }
+    if (used != l->used) return FALSE;
+  }
+
+  return (occupied == s->count) ? TRUE : FALSE;
+}
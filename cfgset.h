@@ -0,0 +1,85 @@
+/*
+   Description::
+
+   Concurrent set of packed configuration keys, with an atomic
+   insert-if-absent operation. Header for cfgset.c
+
+*/
+
+
+/* Preamble */
+#ifndef  CFGSET_H
+#define  CFGSET_H
+
+#include <stdlib.h>
+#include "common.h"
+
+/* Code */
+
+/* A concurrent set stores keys of one or two BitTuple words (i.e. 64
+   or 128 bits).  Keys are inserted with compare-and-swap in an open
+   addressing table with linear probing, so that several threads can
+   insert and query the set at the same time without locks.  Keys are
+   never removed.
+
+   The set is either fixed-capacity, in which case an insertion may
+   fail because the table is full, or growable.  A growable set is a
+   chain of tables (levels) of doubling size: when a level gets too
+   full it is sealed, and new keys go to the next level.  The threads
+   which insert keys also copy the keys of the oldest sealed level
+   into the next one, a chunk of slots each.  When the copy is over
+   the level is skipped by later operations, so that these usually
+   scan one or two levels.  Skipped levels are freed only with the
+   set.
+*/
+typedef struct CSetLevel {
+
+  size_t capacity;               /* Number of slots (a power of two) */
+  size_t threshold;              /* Slots used before sealing */
+
+  volatile size_t used;          /* Slots claimed so far */
+  volatile int    sealed;        /* New keys go to the next level */
+
+  volatile size_t migrate_next;  /* First slot not claimed for the copy */
+  volatile size_t migrated;      /* Slots already copied */
+
+  BitTuple *slots;               /* capacity * width words */
+
+  struct CSetLevel *volatile next;
+
+} CSetLevel;
+
+typedef struct {
+
+  unsigned int width;            /* Words per key: 1 or 2 */
+  Boolean      growable;
+
+  CSetLevel *first;              /* The oldest level */
+  CSetLevel *volatile head;      /* The oldest level not yet copied */
+
+  volatile size_t count;         /* Number of keys in the set */
+
+  /* The two keys which are mixed into the slot values reserved for
+     empty and moved slots are recorded here. */
+  volatile int special[2];
+
+} CSet;
+
+/* Results of an insertion */
+#define CSET_PRESENT   0         /* Another thread inserted the key */
+#define CSET_INSERTED  1         /* The caller inserted the key */
+#define CSET_FULL     -1         /* Fixed-capacity set is full */
+
+extern CSet   *newCSet(size_t capacity,unsigned int width,Boolean growable);
+extern void    disposeCSet(CSet *s);
+
+extern Boolean isconsistentCSet(CSet *s);
+
+extern int     insertCSet(CSet *s,const BitTuple *key);
+extern Boolean queryCSet(CSet *s,const BitTuple *key);
+
+extern size_t  sizeCSet(const CSet *s);
+extern size_t  allocationCSet(const CSet *s);
+extern size_t  levelsCSet(const CSet *s);
+
+#endif /* CFGSET_H */
@@ -0,0 +1,243 @@
+/*
+  Stress test and thread-scaling benchmark for the concurrent set of
+  configurations in cfgset.c.
+
+  The stress test lets several threads insert the same keys in
+  different orders, and checks that each key has exactly one winner.
+  The benchmark measures the insertion throughput from 1 to N threads.
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "common.h"
+#include "cfgset.h"
+
+
+#define USAGEMESSAGE "\n\
+Usage: %s [-hsb] [-t <threads>] [-n <keys>]\n\
+\n\
+       -h     help message;\n\
+       -s     run only the stress test;\n\
+       -b     run only the benchmark;\n\
+       -t N   maximum number of threads (default: number of cores);\n\
+       -n K   number of distinct keys (default: 1048576).\n"
+
+
+/* Distinct keys, including the ones which are mixed into reserved
+   slot values. Many keys share the second word. */
+static void make_key(size_t i,BitTuple *key) {
+  key[0] = (BitTuple)i * 0x9E3779B97F4A7C15ULL;
+  key[1] = (BitTuple)(i >> 3);
+}
+
+typedef struct {
+
+  CSet   *set;
+  size_t  keys;
+  size_t  first;       /* Starting key */
+  size_t  length;      /* Number of insertions */
+  int     backward;    /* Direction of the scan */
+  Counter *wins;       /* Winner counts per key (stress only) */
+  Counter full;        /* Insertions failed for full set */
+
+} Job;
+
+static void *run_job(void *arg) {
+
+  Job *job=(Job*)arg;
+  BitTuple key[2];
+  size_t i,k;
+  int res;
+
+  for(i=0;i<job->length;i++) {
+    k = job->backward ? (job->first + job->keys - i) : (job->first + i);
+    k %= job->keys;
+    make_key(k,key);
+    res = insertCSet(job->set,key);
+    if (res==CSET_INSERTED && job->wins) __sync_add_and_fetch(job->wins+k,1);
+    if (res==CSET_FULL) job->full++;
+  }
+  return NULL;
+}
+
+static void run_jobs(Job *jobs,int threads) {
+  pthread_t *tid=(pthread_t*)malloc(threads*sizeof(pthread_t));
+  for(int t=0;t<threads;t++) pthread_create(tid+t,NULL,run_job,jobs+t);
+  for(int t=0;t<threads;t++) pthread_join(tid[t],NULL);
+  free(tid);
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+
+/*
+  Each thread inserts all keys, starting from a different point and in
+  alternating directions.  With a small fixed capacity some insertions
+  fail, but still no key may have two winners.
+ */
+static int stress(unsigned int width,Boolean growable,size_t capacity,size_t keys,int threads) {
+
+  CSet    *set  = newCSet(capacity,width,growable);
+  Counter *wins = (Counter*)calloc(keys,sizeof(Counter));
+  Job     *jobs = (Job*)calloc(threads,sizeof(Job));
+  BitTuple key[2];
+  Counter full=0,winners=0;
+  int errors=0;
+
+  for(int t=0;t<threads;t++) {
+    jobs[t].set      = set;
+    jobs[t].keys     = keys;
+    jobs[t].first    = (keys / threads) * t;
+    jobs[t].length   = keys;
+    jobs[t].backward = t % 2;
+    jobs[t].wins     = wins;
+  }
+  run_jobs(jobs,threads);
+  for(int t=0;t<threads;t++) full += jobs[t].full;
+
+  for(size_t k=0;k<keys;k++) {
+    make_key(k,key);
+    if (wins[k]>1) errors++;
+    if (wins[k]==0 && full==0) errors++;
+    if (wins[k]==1 && !queryCSet(set,key)) errors++;
+    winners += wins[k];
+  }
+  for(size_t k=keys;k<2*keys;k++) {
+    make_key(k,key);
+    if (queryCSet(set,key)) errors++;
+  }
+  if (winners != sizeCSet(set)) errors++;
+  if (!isconsistentCSet(set)) errors++;
+
+  printf("c %s width=%u capacity=%-8lu threads=%2d: %8llu keys in %lu levels, %8llu full, %s\n",
+         growable ? "growable" : "fixed   ",
+         width,(unsigned long)capacity,threads,
+         winners,(unsigned long)levelsCSet(set),full,
+         errors ? "FAILED" : "ok");
+
+  disposeCSet(set);
+  free(wins);
+  free(jobs);
+  return errors;
+}
+
+
+/*
+  Each thread inserts its own share of the keys, and then the share of
+  the next thread, so that half of the insertions are duplicates.
+ */
+static double bench(unsigned int width,Boolean growable,size_t keys,int threads) {
+
+  CSet *set = newCSet(growable ? 1024 : 2*keys,width,growable);
+  Job  *jobs = (Job*)calloc(threads,sizeof(Job));
+  double start,elapsed;
+
+  for(int t=0;t<threads;t++) {
+    jobs[t].set      = set;
+    jobs[t].keys     = keys;
+    jobs[t].first    = (keys / threads) * t;
+    jobs[t].length   = 2 * (keys / threads);
+    jobs[t].backward = 0;
+    jobs[t].wins     = NULL;
+  }
+
+  start=now();
+  run_jobs(jobs,threads);
+  elapsed=now()-start;
+
+  disposeCSet(set);
+  free(jobs);
+  return elapsed;
+}
+
+
+int main(int argc, char *argv[])
+{
+  int option_code=0;
+  int max_threads=(int)sysconf(_SC_NPROCESSORS_ONLN);
+  size_t keys=1<<20;
+  int do_stress=1;
+  int do_bench=1;
+  int errors=0;
+
+  while((option_code = getopt(argc,argv,"hsbt:n:"))!=-1) {
+    switch (option_code) {
+    case 'h':
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_SUCCESS);
+      break;
+    case 's':
+      do_bench=0;
+      break;
+    case 'b':
+      do_stress=0;
+      break;
+    case 't':
+      max_threads=atoi(optarg);
+      if (max_threads>0) break;
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    case 'n':
+      keys=(size_t)atol(optarg);
+      if (keys>0) break;
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    case '?':
+    default:
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (max_threads<2 && do_stress) {
+    printf("c stress test runs with 2 threads at least.\n");
+  }
+
+  if (do_stress) {
+    int threads = max_threads < 2 ? 2 : max_threads;
+    printf("c ===== stress test ====\n");
+    for(unsigned int width=1;width<=2;width++) {
+      errors += stress(width,FALSE,2*keys,keys,threads);
+      errors += stress(width,FALSE,1024,4096,threads);
+      errors += stress(width,TRUE ,16,keys,threads);
+    }
+  }
+
+  if (do_bench) {
+    printf("c ===== benchmark ======\n");
+    printf("c %d distinct keys, %d insertions\n",(int)keys,(int)(2*keys));
+    printf("c             threads |  width 1 Mops/s  speedup |  width 2 Mops/s  speedup\n");
+    for(int growable=0;growable<=1;growable++) {
+      double base[2]={0,0};
+      for(int t=1;t<=max_threads;t++) {
+        printf("c %s %3d ",growable ? "growable" : "fixed   ",t);
+        for(unsigned int width=1;width<=2;width++) {
+          double elapsed=bench(width,growable,keys,t);
+          double rate=(2.0*(keys/t)*t)/elapsed/1e6;
+          if (t==1) base[width-1]=rate;
+          printf("| %15.2f %8.2f ",rate,rate/base[width-1]);
+        }
+        printf("\n");
+      }
+    }
+  }
+
+  if (errors) {
+    printf("s STRESS TEST FAILED\n");
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,96 @@
+/*
+   Description::
+
+   The parts of the checkpoints which do not depend on the pebbling
+   variant: the header line and the identification of the graph.  The
+   state of the search itself is written and read in bfs.c.
+
+*/
+
+/* Preamble */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+#include "dag.h"
+#include "checkpoint.h"
+
+#define CHECKPOINT_MAGIC "c pebble checkpoint"
+
+/* Code */
+
+static inline BitTuple fnv1a(BitTuple h,BitTuple x) {
+  for(int i=0;i<8;i++) {
+    h ^= (x >> (8*i)) & 0xFF;
+    h *= 0x100000001B3ULL;
+  }
+  return h;
+}
+
+BitTuple hash_DAG(const DAG *g) {
+
+  assert(isconsistent_DAG(g));
+
+  BitTuple h=0xCBF29CE484222325ULL;
+  h=fnv1a(h,g->size);
+  for(Vertex v=0;v<g->size;v++) {
+    h=fnv1a(h,g->indegree[v]);
+    for(size_t i=0;i<g->indegree[v];i++) h=fnv1a(h,g->in[v][i]);
+  }
+  return h;
+}
+
+
+Boolean write_CheckpointHeader(FILE *f,const CheckpointHeader *h) {
+
+  assert(f && h);
+
+  return fprintf(f,CHECKPOINT_MAGIC " %d %s %zu %016llx %u %d %zu %zu %llu %llu\n",
+                 CHECKPOINT_VERSION,
+                 h->variant,
+                 h->vertices,
+                 h->graph,
+                 h->bound,
+                 (int)h->persistent,
+                 h->dict_allocation,
+                 h->dict_size,
+                 h->configurations,
+                 h->queued) > 0;
+}
+
+Boolean read_CheckpointHeader(FILE *f,CheckpointHeader *h) {
+
+  assert(f && h);
+
+  int version,persistent;
+  memset(h,0,sizeof(CheckpointHeader));
+
+  if (fscanf(f,CHECKPOINT_MAGIC " %d %7s %zu %llx %u %d %zu %zu %llu %llu",
+             &version,
+             h->variant,
+             &h->vertices,
+             &h->graph,
+             &h->bound,
+             &persistent,
+             &h->dict_allocation,
+             &h->dict_size,
+             &h->configurations,
+             &h->queued)!=10) return FALSE;
+
+  if (version!=CHECKPOINT_VERSION || fgetc(f)!='\n') return FALSE;
+  h->persistent = persistent ? TRUE : FALSE;
+  return TRUE;
+}
+
+Boolean peek_CheckpointHeader(const char *path,CheckpointHeader *h) {
+
+  assert(path && h);
+
+  FILE *f=fopen(path,"rb");
+  if (f==NULL) return FALSE;
+  Boolean ok=read_CheckpointHeader(f,h);
+  fclose(f);
+  return ok;
+}
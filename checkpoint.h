@@ -0,0 +1,54 @@
+/*
+   Description::
+
+   Checkpoints of the breadth-first search, to continue a long search
+   after the program is stopped. Header for checkpoint.c
+
+*/
+
+
+/* Preamble */
+#ifndef  CHECKPOINT_H
+#define  CHECKPOINT_H
+
+#include <stdio.h>
+
+#include "common.h"
+#include "dag.h"
+
+
+/* Code */
+
+#define CHECKPOINT_VERSION          1
+#define CHECKPOINT_DEFAULT_INTERVAL 600      /* Seconds */
+
+/* A checkpoint file starts with a text line describing the search,
+   followed by its state in binary form (see bfs.c).  The state is in
+   the layout of the machine and of the build which wrote it. */
+typedef struct {
+
+  char         variant[8];      /* black, bw or rev */
+  size_t       vertices;
+  BitTuple     graph;           /* Hash of the graph */
+  unsigned int bound;
+  Boolean      persistent;
+
+  size_t       dict_allocation; /* Dictionary of the visited set */
+  size_t       dict_size;
+
+  Counter      configurations;  /* Visited configurations */
+  Counter      queued;          /* Configurations still in queue */
+
+} CheckpointHeader;
+
+/* Hash of the vertices and of the edges of a graph, to check that a
+   checkpoint is resumed on the graph which it was taken on. */
+extern BitTuple hash_DAG(const DAG *g);
+
+extern Boolean write_CheckpointHeader(FILE *f,const CheckpointHeader *h);
+extern Boolean  read_CheckpointHeader(FILE *f,CheckpointHeader *h);
+
+/* Read the header of the checkpoint file at `path'. */
+extern Boolean peek_CheckpointHeader(const char *path,CheckpointHeader *h);
+
+#endif /* CHECKPOINT_H */
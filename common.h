@@ -27,7 +27,7 @@ typedef unsigned char          Boolean;
 #define BITTUPLE_UNIT 0x1ULL       /* A bitmask compatible with BitTuple, of value 1 */
 #define BITTUPLE_ZERO 0x0ULL       /* A bitmask compatible with BitTuple, of value 0 */
 #define BITTUPLE_FULL (~0x0ULL)    /* A bitmask compatible with BitTuple, of value 1 */
-#define BITTUPLE_SIZE sizeof(BitTuple)*CHAR_BIT
+#define BITTUPLE_SIZE (sizeof(BitTuple)*CHAR_BIT)
 
 #define TRUE  1
 #define FALSE 0
@@ -36,6 +36,18 @@ typedef unsigned char          Boolean;
 #define   SETBIT(tuple,i) ((tuple)|=(BITTUPLE_UNIT << (i)))
 #define RESETBIT(tuple,i) ((tuple)&= ~(BITTUPLE_UNIT << (i)))
 
+/* Index of the lowest bit set in a non zero tuple. Iterate over the
+   bits of a tuple with  for(; t; t &= t-1) { i=LOWESTBIT(t); ... }  */
+#if defined(__GNUC__)
+#define LOWESTBIT(tuple) ((unsigned int)__builtin_ctzll(tuple))
+#else
+static inline unsigned int LOWESTBIT(BitTuple tuple) {
+  unsigned int i=0;
+  while(!(tuple & BITTUPLE_UNIT)) { tuple >>= 1; i++; }
+  return i;
+}
+#endif
+
 #define MAX(a,b) (a > b ? a : b )
 
 
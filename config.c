@@ -13,6 +13,9 @@
 /* Preamble */
 #include <stdlib.h>
 #include "config.h"
+#include "symbolic.h"
+#include "beam.h"
+#include "pareto.h"
 
 /* Code */
 
@@ -55,3 +58,34 @@ const char* pebbling_Type() {
 #endif
 
 
+/* Entry points for this variant */
+const VariantOps VARIANT_SYMBOL(variant_ops) = {
+
+#if REVERSIBLE_PEBBLING
+  VARIANT_REVERSIBLE,
+#elif BLACK_WHITE_PEBBLING
+  VARIANT_BLACK_WHITE,
+#else
+  VARIANT_BLACK,
+#endif
+#ifdef PEBBLING_VARIANT
+  VARIANT_STRING(PEBBLING_VARIANT),
+#else
+  "",
+#endif
+
+  pebbling_type,
+  pebbling_Type,
+
+  bfs_pebbling_strategy,
+  symbolic_pebbling_strategy,
+  beam_pebbling_strategy,
+  pareto_pebbling_strategy,
+
+  new_Pebbling,
+  isvalid_Pebbling,
+  dispose_Pebbling,
+
+  fprint_text_Pebbling,
+  fprint_dot_Pebbling
+};
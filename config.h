@@ -11,10 +11,55 @@
 #define _CONFIG_H_
 
 #include <stdlib.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "variant.h"
+#include "dag.h"
+#include "pebbling.h"
+#include "bfs.h"
 
 
 const char* pebbling_Type();
 const char* pebbling_type();
 
 
+/* The pebbling variants linked in the program */
+typedef enum {
+
+  VARIANT_BLACK,
+  VARIANT_BLACK_WHITE,
+  VARIANT_REVERSIBLE
+
+} PebblingVariant;
+
+/* Entry points of the code compiled for one variant.  Only the top
+   level calls go through the table: the search inside is specialised
+   for the variant. */
+typedef struct {
+
+  PebblingVariant variant;
+  const char     *name;                   /* Suffix of the variant symbols */
+
+  const char* (*type)(void);
+  const char* (*Type)(void);
+
+  Pebbling* (*bfs)(const DAG*,unsigned int,Boolean,BFSOptions*);
+  Pebbling* (*symbolic)(const DAG*,unsigned int,Boolean,BFSOptions*);
+  Pebbling* (*beam)(const DAG*,unsigned int,Boolean,BFSOptions*);
+  Pebbling**(*pareto)(const DAG*,unsigned int,Boolean,BFSOptions*,size_t*);
+
+  Pebbling* (*create)(size_t);
+  Boolean   (*isvalid)(const DAG*,const Pebbling*,Boolean);
+  void      (*dispose)(Pebbling*);
+
+  void      (*fprint_text)(FILE*,const DAG*,const Pebbling*);
+  Boolean   (*fprint_dot)(char*,const DAG*,const Pebbling*);
+
+} VariantOps;
+
+extern const VariantOps variant_ops_black;
+extern const VariantOps variant_ops_bw;
+extern const VariantOps variant_ops_rev;
+
 #endif /* _CONFIG_H_ */
@@ -0,0 +1,470 @@
+/*
+   Description::
+
+   Daemon mode. The main thread accepts the connections on a Unix
+   domain socket and queues them for a pool of workers.  Each worker
+   keeps a search context for its whole life, so that the dictionary
+   is allocated once; it is warmed up on a trivial graph before the
+   first client arrives.
+
+   The answers of the queries are kept in a direct mapped cache,
+   indexed by a hash of the whole request, so that a repeated query
+   is answered without even parsing the graph.  With a result cache on
+   disk, queries on relabellings of a known graph are answered too.
+
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+/* Preamble */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "common.h"
+#include "dag.h"
+#include "kthparser.h"
+#include "libpebble.h"
+#include "cache.h"
+#include "batch.h"
+#include "daemon.h"
+
+
+/* An answer in the cache, with the request it answers */
+typedef struct {
+
+  BitTuple hash;
+  char    *request;
+  size_t   request_length;
+  char    *answer;
+  size_t   answer_length;
+
+} Answer;
+
+typedef struct {
+
+  const DaemonOptions *opts;
+  int listener;
+
+  int     queue[DAEMON_QUEUE];  /* Accepted connections */
+  size_t  head;
+  size_t  count;
+  Boolean stopping;
+
+  pthread_mutex_t lock;
+  pthread_cond_t  nonempty;
+  pthread_cond_t  nonfull;
+
+  Answer          answers[DAEMON_ANSWERS];
+  pthread_mutex_t answers_lock;
+
+} Daemon;
+
+static volatile sig_atomic_t stop_signal=0;
+
+static void stop_handler(int sig) {
+  stop_signal=1;
+}
+
+
+void init_DaemonOptions(DaemonOptions *opts) {
+
+  assert(opts);
+
+  opts->workers   = 1;
+  opts->dict_size = BATCH_DEFAULT_DICT_SIZE;
+  opts->cache_dir = NULL;
+}
+
+
+/* Read until the client shuts down its side. Return NULL on errors
+   or if the request is too large. */
+static char *readrequest(int fd,size_t *length) {
+
+  size_t allocation=4096;
+  char *buffer=(char*)malloc(allocation);
+  assert(buffer);
+  *length=0;
+
+  for(;;) {
+    if (*length == allocation) {
+      if (allocation >= DAEMON_REQUEST_MAX) { free(buffer); return NULL; }
+      allocation *= 2;
+      buffer=(char*)realloc(buffer,allocation);
+      assert(buffer);
+    }
+    ssize_t r=read(fd,buffer+*length,allocation-*length);
+    if (r<0 && errno==EINTR) continue;
+    if (r<0) { free(buffer); return NULL; }
+    if (r==0) break;
+    *length += (size_t)r;
+  }
+  return buffer;
+}
+
+static void writeanswer(int fd,const char *answer,size_t length) {
+
+  while (length>0) {
+    ssize_t w=write(fd,answer,length);
+    if (w<0 && errno==EINTR) continue;
+    if (w<=0) return;
+    answer += w;
+    length -= (size_t)w;
+  }
+}
+
+static BitTuple hashrequest(const char *request,size_t length) {
+
+  BitTuple h=0xCBF29CE484222325ULL;
+  for(size_t i=0;i<length;i++) {
+    h ^= (unsigned char)request[i];
+    h *= 0x100000001B3ULL;
+  }
+  return h;
+}
+
+/* Copy of the cached answer, or NULL */
+static char *cachedanswer(Daemon *d,BitTuple hash,
+                          const char *request,size_t length,size_t *answer_length) {
+
+  char *answer=NULL;
+  Answer *slot=d->answers + hash % DAEMON_ANSWERS;
+
+  pthread_mutex_lock(&d->answers_lock);
+  if (slot->request && slot->hash==hash && slot->request_length==length &&
+      memcmp(slot->request,request,length)==0) {
+    answer=(char*)malloc(slot->answer_length);
+    assert(answer);
+    memcpy(answer,slot->answer,slot->answer_length);
+    *answer_length=slot->answer_length;
+  }
+  pthread_mutex_unlock(&d->answers_lock);
+  return answer;
+}
+
+static void storeanswer(Daemon *d,BitTuple hash,
+                        const char *request,size_t length,
+                        const char *answer,size_t answer_length) {
+
+  Answer *slot=d->answers + hash % DAEMON_ANSWERS;
+  char *r=(char*)malloc(length);
+  char *a=(char*)malloc(answer_length);
+  assert(r && a);
+  memcpy(r,request,length);
+  memcpy(a,answer,answer_length);
+
+  pthread_mutex_lock(&d->answers_lock);
+  free(slot->request);
+  free(slot->answer);
+  slot->hash=hash;
+  slot->request=r;
+  slot->request_length=length;
+  slot->answer=a;
+  slot->answer_length=answer_length;
+  pthread_mutex_unlock(&d->answers_lock);
+}
+
+
+/* Parse the query line. Return the offset of the graph, or 0 if the
+   line is malformed. */
+static size_t parsequery(const char *request,size_t length,
+                         PebblingVariant *variant,unsigned int *bound,
+                         Boolean *shortest,Boolean *persistent,SearchEngine *engine) {
+
+  char   line[128],name[16],flags[16];
+  size_t end=0;
+
+  while (end<length && request[end]!='\n') end++;
+  if (end>=length || end>=sizeof(line)) return 0;
+  memcpy(line,request,end);
+  line[end]='\0';
+
+  if (sscanf(line,"q %15s %u %15s",name,bound,flags)!=3 || *bound==0) return 0;
+
+  if (strcmp(name,"black")==0)      *variant=VARIANT_BLACK;
+  else if (strcmp(name,"bw")==0)    *variant=VARIANT_BLACK_WHITE;
+  else if (strcmp(name,"rev")==0)   *variant=VARIANT_REVERSIBLE;
+  else return 0;
+
+  *shortest=FALSE;
+  *persistent=FALSE;
+  *engine=SEARCH_EXPLICIT;
+  if (strcmp(flags,"-")!=0) {
+    for(const char *f=flags;*f;f++) {
+      if (*f=='t')      *shortest=TRUE;
+      else if (*f=='Z') *persistent=TRUE;
+      else if (*f=='S') *engine=SEARCH_SYMBOLIC;
+      else return 0;
+    }
+  }
+  return end+1;
+}
+
+/* Solve the query, and write the answer on `output'. Return TRUE if
+   the answer may be cached. */
+static Boolean answerquery(PebbleSearch *s,const char *request,size_t length,FILE *output) {
+
+  PebblingVariant variant;
+  unsigned int bound;
+  Boolean      shortest,persistent;
+  SearchEngine engine;
+
+  size_t offset=parsequery(request,length,&variant,&bound,&shortest,&persistent,&engine);
+  if (offset==0) {
+    fprintf(output,"s ERROR malformed query\n");
+    return FALSE;
+  }
+
+  DAG *g = kthparser_buffer(request+offset,length-offset,NULL);
+  if (g==NULL) {
+    fprintf(output,"s ERROR malformed graph\n");
+    return FALSE;
+  }
+
+  setgraph_PebbleSearch(s,g);
+  setoption_PebbleSearch(s,OPTION_VARIANT,variant);
+  setoption_PebbleSearch(s,OPTION_PERSISTENT,persistent);
+  setoption_PebbleSearch(s,OPTION_ENGINE,engine);
+
+  SearchResult result=SEARCH_NOT_RUN;
+  Counter processed=0,unique=0;
+  for(unsigned int cost = shortest ? bound : 1; cost <= bound; cost++) {
+    setoption_PebbleSearch(s,OPTION_BOUND,cost);
+    result=run_PebbleSearch(s);
+    processed += stats_PebbleSearch(s)->processed_T;
+    unique    += stats_PebbleSearch(s)->first_queuing_T;
+    if (result==SEARCH_FOUND || result==SEARCH_ERROR) break;
+  }
+
+  if (result==SEARCH_FOUND) {
+    const Pebbling *p=pebbling_PebbleSearch(s);
+    fprintf(output,"s SATISFIABLE\n");
+    fprintf(output,"c cost=%d length=%zu processed=%llu unique=%llu\n",
+            p->cost,p->length,processed,unique);
+    fprint_text_PebbleSearch(output,s);
+  } else if (result==SEARCH_NOT_FOUND) {
+    fprintf(output,"s UNSATISFIABLE\n");
+    fprintf(output,"c cost=- length=- processed=%llu unique=%llu\n",processed,unique);
+  } else {
+    fprintf(output,"s ERROR %s\n",
+            error_PebbleSearch(s) ? error_PebbleSearch(s) : "search failed");
+  }
+
+  setgraph_PebbleSearch(s,NULL);
+  dispose_DAG(g);
+  return result==SEARCH_FOUND || result==SEARCH_NOT_FOUND;
+}
+
+
+static void serve(Daemon *d,PebbleSearch *s,int fd) {
+
+  size_t length;
+  char *request=readrequest(fd,&length);
+
+  if (request==NULL) {
+    static const char error[]="s ERROR unreadable request\n";
+    writeanswer(fd,error,sizeof(error)-1);
+    return;
+  }
+
+  if (length>0 && request[0]=='x') {
+    static const char bye[]="c daemon stopping\n";
+    pthread_mutex_lock(&d->lock);
+    d->stopping=TRUE;
+    pthread_mutex_unlock(&d->lock);
+    shutdown(d->listener,SHUT_RDWR);      /* Wake up accept() */
+    writeanswer(fd,bye,sizeof(bye)-1);
+    free(request);
+    return;
+  }
+
+  BitTuple hash=hashrequest(request,length);
+  size_t answer_length=0;
+  char *answer=cachedanswer(d,hash,request,length,&answer_length);
+
+  if (answer==NULL) {
+    FILE *output=open_memstream(&answer,&answer_length);
+    assert(output);
+    Boolean cacheable=answerquery(s,request,length,output);
+    fclose(output);
+    if (cacheable) storeanswer(d,hash,request,length,answer,answer_length);
+  }
+
+  writeanswer(fd,answer,answer_length);
+  free(answer);
+  free(request);
+}
+
+
+static void *worker(void *arg) {
+
+  Daemon *d=(Daemon*)arg;
+  ResultCache *cache=NULL;
+
+  if (d->opts->cache_dir) cache=new_ResultCache(d->opts->cache_dir);
+
+  /* Warm up: the dictionary is allocated by the first run */
+  DAG *warmup=path(1);
+  PebbleSearch *s=new_PebbleSearch(warmup);
+  setoption_PebbleSearch(s,OPTION_DICT_SIZE,(long)d->opts->dict_size);
+  setoption_PebbleSearch(s,OPTION_BOUND,2);
+  run_PebbleSearch(s);
+  setgraph_PebbleSearch(s,NULL);
+  dispose_DAG(warmup);
+  setcache_PebbleSearch(s,cache);
+
+  for(;;) {
+    pthread_mutex_lock(&d->lock);
+    while (d->count==0 && !d->stopping) pthread_cond_wait(&d->nonempty,&d->lock);
+    if (d->count==0) {
+      pthread_mutex_unlock(&d->lock);
+      break;
+    }
+    int fd=d->queue[d->head];
+    d->head=(d->head+1) % DAEMON_QUEUE;
+    d->count--;
+    pthread_cond_signal(&d->nonfull);
+    pthread_mutex_unlock(&d->lock);
+
+    serve(d,s,fd);
+    close(fd);
+  }
+
+  dispose_PebbleSearch(s);
+  dispose_ResultCache(cache);
+  return NULL;
+}
+
+
+/* Bind the socket, replacing the file of a dead daemon */
+static int opensocket(const char *path) {
+
+  struct sockaddr_un address;
+
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    fprintf(stderr,"c ERROR: socket path \"%s\" too long\n",path);
+    return -1;
+  }
+  memset(&address,0,sizeof(address));
+  address.sun_family=AF_UNIX;
+  strcpy(address.sun_path,path);
+
+  int fd=socket(AF_UNIX,SOCK_STREAM,0);
+  if (fd<0) {
+    perror("c ERROR: socket");
+    return -1;
+  }
+
+  if (connect(fd,(struct sockaddr*)&address,sizeof(address))==0) {
+    fprintf(stderr,"c ERROR: a daemon is already listening on \"%s\"\n",path);
+    close(fd);
+    return -1;
+  }
+  close(fd);
+  unlink(path);
+
+  fd=socket(AF_UNIX,SOCK_STREAM,0);
+  if (fd<0 ||
+      bind(fd,(struct sockaddr*)&address,sizeof(address))!=0 ||
+      listen(fd,DAEMON_QUEUE)!=0) {
+    perror("c ERROR: unable to listen on the socket");
+    if (fd>=0) close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+
+int pebble_daemon(const char *path,const DaemonOptions *opts) {
+
+  assert(path);
+  assert(opts);
+
+  Daemon *d=(Daemon*)calloc(1,sizeof(Daemon));
+  assert(d);
+  d->opts=opts;
+  d->listener=opensocket(path);
+  if (d->listener<0) {
+    free(d);
+    return -1;
+  }
+  pthread_mutex_init(&d->lock,NULL);
+  pthread_mutex_init(&d->answers_lock,NULL);
+  pthread_cond_init(&d->nonempty,NULL);
+  pthread_cond_init(&d->nonfull,NULL);
+
+  /* Clients which hang up must not kill the daemon, and the stop
+     signals are received by the main thread only */
+  struct sigaction action;
+  sigset_t stopset,oldset;
+  memset(&action,0,sizeof(action));
+  action.sa_handler=SIG_IGN;
+  sigaction(SIGPIPE,&action,NULL);
+  action.sa_handler=stop_handler;           /* No SA_RESTART */
+  sigaction(SIGINT,&action,NULL);
+  sigaction(SIGTERM,&action,NULL);
+  sigemptyset(&stopset);
+  sigaddset(&stopset,SIGINT);
+  sigaddset(&stopset,SIGTERM);
+  pthread_sigmask(SIG_BLOCK,&stopset,&oldset);
+
+  unsigned int workers = opts->workers > 0 ? opts->workers : 1;
+  pthread_t *tid=(pthread_t*)malloc(workers*sizeof(pthread_t));
+  assert(tid);
+  for(unsigned int t=0;t<workers;t++) pthread_create(tid+t,NULL,worker,d);
+
+  pthread_sigmask(SIG_SETMASK,&oldset,NULL);
+
+  fprintf(stderr,"c Pebbling daemon on %s with %u workers\n",path,workers);
+
+  for(;;) {
+    int fd=accept(d->listener,NULL,NULL);
+
+    pthread_mutex_lock(&d->lock);
+    if (stop_signal) d->stopping=TRUE;
+    if (d->stopping) {
+      pthread_mutex_unlock(&d->lock);
+      if (fd>=0) close(fd);
+      break;
+    }
+    if (fd<0) {
+      pthread_mutex_unlock(&d->lock);
+      continue;
+    }
+    while (d->count==DAEMON_QUEUE) pthread_cond_wait(&d->nonfull,&d->lock);
+    d->queue[(d->head+d->count) % DAEMON_QUEUE]=fd;
+    d->count++;
+    pthread_cond_signal(&d->nonempty);
+    pthread_mutex_unlock(&d->lock);
+  }
+
+  /* The queued connections are served before stopping */
+  pthread_mutex_lock(&d->lock);
+  pthread_cond_broadcast(&d->nonempty);
+  pthread_mutex_unlock(&d->lock);
+  for(unsigned int t=0;t<workers;t++) pthread_join(tid[t],NULL);
+  free(tid);
+
+  close(d->listener);
+  unlink(path);
+  fprintf(stderr,"c Pebbling daemon on %s stopped\n",path);
+
+  for(size_t i=0;i<DAEMON_ANSWERS;i++) {
+    free(d->answers[i].request);
+    free(d->answers[i].answer);
+  }
+  pthread_mutex_destroy(&d->lock);
+  pthread_mutex_destroy(&d->answers_lock);
+  pthread_cond_destroy(&d->nonempty);
+  pthread_cond_destroy(&d->nonfull);
+  free(d);
+  return 0;
+}
@@ -0,0 +1,56 @@
+/*
+   Description::
+
+   Daemon mode: a long running solver which answers queries over a
+   Unix domain socket. Header for daemon.c
+
+*/
+
+
+/* Preamble */
+#ifndef  DAEMON_H
+#define  DAEMON_H
+
+#include "common.h"
+
+
+/* Code */
+
+/* A request is a query line followed by a graph in KTH format
+
+       q <variant> <bound> <flags>
+
+   where <variant> is black, bw or rev, and <flags> is `-' or some of
+   the letters t (shortest pebbling within the bound), Z (persistent
+   pebbling) and S (symbolic search).  The request ends when the client
+   shuts down its side of the connection.  The request
+
+       x
+
+   stops the daemon.  The answer is the status line `s SATISFIABLE',
+   `s UNSATISFIABLE' or `s ERROR <message>', a line
+
+       c cost=<cost> length=<length> processed=<n> unique=<n>
+
+   and, for satisfiable queries, the pebbling as printed by pebble. */
+#define DAEMON_REQUEST_MAX   (1<<24)  /* Bytes of a request */
+#define DAEMON_ANSWERS       4096     /* Slots of the answer cache */
+#define DAEMON_QUEUE         64       /* Connections waiting a worker */
+
+typedef struct {
+
+  unsigned int workers;
+  size_t       dict_size;       /* Buckets of the dictionary of each worker */
+  const char  *cache_dir;       /* Result cache on disk, or NULL */
+
+} DaemonOptions;
+
+extern void init_DaemonOptions(DaemonOptions *opts);
+
+/* Serve the requests on the socket at `path' until the daemon is
+   stopped by a request or by SIGINT/SIGTERM.
+
+   @return 0, or -1 if the socket could not be set up. */
+extern int pebble_daemon(const char *path,const DaemonOptions *opts);
+
+#endif /* DAEMON_H */
@@ -12,10 +12,16 @@
 */
 
 /* Preamble */
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include "common.h"
 #include "dag.h"
@@ -25,6 +31,73 @@
                      DATA STRUCTURE MANAGEMENT FUNCTIONS
  ********************************************************************************/
 
+/*
+   A graph with `size' vertices and no edges.  The outgoing lists are
+   built later by dag_precompute_data.  */
+DAG* new_DAG(size_t size) {
+
+  DAG *d=(DAG*)malloc(sizeof(DAG));
+  assert(d);
+
+  d->size = size;
+
+  d->indegree   = (size_t*)calloc( size,sizeof(size_t) );
+  d->outdegree  = (size_t*)calloc( size,sizeof(size_t) );
+  d->in         = (Vertex**)malloc( size*sizeof(Vertex*) );
+  d->out        = (Vertex**)malloc( size*sizeof(Vertex*) );
+  d->in_offset  = (size_t*)calloc( size+1,sizeof(size_t) );
+  d->out_offset = (size_t*)calloc( size+1,sizeof(size_t) );
+
+  assert(d->indegree && d->outdegree);
+  assert(d->in && d->out);
+  assert(d->in_offset && d->out_offset);
+
+  d->in_edges  = NULL;
+  d->out_edges = NULL;
+
+  /* Set to null sinks and source vector */
+  d->pred_bitmasks=NULL;
+  d->succ_bitmasks=NULL;
+  d->sources=NULL;
+  d->sinks=NULL;
+  d->source_number=0;
+  d->sink_number=0;
+
+  d->image=NULL;
+  d->image_length=0;
+
+  return d;
+}
+
+/*
+   Allocate the incoming lists, according to the indegrees, in a
+   single array.  */
+void edges_DAG(DAG *d) {
+
+  size_t edges=0;
+  for(Vertex v=0;v<d->size;v++) edges+=d->indegree[v];
+
+  Vertex *in_edges=(Vertex*)malloc( (edges+1)*sizeof(Vertex) );
+  assert(in_edges);
+  adoptedges_DAG(d,in_edges);
+}
+
+/*
+   The incoming lists are already in `in_edges', one after the other
+   according to the indegrees, and the graph takes the array. */
+void adoptedges_DAG(DAG *d,Vertex *in_edges) {
+
+  assert(d->in_edges==NULL);
+  assert(in_edges);
+
+  d->in_offset[0]=0;
+  for(Vertex v=0;v<d->size;v++) d->in_offset[v+1]=d->in_offset[v]+d->indegree[v];
+
+  d->in_edges=in_edges;
+  for(Vertex v=0;v<d->size;v++) d->in[v]=d->in_edges+d->in_offset[v];
+}
+
+
 /*
    Graph structure is mostly used statically. Once the graph has been
    defined, it is not modified anymore.  Thus we can do precomputing
@@ -33,6 +106,30 @@ void dag_precompute_data(DAG *digraph) {
 
   assert(digraph->sinks  ==NULL);
   assert(digraph->sources==NULL);
+  assert(digraph->in_edges);
+  assert(digraph->out_edges==NULL);
+
+  /* The outgoing lists, from the incoming ones, in time linear in
+     the size of the graph.  Each list is sorted, since the heads are
+     visited in order. */
+  for(Vertex v=0;v<digraph->size;v++) digraph->outdegree[v]=0;
+  for(size_t e=0;e<digraph->in_offset[digraph->size];e++)
+    digraph->outdegree[digraph->in_edges[e]]++;
+
+  digraph->out_offset[0]=0;
+  for(Vertex v=0;v<digraph->size;v++) {
+    digraph->out_offset[v+1]=digraph->out_offset[v]+digraph->outdegree[v];
+    digraph->outdegree[v]=0;
+  }
+  digraph->out_edges=(Vertex*)malloc( (digraph->out_offset[digraph->size]+1)*sizeof(Vertex) );
+  assert(digraph->out_edges);
+
+  for(Vertex v=0;v<digraph->size;v++) digraph->out[v]=digraph->out_edges+digraph->out_offset[v];
+  for(Vertex v=0;v<digraph->size;v++)
+    for(size_t j=0;j<digraph->indegree[v];j++) {
+      Vertex u=digraph->in[v][j];
+      digraph->out[u][ digraph->outdegree[u]++ ]=v;
+    }
 
   /* Count the number of sources */
   digraph->sink_number=0;
@@ -81,68 +178,40 @@ void dag_precompute_data(DAG *digraph) {
 }
 
 
-/* This builds a copy of a DAG.
-
-   N.B. The clone of an inconsistent graph maybe inconsistent, but the
-   inconsistency may be different. */
-
+/* This builds a copy of a DAG. */
 DAG* copy_DAG(const DAG *src) {
 
-  DAG *d;
-
-  assert(src);
-
-  d=(DAG*)malloc(sizeof(DAG));
+  assert(isconsistent_DAG(src));
 
-  assert(d);
-
-  /* Allocation for arcs specification */
-  d->size = src->size;
-
-  d->in  = (Vertex**)malloc( d->size*sizeof(Vertex*) );
-  d->out = (Vertex**)malloc( d->size*sizeof(Vertex*) );
-
-  assert(d->in );
-  assert(d->out);
+  DAG *d=new_DAG(src->size);
 
-  /* Copy the degree specifications */
-  d->indegree  = (size_t*)malloc( d->size*sizeof(size_t) );
-  d->outdegree = (size_t*)malloc( d->size*sizeof(size_t) );
+  memcpy(d->indegree,src->indegree,d->size*sizeof(size_t));
+  edges_DAG(d);
+  memcpy(d->in_edges,src->in_edges,d->in_offset[d->size]*sizeof(Vertex));
 
-  assert(d->indegree );
-  assert(d->outdegree);
+  dag_precompute_data(d);
 
-  memcpy(d->indegree,src->indegree,d->size);
-  memcpy(d->outdegree,src->outdegree,d->size);
+  assert(isconsistent_DAG(d)); /* Construction should be sound */
+  return d;
+}
 
-  /*
-     If the original graph is not well formed (e.g. it has outgoing
-     edges but not the respective incoming edges) we copy the same
-     defects.
-  */
-  
-  /* Copy of incoming neighbour information */
-  Vertex v;
-  for(v=0;v<d->size;v++) {
 
-    if (d->indegree[v]==0) { d->in[v]=NULL; continue; }
+/* This builds the graph with one more vertex, the new sink, whose
+   predecessors are the sinks of the source.  A graph with a single
+   sink is just copied. */
+DAG* closesinks_DAG(const DAG *src) {
 
-    d->in[v]  = (Vertex*)malloc( (d->indegree[v]) *sizeof(Vertex) );
-    assert(d->in [v]  );
-    assert(src->in [v]);
-    memcpy(d->in[v],src->in[v],d->size);
-  }
+  assert(isconsistent_DAG(src));
 
-  /* Copy of outgoing neighbour information */
-  for(v=0;v<d->size;v++) {
+  if (src->sink_number==1) return copy_DAG(src);
 
-    if (d->outdegree[v]==0) { d->out[v]=NULL; continue; }
+  DAG *d=new_DAG(src->size+1);
 
-    d->out[v] = (Vertex*)malloc( (d->outdegree[v])*sizeof(Vertex) );
-    assert(d->out   [v]);
-    assert(src->out [v]);
-    memcpy(d->out[v],src->out[v],d->size);
-  }
+  memcpy(d->indegree,src->indegree,src->size*sizeof(size_t));
+  d->indegree[src->size]=src->sink_number;
+  edges_DAG(d);
+  memcpy(d->in_edges,src->in_edges,src->in_offset[src->size]*sizeof(Vertex));
+  memcpy(d->in[src->size],src->sinks,src->sink_number*sizeof(Vertex));
 
   dag_precompute_data(d);
 
@@ -157,21 +226,24 @@ void dispose_DAG(DAG* p) {
   /* Ignore null graphs */
   if (p==NULL) return;
 
-  Vertex v; /* index variable */
-
-  /* Remove incoming arcs arrays */
-  if (p->in!=NULL) {
-    for(v=0;v<p->size;v++)
-      if (p->in[v]!=NULL) free(p->in[v]);
+  /* The arrays are in the image */
+  if (p->image) {
     free(p->in);
-  }
-  /* Remove outgoing arcs arrays */
-  if (p->out!=NULL) {
-    for(v=0;v< p->size ;v++)
-      if (p->out[v]!=NULL) free(p->out[v]);
     free(p->out);
+    if (p->image_length>0) munmap(p->image,p->image_length);
+    else free(p->image);
+    free(p);
+    return;
   }
 
+  /* Remove the arcs arrays */
+  if (p->in        !=NULL) free(p->in);
+  if (p->out       !=NULL) free(p->out);
+  if (p->in_edges  !=NULL) free(p->in_edges);
+  if (p->out_edges !=NULL) free(p->out_edges);
+  if (p->in_offset !=NULL) free(p->in_offset);
+  if (p->out_offset!=NULL) free(p->out_offset);
+
   /* Dispose other arays */
   if (p->indegree  !=NULL) free(p->indegree );
   if (p->outdegree !=NULL) free(p->outdegree);
@@ -184,11 +256,48 @@ void dispose_DAG(DAG* p) {
   free(p);
 }
 
-/* TODO: Check that the data structure representing the graph is sound,
-   meaning that any outgoing edge is related with a corresponding
-   incoming edge, that the degrees have been computed appropriately.
-   All checks are rather exprensive but this is not an issue for the
-   application of pebbling. */
+/* Whether the arrays of the graph are sound, in one pass over them:
+   the offsets start at zero, grow by the degrees up to the number of
+   edges, each predecessor comes before its vertex and each successor
+   after it, the sources and the sinks are vertices without incoming
+   and outgoing edges, and the bitmasks (if any) are the ones of the
+   lists.  Nothing is read out of the arrays, so that a damaged graph
+   image is rejected before it is used. */
+static Boolean wellformed_DAG(const DAG *g) {
+
+  size_t n=g->size;
+  size_t edges=g->in_offset[n];
+
+  if (g->in_offset[0]!=0 || g->out_offset[0]!=0 || g->out_offset[n]!=edges) return FALSE;
+  for(Vertex v=0;v<n;v++) {
+    if (g->in_offset[v] >g->in_offset[v+1]  || g->in_offset[v+1] >edges) return FALSE;
+    if (g->out_offset[v]>g->out_offset[v+1] || g->out_offset[v+1]>edges) return FALSE;
+    if (g->indegree[v] !=g->in_offset[v+1] -g->in_offset[v])  return FALSE;
+    if (g->outdegree[v]!=g->out_offset[v+1]-g->out_offset[v]) return FALSE;
+  }
+  for(Vertex v=0;v<n;v++) {
+    BitTuple pred=BITTUPLE_ZERO;
+    BitTuple succ=BITTUPLE_ZERO;
+    for(size_t e=g->in_offset[v];e<g->in_offset[v+1];e++) {
+      if (g->in_edges[e]>=v) return FALSE;
+      if (g->pred_bitmasks) pred |= BITTUPLE_UNIT << g->in_edges[e];
+    }
+    for(size_t e=g->out_offset[v];e<g->out_offset[v+1];e++) {
+      if (g->out_edges[e]<=v || g->out_edges[e]>=n) return FALSE;
+      if (g->succ_bitmasks) succ |= BITTUPLE_UNIT << g->out_edges[e];
+    }
+    if (g->pred_bitmasks && (g->pred_bitmasks[v]!=pred || g->succ_bitmasks[v]!=succ)) return FALSE;
+  }
+  for(size_t i=0;i<g->source_number;i++)
+    if (g->sources[i]>=n || g->indegree[g->sources[i]]!=0) return FALSE;
+  for(size_t i=0;i<g->sink_number;i++)
+    if (g->sinks[i]>=n || g->outdegree[g->sinks[i]]!=0) return FALSE;
+  return TRUE;
+}
+
+/* Check that the data structure representing the graph is sound (see
+   wellformed_DAG).  The check is rather expensive, but this is not an
+   issue for the application of pebbling. */
 Boolean isconsistent_DAG(const DAG *ptr) {
 
   assert(ptr);
@@ -199,6 +308,9 @@ Boolean isconsistent_DAG(const DAG *ptr) {
 
   assert(ptr->in);
   assert(ptr->out);
+  assert(ptr->in_offset  && ptr->in_edges);
+  assert(ptr->out_offset && ptr->out_edges);
+  assert(ptr->in_offset[ptr->size]==ptr->out_offset[ptr->size]);
 
   assert(ptr->sinks);
   assert(ptr->sources);
@@ -211,7 +323,7 @@ Boolean isconsistent_DAG(const DAG *ptr) {
     assert(ptr->pred_bitmasks==NULL);
     assert(ptr->succ_bitmasks==NULL);
   }
-  return TRUE;
+  return wellformed_DAG(ptr);
 }
 
 
@@ -302,6 +414,177 @@ void fprint_dot_DAG(FILE *outfile,
   fprintf(outfile,"}\n");
 
 }
+
+
+/* Header of a binary image.  The arrays follow, in the order of the
+   fields of DAG, each one of a multiple of 8 bytes. */
+typedef struct {
+
+  char   magic[8];         /* DAG_IMAGE_MAGIC */
+  size_t layout;           /* DAG_IMAGE_LAYOUT, as written by the machine */
+  size_t version;
+  size_t size;
+  size_t edges;
+  size_t source_number;
+  size_t sink_number;
+  size_t bitmasks;         /* The bitmasks are present */
+
+} DAGImageHeader;
+
+#define DAG_IMAGE_LAYOUT ((size_t)0x0102030405060708ULL)
+
+/* Length of the image described by the header, zero if malformed */
+static size_t imagelength(const DAGImageHeader *h) {
+
+  size_t words;
+
+  if (h->size>SIZE_MAX/64 || h->edges>SIZE_MAX/64) return 0;
+  words = 4*h->size + 2 + 2*h->edges + h->source_number + h->sink_number;
+
+  if (memcmp(h->magic,DAG_IMAGE_MAGIC,sizeof(h->magic))!=0 ||
+      h->layout!=DAG_IMAGE_LAYOUT || h->version!=DAG_IMAGE_VERSION ||
+      h->size==0 || h->source_number==0 || h->sink_number==0 ||
+      h->source_number>h->size || h->sink_number>h->size ||
+      h->bitmasks!=(h->size<=BITTUPLE_SIZE)) return 0;
+
+  return sizeof(DAGImageHeader) + words*sizeof(size_t) +
+    (h->bitmasks ? 2*h->size*sizeof(BitTuple) : 0);
+}
+
+/* Writes the binary image of the DAG. */
+Boolean fwrite_DAG(FILE *outfile,const DAG *p) {
+
+  assert(isconsistent_DAG(p));
+  assert(sizeof(Vertex)==sizeof(size_t));
+
+  DAGImageHeader h;
+  memset(&h,0,sizeof(h));
+  memcpy(h.magic,DAG_IMAGE_MAGIC,sizeof(h.magic));
+  h.layout  = DAG_IMAGE_LAYOUT;
+  h.version = DAG_IMAGE_VERSION;
+  h.size    = p->size;
+  h.edges   = p->in_offset[p->size];
+  h.source_number = p->source_number;
+  h.sink_number   = p->sink_number;
+  h.bitmasks      = (p->pred_bitmasks!=NULL);
+
+  Boolean ok = fwrite(&h,sizeof(h),1,outfile)==1;
+  ok = ok && fwrite(p->indegree,  sizeof(size_t),p->size,outfile)==p->size;
+  ok = ok && fwrite(p->outdegree, sizeof(size_t),p->size,outfile)==p->size;
+  ok = ok && fwrite(p->in_offset, sizeof(size_t),p->size+1,outfile)==p->size+1;
+  ok = ok && fwrite(p->out_offset,sizeof(size_t),p->size+1,outfile)==p->size+1;
+  ok = ok && fwrite(p->in_edges,  sizeof(Vertex),h.edges,outfile)==h.edges;
+  ok = ok && fwrite(p->out_edges, sizeof(Vertex),h.edges,outfile)==h.edges;
+  ok = ok && fwrite(p->sources,   sizeof(Vertex),h.source_number,outfile)==h.source_number;
+  ok = ok && fwrite(p->sinks,     sizeof(Vertex),h.sink_number,outfile)==h.sink_number;
+  if (h.bitmasks) {
+    ok = ok && fwrite(p->pred_bitmasks,sizeof(BitTuple),p->size,outfile)==p->size;
+    ok = ok && fwrite(p->succ_bitmasks,sizeof(BitTuple),p->size,outfile)==p->size;
+  }
+  return ok;
+}
+
+/* The graph whose image starts at `data', whose header has been
+   validated by imagelength, with `available' bytes from `data' to the
+   end of the image.  The arrays stay in the image, and they are
+   checked before use: NULL if they are not sound. */
+static DAG *imagegraph(void *image,size_t image_length,char *data,size_t available) {
+
+  const DAGImageHeader *h=(const DAGImageHeader*)data;
+  size_t *word=(size_t*)(data+sizeof(DAGImageHeader));
+
+  DAG *d=(DAG*)malloc(sizeof(DAG));
+  assert(d);
+
+  d->size          = h->size;
+  d->source_number = h->source_number;
+  d->sink_number   = h->sink_number;
+  d->indegree      = word; word += h->size;
+  d->outdegree     = word; word += h->size;
+  d->in_offset     = word; word += h->size+1;
+  d->out_offset    = word; word += h->size+1;
+  d->in_edges      = (Vertex*)word; word += h->edges;
+  d->out_edges     = (Vertex*)word; word += h->edges;
+  d->sources       = (Vertex*)word; word += h->source_number;
+  d->sinks         = (Vertex*)word; word += h->sink_number;
+  d->pred_bitmasks = h->bitmasks ? (BitTuple*)word : NULL;
+  d->succ_bitmasks = h->bitmasks ? (BitTuple*)word + h->size : NULL;
+  d->image         = image;
+  d->image_length  = image_length;
+
+  d->in  = (Vertex**)malloc( d->size*sizeof(Vertex*) );
+  d->out = (Vertex**)malloc( d->size*sizeof(Vertex*) );
+  assert(d->in && d->out);
+
+  if (imagelength(h)>available ||
+      d->in_offset[d->size]!=h->edges || d->out_offset[d->size]!=h->edges ||
+      !wellformed_DAG(d)) {
+    fprintf(stderr,"c ERROR: malformed graph image.\n");
+    dispose_DAG(d);
+    return NULL;
+  }
+  for(Vertex v=0;v<d->size;v++) {
+    d->in[v]  = d->in_edges +d->in_offset[v];
+    d->out[v] = d->out_edges+d->out_offset[v];
+  }
+  assert(isconsistent_DAG(d));
+  return d;
+}
+
+/* Reads the binary image of a DAG, and leaves the stream after it.
+   NULL if the image is malformed, or it has been written by a machine
+   with a different layout. */
+DAG *fread_DAG(FILE *infile) {
+
+  DAGImageHeader h;
+  struct stat info;
+  off_t  offset=ftello(infile);
+  int    fd=fileno(infile);
+  size_t length;
+
+  /* Map the file if the image can be used in place */
+  if (offset>=0 && offset%sizeof(size_t)==0 && fd>=0 && fstat(fd,&info)==0 &&
+      S_ISREG(info.st_mode) && info.st_size-offset>=(off_t)sizeof(h)) {
+
+    void *map=mmap(NULL,(size_t)info.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+    if (map!=MAP_FAILED) {
+      memcpy(&h,(char*)map+offset,sizeof(h));
+      length=imagelength(&h);
+      if (length==0 || (off_t)length>info.st_size-offset) {
+        fprintf(stderr,"c ERROR: malformed or incompatible graph image.\n");
+        munmap(map,(size_t)info.st_size);
+        return NULL;
+      }
+      fseeko(infile,offset+(off_t)length,SEEK_SET);
+      return imagegraph(map,(size_t)info.st_size,(char*)map+offset,
+                        (size_t)(info.st_size-offset));
+    }
+  }
+
+  /* Otherwise read it in a single block */
+  if (fread(&h,sizeof(h),1,infile)!=1 || (length=imagelength(&h))==0) {
+    fprintf(stderr,"c ERROR: malformed or incompatible graph image.\n");
+    return NULL;
+  }
+  char *data=(char*)malloc(length);
+  assert(data);
+  memcpy(data,&h,sizeof(h));
+  if (fread(data+sizeof(h),1,length-sizeof(h),infile)!=length-sizeof(h)) {
+    fprintf(stderr,"c ERROR: truncated graph image.\n");
+    free(data);
+    return NULL;
+  }
+  return imagegraph(data,0,data,length);
+}
+
+/* Whether the stream starts with a binary image, rather than with a
+   graph in KTH format.  Nothing is consumed. */
+Boolean isimage_DAG(FILE *infile) {
+  int c=fgetc(infile);
+  if (c==EOF) return FALSE;
+  ungetc(c,infile);
+  return c==(unsigned char)DAG_IMAGE_MAGIC[0];
+}
 /* }}} */
 
 
@@ -313,46 +596,15 @@ void fprint_dot_DAG(FILE *outfile,
 /* {{{ */ DAG* tree(int height) {
 
   Vertex u,v;
-  DAG *d=(DAG*)malloc(sizeof(DAG));
-  assert(d);
+  DAG *d;
   assert(height>=0);
 
-  /* Set to null sinks and source vector */
-  d->pred_bitmasks=NULL;
-  d->succ_bitmasks=NULL;
-  d->sources=NULL;
-  d->sinks=NULL;
-
   /* Size of the vertex set */
-  d->size=(1<<height) + ((1 << height) - 1);
-
-  /* Allocation of degree information */
-
-  d->in  = (Vertex**)malloc( d->size*sizeof(Vertex*) );
-  d->out = (Vertex**)malloc( d->size*sizeof(Vertex*) );
-
-  assert(d->in );
-  assert(d->out);
-
-  d->indegree  = (size_t*)calloc( d->size,sizeof(size_t) );
-  d->outdegree = (size_t*)calloc( d->size,sizeof(size_t) );
-
-  assert(d->indegree );
-  assert(d->outdegree);
+  d=new_DAG((1<<height) + ((1 << height) - 1));
 
   /* Computing of degree information */
-  for(v=0; v < (1<<height); v++)       d->indegree[v]=0;  /* Source elements */
   for(v=(1<<height); v < d->size; v++) d->indegree[v]=2;  /* Non source elements */
-  for(v=0; v < d->size-1; v++)         d->outdegree[v]=1; /* Non sink elements */
-  d->outdegree[v]=0;
-
-  /* Allocation of neighbour informations */
-  for(v=0;v<d->size;v++) {
-    d->in[v]  = (Vertex*)malloc( (d->indegree[v]) *sizeof(Vertex) );
-    d->out[v] = (Vertex*)malloc( (d->outdegree[v])*sizeof(Vertex) );
-    assert(d->in [v]);
-    assert(d->out[v]);
-  }
+  edges_DAG(d);
 
   /* Incoming vertices */
   /* Notice that in a level by level enumeration from root to leafs,
@@ -364,12 +616,6 @@ void fprint_dot_DAG(FILE *outfile,
     d->in[v][0]=u++;
     d->in[v][1]=u++;
   }
-  u=(1<<height);
-  for(v=0; v < d->size-2; v+=2) { /* Non sink elements */
-    d->out[v  ][0]=u;
-    d->out[v+1][0]=u;
-    u++;
-  }
 
   dag_precompute_data(d);
   assert(isconsistent_DAG(d)); /* Construction should be sound */
@@ -395,74 +641,28 @@ void fprint_dot_DAG(FILE *outfile,
 */
 
   int i,j,v;
-  DAG *d=(DAG*)malloc(sizeof(DAG));
-  assert(d);
+  DAG *d;
   assert(h>=0);
 
-  /* Set to null sinks and source vector */
-  d->pred_bitmasks=NULL;
-  d->succ_bitmasks=NULL;
-  d->sources=NULL;
-  d->sinks=NULL;
-
-
-  /* Allocation of degree information */
-  d->size = (h+2)*(h+1) / 2;
-
-  d->in  = (Vertex**)malloc( d->size*sizeof(Vertex*) );
-  d->out = (Vertex**)malloc( d->size*sizeof(Vertex*) );
-
-  assert(d->in );
-  assert(d->out);
-
-  d->indegree  = (size_t*)calloc( d->size,sizeof(size_t) );
-  d->outdegree = (size_t*)calloc( d->size,sizeof(size_t) );
-
-  assert(d->indegree );
-  assert(d->outdegree);
+  d=new_DAG((h+2)*(h+1) / 2);
 
   /* Computing of degree information */
-  v=0;
-  for (i=0; i < h; ++i)
-  {
-    d->outdegree[v]=1;      /* First of each level has only an arc */
-    v++;
-    for (j = 1; j < h-i; ++j) {
-      d->outdegree[v]=2;
-      v++;
-    }
-    d->outdegree[v]=1;     /* Last of each level has only an arc */
-    v++;
-  }
-  for(v=h+1;v<d->size;v++) d->indegree[v]=2; /* Indegree is 2 for any non source */
-
-  /* Allocation of neighbour informations */
-  for(v=0;v<d->size;v++) {
-    d->in[v]  = (Vertex*)malloc( (d->indegree[v]) *sizeof(Vertex) );
-    d->out[v] = (Vertex*)malloc( (d->outdegree[v])*sizeof(Vertex) );
-    assert(d->in [v]);
-    assert(d->out[v]);
-  }
+  for(v=h+1;v<(int)d->size;v++) d->indegree[v]=2; /* Indegree is 2 for any non source */
+  edges_DAG(d);
 
   /* Fix the incoming vertices */
   v=0;
   for (i=0; i < h; ++i)
   {
     /* First of each level has only an arc */
-    d->out      [v][0]=v+h+1-i;
     d->in [v+h+1-i][0]=v      ;
     v++;
     for (j = 1; j < h-i; ++j) {
-
-      d->out      [v][0]=v+h-i;   /* Left arc */
-      d->in [v+h  -i][1]=v;
-
-      d->out      [v][1]=v+h+1-i; /* Right arc */
-      d->in [v+h+1-i][0]=v;
+      d->in [v+h  -i][1]=v;       /* Left arc */
+      d->in [v+h+1-i][0]=v;       /* Right arc */
       v++;
     }
-    d->out      [v][0]=v+h-i;  /* Last of each level has only an arc */
-    d->in [v+h  -i][1]=v;
+    d->in [v+h  -i][1]=v;       /* Last of each level has only an arc */
     v++;
   }
 
@@ -481,51 +681,14 @@ void fprint_dot_DAG(FILE *outfile,
 */
 
   int v;
-  DAG *d=(DAG*)malloc(sizeof(DAG));
-  assert(d);
-
-  /* Set to null sinks and source vector */
-  d->pred_bitmasks=NULL;
-  d->succ_bitmasks=NULL;
-  d->sources=NULL;
-  d->sinks=NULL;
-
-  /* Allocation of degree information */
-  d->size = n+1;
-
-  d->in  = (Vertex**)malloc( d->size*sizeof(Vertex*) );
-  d->out = (Vertex**)malloc( d->size*sizeof(Vertex*) );
-
-  assert(d->in );
-  assert(d->out);
-
-  d->indegree  = (size_t*)calloc( d->size,sizeof(size_t) );
-  d->outdegree = (size_t*)calloc( d->size,sizeof(size_t) );
-
-  assert(d->indegree );
-  assert(d->outdegree);
+  DAG *d=new_DAG(n+1);
 
   /* Computing of degree information */
-  for(v=0; v < n; ++v)
-  {
-    d->outdegree[v] =1;      /* Except for last vertex: outdegree is 1 */
-    d->indegree[v+1]=1;      /* Except for first vertex: indegree is 1 */
-  }
-
-  /* Allocation of neighbour informations */
-  for(v=0;v<d->size;v++) {
-    d->in[v]  = (Vertex*)malloc( (d->indegree[v]) *sizeof(Vertex) );
-    d->out[v] = (Vertex*)malloc( (d->outdegree[v])*sizeof(Vertex) );
-    assert(d->in [v]);
-    assert(d->out[v]);
-  }
+  for(v=0; v < n; ++v) d->indegree[v+1]=1;  /* Except for first vertex: indegree is 1 */
+  edges_DAG(d);
 
   /* Fix the incoming vertices */
-  for(v=0; v < n; ++v)
-  {
-    d->out[v][0] =v+1;      /* Except for last vertex: outdegree is 1 */
-    d->in[v+1][0]=v;        /* Except for first vertex: indegree is 1 */
-  }
+  for(v=0; v < n; ++v) d->in[v+1][0]=v;
 
   dag_precompute_data(d);
   assert(isconsistent_DAG(d)); /* Construction should be sound */
@@ -547,62 +710,414 @@ void fprint_dot_DAG(FILE *outfile,
 */
 
   int v;
-  DAG *d=(DAG*)malloc(sizeof(DAG));
-  assert(d);
+  DAG *d=new_DAG(n+1);
 
-  /* Set to null sinks and source vector */
-  d->pred_bitmasks=NULL;
-  d->succ_bitmasks=NULL;
-  d->sources=NULL;
-  d->sinks=NULL;
+  /* Computing of degree information */
+  d->indegree[n]=n;        /* All the other vertices are sources */
+  edges_DAG(d);
 
-  /* Allocation of degree information */
-  d->size = n+1;
+  /* Fix the incoming vertices */
+  for(v=0; v < n; ++v) d->in[n][v] = v;
 
-  d->in  = (Vertex**)malloc( d->size*sizeof(Vertex*) );
-  d->out = (Vertex**)malloc( d->size*sizeof(Vertex*) );
+  dag_precompute_data(d);
+  assert(isconsistent_DAG(d)); /* Construction should be sound */
+  return d;
+}
+/* }}} */
+
+
+
+/* Build a grid. */
+/* {{{ */ DAG* grid(int w,int h) {
+/*
+
+   8 -- 9 --10 --11
+   |    |    |    |
+   4 -- 5 -- 6 -- 7     a grid of width 4 and height 3: each vertex
+   |    |    |    |     has the one below and the one on its left as
+   0 -- 1 -- 2 -- 3     predecessors.
 
-  assert(d->in );
-  assert(d->out);
+*/
 
-  d->indegree  = (size_t*)calloc( d->size,sizeof(size_t) );
-  d->outdegree = (size_t*)calloc( d->size,sizeof(size_t) );
+  int i,j;
+  DAG *d;
+  assert(w>0 && h>0);
 
-  assert(d->indegree );
-  assert(d->outdegree);
+  d=new_DAG((size_t)w*(size_t)h);
 
   /* Computing of degree information */
-  for(v=0; v < n; ++v)
-  {
-    d->outdegree[v]=1;      /* Except for last vertex: outdegree is 1 */
-    d->indegree [v]=0;      /* Except for last vertex: indegree is  0 */
-  }
-  d->outdegree[n]=0;
-  d->indegree [n]=n;
+  for(i=0;i<h;i++)
+    for(j=0;j<w;j++) d->indegree[(size_t)i*w+j] = (i>0) + (j>0);
+  edges_DAG(d);
+
+  /* Fix the incoming vertices, the one below first */
+  for(i=0;i<h;i++)
+    for(j=0;j<w;j++) {
+      Vertex v=(size_t)i*w+j;
+      Vertex *p=d->in[v];
+      if (i>0) *(p++)=v-w;
+      if (j>0) *(p++)=v-1;
+    }
 
-  /* Allocation of neighbour informations */
-  for(v=0;v<d->size;v++) {
-    d->in[v]  = (Vertex*)malloc( (d->indegree[v]) *sizeof(Vertex) );
-    d->out[v] = (Vertex*)malloc( (d->outdegree[v])*sizeof(Vertex) );
-    assert(d->in [v]);
-    assert(d->out[v]);
-  }
+  dag_precompute_data(d);
+  assert(isconsistent_DAG(d)); /* Construction should be sound */
+  return d;
+}
+/* }}} */
+
+
+/* Levels of width 2^k, where vertex x of level l has as predecessors
+   the vertices x and x XOR 2^bit(l) of level l-1.  The butterfly has
+   bit(l)=l-1 for l=1...k.  A superconcentrator is a butterfly
+   followed by a reversed one, and the stack repeats it. */
+static int butterflybit(int k,Boolean stacked,int l) {
+  int j;
+  if (!stacked) return l-1;
+  j=(l-1)%(2*k);
+  return j<k ? j : 2*k-1-j;
+}
+
+static DAG* levels(int k,int depth,Boolean stacked) {
+
+  size_t n=(size_t)1<<k;
+  size_t x;
+  int l;
+  DAG *d=new_DAG(n*(depth+1));
+
+  /* Computing of degree information */
+  for(x=n;x<d->size;x++) d->indegree[x]=2;  /* All but the first level */
+  edges_DAG(d);
 
   /* Fix the incoming vertices */
-  for(v=0; v < n; ++v)
-  {
-    d->out[v][0] = n;      /* Except for last vertex: outdegree is 1 */
-    d-> in[n][v] = v;
+  for(l=1;l<=depth;l++) {
+    size_t bit=(size_t)1<<butterflybit(k,stacked,l);
+    for(x=0;x<n;x++) {
+      Vertex v=l*n+x;
+      d->in[v][0]=(l-1)*n+(x & ~bit);
+      d->in[v][1]=(l-1)*n+(x |  bit);
+    }
   }
+
   dag_precompute_data(d);
   assert(isconsistent_DAG(d)); /* Construction should be sound */
   return d;
 }
+
+/* Build a butterfly. */
+/* {{{ */ DAG* butterfly(int k) {
+/*
+
+   8   9  10  11
+   | \/ \/ \/ |
+   | /\ /\ /\ |     the butterfly of dimension 2: k+1 levels of 2^k
+   4   5   6   7     vertices, and the edges of level l cross at
+   | \/|   | \/|     distance 2^(l-1).
+   | /\|   | /\|
+   0   1   2   3
+
+*/
+  assert(k>=1 && k<(int)(8*sizeof(size_t)-8));
+  return levels(k,k,FALSE);
+}
 /* }}} */
 
+/* Build a stack of superconcentrators. */
+/* {{{ */ DAG* superconcentrators(int k,int stack) {
+/*
+
+   Each superconcentrator connects 2^k inputs to 2^k outputs with a
+   butterfly followed by a reversed butterfly, i.e. a Benes network,
+   which has vertex disjoint paths between any r inputs and any r
+   outputs.  The outputs of each superconcentrator are the inputs of
+   the next one.
+
+*/
+  assert(k>=1 && stack>=1 && k<(int)(8*sizeof(size_t)-8));
+  return levels(k,2*k*stack,TRUE);
+}
+/* }}} */
+
+
+/* A graph built vertex by vertex, in topological order, in two
+   passes: the first one only counts the vertices and the edges, the
+   second one writes them in the graph. */
+typedef struct {
+
+  DAG    *dag;            /* NULL during the first pass */
+  Vertex *edges;
+  size_t  vertices;
+  size_t  edge_count;
+
+} Builder;
+
+static Vertex addvertex(Builder *b,const Vertex *pred,size_t k) {
+
+  if (b->dag) {
+    Vertex *p=b->edges+b->edge_count;
+    b->dag->indegree[b->vertices]=k;
+    for(size_t i=0;i<k;i++) {            /* Insertion sort */
+      size_t j=i;
+      assert(pred[i]<b->vertices);
+      while(j>0 && p[j-1]>pred[i]) { p[j]=p[j-1]; j--; }
+      assert(j==0 || p[j-1]!=pred[i]);
+      p[j]=pred[i];
+    }
+  }
+  b->edge_count += k;
+  return b->vertices++;
+}
+
+static DAG *build(void (*construction)(Builder*,const void*),const void *data) {
+
+  Builder b;
+  memset(&b,0,sizeof(b));
+  construction(&b,data);
 
+  b.dag=new_DAG(b.vertices);
+  b.edges=(Vertex*)malloc((b.edge_count+1)*sizeof(Vertex));
+  assert(b.edges);
+  b.vertices=0;
+  b.edge_count=0;
+  construction(&b,data);
 
-/* Build the OR product of two DAGs
+  adoptedges_DAG(b.dag,b.edges);
+  dag_precompute_data(b.dag);
+  assert(isconsistent_DAG(b.dag)); /* Construction should be sound */
+  return b.dag;
+}
+
+/* The 2k levels of a superconcentrator on top of `level', which then
+   holds its outputs. */
+static void superconcentrator_levels(Builder *b,Vertex *level,int k) {
+  size_t n=(size_t)1<<k;
+  Vertex *next=(Vertex*)malloc(n*sizeof(Vertex));
+  Vertex pred[2];
+  assert(next);
+  for(int l=1;l<=2*k;l++) {
+    size_t bit=(size_t)1<<butterflybit(k,TRUE,l);
+    for(size_t x=0;x<n;x++) {
+      pred[0]=level[x];
+      pred[1]=level[x^bit];
+      next[x]=addvertex(b,pred,2);
+    }
+    memcpy(level,next,n*sizeof(Vertex));
+  }
+  free(next);
+}
+
+/* The graph G_i on the 2^i inputs in `in', with its outputs written
+   in `out'. */
+static void ptclevels(Builder *b,const Vertex *in,Vertex *out,int i) {
+
+  size_t n=(size_t)1<<i;
+  Vertex pred[2];
+
+  if (i==0) {
+    out[0]=addvertex(b,in,1);
+    return;
+  }
+
+  Vertex *x=(Vertex*)malloc(n*sizeof(Vertex));
+  Vertex *y=(Vertex*)malloc(n*sizeof(Vertex));
+  assert(x && y);
+
+  memcpy(x,in,n*sizeof(Vertex));
+  superconcentrator_levels(b,x,i);
+
+  /* The two copies of G_{i-1} one after the other: the first one on
+     the first half of the outputs, the second one on its outputs and
+     on the second half. */
+  ptclevels(b,x,y,i-1);
+  for(size_t j=0;j<n/2;j++) {
+    pred[0]=y[j];
+    pred[1]=x[n/2+j];
+    x[n/2+j]=addvertex(b,pred,2);
+  }
+  ptclevels(b,x+n/2,y+n/2,i-1);
+
+  superconcentrator_levels(b,y,i);
+  for(size_t j=0;j<n;j++) {
+    pred[0]=y[j];
+    pred[1]=in[j];
+    out[j]=addvertex(b,pred,2);
+  }
+  free(x);
+  free(y);
+}
+
+static void ptcconstruction(Builder *b,const void *data) {
+  int i=*(const int*)data;
+  size_t n=(size_t)1<<i;
+  Vertex *in=(Vertex*)malloc(n*sizeof(Vertex));
+  Vertex *out=(Vertex*)malloc(n*sizeof(Vertex));
+  assert(in && out);
+  for(size_t j=0;j<n;j++) in[j]=addvertex(b,NULL,0);
+  ptclevels(b,in,out,i);
+  free(in);
+  free(out);
+}
+
+/* Build a graph in the style of Paul, Tarjan and Celoni. */
+/* {{{ */ DAG* ptc(int i) {
+/*
+
+   G_i has 2^i inputs and 2^i outputs.  The inputs go through a
+   superconcentrator; the first half of its outputs feeds a copy of
+   G_{i-1}, and the outputs of that copy together with the second
+   half feed a second copy.  The outputs of the two copies go
+   through a second superconcentrator, and each output of G_i has
+   also an edge from the corresponding input.  G_0 is a single edge.
+
+*/
+  assert(i>=0 && i<(int)(8*sizeof(size_t)-8));
+  return build(ptcconstruction,&i);
+}
+/* }}} */
+
+
+/* The generator of the random graphs, reproducible everywhere */
+static inline BitTuple splitmix(BitTuple *state) {
+  BitTuple z=(*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+typedef struct {
+
+  size_t        size;
+  const double *weight;     /* Unnormalized probability of each indegree */
+  size_t        degrees;
+  BitTuple      seed;
+
+} RandomDAGParameters;
+
+static void randomconstruction(Builder *b,const void *data) {
+
+  const RandomDAGParameters *r=(const RandomDAGParameters*)data;
+  BitTuple state=r->seed;
+  Vertex  *pred=(Vertex*)malloc((r->degrees+1)*sizeof(Vertex));
+  double   total=0.0;
+
+  assert(pred);
+  for(size_t d=0;d<r->degrees;d++) total+=r->weight[d];
+
+  for(Vertex v=0;v<r->size;v++) {
+
+    /* The indegree, at most the number of previous vertices */
+    double coin=(double)(splitmix(&state)>>11)*(1.0/9007199254740992.0)*total;
+    size_t k=0;
+    while(k+1<r->degrees && coin>=r->weight[k]) coin-=r->weight[k++];
+    if (k>v) k=v;
+
+    /* Distinct predecessors, uniformly among the previous vertices */
+    for(size_t i=0;i<k;i++) {
+      Boolean fresh;
+      do {
+        pred[i]=splitmix(&state)%v;
+        fresh=TRUE;
+        for(size_t j=0;j<i;j++) fresh = fresh && pred[j]!=pred[i];
+      } while(!fresh);
+    }
+    addvertex(b,pred,k);
+  }
+  free(pred);
+}
+
+/* Build a random graph. */
+/* {{{ */ DAG* randomdag(size_t n,const double *weight,size_t degrees,BitTuple seed) {
+/*
+
+   Vertex v has indegree d with probability proportional to
+   weight[d], for d < degrees, or v if smaller.  The predecessors are
+   distinct, and uniformly chosen among 0...v-1.  The same seed gives
+   the same graph on every machine.
+
+*/
+  RandomDAGParameters r;
+  assert(n>0 && degrees>0);
+  r.size=n;
+  r.weight=weight;
+  r.degrees=degrees;
+  r.seed=seed;
+  return build(randomconstruction,&r);
+}
+/* }}} */
+
+
+/* The graph of the family described by `spec', or NULL if the
+   description is malformed.  See DAG_FAMILIES_MESSAGE in dag.h. */
+DAG *generate_DAG(const char *spec) {
+
+  /* The suffix +sink closes the sinks of the graph */
+  size_t total=strlen(spec);
+  if (total>5 && strcmp(spec+total-5,"+sink")==0) {
+    char *base=(char*)malloc(total-4);
+    assert(base);
+    memcpy(base,spec,total-5);
+    base[total-5]='\0';
+    DAG *g=generate_DAG(base);
+    free(base);
+    if (g==NULL) return NULL;
+    DAG *closed=closesinks_DAG(g);
+    dispose_DAG(g);
+    return closed;
+  }
+
+  const char *colon=strchr(spec,':');
+  size_t      length= colon ? (size_t)(colon-spec) : strlen(spec);
+  const char *args  = colon ? colon+1 : "";
+  int a=0,b=0,used=-1;
+
+#define FAMILY(name) (length==strlen(name) && strncmp(spec,name,length)==0)
+#define ARGS1(low,high) (sscanf(args,"%d%n",&a,&used)==1 && args[used]=='\0' && \
+                         a>=(low) && a<=(high))
+#define ARGS2(low,high,low2,high2) (sscanf(args,"%d:%d%n",&a,&b,&used)==2 && args[used]=='\0' && \
+                                    a>=(low) && a<=(high) && b>=(low2) && b<=(high2))
+
+  if (FAMILY("pyramid") && ARGS1(1,60000))  return pyramid(a);
+  if (FAMILY("tree")    && ARGS1(1,30))      return tree(a);
+  if (FAMILY("path")    && ARGS1(1,INT_MAX-1)) return path(a);
+  if (FAMILY("grid")    && ARGS2(1,INT_MAX,1,INT_MAX) &&
+      (size_t)a*(size_t)b < ((size_t)1<<40)) return grid(a,b);
+  if (FAMILY("butterfly") && ARGS1(1,30))  return butterfly(a);
+  if (FAMILY("superconcentrator") && ARGS2(1,30,1,1<<20) &&
+      (size_t)a*(size_t)b <= (1<<20)) return superconcentrators(a,b);
+  if (FAMILY("ptc") && ARGS1(0,16)) return ptc(a);
+
+  if (FAMILY("random")) {
+    unsigned long long n,seed;
+    double weight[64];
+    size_t degrees=0;
+    const char *p;
+
+    if (sscanf(args,"%llu:%llu:%n",&n,&seed,&used)!=2 || used<0 || n==0) return NULL;
+    p=args+used;
+    while(degrees<64) {
+      char *end;
+      weight[degrees]=strtod(p,&end);
+      if (end==p || weight[degrees]<0) return NULL;
+      degrees++;
+      if (*end=='\0') break;
+      if (*end!=',') return NULL;
+      p=end+1;
+    }
+    if (degrees==64) return NULL;
+    double total=0.0;
+    for(size_t d=0;d<degrees;d++) total+=weight[d];
+    if (total<=0.0) return NULL;
+    return randomdag((size_t)n,weight,degrees,(BitTuple)seed);
+  }
+
+#undef FAMILY
+#undef ARGS1
+#undef ARGS2
+
+  return NULL;
+}
+
+
+/* The OR product of two DAGs
 
    The OR product means that there is a vertex (i,j) for every vertex
    i of the outer graph and vertex j of the inner graph.
@@ -611,115 +1126,895 @@ void fprint_dot_DAG(FILE *outfile,
    plus (i',s) for each inner sink s and i' predecessor of i in the
    outer graph.
 
+   The product is kept implicit: the vertex (i,j) is the number
+   i*Si+j, where Si is the size of the inner graph, and its
+   predecessors are computed from the two factors when needed.  Only
+   orproduct builds the whole graph.
+
 */
+/* {{{ */ ProductDAG *new_ProductDAG(const DAG *outer,const DAG *inner) {
+
+  assert(outer && inner);
+  assert(outer->size>0 && inner->size>0);
+
+  ProductDAG *p=(ProductDAG*)malloc(sizeof(ProductDAG));
+  assert(p);
+  assert(outer->size <= ((size_t)-1)/inner->size);
+
+  p->outer=outer;
+  p->inner=inner;
+  p->size =outer->size*inner->size;
+  return p;
+}
+
+void dispose_ProductDAG(ProductDAG *p) {
+  free(p);
+}
+
+size_t indegree_ProductDAG(const ProductDAG *p,Vertex v) {
+  assert(v<p->size);
+  size_t Si=p->inner->size;
+  return p->inner->indegree[v%Si] + p->outer->indegree[v/Si]*p->inner->sink_number;
+}
+
+/* The inner predecessors first, then for each outer predecessor the
+   copies of the inner sinks */
+size_t predecessors_ProductDAG(const ProductDAG *p,Vertex v,Vertex *buffer) {
+
+  assert(v<p->size);
+  const DAG *inner=p->inner;
+  const DAG *outer=p->outer;
+  size_t Si=inner->size;
+  Vertex xo=v/Si, xi=v%Si;
+  size_t n=0;
+
+  for(size_t i=0;i<inner->indegree[xi];i++)
+    buffer[n++]=xo*Si+inner->in[xi][i];
+  for(size_t i=0;i<outer->indegree[xo];i++)
+    for(size_t j=0;j<inner->sink_number;j++)
+      buffer[n++]=outer->in[xo][i]*Si+inner->sinks[j];
+  return n;
+}
+/* }}} */
+
+
+/* Build the OR product of two DAGs, from its implicit description */
 /* {{{ */ DAG *orproduct(const DAG *outer,const DAG *inner) {
-  DAG *p=NULL;
 
-  Vertex i,j;
-  Vertex xo,xi,x;
-  size_t So,Si,S;
+  ProductDAG *product=new_ProductDAG(outer,inner);
+  DAG *p=new_DAG(product->size);
+  size_t edges=0;
 
-  assert(inner);
-  assert(outer);
+  for(Vertex v=0;v<product->size;v++) {
+    p->indegree[v]=indegree_ProductDAG(product,v);
+    edges+=p->indegree[v];
+  }
+  Vertex *in_edges=(Vertex*)malloc( (edges+1)*sizeof(Vertex) );
+  assert(in_edges);
 
-  /* Size of the new graph */
-  Si=inner->size;
-  So=outer->size;
-  S =  So * Si;
+  edges=0;
+  for(Vertex v=0;v<product->size;v++)
+    edges+=predecessors_ProductDAG(product,v,in_edges+edges);
+  adoptedges_DAG(p,in_edges);
+  dag_precompute_data(p);
 
-  /* Initial structure */
-  p=(DAG*)malloc(sizeof(DAG));
-  assert(p);
-  p->size=S;
+  assert(isconsistent_DAG(p)); /* Construction should be sound */
+  dispose_ProductDAG(product);
+  return p;
+}
+/* }}} */
 
-  /* Set to null sinks and source vector */
-  p->pred_bitmasks=NULL;
-  p->succ_bitmasks=NULL;
-  p->sources=NULL;
-  p->sinks=NULL;
-
-  /* Basic arrays */
-  p->in  = (Vertex**)malloc( S*sizeof(Vertex*) );
-  p->out = (Vertex**)malloc( S*sizeof(Vertex*) );
-  assert(p->in );
-  assert(p->out);
-  p->indegree  = (size_t*)malloc( S*sizeof(size_t) );
-  p->outdegree = (size_t*)malloc( S*sizeof(size_t) );
-  assert(p->indegree );
-  assert(p->outdegree);
 
-  /* Computes the degrees */
+/********************************************************************************
+                     CANONICAL LABELLING
+ ********************************************************************************/
+
+/*
+   Canonical labelling by individualization and refinement, in the
+   style of nauty.  The vertices are partitioned in ordered cells,
+   and the color of a vertex is the position of its cell.  The
+   partition is refined until each vertex of a cell has the same
+   number of predecessors and successors in each cell, up to the
+   collisions of a hash.  When it is not discrete, each vertex of the
+   first non singleton cell is individualized in turn.  Each discrete
+   partition gives a labelling, and the canonical one gives the
+   smallest relabelled graph.
+
+   Two labellings giving the same graph reveal an automorphism, which
+   maps the subtree of the current leaf to an explored one: the search
+   goes back to the node where the two leaves diverge.  The
+   automorphisms also prune the children which are in the same orbit
+   of an explored child. The search stops after CANONICAL_BUDGET nodes; the
+   labelling is then the best found so far, which depends on the
+   input numbering.
+*/
+#define CANONICAL_BUDGET        0x20000
+#define CANONICAL_AUTOMORPHISMS 256
+
+typedef struct {
+
+  size_t   color;
+  BitTuple hash;
+  Vertex   v;
+
+} RefineKey;
+
+typedef struct {
+
+  const DAG *g;
+
+  RefineKey *keys;              /* Workspace for the refinement */
+
+  size_t  *certificate;         /* Workspace for the leaves */
+  size_t  *best_certificate;
+  Vertex  *best_label;
+  Vertex  *best_prefix;
+  Boolean  found;
+  size_t   backjump;            /* Depth to go back to, or (size_t)-1 */
+
+  Vertex **automorphisms;
+  size_t   automorphism_count;
+
+  Vertex  *prefix;              /* Individualized vertices */
+  Vertex  *orbit;               /* Union-find for orbits */
+
+  size_t   nodes;
+
+} CanonicalSearch;
+
+
+static inline BitTuple mixcolor(size_t c,BitTuple salt) {
+  BitTuple x = ((BitTuple)c + salt) * 0x9E3779B97F4A7C15ULL;
+  x ^= x >> 29;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  return x ^ (x >> 32);
+}
+
+static int comparekeys(const void *a,const void *b) {
+  const RefineKey *x=(const RefineKey*)a;
+  const RefineKey *y=(const RefineKey*)b;
+  if (x->color != y->color) return x->color < y->color ? -1 : 1;
+  if (x->hash  != y->hash ) return x->hash  < y->hash  ? -1 : 1;
+  return 0;
+}
+
+/* Refine the coloring until stable. Return the number of cells. */
+static size_t refine(CanonicalSearch *S,size_t *color) {
+
+  const DAG *g=S->g;
+  size_t n=g->size;
+  size_t cells=0,previous;
+
+  do {
+    previous=cells;
+
+    for(Vertex v=0;v<n;v++) {
+      BitTuple h=0;
+      for(size_t i=0;i<g->indegree[v];i++)  h += mixcolor(color[g->in[v][i]],1);
+      for(size_t i=0;i<g->outdegree[v];i++) h += mixcolor(color[g->out[v][i]],2);
+      S->keys[v].color=color[v];
+      S->keys[v].hash=h;
+      S->keys[v].v=v;
+    }
+    qsort(S->keys,n,sizeof(RefineKey),comparekeys);
+
+    cells=0;
+    size_t first=0;
+    for(size_t i=0;i<n;i++) {
+      if (i==0 || comparekeys(S->keys+i-1,S->keys+i)!=0) { first=i; cells++; }
+      color[S->keys[i].v]=first;
+    }
+  } while (cells!=previous && cells<n);
+
+  return cells;
+}
+
+/* The relabelled graph: for each new vertex, in order, its indegree
+   and the sorted new names of its predecessors. */
+static void certificate(const CanonicalSearch *S,const size_t *label,size_t *cert) {
+
+  const DAG *g=S->g;
+  size_t n=g->size;
+  size_t pos=0;
+
+  /* Inverse labelling in the tail of the workspace */
+  Vertex *inverse=S->prefix+n;
+  for(Vertex v=0;v<n;v++) inverse[label[v]]=v;
+
+  for(size_t i=0;i<n;i++) {
+    Vertex v=inverse[i];
+    size_t start=++pos;
+    cert[start-1]=g->indegree[v];
+    for(size_t j=0;j<g->indegree[v];j++) {
+      /* insertion sort, predecessors lists are short */
+      size_t x=label[g->in[v][j]];
+      size_t k=pos++;
+      while (k>start && cert[k-1]>x) { cert[k]=cert[k-1]; k--; }
+      cert[k]=x;
+    }
+  }
+}
+
+static Vertex findorbit(Vertex *orbit,Vertex v) {
+  while (orbit[v]!=v) { orbit[v]=orbit[orbit[v]]; v=orbit[v]; }
+  return v;
+}
+
+/* Orbits of the automorphisms found, which fix the prefix */
+static void orbits(CanonicalSearch *S,size_t depth) {
+
+  size_t n=S->g->size;
+
+  for(Vertex v=0;v<n;v++) S->orbit[v]=v;
+
+  for(size_t a=0;a<S->automorphism_count;a++) {
+    const Vertex *gamma=S->automorphisms[a];
+    Boolean fixes=TRUE;
+    for(size_t i=0;i<depth && fixes;i++) fixes = (gamma[S->prefix[i]]==S->prefix[i]);
+    if (!fixes) continue;
+    for(Vertex v=0;v<n;v++) {
+      Vertex x=findorbit(S->orbit,v);
+      Vertex y=findorbit(S->orbit,gamma[v]);
+      if (x<y) S->orbit[y]=x; else if (y<x) S->orbit[x]=y;
+    }
+  }
+}
+
+static void leaf(CanonicalSearch *S,const size_t *color,size_t depth) {
+
+  size_t n=S->g->size;
+  size_t length=n;
+  for(Vertex v=0;v<n;v++) length+=S->g->indegree[v];
+
+  certificate(S,color,S->certificate);
+
+  int cmp = S->found ? memcmp(S->certificate,S->best_certificate,length*sizeof(size_t)) : -1;
+  if (S->found && cmp==0) {
+    /* Same graph: an automorphism mapping v to the vertex of the best
+       labelling with the same label */
+    if (S->automorphism_count < CANONICAL_AUTOMORPHISMS) {
+      Vertex *inverse=S->prefix+n;
+      for(Vertex v=0;v<n;v++) inverse[S->best_label[v]]=v;
+      Vertex *gamma=(Vertex*)malloc(n*sizeof(Vertex));
+      assert(gamma);
+      for(Vertex v=0;v<n;v++) gamma[v]=inverse[color[v]];
+      S->automorphisms[S->automorphism_count++]=gamma;
+    }
+    size_t k=0;
+    while (k<depth && S->prefix[k]==S->best_prefix[k]) k++;
+    S->backjump=k;
+    return;
+  }
+  if (!S->found || cmp<0) {
+    for(size_t i=0;i<length;i++) S->best_certificate[i]=S->certificate[i];
+    for(Vertex v=0;v<n;v++) S->best_label[v]=color[v];
+    for(size_t i=0;i<depth;i++) S->best_prefix[i]=S->prefix[i];
+    S->found=TRUE;
+  }
+}
+
+static void individualize(CanonicalSearch *S,const size_t *color,size_t depth) {
 
-  /* Number of inner edges */
-  for(xo=0;xo<So;xo++) {
-    for(xi=0;xi<Si;xi++) {
-      p->indegree [xo*Si+xi]  = inner->indegree[xi]; // + (outer->indegree[xo])*inner->sink_number;
-      p->outdegree[xo*Si+xi]  = inner->outdegree[xi];
+  size_t n=S->g->size;
+
+  if (++S->nodes > CANONICAL_BUDGET && S->found) return;
+
+  /* First non singleton cell */
+  size_t *size=(size_t*)calloc(n,sizeof(size_t));
+  assert(size);
+  for(Vertex v=0;v<n;v++) size[color[v]]++;
+  size_t target=n;
+  for(size_t c=0;c<n;c++) if (size[c]>1) { target=c; break; }
+  free(size);
+
+  if (target==n) { leaf(S,color,depth); return; }
+
+  size_t *child=(size_t*)malloc(n*sizeof(size_t));
+  Vertex *explored=(Vertex*)malloc(n*sizeof(Vertex));
+  size_t explored_count=0;
+  assert(child && explored);
+
+  for(Vertex v=0;v<n;v++) {
+
+    if (color[v]!=target) continue;
+
+    /* Skip v if an automorphism fixing the prefix maps an explored
+       child to it */
+    if (explored_count>0) {
+      orbits(S,depth);
+      Boolean seen=FALSE;
+      for(size_t i=0;i<explored_count && !seen;i++)
+        seen = (findorbit(S->orbit,explored[i])==findorbit(S->orbit,v));
+      if (seen) continue;
     }
+    if (S->nodes > CANONICAL_BUDGET && S->found) break;
+
+    for(Vertex w=0;w<n;w++) child[w] = (color[w]==target && w!=v) ? target+1 : color[w];
+    refine(S,child);
+
+    S->prefix[depth]=v;
+    individualize(S,child,depth+1);
+    explored[explored_count++]=v;
+
+    if (S->backjump<depth) break;
+    if (S->backjump==depth) S->backjump=(size_t)-1;
   }
-  /* Incoming edges from predecessors' sinks */
-  for(xo=0;xo<So;xo++) {
-    for(xi=0;xi<Si;xi++) {
-      p->indegree [xo*Si+xi]  += (outer->indegree[xo])*inner->sink_number;
+
+  free(explored);
+  free(child);
+}
+
+
+/*
+   Compute a canonical labelling of the graph: `label[v]' is the new
+   name of vertex v, and isomorphic graphs are relabelled to the same
+   graph.
+
+   @return FALSE if the search was cut by its budget. The labelling
+   is then a valid relabelling, but it may not be canonical.
+*/
+Boolean canonical_labelling_DAG(const DAG *g,Vertex *label) {
+
+  assert(isconsistent_DAG(g));
+  assert(label);
+
+  size_t n=g->size;
+  size_t length=n;
+  for(Vertex v=0;v<n;v++) length+=g->indegree[v];
+
+  CanonicalSearch S;
+  S.g=g;
+  S.keys=(RefineKey*)malloc(n*sizeof(RefineKey));
+  S.certificate=(size_t*)malloc(length*sizeof(size_t));
+  S.best_certificate=(size_t*)malloc(length*sizeof(size_t));
+  S.best_label=label;
+  S.best_prefix=(Vertex*)malloc(n*sizeof(Vertex));
+  S.found=FALSE;
+  S.backjump=(size_t)-1;
+  S.automorphisms=(Vertex**)malloc(CANONICAL_AUTOMORPHISMS*sizeof(Vertex*));
+  S.automorphism_count=0;
+  S.prefix=(Vertex*)malloc(2*n*sizeof(Vertex));
+  S.orbit=(Vertex*)malloc(n*sizeof(Vertex));
+  S.nodes=0;
+  assert(S.keys && S.certificate && S.best_certificate && S.best_prefix);
+  assert(S.automorphisms && S.prefix && S.orbit);
+
+  size_t *color=(size_t*)calloc(n,sizeof(size_t));
+  assert(color);
+  refine(&S,color);
+  individualize(&S,color,0);
+  free(color);
+
+  for(size_t a=0;a<S.automorphism_count;a++) free(S.automorphisms[a]);
+  free(S.automorphisms);
+  free(S.keys);
+  free(S.certificate);
+  free(S.best_certificate);
+  free(S.prefix);
+  free(S.best_prefix);
+  free(S.orbit);
+
+  assert(S.found);
+  return S.nodes <= CANONICAL_BUDGET;
+}
+
+/*
+   The graph relabelled by `label', as a sequence of numbers: for
+   each new vertex in order, its indegree followed by the sorted new
+   names of its predecessors.  The sequence has `*length' elements,
+   and must be freed by the caller.
+*/
+size_t *certificate_DAG(const DAG *g,const Vertex *label,size_t *length) {
+
+  assert(isconsistent_DAG(g));
+  assert(label);
+  assert(length);
+
+  size_t n=g->size;
+  *length=n;
+  for(Vertex v=0;v<n;v++) *length+=g->indegree[v];
+
+  CanonicalSearch S;
+  S.g=g;
+  S.prefix=(Vertex*)malloc(2*n*sizeof(Vertex));
+  size_t *cert=(size_t*)malloc(*length*sizeof(size_t));
+  assert(S.prefix && cert);
+
+  certificate(&S,label,cert);
+
+  free(S.prefix);
+  return cert;
+}
+
+
+/********************************************************************************
+                     REDUCTION
+ ********************************************************************************/
+
+/*
+   The sink of the search is the last vertex, and the vertices which
+   are not its ancestors are removed: no move on them is needed, in
+   any variant, and the pebblings of the reduced graph are exactly the
+   pebblings of the original graph without these moves.
+
+   In black pebbling the chains are contracted too.  A vertex is
+   inside a chain if it has one predecessor and one successor.  A
+   maximal chain y_1 -> ... -> y_k between x and z is removed, and
+   replaced by the edge x -> z, when x has no other successor, or when
+   z (not the sink) has no other predecessor: a pebble on x (or on z)
+   of the reduced graph stands for a pebble on one of x, y_1, ..., y_k
+   (or y_1, ..., y_k, z) of the original graph, and it slides along
+   the chain when needed, with one more pebble for a single move.
+   The reduced graph needs one more pebble for the same moves, so the
+   cost is the same.  Otherwise y_1, ..., y_{k-1} are removed, and
+   y_k is kept as the end of a chain of the second kind.  The lifted
+   pebbling is longer, and not necessarily the shortest one.
+*/
+
+/* Reduce the graph for the pebbling search, contracting the chains
+   if `chains' is TRUE.  See above. */
+DAGReduction *reduce_DAG(const DAG *g,Boolean chains) {
+
+  assert(isconsistent_DAG(g));
+  assert(g->size>0);
+
+  size_t n=g->size;
+  Vertex t=n-1;
+  size_t maxdegree=0;
+  DAGReduction *r=(DAGReduction*)calloc(1,sizeof(DAGReduction));
+  size_t  *outdegree=(size_t*)calloc(n,sizeof(size_t));
+  Vertex  *succ=(Vertex*)malloc(n*sizeof(Vertex));     /* Last successor */
+  Vertex  *name=(Vertex*)malloc(n*sizeof(Vertex));
+  Boolean *keep=(Boolean*)calloc(n,sizeof(Boolean));
+  Boolean *inside=(Boolean*)calloc(n,sizeof(Boolean));
+  assert(r && outdegree && succ && name && keep && inside);
+  r->original=g;
+
+  /* Ancestors of the sink, and their successors among them */
+  keep[t]=TRUE;
+  for(Vertex v=n;v-->0;) {
+    if (!keep[v]) { r->pruned++; continue; }
+    for(size_t i=0;i<g->indegree[v];i++) {
+      keep[g->in[v][i]]=TRUE;
+      outdegree[g->in[v][i]]++;
+      succ[g->in[v][i]]=v;
     }
+    if (g->indegree[v]>maxdegree) maxdegree=g->indegree[v];
   }
-  /* Outgoing edges to successors' sources */
-  for(xo=0;xo<So;xo++) {
-    for(i=0;i<inner->sink_number;i++) {
-      p->outdegree[xo*Si+inner->sinks[i]] += Si*(outer->outdegree[xo]);
+
+  /* Maximal chains, from their first vertex */
+#define INCHAIN(v) (g->indegree[v]==1 && outdegree[v]==1)
+  for(Vertex v=0;chains && v<n;v++) {
+    if (!keep[v] || !INCHAIN(v) || INCHAIN(g->in[v][0])) continue;
+    Vertex x=g->in[v][0];
+    Vertex y=v;
+    while (INCHAIN(succ[y])) y=succ[y];
+    Vertex z=succ[y];
+    Boolean whole = outdegree[x]==1 || (g->indegree[z]==1 && z!=t);
+    for(Vertex u=v; whole || u!=y; u=succ[u]) {
+      inside[u]=TRUE;
+      r->contracted++;
+      if (u==y) break;
     }
   }
+#undef INCHAIN
+
+  /* Names in the reduced graph, in the same order */
+  size_t size=0;
+  size_t edges=0;
+  for(Vertex v=0;v<n;v++) {
+    if (!keep[v] || inside[v]) continue;
+    name[v]=size++;
+    edges+=g->indegree[v];
+  }
+
+  r->dag=new_DAG(size);
+  r->label=(Vertex*)malloc(size*sizeof(Vertex));
+  r->chain_offset=(size_t*)malloc((edges+1)*sizeof(size_t));
+  r->chain=(Vertex*)malloc((r->contracted+1)*sizeof(Vertex));
+  r->forward=(Boolean*)malloc((edges+1)*sizeof(Boolean));
+  Vertex *via=(Vertex*)malloc((maxdegree+1)*sizeof(Vertex));
+  assert(r->label && r->chain_offset && r->chain && r->forward && via);
+
+  for(Vertex v=0;v<n;v++) {
+    if (!keep[v] || inside[v]) continue;
+    r->label[name[v]]=v;
+    r->dag->indegree[name[v]]=g->indegree[v];
+  }
+  edges_DAG(r->dag);
+
+  /* The incoming edges, sorted by tail, and the chains behind them.
+     `via[i]' is the predecessor in the original graph. */
+  size_t e=0;
+  size_t c=0;
+  for(Vertex w=0;w<size;w++) {
+    Vertex  v=r->label[w];
+    Vertex *in=r->dag->in[w];
+    size_t  k=g->indegree[v];
+
+    for(size_t i=0;i<k;i++) {
+      Vertex q=g->in[v][i];
+      Vertex x=q;
+      size_t j=i;
+      while (inside[x]) x=g->in[x][0];
+      for(;j>0 && in[j-1]>name[x];j--) { in[j]=in[j-1]; via[j]=via[j-1]; }
+      in[j]=name[x];
+      via[j]=q;
+    }
+    for(size_t i=0;i<k;i++,e++) {
+      size_t length=0;
+      r->chain_offset[e]=c;
+      r->forward[e]=(outdegree[r->label[in[i]]]==1);
+      for(Vertex y=via[i]; inside[y]; y=g->in[y][0]) length++;
+      c+=length;
+      for(Vertex y=via[i]; inside[y]; y=g->in[y][0]) r->chain[--length+r->chain_offset[e]]=y;
+    }
+  }
+  r->chain_offset[e]=c;
+  assert(c==r->contracted);
+
+  dag_precompute_data(r->dag);
+  assert(isconsistent_DAG(r->dag));
+
+  free(outdegree);
+  free(succ);
+  free(name);
+  free(keep);
+  free(inside);
+  free(via);
+  return r;
+}
+
+
+void dispose_DAGReduction(DAGReduction *r) {
+  if (r==NULL) return;
+  dispose_DAG(r->dag);
+  free(r->label);
+  free(r->chain_offset);
+  free(r->chain);
+  free(r->forward);
+  free(r);
+}
+
+
+#define NOCHAIN ((size_t)-1)
+
+/* State of the lifting of a pebbling: `token[e]' is the position,
+   in the chain y_0, ..., y_{k-1} of the edge e, of the pebble which
+   stands for its tail (forward chains, -1 on the tail) or for its
+   head (the other chains, k on the head). */
+typedef struct {
+
+  const DAGReduction *r;
+  long   *token;
+  Vertex *head;              /* Head of each edge */
+  size_t *start;             /* Forward chain out of a vertex, or NOCHAIN */
+  size_t *end;               /* Other chain into a vertex, or NOCHAIN */
+  Vertex *steps;
+  size_t  length;
+  size_t  allocation;
+
+} Lifting;
+
+static inline void liftstep(Lifting *l,Vertex v) {
+  if (l->length==l->allocation) {
+    l->allocation*=2;
+    l->steps=(Vertex*)realloc(l->steps,l->allocation*sizeof(Vertex));
+    assert(l->steps);
+  }
+  l->steps[l->length++]=v;
+}
+
+/* Vertex of the original graph at position `p' of the chain of `e' */
+static inline Vertex chainvertex(const Lifting *l,size_t e,long p) {
+  const DAGReduction *r=l->r;
+  if (p<0) return r->label[r->dag->in_edges[e]];
+  if ((size_t)p==r->chain_offset[e+1]-r->chain_offset[e]) return r->label[l->head[e]];
+  return r->chain[r->chain_offset[e]+(size_t)p];
+}
+
+/* Slide the pebble along the chain of `e' up to position `p' */
+static void slide(Lifting *l,size_t e,long p) {
+  while (l->token[e]<p) {
+    liftstep(l,chainvertex(l,e,l->token[e]+1));
+    liftstep(l,chainvertex(l,e,l->token[e]));
+    l->token[e]++;
+  }
+}
+
+
+/* The pebbling of the original graph for a pebbling of the reduced
+   graph, as a sequence of vertices of the original graph (see
+   Pebbling in pebbling.h).  Its cost is the same, and it has
+   `*length' steps.  The array must be freed by the caller. */
+Vertex *lift_DAGReduction(const DAGReduction *r,const Vertex *steps,size_t n,size_t *length) {
+
+  assert(r);
+  assert(length);
+
+  const DAG *d=r->dag;
+  size_t edges=d->in_offset[d->size];
+  Boolean *pebbled=(Boolean*)calloc(d->size+1,sizeof(Boolean));
+  Lifting l;
+  l.r=r;
+  l.token=(long*)calloc(edges+1,sizeof(long));
+  l.head=(Vertex*)malloc((edges+1)*sizeof(Vertex));
+  l.start=(size_t*)malloc((d->size+1)*sizeof(size_t));
+  l.end=(size_t*)malloc((d->size+1)*sizeof(size_t));
+  l.length=0;
+  l.allocation=n+r->contracted+16;
+  l.steps=(Vertex*)malloc(l.allocation*sizeof(Vertex));
+  assert(pebbled && l.token && l.head && l.start && l.end && l.steps);
+
+  for(Vertex w=0;w<d->size;w++) l.start[w]=l.end[w]=NOCHAIN;
+  for(Vertex w=0;w<d->size;w++)
+    for(size_t e=d->in_offset[w];e<d->in_offset[w+1];e++) {
+      l.head[e]=w;
+      if (r->chain_offset[e]==r->chain_offset[e+1]) continue;
+      if (r->forward[e]) l.start[d->in_edges[e]]=e;
+      else               l.end[w]=e;
+    }
+
+  for(size_t i=0;i<n;i++) {
+    Vertex v=steps[i];
+    assert(v<d->size);
+
+    if (pebbled[v]) {                  /* Remove the pebble standing for v */
+      if (l.end[v]!=NOCHAIN)        liftstep(&l,chainvertex(&l,l.end[v],l.token[l.end[v]]));
+      else if (l.start[v]!=NOCHAIN) liftstep(&l,chainvertex(&l,l.start[v],l.token[l.start[v]]));
+      else                          liftstep(&l,r->label[v]);
+      pebbled[v]=FALSE;
+      continue;
+    }
 
-  /* Allocation of in/out arrays */
-  for(x=0;x<S;x++) {
-    p->in[x]  = (Vertex*)malloc(p->indegree[x]*sizeof(Vertex));
-    p->out[x] = (Vertex*)malloc(p->outdegree[x]*sizeof(Vertex*));
+    /* The predecessors of v must be actually pebbled, and the
+       forward chains into v must be pebbled up to their end */
+    for(size_t e=d->in_offset[v];e<d->in_offset[v+1];e++) {
+      Vertex u=d->in_edges[e];
+      size_t k=r->chain_offset[e+1]-r->chain_offset[e];
+      if (k>0 && r->forward[e]) slide(&l,e,(long)k-1);
+      else if (l.end[u]!=NOCHAIN) {
+        size_t f=l.end[u];
+        slide(&l,f,(long)(r->chain_offset[f+1]-r->chain_offset[f]));
+      }
+    }
+
+    if (l.end[v]!=NOCHAIN) {           /* Place a pebble at the start of the chain */
+      l.token[l.end[v]]=0;
+      liftstep(&l,chainvertex(&l,l.end[v],0));
+    } else {
+      if (l.start[v]!=NOCHAIN) l.token[l.start[v]]=-1;
+      liftstep(&l,r->label[v]);
+    }
+    pebbled[v]=TRUE;
   }
 
-  /* Build the network of links */
+  free(pebbled);
+  free(l.token);
+  free(l.head);
+  free(l.start);
+  free(l.end);
+  *length=l.length;
+  return l.steps;
+}
+
+
+/********************************************************************************
+                     TOPOLOGICAL ORDERS
+ ********************************************************************************/
+
+/*
+   The search explores the same pebblings in any topological order of
+   the vertices, but the heuristic cuts of pebbling.c compare the
+   ranks of the vertices: they never place two pebbles in decreasing
+   order, nor remove two in increasing order.  An order where each
+   vertex comes soon after its predecessors, and where few vertices
+   wait for their successors, cuts more configurations.
+
+   ORDER_DEPTH_FIRST lists the ancestors of the sinks in post-order
+   of a depth first visit of the predecessors, so that each vertex
+   comes right after the subgraph below it.  ORDER_SEPARATION and
+   ORDER_CUTWIDTH build the order greedily, taking at each step the
+   vertex, among the ones whose predecessors have been taken, which
+   keeps smallest the number of taken vertices with a successor still
+   to take (vertex separation), or the number of edges between taken
+   and untaken vertices (cutwidth).  Ties go to the earlier vertex of
+   the input.  The greedy orders take quadratic time, which is fine
+   for the graphs of the search.
+*/
 
-  /* Setup inner arcs */
-  for(xo=0;xo<So;xo++) {
-    for(xi=0;xi<Si;xi++) {
-      /* Incoming */
-      for(i=0;i<inner->indegree[xi] ;i++)  p->in[xo*Si+xi][i] =inner->in[xi][i]+xo*Si;
-      /* Outgoing */
-      for(i=0;i<inner->outdegree[xi];i++)  p->out[xo*Si+xi][i]=inner->out[xi][i]+xo*Si;
+static const char *order_names[]={ "input", "dfs", "separation", "cutwidth" };
+
+const char *name_DAGOrderStrategy(DAGOrderStrategy strategy) {
+  assert(strategy<=ORDER_CUTWIDTH);
+  return order_names[strategy];
+}
+
+Boolean parse_DAGOrderStrategy(const char *name,DAGOrderStrategy *strategy) {
+  for(int s=ORDER_INPUT;s<=ORDER_CUTWIDTH;s++)
+    if (strcmp(name,order_names[s])==0) {
+      *strategy=(DAGOrderStrategy)s;
+      return TRUE;
     }
+  return FALSE;
+}
+
+
+/* The maximum, over the prefixes of the order, of the vertices in
+   the prefix with a successor outside it */
+size_t separation_DAG(const DAG *g) {
+
+  long *delta=(long*)calloc(g->size+1,sizeof(long));
+  long  live=0;
+  size_t width=0;
+  assert(delta);
+
+  for(Vertex v=0;v<g->size;v++)
+    if (g->outdegree[v]>0) {
+      delta[v]++;
+      delta[g->out[v][g->outdegree[v]-1]]--;
+    }
+  for(Vertex v=0;v<g->size;v++) {
+    live+=delta[v];
+    if ((size_t)live>width) width=(size_t)live;
   }
+  free(delta);
+  return width;
+}
+
+/* The maximum, over the prefixes of the order, of the edges leaving
+   the prefix */
+size_t cutwidth_DAG(const DAG *g) {
+
+  long cut=0;
+  size_t width=0;
+
+  for(Vertex v=0;v<g->size;v++) {
+    cut+=(long)g->outdegree[v]-(long)g->indegree[v];
+    if ((size_t)cut>width) width=(size_t)cut;
+  }
+  return width;
+}
 
-  /* Edges between outer copies to be connected */
-  Vertex yo,yi;
 
-  /* Incoming edges from predecessors' sinks */
-  for(yo=0;yo<So;yo++)
-    for(i=0;i<outer->indegree[yo];i++) {
-      xo=outer->in[yo][i];
-      /* (xo -> yo) is the outer pair to be connected */
-      for(yi=0;yi<Si;yi++) for(j=0;j<inner->sink_number;j++)  {
-          xi=inner->sinks[j];
-          /* (xi -> yi) is the inner pair to be connected */
-          p->in[yo*Si+yi][inner->indegree[yi]+i*inner->sink_number+j] = xo*Si+xi;
+/* Post-order of the ancestors of the sinks, with an explicit stack */
+static size_t depthfirst(const DAG *g,Vertex *order) {
+
+  Boolean *seen=(Boolean*)calloc(g->size,sizeof(Boolean));
+  Vertex  *stack=(Vertex*)malloc(g->size*sizeof(Vertex));
+  size_t  *next=(size_t*)calloc(g->size,sizeof(size_t));
+  size_t   n=0;
+  assert(seen && stack && next);
+
+  for(size_t s=0;s<g->sink_number;s++) {
+    size_t top=0;
+    stack[top++]=g->sinks[s];
+    seen[g->sinks[s]]=TRUE;
+    while (top>0) {
+      Vertex v=stack[top-1];
+      if (next[v]<g->indegree[v]) {
+        Vertex u=g->in[v][next[v]++];
+        if (!seen[u]) { seen[u]=TRUE; stack[top++]=u; }
+      } else {
+        order[n++]=v;
+        top--;
       }
     }
+  }
+  free(seen);
+  free(stack);
+  free(next);
+  return n;
+}
+
+/* Greedy order, see above */
+static void greedy(const DAG *g,DAGOrderStrategy strategy,Vertex *order) {
+
+  size_t   n=g->size;
+  size_t  *missing=(size_t*)malloc(n*sizeof(size_t));  /* Predecessors not taken */
+  size_t  *waiting=(size_t*)malloc(n*sizeof(size_t));  /* Successors not taken */
+  Boolean *taken=(Boolean*)calloc(n,sizeof(Boolean));
+  assert(missing && waiting && taken);
 
-  /* Outgoing edges to successors' vertices */
-  for(xo=0;xo<So;xo++)
-    for(i=0;i<outer->outdegree[xo];i++) {
-      yo=outer->out[xo][i];
-      /* (xo -> yo) is the outer pair to be connected */
-      for(j=0;j<inner->sink_number;j++) for(yi=0;yi<Si;yi++)  {
-          xi=inner->sinks[j];
-          /* (xi -> yi) is the inner pair to be connected
-             notice that inner->outdegree[x0] should be always 0.
-           */
-          p->out[xo*Si+xi][inner->outdegree[xi]+i*Si+yi] = yo*Si+yi;
+  for(Vertex v=0;v<n;v++) {
+    missing[v]=g->indegree[v];
+    waiting[v]=g->outdegree[v];
+  }
+
+  for(size_t k=0;k<n;k++) {
+    Vertex best=n;
+    long   score=0;
+    for(Vertex v=0;v<n;v++) {
+      if (taken[v] || missing[v]>0) continue;
+      long s;
+      if (strategy==ORDER_CUTWIDTH) {
+        s=(long)g->outdegree[v]-(long)g->indegree[v];
+      } else {
+        s=(g->outdegree[v]>0) ? 1 : 0;
+        for(size_t i=0;i<g->indegree[v];i++)
+          if (waiting[g->in[v][i]]==1) s--;
       }
+      if (best==n || s<score) { best=v; score=s; }
     }
+    assert(best<n);
+    order[k]=best;
+    taken[best]=TRUE;
+    for(size_t i=0;i<g->indegree[best];i++) waiting[g->in[best][i]]--;
+    for(size_t i=0;i<g->outdegree[best];i++) missing[g->out[best][i]]--;
+  }
+  free(missing);
+  free(waiting);
+  free(taken);
+}
 
 
-  dag_precompute_data(p);
-  assert(isconsistent_DAG(p)); /* Construction should be sound */
-  return p;
+DAGOrder *order_DAG(const DAG *g,DAGOrderStrategy strategy) {
+
+  assert(isconsistent_DAG(g));
+  assert(strategy<=ORDER_CUTWIDTH);
+
+  size_t n=g->size;
+  DAGOrder *o=(DAGOrder*)malloc(sizeof(DAGOrder));
+  Vertex *name=(Vertex*)malloc(n*sizeof(Vertex));
+  assert(o && name);
+
+  o->original=g;
+  o->strategy=strategy;
+  o->label=(Vertex*)malloc(n*sizeof(Vertex));
+  assert(o->label);
+
+  if (strategy==ORDER_INPUT) {
+    for(Vertex v=0;v<n;v++) o->label[v]=v;
+  } else if (strategy==ORDER_DEPTH_FIRST) {
+    /* The vertices which do not reach a sink cannot exist: every
+       vertex is an ancestor of some sink */
+    size_t m=depthfirst(g,o->label);
+    assert(m==n);
+    (void)m;
+  } else {
+    greedy(g,strategy,o->label);
+  }
+
+  /* The relabelled graph, with sorted incoming lists */
+  for(Vertex w=0;w<n;w++) name[o->label[w]]=w;
+  o->dag=new_DAG(n);
+  for(Vertex w=0;w<n;w++) o->dag->indegree[w]=g->indegree[o->label[w]];
+  edges_DAG(o->dag);
+  for(Vertex w=0;w<n;w++) {
+    Vertex  v=o->label[w];
+    Vertex *in=o->dag->in[w];
+    for(size_t i=0;i<g->indegree[v];i++) {
+      size_t j=i;
+      for(;j>0 && in[j-1]>name[g->in[v][i]];j--) in[j]=in[j-1];
+      in[j]=name[g->in[v][i]];
+    }
+  }
+  dag_precompute_data(o->dag);
+  assert(isconsistent_DAG(o->dag));
+
+  free(name);
+  return o;
+}
+
+
+void dispose_DAGOrder(DAGOrder *o) {
+  if (o==NULL) return;
+  dispose_DAG(o->dag);
+  free(o->label);
+  free(o);
+}
+
+
+/* The moves of the relabelled graph as moves of the original one.
+   The array must be freed by the caller. */
+Vertex *lift_DAGOrder(const DAGOrder *o,const Vertex *steps,size_t n) {
+
+  assert(o);
+  Vertex *lifted=(Vertex*)malloc((n+1)*sizeof(Vertex));
+  assert(lifted);
+  for(size_t i=0;i<n;i++) {
+    assert(steps[i]<o->dag->size);
+    lifted[i]=o->label[steps[i]];
+  }
+  return lifted;
 }
-/* }}} */
@@ -32,9 +32,19 @@ typedef size_t Vertex;
    representation.  Each  vertex  has  both  a list  of  incoming  and
    outgoing edges.
 
+   The lists are in compressed sparse row layout: all the incoming
+   edges are in a single array, sorted by head, and the ones of `v'
+   are at positions in_offset[v] to in_offset[v+1]-1.  The same for
+   the outgoing edges.  The lists `in[v]' and `out[v]' point inside
+   these arrays.
+
    An info array may  or may not be present (i.e. it  is null). If not
    null it contains the status of the vertices.
 
+   A graph read from a binary image (see fread_DAG) keeps its arrays
+   in the image, which is either mapped from the file or read in a
+   single block; only `in' and `out' are allocated.
+
    This representation is very static and is not apt to be modified
    much during the program.  This is not an issue, since we are mostly
    interested in analysis of a static graph.
@@ -50,6 +60,11 @@ typedef struct {
   Vertex **in;      /* Vector of incoming vertices */
   Vertex **out;     /* Vector of outgoing vertices */
 
+  size_t *in_offset;  /* size+1 offsets in the edge arrays */
+  size_t *out_offset;
+  Vertex *in_edges;   /* All incoming vertices, contiguous */
+  Vertex *out_edges;  /* All outgoing vertices, contiguous */
+
   /* The following data is precomputed for efficiency */
 
   BitTuple *pred_bitmasks;  /* Bitmask indicating the predecessors of a vertex */
@@ -61,16 +76,49 @@ typedef struct {
   Vertex *sources;
   Vertex *sinks;
 
+  void   *image;         /* Binary image holding the arrays, or NULL */
+  size_t  image_length;  /* Length of the mapping, zero if malloc'ed */
+
 } DAG;
 
 /* Data structure management functions */
+
+/* A graph is built in three steps: new_DAG allocates the vertices,
+   with no edges; the caller sets `indegree[v]' for every vertex, and
+   edges_DAG allocates the incoming lists; the caller fills `in[v]',
+   with predecessors of smaller index, and dag_precompute_data derives
+   the outgoing lists, the sources, the sinks and the bitmasks.
+   Instead of edges_DAG, a caller which has already written the
+   incoming lists in a single malloc'ed array gives it to the graph
+   with adoptedges_DAG. */
+extern DAG*    new_DAG(size_t size);
+extern void    edges_DAG(DAG *g);
+extern void    adoptedges_DAG(DAG *g,Vertex *in_edges);
+extern void    dag_precompute_data(DAG *g);
+
 extern Boolean isconsistent_DAG(const DAG *ptr);
 extern DAG*    copy_DAG(const DAG *src);
+extern DAG*    closesinks_DAG(const DAG *src);
 extern void    dispose_DAG(DAG* ptr);
 
 /* I/O Functions */
 extern void fprint_DAG(FILE *outfile,const DAG *p,const char* prefix);
 
+/* Binary image of a graph: a header, the degrees, the offsets and the
+   edges in compressed sparse row layout, the sources, the sinks and
+   the bitmasks (present iff the graph has at most BITTUPLE_SIZE
+   vertices).  The image is in the layout of the machine which wrote
+   it.  A regular file is mapped in memory, so that the graph is
+   loaded without parsing, copying or precomputing anything; other
+   streams are read in a single block.  The first character of an
+   image, unlike the first one of a KTH file, is DAG_IMAGE_MAGIC[0]. */
+#define DAG_IMAGE_MAGIC   "\177pebDAG"
+#define DAG_IMAGE_VERSION 1
+
+extern Boolean fwrite_DAG(FILE *outfile,const DAG *p);
+extern DAG*    fread_DAG(FILE *infile);
+extern Boolean isimage_DAG(FILE *infile);
+
 extern void fprint_dot_DAG(FILE *outfile,const DAG *p,
                             char *name,
                             char *options,
@@ -82,9 +130,116 @@ extern DAG* pyramid(int h);
 extern DAG* path(int n);
 extern DAG* leader(int n);
 extern DAG* tree(int h);
+extern DAG* grid(int w,int h);
+extern DAG* butterfly(int k);
+extern DAG* superconcentrators(int k,int stack);
+extern DAG* ptc(int i);
+extern DAG* randomdag(size_t n,const double *weight,size_t degrees,BitTuple seed);
+
+/* The graph of a family, by name and parameters, as in the usage
+   message below; NULL if the description is malformed. */
+extern DAG* generate_DAG(const char *spec);
+
+#define DAG_FAMILIES_MESSAGE "\n\
+Graph families, for -G <family>:\n\
+\n\
+       pyramid:<h>           pyramid of height h;\n\
+       tree:<h>              complete binary tree of height h;\n\
+       path:<n>              chain of length n;\n\
+       grid:<w>:<h>          grid of width w and height h;\n\
+       butterfly:<k>         butterfly on 2^k inputs;\n\
+       superconcentrator:<k>:<s>  stack of s superconcentrators on 2^k inputs;\n\
+       ptc:<i>               graph G_i of Paul, Tarjan and Celoni, on 2^i inputs;\n\
+       random:<n>:<seed>:<w0>,<w1>,...  random DAG on n vertices, where a vertex\n\
+                             has d predecessors with probability proportional to wd.\n\
+\n\
+The search needs a single sink: butterfly, superconcentrator, ptc and random\n\
+have several, so they are for kth2dag unless <family>+sink adds a vertex\n\
+whose predecessors are all the sinks (e.g. butterfly:3+sink).\n"
+
+/* The OR product of two graphs, without building it: the vertex (i,j)
+   is i*inner->size+j, and its predecessors are computed from the
+   factors on demand (the buffer must hold the indegree of the
+   vertex).  orproduct builds the whole graph. */
+typedef struct {
+
+  const DAG *outer;
+  const DAG *inner;
+  size_t     size;
+
+} ProductDAG;
+
+extern ProductDAG* new_ProductDAG(const DAG *outer,const DAG *inner);
+extern void        dispose_ProductDAG(ProductDAG *p);
+extern size_t      indegree_ProductDAG(const ProductDAG *p,Vertex v);
+extern size_t      predecessors_ProductDAG(const ProductDAG *p,Vertex v,Vertex *buffer);
 
 extern DAG* orproduct(const DAG *outer,const DAG *inner);
 
+/* Reduction of a graph for the pebbling search: the vertices which
+   are not ancestors of the last vertex are removed, and with `chains'
+   (for black pebbling only) also the inner vertices of the chains.
+   The optimal cost is the same, and a pebbling of the reduced graph
+   is lifted to one of the original graph.  See dag.c for details. */
+typedef struct {
+
+  DAG       *dag;           /* The reduced graph */
+  const DAG *original;
+  Vertex    *label;         /* Original vertex of each reduced vertex */
+
+  /* The vertices removed inside the chain of the incoming edge e of
+     the reduced graph, from its tail, are chain[chain_offset[e]] up
+     to chain[chain_offset[e+1]-1].  The chain is forward if its tail
+     has no other successor. */
+  size_t    *chain_offset;
+  Vertex    *chain;
+  Boolean   *forward;
+
+  size_t     pruned;        /* Vertices which are not ancestors of the sink */
+  size_t     contracted;    /* Vertices inside chains */
+
+} DAGReduction;
+
+extern DAGReduction *reduce_DAG(const DAG *g,Boolean chains);
+extern Vertex       *lift_DAGReduction(const DAGReduction *r,const Vertex *steps,size_t n,size_t *length);
+extern void          dispose_DAGReduction(DAGReduction *r);
+
+/* Topological order of a graph for the search, which changes the
+   configurations cut by the heuristics of pebbling.c.  The graph is
+   relabelled in the order, and a pebbling of the relabelled graph is
+   lifted back to the original one.  See dag.c for the strategies. */
+typedef enum {
+
+  ORDER_INPUT,         /* The order of the input */
+  ORDER_DEPTH_FIRST,   /* Post-order of a depth first visit from the sinks */
+  ORDER_SEPARATION,    /* Greedy, for a small vertex separation */
+  ORDER_CUTWIDTH       /* Greedy, for a small cutwidth */
+
+} DAGOrderStrategy;
+
+typedef struct {
+
+  DAG             *dag;        /* The relabelled graph */
+  const DAG       *original;
+  Vertex          *label;      /* Original vertex of each relabelled vertex */
+  DAGOrderStrategy strategy;
+
+} DAGOrder;
+
+extern DAGOrder   *order_DAG(const DAG *g,DAGOrderStrategy strategy);
+extern Vertex     *lift_DAGOrder(const DAGOrder *o,const Vertex *steps,size_t n);
+extern void        dispose_DAGOrder(DAGOrder *o);
+extern const char *name_DAGOrderStrategy(DAGOrderStrategy strategy);
+extern Boolean     parse_DAGOrderStrategy(const char *name,DAGOrderStrategy *strategy);
+
+/* Width of the current order of the graph */
+extern size_t separation_DAG(const DAG *g);
+extern size_t cutwidth_DAG(const DAG *g);
+
+/* Canonical labelling, where `label[v]' is the new name of v */
+extern Boolean canonical_labelling_DAG(const DAG *g,Vertex *label);
+extern size_t* certificate_DAG(const DAG *g,const Vertex *label,size_t *length);
+
 #endif /* DAG_H */
 
 
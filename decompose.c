@@ -0,0 +1,212 @@
+/*
+   Description::
+
+   Series decomposition for black pebbling.  In a graph with a single
+   sink, a vertex `a' is a cut when no edge jumps over it and no source
+   follows it: then every vertex after `a' is a descendant of `a', and
+   the vertices before `a' reach the rest of the graph only through
+   `a'.
+
+   Let c be the cost of the graph L up to `a'.  The graph is as hard
+   to pebble as the graph where L is replaced by c-1 sources which are
+   the predecessors of `a'.  A pebbling of L can stand for the c pebbles
+   on the sources and on `a', and a pebbling of the whole graph never
+   needs more than a pebble on `a' inside L: keeping just `a' pebbled,
+   from the last time L needed c pebbles, is never worse than keeping
+   any other part of L.
+
+   So the parts between consecutive cuts are searched in order, each
+   one with the gadget for the cost of the previous ones, and the
+   search space is the one of the largest part instead of the one of
+   the whole graph.  The pebbling of each part is spliced in the
+   next one, at each placement of a pebble on the gadget.
+
+*/
+
+/* Preamble */
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+#include "dag.h"
+#include "pebbling.h"
+#include "config.h"
+#include "libpebble.h"
+#include "decompose.h"
+
+
+/* Code */
+
+/* The cuts, in order, and the sink at the end */
+Decomposition *new_Decomposition(const DAG *g) {
+
+  assert(isconsistent_DAG(g));
+  assert(g->size>0);
+
+  size_t n=g->size;
+  Decomposition *d=(Decomposition*)calloc(1,sizeof(Decomposition));
+  long   *jumps=(long*)calloc(n+1,sizeof(long));
+  assert(d && jumps);
+
+  d->graph=g;
+  d->cut=(Vertex*)malloc(n*sizeof(Vertex));
+  assert(d->cut);
+
+  /* jumps[a] counts the edges u -> v with u < a < v, after the sum */
+  Vertex lastsource=0;
+  for(Vertex v=0;v<n;v++) {
+    if (g->indegree[v]==0) lastsource=v;
+    for(size_t i=0;i<g->indegree[v];i++) {
+      Vertex u=g->in[v][i];
+      if (u+1<v) { jumps[u+1]++; jumps[v]--; }
+    }
+  }
+  for(Vertex a=1;a<n;a++) jumps[a]+=jumps[a-1];
+
+  if (g->sink_number==1)
+    for(Vertex a=lastsource;a+1<n;a++)
+      if (jumps[a]==0) d->cut[d->parts++]=a;
+  d->cut[d->parts++]=n-1;
+
+  d->cost=(int*)calloc(d->parts,sizeof(int));
+  assert(d->cost);
+  free(jumps);
+  return d;
+}
+
+
+void dispose_Decomposition(Decomposition *d) {
+  if (d==NULL) return;
+  free(d->cut);
+  free(d->cost);
+  free(d->steps);
+  free(d);
+}
+
+
+/* The graph of part i, where the `gadget' sources are the
+   predecessors of the previous cut.  The vertex w > gadget of the
+   part is the vertex w - gadget + cut[i-1] of the graph. */
+static DAG *partgraph(const Decomposition *d,size_t i,size_t gadget) {
+
+  const DAG *g=d->graph;
+  Vertex lo     = (i==0) ? 0 : d->cut[i-1];
+  size_t offset = (i==0) ? 0 : gadget;
+  size_t size   = offset + d->cut[i] - lo + 1;
+  DAG *p=new_DAG(size);
+
+  for(Vertex w=offset;w<size;w++)
+    p->indegree[w] = (i>0 && w==offset) ? gadget : g->indegree[lo+w-offset];
+  edges_DAG(p);
+  for(Vertex w=offset;w<size;w++)
+    for(size_t j=0;j<p->indegree[w];j++)
+      p->in[w][j] = (i>0 && w==offset) ? j : g->in[lo+w-offset][j]-lo+offset;
+  dag_precompute_data(p);
+  assert(isconsistent_DAG(p));
+  return p;
+}
+
+static inline void append(Decomposition *d,size_t *allocation,Vertex v) {
+  if (d->length==*allocation) {
+    *allocation*=2;
+    d->steps=(Vertex*)realloc(d->steps,*allocation*sizeof(Vertex));
+    assert(d->steps);
+  }
+  d->steps[d->length++]=v;
+}
+
+/* Splice the pebbling of part i into the pebbling of the graph up to
+   its previous cut, which ends with just the cut pebbled.  A
+   placement on the gadget is the pebbling up to the cut, a removal is
+   the removal of the cut, and the moves on the sources are dropped.
+   Before the last part the moves on the cut after its placement are
+   dropped too, so that the cut stays pebbled. */
+static void splice(Decomposition *d,size_t i,size_t gadget,const Pebbling *p) {
+
+  Vertex  lo     = (i==0) ? 0 : d->cut[i-1];
+  size_t  offset = (i==0) ? 0 : gadget;
+  Vertex *lower  = d->steps;
+  size_t  lower_length=d->length;
+  Boolean hub=FALSE;
+  Boolean placed=FALSE;
+  size_t  allocation=p->length+lower_length+16;
+
+  d->steps=(Vertex*)malloc(allocation*sizeof(Vertex));
+  d->length=0;
+  assert(d->steps);
+
+  for(size_t k=0;k<p->length;k++) {
+    Vertex w=p->steps[k];
+    if (i>0 && w<offset) continue;
+    if (i>0 && w==offset) {
+      if (hub) append(d,&allocation,lo);
+      else for(size_t j=0;j<lower_length;j++) append(d,&allocation,lower[j]);
+      hub=!hub;
+      continue;
+    }
+    Vertex v=lo+w-offset;
+    if (v==d->cut[i] && i+1<d->parts) {
+      if (placed) continue;
+      placed=TRUE;
+    }
+    append(d,&allocation,v);
+  }
+  free(lower);
+}
+
+
+SearchResult run_Decomposition(Decomposition *d,PebbleSearch *s) {
+
+  assert(d && s);
+
+  unsigned int bound=s->bound;
+  SearchResult result=SEARCH_FOUND;
+
+  free(d->steps);
+  d->steps=NULL;
+  d->length=0;
+  d->solved=0;
+  memset(d->cost,0,d->parts*sizeof(int));
+
+  if (s->variant!=&variant_ops_black) {
+    setgraph_PebbleSearch(s,d->graph);
+    s->options.error="the decomposition is for black pebbling only";
+    s->result=SEARCH_ERROR;
+    return s->result;
+  }
+
+  /* Each part needs at least the pebbles of the previous ones */
+  unsigned int cost=1;
+  for(size_t i=0;i<d->parts && result==SEARCH_FOUND;i++) {
+
+    size_t gadget = (i==0) ? 0 : cost-1;
+    DAG *p=partgraph(d,i,gadget);
+    setgraph_PebbleSearch(s,p);
+
+    result=SEARCH_NOT_FOUND;
+    for(;cost<=bound && result==SEARCH_NOT_FOUND;cost++) {
+      setoption_PebbleSearch(s,OPTION_BOUND,cost);
+      result=run_PebbleSearch(s);
+    }
+    if (result==SEARCH_FOUND) {
+      const Pebbling *solution=pebbling_PebbleSearch(s);
+      cost=(unsigned int)solution->cost;
+      d->cost[i]=solution->cost;
+      d->solved++;
+      splice(d,i,gadget,solution);
+    }
+    setgraph_PebbleSearch(s,NULL);
+    dispose_DAG(p);
+  }
+
+  if (result!=SEARCH_FOUND) {
+    free(d->steps);
+    d->steps=NULL;
+    d->length=0;
+  }
+  setgraph_PebbleSearch(s,d->graph);
+  setoption_PebbleSearch(s,OPTION_BOUND,bound);
+  s->result=result;
+  return result;
+}
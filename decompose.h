@@ -0,0 +1,48 @@
+/*
+   Description::
+
+   Series decomposition of a graph for black pebbling: the graph is
+   split at the vertices through which every path to the sink passes,
+   and the parts are searched one after the other.  Header for
+   decompose.c
+
+*/
+
+
+/* Preamble */
+#ifndef  DECOMPOSE_H
+#define  DECOMPOSE_H
+
+#include "common.h"
+#include "dag.h"
+#include "libpebble.h"
+
+
+/* Code */
+
+/* Part i is made of the vertices after cut[i-1] (after -1 for the
+   first part) up to cut[i], and the last cut is the sink. */
+typedef struct {
+
+  const DAG *graph;
+  size_t     parts;
+  Vertex    *cut;
+  int       *cost;          /* Cost of each part solved, otherwise 0 */
+  size_t     solved;
+
+  Vertex    *steps;         /* Pebbling of the graph, when found (see Pebbling) */
+  size_t     length;
+
+} Decomposition;
+
+/* The graph must have a single sink, otherwise it is a single part */
+extern Decomposition *new_Decomposition(const DAG *g);
+extern void           dispose_Decomposition(Decomposition *d);
+
+/* Search the cheapest black pebbling within the bound of the context,
+   one part at a time.  The context is moved to the parts, and back to
+   the graph at the end, without a pebbling.  Its error and its limit
+   are the ones of the part which stopped the search. */
+extern SearchResult   run_Decomposition(Decomposition *d,PebbleSearch *s);
+
+#endif /* DECOMPOSE_H */
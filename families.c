@@ -0,0 +1,529 @@
+/*
+   Description::
+
+   Pebblings of the classic families, built without search.  The
+   vertices are numbered as in path(), tree() and pyramid() in dag.c.
+
+   Black pebbling: a path needs 2 pebbles, a binary tree and a pyramid
+   of height h need h+2.  The tree is pebbled recursively, keeping the
+   root of the left subtree while pebbling the right one.  The pyramid
+   is pebbled one diagonal at a time, from the left corner up to the
+   apex, and each diagonal replaces the previous one.
+
+   Reversible pebbling of paths: the recurrences of
+   rev-line-estimates.py.  A persistent pebbling of a path of length
+   n pebbles the vertex a-1 persistently, then the rest of the path,
+   and then unpebbles vertex a-1 by running its pebbling backward:
+
+       p(n) = 1 + max(p(a-1), p(n-a))       c(n) = max(p(a-1), 1 + c(n-a))
+
+   where c is the cost of visiting the sink instead.
+
+   Reversible pebbling of a pyramid of height h, with a split s and
+   L=h-s.  The top L vertices (h-1-j,j) of the diagonal under the
+   right side, and the vertex (s,L) of the right side, are pebbled
+   persistently one after the other.  The right side from row s+1 to
+   the apex is then a path, pebbled as above, and the diagonal is
+   unpebbled backward:
+
+       p(h) = 1 + max(max_j (j + p(h-1-j)), L + p(s), L + p'(L-1))
+
+   where p' is the cost of the path.  These are the costs of
+   rev-pyr-persistent.py: with h+x pebbles this reaches the height
+   g(x)=2^(g(x-1)+x-2)+g(x-1), since a pyramid of height g(x-1) and
+   a path of length 2^(g(x-1)+x-2) cost g(x-1)+x-1 pebbles.  The
+   pyramid can also be pebbled row by row: the a+1 vertices of row
+   h-a under the apex are pebbled persistently, then the apex on top
+   of them, and the row is unpebbled backward, which costs
+
+       p(h) = a + 1 + max(p(h-a), p(a-1))   c(h) = max(a + p(h-a), a + 1 + c(a-1))
+
+   The visiting pebbling is the best of the row one, of the diagonal
+   one where the right side is visited and the apex is not kept, and
+   of the persistent one.  Up to height 9 these are the costs of
+   rev-pyr-estimates.py, which are optimal up to height 6 at least,
+   and from height 10 they are lower.  Between pebblings of the same
+   cost the shorter one is chosen, and p(0) = c(0) = 1.  All these
+   costs are upper bounds, not known to be optimal.
+
+*/
+
+/* Preamble */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "common.h"
+#include "dag.h"
+#include "config.h"
+#include "families.h"
+
+
+/* Code */
+
+GraphFamily parse_GraphFamily(const char *spec,int *parameter) {
+
+  int used=0;
+  int a=0;
+
+  assert(spec && parameter);
+
+  if (sscanf(spec,"pyramid:%d%n",&a,&used)==1 && spec[used]=='\0' && a>=1 && a<=60000) {
+    *parameter=a;
+    return FAMILY_PYRAMID;
+  }
+  if (sscanf(spec,"tree:%d%n",&a,&used)==1 && spec[used]=='\0' && a>=1 && a<=30) {
+    *parameter=a;
+    return FAMILY_TREE;
+  }
+  if (sscanf(spec,"path:%d%n",&a,&used)==1 && spec[used]=='\0' && a>=1 && a<=INT_MAX-1) {
+    *parameter=a;
+    return FAMILY_PATH;
+  }
+  return FAMILY_NONE;
+}
+
+
+/* Sequence of moves, which grows as needed */
+typedef struct {
+
+  Vertex *steps;
+  size_t  length;
+  size_t  allocation;
+
+} Moves;
+
+static inline void move(Moves *m,Vertex v) {
+  if (m->length==m->allocation) {
+    m->allocation*=2;
+    m->steps=(Vertex*)realloc(m->steps,m->allocation*sizeof(Vertex));
+    assert(m->steps);
+  }
+  m->steps[m->length++]=v;
+}
+
+/* Append the moves from `from' to `to' (excluded), backward */
+static void undo(Moves *m,size_t from,size_t to) {
+  for(size_t k=to;k-->from;) move(m,m->steps[k]);
+}
+
+
+/* Recurrences for the reversible pebbling of paths, up to length n.
+   Both p(a-1) and c(n-a) (or p(n-a)) are monotone in the split, so
+   the best split is where they cross. */
+static void linetables(size_t n,int *p,size_t *psplit,int *c,size_t *csplit) {
+
+  p[0]=c[0]=1;
+  psplit[0]=csplit[0]=0;
+
+  for(size_t m=1;m<=n;m++) {
+    size_t lo=1,hi=m;
+    while(lo<hi) {                           /* First a with p(a-1) >= p(m-a) */
+      size_t a=(lo+hi)/2;
+      if (p[a-1]>=p[m-a]) hi=a; else lo=a+1;
+    }
+    p[m]=1+MAX(p[lo-1],p[m-lo]);
+    psplit[m]=lo;
+    if (lo>1 && 1+MAX(p[lo-2],p[m-lo+1])<p[m]) {
+      p[m]=1+MAX(p[lo-2],p[m-lo+1]);
+      psplit[m]=lo-1;
+    }
+
+    lo=1; hi=m;
+    while(lo<hi) {                           /* First a with p(a-1) >= 1+c(m-a) */
+      size_t a=(lo+hi)/2;
+      if (p[a-1]>=1+c[m-a]) hi=a; else lo=a+1;
+    }
+    c[m]=MAX(p[lo-1],1+c[m-lo]);
+    csplit[m]=lo;
+    if (lo>1 && MAX(p[lo-2],1+c[m-lo+1])<c[m]) {
+      c[m]=MAX(p[lo-2],1+c[m-lo+1]);
+      csplit[m]=lo-1;
+    }
+  }
+}
+
+/* Reversible pebbling of the path from s to s+n, where s-1 (if any)
+   is pebbled.  The persistent one leaves just s+n pebbled. */
+static void linepersistent(Moves *m,const size_t *psplit,Vertex s,size_t n) {
+  if (n==0) { move(m,s); return; }
+  size_t a=psplit[n];
+  size_t start=m->length;
+  linepersistent(m,psplit,s,a-1);
+  size_t end=m->length;
+  linepersistent(m,psplit,s+a,n-a);
+  undo(m,start,end);
+}
+
+static void linevisiting(Moves *m,const size_t *psplit,const size_t *csplit,Vertex s,size_t n) {
+  if (n==0) { move(m,s); move(m,s); return; }
+  size_t a=csplit[n];
+  size_t start=m->length;
+  linepersistent(m,psplit,s,a-1);
+  size_t end=m->length;
+  linevisiting(m,psplit,csplit,s+a,n-a);
+  undo(m,start,end);
+}
+
+
+/* Vertex i of row r in the pyramid of height h */
+static inline Vertex pyramidvertex(size_t h,size_t r,size_t i) {
+  return r*(h+1) - r*(r-1)/2 + i;
+}
+
+/* How the pebbling of a pyramid is built */
+typedef enum {
+
+  PYRAMID_PERSISTENT,
+  PYRAMID_ROW,
+  PYRAMID_DIAGONAL
+
+} PyramidStrategy;
+
+/* Tables of the reversible pebblings of pyramids up to height h, and
+   of the paths climbed along their sides */
+typedef struct {
+
+  size_t           h;
+  int             *p;
+  int             *c;
+  size_t          *psplit;
+  size_t          *csplit;
+  PyramidStrategy *pstrategy;
+  PyramidStrategy *cstrategy;
+
+  int             *linep;
+  int             *linec;
+  size_t          *linepsplit;
+  size_t          *linecsplit;
+
+} PyramidPebbling;
+
+/* Between pebblings of the same cost, the shorter one */
+static inline Boolean better(int cost,double length,int bestcost,double bestlength) {
+  return cost<bestcost || (cost==bestcost && length<bestlength);
+}
+
+static void pyramidtables(PyramidPebbling *y,size_t h) {
+
+  y->h=h;
+  y->p=(int*)malloc((h+1)*sizeof(int));
+  y->c=(int*)malloc((h+1)*sizeof(int));
+  y->psplit=(size_t*)malloc((h+1)*sizeof(size_t));
+  y->csplit=(size_t*)malloc((h+1)*sizeof(size_t));
+  y->pstrategy=(PyramidStrategy*)malloc((h+1)*sizeof(PyramidStrategy));
+  y->cstrategy=(PyramidStrategy*)malloc((h+1)*sizeof(PyramidStrategy));
+  y->linep=(int*)malloc((h+1)*sizeof(int));
+  y->linec=(int*)malloc((h+1)*sizeof(int));
+  y->linepsplit=(size_t*)malloc((h+1)*sizeof(size_t));
+  y->linecsplit=(size_t*)malloc((h+1)*sizeof(size_t));
+  assert(y->p && y->c && y->psplit && y->csplit && y->pstrategy && y->cstrategy);
+  assert(y->linep && y->linec && y->linepsplit && y->linecsplit);
+
+  linetables(h,y->linep,y->linepsplit,y->linec,y->linecsplit);
+
+  /* The lengths of the pebblings, to choose among the ones of the
+     same cost */
+  double *plen=(double*)malloc((h+1)*sizeof(double));
+  double *clen=(double*)malloc((h+1)*sizeof(double));
+  double *lineplen=(double*)malloc((h+1)*sizeof(double));
+  double *lineclen=(double*)malloc((h+1)*sizeof(double));
+  assert(plen && clen && lineplen && lineclen);
+
+  lineplen[0]=1;
+  lineclen[0]=2;
+  for(size_t n=1;n<=h;n++) {
+    lineplen[n]=2*lineplen[y->linepsplit[n]-1]+lineplen[n-y->linepsplit[n]];
+    lineclen[n]=2*lineplen[y->linecsplit[n]-1]+lineclen[n-y->linecsplit[n]];
+  }
+
+  int *p=y->p;
+  int *c=y->c;
+  p[0]=c[0]=1;
+  plen[0]=1;
+  clen[0]=2;
+  y->psplit[0]=y->csplit[0]=0;
+  y->pstrategy[0]=y->cstrategy[0]=PYRAMID_DIAGONAL;
+
+  for(size_t n=1;n<=h;n++) {
+
+    /* The split s of the diagonal.  The vertices (n-1-j,j) with
+       j < n-s cost at most top, and their pebblings have length sum. */
+    int    top=INT_MIN;
+    double sum=0;
+    int    cdiagonal=INT_MAX;
+    double cdiagonallen=0;
+    size_t sdiagonal=0;
+
+    p[n]=INT_MAX;
+    for(size_t s=n;s-->0;) {
+      int L=(int)(n-s);
+      top=MAX(top,(int)(n-1-s)+p[s]);
+      sum+=plen[s];
+      int    pv=1+MAX(MAX(top,L+p[s]),L+y->linep[L-1]);
+      int    cv=MAX(MAX(top,L+p[s]),L+1+y->linec[L-1]);
+      double pl=2*(sum+plen[s])+lineplen[L-1];
+      double cl=2*(sum+plen[s])+lineclen[L-1];
+      if (better(pv,pl,p[n],plen[n])) {
+        p[n]=pv; plen[n]=pl; y->psplit[n]=s; y->pstrategy[n]=PYRAMID_DIAGONAL;
+      }
+      if (better(cv,cl,cdiagonal,cdiagonallen)) {
+        cdiagonal=cv; cdiagonallen=cl; sdiagonal=s;
+      }
+    }
+    for(size_t a=1;a<=n;a++) {
+      int    pv=(int)a+1+MAX(p[n-a],p[a-1]);
+      double pl=2*(double)(a+1)*plen[n-a]+plen[a-1];
+      if (better(pv,pl,p[n],plen[n])) {
+        p[n]=pv; plen[n]=pl; y->psplit[n]=a; y->pstrategy[n]=PYRAMID_ROW;
+      }
+    }
+
+    c[n]=p[n];
+    clen[n]=2*plen[n];
+    y->csplit[n]=0;
+    y->cstrategy[n]=PYRAMID_PERSISTENT;
+    for(size_t a=1;a<=n;a++) {
+      int    cv=MAX((int)a+p[n-a],(int)a+1+c[a-1]);
+      double cl=2*(double)(a+1)*plen[n-a]+clen[a-1];
+      if (better(cv,cl,c[n],clen[n])) {
+        c[n]=cv; clen[n]=cl; y->csplit[n]=a; y->cstrategy[n]=PYRAMID_ROW;
+      }
+    }
+    if (better(cdiagonal,cdiagonallen,c[n],clen[n])) {
+      c[n]=cdiagonal;
+      clen[n]=cdiagonallen;
+      y->csplit[n]=sdiagonal;
+      y->cstrategy[n]=PYRAMID_DIAGONAL;
+    }
+  }
+  free(plen);
+  free(clen);
+  free(lineplen);
+  free(lineclen);
+}
+
+static void freepyramidtables(PyramidPebbling *y) {
+  free(y->p);
+  free(y->c);
+  free(y->psplit);
+  free(y->csplit);
+  free(y->pstrategy);
+  free(y->cstrategy);
+  free(y->linep);
+  free(y->linec);
+  free(y->linepsplit);
+  free(y->linecsplit);
+}
+
+static void pyramidrec(Moves *m,const PyramidPebbling *y,size_t r,size_t i,size_t n,Boolean persistent);
+
+/* The right side of the pyramid of height n with apex (r,i), from
+   row n-L+1 to the apex, is a path when the vertices under it on
+   the diagonal are pebbled, and it is pebbled as such. */
+static void pyramidclimb(Moves *m,const PyramidPebbling *y,size_t r,size_t i,size_t L,Boolean persistent) {
+
+  Moves line;
+  line.length=0;
+  line.allocation=4*L+16;
+  line.steps=(Vertex*)malloc(line.allocation*sizeof(Vertex));
+  assert(line.steps);
+
+  if (persistent) linepersistent(&line,y->linepsplit,0,L-1);
+  else            linevisiting(&line,y->linepsplit,y->linecsplit,0,L-1);
+  for(size_t k=0;k<line.length;k++)
+    move(m,pyramidvertex(y->h,r-L+1+line.steps[k],i+L-1-line.steps[k]));
+  free(line.steps);
+}
+
+/* The vertices (n-1-j,j) for j < L=n-s and (s,L), relative to the
+   pyramid of height n with apex (r,i), are pebbled persistently one
+   after the other.  Then the right side above (s,L) is climbed, and
+   those vertices are unpebbled backward. */
+static void pyramiddiagonal(Moves *m,const PyramidPebbling *y,size_t r,size_t i,size_t n,size_t s,Boolean persistent) {
+
+  size_t L=n-s;
+  size_t start=m->length;
+  for(size_t j=0;j<L;j++) pyramidrec(m,y,r-1-j,i+j,n-1-j,TRUE);
+  pyramidrec(m,y,r-L,i+L,s,TRUE);
+  size_t end=m->length;
+  pyramidclimb(m,y,r,i,L,persistent);
+  undo(m,start,end);
+}
+
+/* Reversible pebbling of the pyramid of height n with apex (r,i),
+   where the row under it (if any) is pebbled.  The persistent one
+   leaves the apex pebbled. */
+static void pyramidrec(Moves *m,const PyramidPebbling *y,size_t r,size_t i,size_t n,Boolean persistent) {
+
+  size_t start=m->length;
+  size_t end;
+
+  if (n==0) {
+    move(m,pyramidvertex(y->h,r,i));
+    if (!persistent) move(m,pyramidvertex(y->h,r,i));
+    return;
+  }
+
+  size_t a = persistent ? y->psplit[n] : y->csplit[n];
+  switch(persistent ? y->pstrategy[n] : y->cstrategy[n]) {
+  case PYRAMID_PERSISTENT:
+    pyramidrec(m,y,r,i,n,TRUE);
+    undo(m,start,m->length);
+    break;
+  case PYRAMID_ROW:
+    for(size_t j=0;j<=a;j++) pyramidrec(m,y,r-a,i+j,n-a,TRUE);
+    end=m->length;
+    pyramidrec(m,y,r,i,a-1,persistent);
+    undo(m,start,end);
+    break;
+  case PYRAMID_DIAGONAL:
+    pyramiddiagonal(m,y,r,i,n,a,persistent);
+    break;
+  }
+}
+
+/* Black pebbling of the subtree of v, which leaves v pebbled */
+static void treeblack(Moves *m,Vertex leaves,Vertex v) {
+  if (v<leaves) { move(m,v); return; }
+  Vertex left=2*(v-leaves);
+  treeblack(m,leaves,left);
+  treeblack(m,leaves,left+1);
+  move(m,v);
+  move(m,left);
+  move(m,left+1);
+}
+
+
+int cost_FamilyPebbling(GraphFamily family,int parameter,
+                        PebblingVariant variant,Boolean persistent) {
+
+  assert(parameter>=0);
+  size_t n=(size_t)parameter;
+
+  if (variant==VARIANT_BLACK) {
+    switch(family) {
+    case FAMILY_PATH:    return n==0 ? 1 : 2;
+    case FAMILY_TREE:
+    case FAMILY_PYRAMID: return n==0 ? 1 : (int)n+2;
+    default:             return -1;
+    }
+  }
+  if (variant!=VARIANT_REVERSIBLE || (family!=FAMILY_PATH && family!=FAMILY_PYRAMID))
+    return -1;
+
+  int cost;
+  if (family==FAMILY_PATH) {
+    int    *p=(int*)malloc((n+1)*sizeof(int));
+    int    *c=(int*)malloc((n+1)*sizeof(int));
+    size_t *ps=(size_t*)malloc((n+1)*sizeof(size_t));
+    size_t *cs=(size_t*)malloc((n+1)*sizeof(size_t));
+    assert(p && c && ps && cs);
+    linetables(n,p,ps,c,cs);
+    cost = persistent ? p[n] : c[n];
+    free(p);
+    free(c);
+    free(ps);
+    free(cs);
+  } else {
+    PyramidPebbling y;
+    pyramidtables(&y,n);
+    cost = persistent ? y.p[n] : y.c[n];
+    freepyramidtables(&y);
+  }
+  return cost;
+}
+
+
+FamilyPebbling *new_FamilyPebbling(GraphFamily family,int parameter,
+                                   PebblingVariant variant,Boolean persistent) {
+
+  int expected=cost_FamilyPebbling(family,parameter,variant,persistent);
+  if (expected<0) return NULL;
+
+  size_t n=(size_t)parameter;
+  size_t size= family==FAMILY_PATH ? n+1
+             : family==FAMILY_TREE ? ((size_t)2<<n)-1 : (n+1)*(n+2)/2;
+  Moves m;
+  m.length=0;
+  m.allocation=2*size+16;
+  m.steps=(Vertex*)malloc(m.allocation*sizeof(Vertex));
+  assert(m.steps);
+
+  if (variant==VARIANT_BLACK && family==FAMILY_PATH) {
+
+    move(&m,0);
+    for(Vertex v=1;v<=n;v++) { move(&m,v); move(&m,v-1); }
+    move(&m,n);
+
+  } else if (variant==VARIANT_BLACK && family==FAMILY_TREE) {
+
+    treeblack(&m,(Vertex)1<<n,size-1);
+    move(&m,size-1);
+
+  } else if (variant==VARIANT_BLACK) {
+
+    /* Diagonal j is made of the vertices (r,j-r) */
+    for(size_t j=0;j<=n;j++) {
+      move(&m,pyramidvertex(n,0,j));
+      for(size_t r=1;r<=j;r++) {
+        move(&m,pyramidvertex(n,r,j-r));
+        move(&m,pyramidvertex(n,r-1,j-r));
+      }
+    }
+    for(size_t r=0;r<=n;r++) move(&m,pyramidvertex(n,r,n-r));
+
+  } else if (family==FAMILY_PATH) {
+
+    int    *p=(int*)malloc((n+1)*sizeof(int));
+    int    *c=(int*)malloc((n+1)*sizeof(int));
+    size_t *ps=(size_t*)malloc((n+1)*sizeof(size_t));
+    size_t *cs=(size_t*)malloc((n+1)*sizeof(size_t));
+    assert(p && c && ps && cs);
+
+    linetables(n,p,ps,c,cs);
+    if (persistent) linepersistent(&m,ps,0,n);
+    else            linevisiting(&m,ps,cs,0,n);
+    free(p);
+    free(c);
+    free(ps);
+    free(cs);
+
+  } else {
+
+    PyramidPebbling y;
+    pyramidtables(&y,n);
+    pyramidrec(&m,&y,n,0,n,persistent);
+    freepyramidtables(&y);
+  }
+
+  /* The cost, from the moves */
+  FamilyPebbling *f=(FamilyPebbling*)malloc(sizeof(FamilyPebbling));
+  Boolean *pebbled=(Boolean*)calloc(size,sizeof(Boolean));
+  int pebbles=0;
+  assert(f && pebbled);
+
+  f->cost=0;
+  for(size_t k=0;k<m.length;k++) {
+    assert(m.steps[k]<size);
+    pebbles += pebbled[m.steps[k]] ? -1 : 1;
+    pebbled[m.steps[k]] = !pebbled[m.steps[k]];
+    f->cost=MAX(f->cost,pebbles);
+  }
+  assert(f->cost==expected);
+  free(pebbled);
+
+  f->optimal = (variant==VARIANT_BLACK);
+  f->steps   = m.steps;
+  f->length  = m.length;
+  return f;
+}
+
+
+void dispose_FamilyPebbling(FamilyPebbling *f) {
+  if (f==NULL) return;
+  free(f->steps);
+  free(f);
+}
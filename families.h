@@ -0,0 +1,61 @@
+/*
+   Description::
+
+   Pebblings of paths, complete binary trees and pyramids, built
+   directly from the known formulas and recurrences, without search.
+   Header for families.c
+
+*/
+
+
+/* Preamble */
+#ifndef  FAMILIES_H
+#define  FAMILIES_H
+
+#include "common.h"
+#include "dag.h"
+#include "config.h"
+
+
+/* Code */
+
+/* The graphs of path(), tree() and pyramid() in dag.c */
+typedef enum {
+
+  FAMILY_NONE,
+  FAMILY_PATH,
+  FAMILY_TREE,
+  FAMILY_PYRAMID
+
+} GraphFamily;
+
+/* A pebbling of a graph of the family, as a sequence of vertices (see
+   Pebbling in pebbling.h).  The cost is optimal for black pebbling.
+   For reversible pebbling it comes from the recurrences of families.c
+   and it is just an upper bound.  It is the cost of the script
+   rev-line-estimates.py for visiting a path, the one of
+   rev-pyr-persistent.py for the persistent pebbling of a pyramid,
+   and at most the one of rev-pyr-estimates.py for visiting it. */
+typedef struct {
+
+  int      cost;
+  Boolean  optimal;
+  Vertex  *steps;
+  size_t   length;
+
+} FamilyPebbling;
+
+/* The family of a -G specification, and its parameter, or FAMILY_NONE */
+extern GraphFamily parse_GraphFamily(const char *spec,int *parameter);
+
+/* The cost of the pebbling below, without building it, or -1 if
+   there is no construction for the variant */
+extern int cost_FamilyPebbling(GraphFamily family,int parameter,
+                               PebblingVariant variant,Boolean persistent);
+
+/* NULL if there is no construction for the variant */
+extern FamilyPebbling *new_FamilyPebbling(GraphFamily family,int parameter,
+                                          PebblingVariant variant,Boolean persistent);
+extern void            dispose_FamilyPebbling(FamilyPebbling *f);
+
+#endif /* FAMILIES_H */
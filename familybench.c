@@ -0,0 +1,275 @@
+/*
+  Correctness check and benchmark for the pebblings of the classic
+  families in families.c.
+
+  For small paths, trees and pyramids the pebbling built by families.c
+  must be valid, and its cost must be the one found by the search.
+  The reversible costs of the pyramids, up to the height of the
+  scripts rev-pyr-estimates.py and rev-pyr-persistent.py, are
+  compared with the ones of the scripts.  Then the pebblings of a
+  large graph of each family are built and timed.  With -T the
+  reversible costs are printed next to the ones of the scripts.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "common.h"
+#include "dag.h"
+#include "pebbling.h"
+#include "config.h"
+#include "libpebble.h"
+#include "families.h"
+
+
+#define USAGEMESSAGE "\n\
+Usage: %s [-h] [-p <height>] [-t <height>] [-c <length>] [-P <height>] [-L <length>]\n\
+       %s [-h] -T <height>\n\
+\n\
+       -h     help message;\n\
+       -p H   largest pyramid checked against the search (default: 4);\n\
+       -t H   largest tree checked against the search (default: 3);\n\
+       -c N   longest path checked against the search (default: 12);\n\
+       -P H   height of the large pyramid and tree which are timed (default: 200);\n\
+       -L N   length of the large path which is timed (default: 100000);\n\
+       -T H   print the reversible costs of paths and pyramids up to H,\n\
+              and of the pyramid scripts.\n"
+
+
+/* MaxHeight of the scripts rev-pyr-estimates.py and rev-pyr-persistent.py */
+#define SCRIPTS_HEIGHT 640
+
+static const char *familyname[]={ "none", "path", "tree", "pyramid" };
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static DAG *familygraph(GraphFamily family,int parameter) {
+  switch(family) {
+  case FAMILY_PATH:    return path(parameter);
+  case FAMILY_TREE:    return tree(parameter);
+  case FAMILY_PYRAMID: return pyramid(parameter);
+  default:             return NULL;
+  }
+}
+
+/* Check the pebbling of one graph against the search.  Return the
+   number of errors. */
+static int check(PebbleSearch *s,GraphFamily family,int parameter,
+                 PebblingVariant variant,Boolean persistent) {
+
+  const VariantOps *ops = (variant==VARIANT_BLACK) ? &variant_ops_black : &variant_ops_rev;
+  FamilyPebbling *f=new_FamilyPebbling(family,parameter,variant,persistent);
+  DAG *g=familygraph(family,parameter);
+  int errors=0;
+  int optimum=0;
+
+  if (f==NULL) { dispose_DAG(g); return 0; }
+
+  Pebbling *p=ops->create(f->length);
+  memcpy(p->steps,f->steps,f->length*sizeof(Vertex));
+  p->length=f->length;
+  p->cost=f->cost;
+  if (!ops->isvalid(g,p,persistent)) errors++;
+  ops->dispose(p);
+
+  setgraph_PebbleSearch(s,g);
+  setoption_PebbleSearch(s,OPTION_VARIANT,variant);
+  setoption_PebbleSearch(s,OPTION_PERSISTENT,persistent);
+  for(int b=1;b<=f->cost && optimum==0;b++) {
+    setoption_PebbleSearch(s,OPTION_BOUND,b);
+    SearchResult r=run_PebbleSearch(s);
+    if (r==SEARCH_FOUND) optimum=b;
+    else if (r!=SEARCH_NOT_FOUND) { errors++; break; }
+  }
+  setgraph_PebbleSearch(s,NULL);
+
+  if (optimum!=f->cost) errors++;
+
+  printf("c %-21s %-7s %2d: cost %3d, search %3d, length %6zu, %s\n",
+         variant==VARIANT_BLACK ? "black" : persistent ? "reversible persistent" : "reversible",
+         familyname[family],parameter,f->cost,optimum,f->length,
+         errors ? "FAILED" : "ok");
+
+  dispose_FamilyPebbling(f);
+  dispose_DAG(g);
+  return errors;
+}
+
+/* Build the pebbling of a large graph, and time it */
+static void timing(GraphFamily family,int parameter,PebblingVariant variant,Boolean persistent) {
+
+  double start=now();
+  FamilyPebbling *f=new_FamilyPebbling(family,parameter,variant,persistent);
+  double elapsed=now()-start;
+
+  if (f==NULL) return;
+  printf("c %s%s pebbling of the %s %d: cost %d, length %zu, built in %.3fs\n",
+         variant==VARIANT_BLACK ? "black" : "reversible",persistent ? " persistent" : "",
+         familyname[family],parameter,f->cost,f->length,elapsed);
+  dispose_FamilyPebbling(f);
+}
+
+/* The cost of rev-pyr-persistent.py for the persistent reversible
+   pebbling of the pyramid of height h: h+i, for the first i such
+   that g(i) >= h, where g(1)=0 and g(i)=2^(g(i-1)+i-2)+g(i-1). */
+static int persistentformula(int h) {
+  long g=0;
+  int  i=1;
+  while (g<h) {
+    i++;
+    g = (g+i-2 >= 31) ? h : (1L << (g+i-2)) + g;
+  }
+  return h+i;
+}
+
+/* The table of rev-pyr-estimates.py for the reversible pebbling of
+   the pyramids up to height h: the values up to height 4 come from
+   the search, then c(n) is the minimum of a+1+max(c(a-1),c(n-a)). */
+static int *estimatestable(int h) {
+  static const int seed[5]={ 1, 3, 4, 5, 6 };
+  int *c=(int*)malloc((h+5)*sizeof(int));
+  assert(c);
+  for(int n=0;n<=h+4;n++) {
+    if (n<5) { c[n]=seed[n]; continue; }
+    c[n]=n*n;
+    for(int a=1;a<n;a++)
+      if (a+1+MAX(c[a-1],c[n-a])<c[n]) c[n]=a+1+MAX(c[a-1],c[n-a]);
+  }
+  return c;
+}
+
+/* Compare the reversible costs of the pyramids up to height h with
+   the ones of the scripts, and print them with -T.  The persistent
+   costs must be the same.  The visiting ones must be the same where
+   rev-pyr-estimates.py is below rev-pyr-persistent.py: above, the
+   script is beaten by any persistent pebbling, and the cost must not
+   exceed that one.  Return the number of errors. */
+static int scripts(int height,Boolean print) {
+
+  int *estimates=estimatestable(height);
+  int errors=0;
+
+  if (print)
+    printf("     H | Path c | Path p | Pyr c | rev-pyr-estimates.py | Pyr p | rev-pyr-persistent.py\n");
+  for(int h=0;h<=height;h++) {
+    int c=cost_FamilyPebbling(FAMILY_PYRAMID,h,VARIANT_REVERSIBLE,FALSE);
+    int p=cost_FamilyPebbling(FAMILY_PYRAMID,h,VARIANT_REVERSIBLE,TRUE);
+    int ps=persistentformula(h);
+    int cs=estimates[h];
+    Boolean wrong = (p!=ps) || (cs<ps ? c!=cs : c>ps);
+    if (wrong) errors++;
+    if (print)
+      printf(" %5d | %6d | %6d | %5d | %20d | %5d | %21d%s\n",h,
+             cost_FamilyPebbling(FAMILY_PATH,h,VARIANT_REVERSIBLE,FALSE),
+             cost_FamilyPebbling(FAMILY_PATH,h,VARIANT_REVERSIBLE,TRUE),
+             c,cs,p,ps,wrong ? "  FAILED" : "");
+    else if (wrong)
+      printf("c reversible pyramid %d: costs %d and %d, scripts %d and %d, FAILED\n",h,c,p,cs,ps);
+  }
+  free(estimates);
+  return errors;
+}
+
+
+int main(int argc, char *argv[])
+{
+  int option_code=0;
+  int pyramids=4;
+  int trees=3;
+  int paths=12;
+  int large=200;
+  int long_path=100000;
+  int table=0;
+  int errors=0;
+
+  while((option_code = getopt(argc,argv,"hp:t:c:P:L:T:"))!=-1) {
+    switch (option_code) {
+    case 'h':
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0]);
+      exit(EXIT_SUCCESS);
+      break;
+    case 'p':
+      pyramids=atoi(optarg);
+      break;
+    case 't':
+      trees=atoi(optarg);
+      break;
+    case 'c':
+      paths=atoi(optarg);
+      break;
+    case 'P':
+      large=atoi(optarg);
+      if (large>0 && large<=60000) break;
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    case 'L':
+      long_path=atoi(optarg);
+      if (long_path>0) break;
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    case 'T':
+      table=atoi(optarg);
+      if (table>0) break;
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    default:
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    }
+  }
+
+  if (table>0) {
+    errors=scripts(table,TRUE);
+    printf("c %s\n",errors ? "FAILED" : "all checks passed");
+    exit(errors ? EXIT_FAILURE : EXIT_SUCCESS);
+  }
+
+  DAG *g=path(1);
+  PebbleSearch *s=new_PebbleSearch(g);
+  setoption_PebbleSearch(s,OPTION_DICT_SIZE,0xFFFF);
+  setreport_PebbleSearch(s,NULL,NULL,0);
+
+  for(int n=1;n<=paths;n++) {
+    errors+=check(s,FAMILY_PATH,n,VARIANT_BLACK,FALSE);
+    errors+=check(s,FAMILY_PATH,n,VARIANT_REVERSIBLE,FALSE);
+    errors+=check(s,FAMILY_PATH,n,VARIANT_REVERSIBLE,TRUE);
+  }
+  for(int h=1;h<=trees;h++)
+    errors+=check(s,FAMILY_TREE,h,VARIANT_BLACK,FALSE);
+  for(int h=1;h<=pyramids;h++) {
+    errors+=check(s,FAMILY_PYRAMID,h,VARIANT_BLACK,FALSE);
+    errors+=check(s,FAMILY_PYRAMID,h,VARIANT_REVERSIBLE,FALSE);
+    errors+=check(s,FAMILY_PYRAMID,h,VARIANT_REVERSIBLE,TRUE);
+  }
+  dispose_PebbleSearch(s);
+  dispose_DAG(g);
+  errors+=scripts(SCRIPTS_HEIGHT,FALSE);
+
+  /* The reversible pebblings of pyramids get long quickly */
+  int reversible = large/10<1 ? 1 : large/10>16 ? 16 : large/10;
+  timing(FAMILY_PATH,long_path,VARIANT_BLACK,FALSE);
+  timing(FAMILY_PATH,long_path,VARIANT_REVERSIBLE,FALSE);
+  timing(FAMILY_PATH,long_path,VARIANT_REVERSIBLE,TRUE);
+  timing(FAMILY_TREE,large<20 ? large : 20,VARIANT_BLACK,FALSE);
+  timing(FAMILY_PYRAMID,large,VARIANT_BLACK,FALSE);
+  timing(FAMILY_PYRAMID,reversible,VARIANT_REVERSIBLE,FALSE);
+  timing(FAMILY_PYRAMID,reversible,VARIANT_REVERSIBLE,TRUE);
+
+  printf("c %s\n",errors ? "FAILED" : "all checks passed");
+  exit(errors ? EXIT_FAILURE : EXIT_SUCCESS);
+}
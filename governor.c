@@ -0,0 +1,54 @@
+/*
+   Description::
+
+   Limits to the resources used by a search.  The search checks them
+   every GOVERNOR_PERIOD configurations, and stops cleanly when one is
+   exceeded, instead of failing an allocation.
+
+   The resident memory is read from /proc/self/statm where available,
+   otherwise the peak given by getrusage is used.
+
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+/* Preamble */
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "common.h"
+#include "governor.h"
+
+/* Code */
+
+size_t resident_memory(void) {
+
+  unsigned long pages,resident;
+  FILE *f=fopen("/proc/self/statm","r");
+
+  if (f) {
+    int n=fscanf(f,"%lu %lu",&pages,&resident);
+    fclose(f);
+    if (n==2) return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+  }
+
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF,&usage)==0)
+    return (size_t)usage.ru_maxrss * 1024;   /* Kilobytes on Linux and BSD */
+
+  return 0;
+}
+
+const char *exceeded_ResourceLimits(const ResourceLimits *l,Counter configurations) {
+
+  if (l->max_configurations && configurations > l->max_configurations)
+    return "configurations";
+  if (l->deadline && time(NULL) >= l->deadline)
+    return "time";
+  if (l->max_memory && resident_memory() > l->max_memory)
+    return "memory";
+  return NULL;
+}
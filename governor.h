@@ -0,0 +1,45 @@
+/*
+   Description::
+
+   Limits to the resources used by a search. Header for governor.c
+
+*/
+
+
+/* Preamble */
+#ifndef  GOVERNOR_H
+#define  GOVERNOR_H
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "common.h"
+
+
+/* Code */
+
+/* Configurations processed between two checks of the limits */
+#define GOVERNOR_PERIOD 0x3FFF
+
+/* A zero field means no limit */
+typedef struct {
+
+  size_t  max_memory;           /* Bytes of resident memory */
+  Counter max_configurations;   /* Visited configurations */
+  time_t  deadline;             /* Wall clock time */
+
+} ResourceLimits;
+
+static inline void init_ResourceLimits(ResourceLimits *l) {
+  l->max_memory         = 0;
+  l->max_configurations = 0;
+  l->deadline           = 0;
+}
+
+/* Resident memory of the process in bytes, 0 if unknown */
+extern size_t resident_memory(void);
+
+/* Name of a limit which has been exceeded, or NULL */
+extern const char *exceeded_ResourceLimits(const ResourceLimits *l,Counter configurations);
+
+#endif /* GOVERNOR_H */
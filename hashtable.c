@@ -19,8 +19,6 @@
 #include "dsbasic.h"
 #include "hashtable.h"
 
-extern long int random(void);
-
 Boolean isconsistentDict(Dict *d) {
   assert(d);
   assert(d->size <= d->allocation);
@@ -74,28 +72,76 @@ void disposeDict(Dict *d) {
   /* Remove data structure from memory */
   for(size_t i=0;i<d->size;i++) disposeSL(d->buckets[i]);
   free(d->buckets);
+  free(d->used);
   free(d);
 }
 
+/*
+   Remove all elements from the dictionary, disposing them, but keep
+   the buckets allocated for reuse.
+ */
+void clearDict(Dict *d) {
+
+  LinkedList *ll;
+
+  assert(d);
+
+  for(size_t i=0;i<d->used_count;i++) {
+    ll=d->buckets[d->used[i]];
+    resetSL(ll);
+    while(iscursorvalidSL(ll)) {
+      if (d->dispose_function!=NULL) d->dispose_function(getSL(ll));
+      delete_and_nextSL(ll);
+    }
+    assert(isemptySL(ll));
+  }
+  d->used_count=0;
+}
+
 
+/* The size is drawn by a generator private to the dictionary, seeded
+   by its allocation, so that the library does not touch the state of
+   random() of the caller, and the same allocation gives the same
+   layout in every run. */
 Dict *newDict(size_t allocation) {
 
+  BitTuple state=(BitTuple)allocation;
+  BitTuple z=(state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z =  z ^ (z >> 31);
+
+  size_t slack=allocation >> 4;
+  size_t r = slack ? (size_t)(z % slack) : 0;
+  return newDictWithSize(allocation,allocation - slack + r);
+}
+
+/* A dictionary with exactly `size' buckets, e.g. to rebuild a
+   dictionary with the same layout. */
+Dict *newDictWithSize(size_t allocation,size_t size) {
+
+  assert(size>0 && size<=allocation);
+
   Dict *d=(Dict *)malloc(sizeof(Dict));
   assert(d);
 
-  size_t r=random() % (allocation >> 4);
   d->allocation = allocation;
-  d->size = allocation - (allocation >> 4) + r;
+  d->size = size;
 
   d->key_function = NULL;
   d->eq_function  = NULL;
   d->dispose_function = NULL;
 
   d-> buckets = (LinkedList**)calloc(d->size,sizeof(LinkedList*));
+  assert(d->buckets);
   for(size_t i=0;i<d->size;i++) {
     d->buckets[i]=newSL();
   }
-  assert(d->buckets);
+
+  d->used_count      = 0;
+  d->used_allocation = 1024;
+  d->used = (size_t*)malloc(d->used_allocation*sizeof(size_t));
+  assert(d->used);
   return d;
 
 }
@@ -159,6 +205,14 @@ void unsafe_noquery_writeDict(Dict *d,DictQueryResult *const result,void *data)
 
   if (result->value==NULL) {
     /* The configuration does not occur in the dictionary */
+    if (ll->head==NULL) {
+      if (d->used_count==d->used_allocation) {
+        d->used_allocation *= 2;
+        d->used = (size_t*)realloc(d->used,d->used_allocation*sizeof(size_t));
+        assert(d->used);
+      }
+      d->used[d->used_count++] = result->bucket;
+    }
     appendSL(ll,data);
   } else {
     /* The configuration occur, so we update the old record if there's the need. */
@@ -29,6 +29,10 @@
 
    The dictionary also keeps a list of elements in the buckets. It is
    sorted with respect to the time of insertion in the dictionary.
+
+   The indices of the non empty buckets are recorded, so that the
+   dictionary can be emptied and reused in time proportional to its
+   content, rather than to its allocation.
  */
 typedef struct {
 
@@ -37,6 +41,10 @@ typedef struct {
 
   LinkedList **buckets;
 
+  size_t *used;                 /* Non empty buckets */
+  size_t  used_count;
+  size_t  used_allocation;
+
   size_t   (*key_function)(void *data);
   Boolean  ( *eq_function)(void *A,void *B);
   void     (*dispose_function)(void *data);
@@ -59,7 +67,9 @@ typedef struct {
 } DictQueryResult;
 
 extern Dict *newDict(size_t allocation);
+extern Dict *newDictWithSize(size_t allocation,size_t size);
 extern void disposeDict(Dict *d);
+extern void clearDict(Dict *d);
 
 extern Boolean isconsistentDict(Dict *d);
 
@@ -0,0 +1,117 @@
+/*
+  Converts a graph in KTH format to a binary image (see fread_DAG in
+  dag.c), which the pebbling tools load by mapping the file in
+  memory, without parsing.  With -r it writes KTH format instead, for
+  instance from an image.  With -G the graph is generated, rather
+  than read.
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "common.h"
+#include "dag.h"
+#include "kthparser.h"
+
+
+#define USAGEMESSAGE "\n\
+Usage: %s [-hr] [-j<int>] [<input> [<output>]]\n\
+       %s [-hr] -G <family> [<output>]\n\
+\n\
+       -h     help message;\n\
+       -r     write KTH format instead of a binary image;\n\
+       -j T   threads which parse the input file (default: number of cores);\n\
+       -G <family>  generate a graph of the family, instead of reading it.\n\
+\n\
+The input and the output default to the standard input and output,\n\
+also written '-'.  The image is in the layout of the machine which\n\
+writes it.\n%s"
+
+
+int main(int argc, char *argv[])
+{
+  int option_code=0;
+  long threads=0;
+  Boolean reverse=FALSE;
+  char *family=NULL;
+  FILE *input=stdin;
+  FILE *output=stdout;
+
+  while((option_code = getopt(argc,argv,"hrj:G:"))!=-1) {
+    switch (option_code) {
+    case 'h':
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0],DAG_FAMILIES_MESSAGE);
+      exit(EXIT_SUCCESS);
+      break;
+    case 'r':
+      reverse=TRUE;
+      break;
+    case 'j':
+      threads=atol(optarg);
+      if (threads>0) break;
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0],DAG_FAMILIES_MESSAGE);
+      exit(EXIT_FAILURE);
+      break;
+    case 'G':
+      family=optarg;
+      break;
+    case '?':
+    default:
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0],DAG_FAMILIES_MESSAGE);
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (argc-optind > (family ? 1 : 2)) {
+    fprintf(stderr,USAGEMESSAGE,argv[0],argv[0],DAG_FAMILIES_MESSAGE);
+    exit(EXIT_FAILURE);
+  }
+  if (threads==0) threads=sysconf(_SC_NPROCESSORS_ONLN);
+
+  if (family==NULL && optind<argc && strcmp(argv[optind],"-")!=0 &&
+      (input=fopen(argv[optind],"r"))==NULL) {
+    fprintf(stderr, "c ERROR: unable to open input file \"%s\"\n",argv[optind]);
+    exit(EXIT_FAILURE);
+  }
+  if (family==NULL && optind<argc) optind++;
+  if (optind<argc && strcmp(argv[optind],"-")!=0 &&
+      (output=fopen(argv[optind],"w"))==NULL) {
+    fprintf(stderr, "c ERROR: unable to open output file \"%s\"\n",argv[optind]);
+    exit(EXIT_FAILURE);
+  }
+
+  DAG *g;
+  if (family) {
+    g = generate_DAG(family);
+    if (g==NULL) {
+      fprintf(stderr, "c ERROR: unknown graph family \"%s\"\n",family);
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0],DAG_FAMILIES_MESSAGE);
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    g = kthparser_parallel(input,(unsigned int)threads);
+    if (g==NULL) exit(EXIT_FAILURE);
+  }
+
+  Boolean ok;
+  if (reverse) {
+    fprintf(output,"%lu\n",(unsigned long)g->size);
+    fprint_DAG(output,g,NULL);
+    ok = !ferror(output);
+  } else {
+    ok = fwrite_DAG(output,g);
+  }
+  ok = (fclose(output)==0) && ok;
+  if (input!=stdin) fclose(input);
+  dispose_DAG(g);
+
+  if (!ok) {
+    fprintf(stderr, "c ERROR: unable to write the output\n");
+    exit(EXIT_FAILURE);
+  }
+  exit(EXIT_SUCCESS);
+}
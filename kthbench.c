@@ -0,0 +1,299 @@
+/*
+  Correctness check and benchmark for the KTH parser in kthparser.c.
+
+  A random graph is written in a temporary file, once for each way of
+  spacing the colon after the vertices, and it is read back from the
+  mapped file, from a pipe, and by the parallel parser.  Each graph
+  read must be the one which was written.  Two graphs in the same
+  file must be read one after the other as a stream, and rejected as
+  a single graph.  The parallel parser must also reject a malformed
+  graph.  Finally the graph is written as a binary image, and loaded
+  back.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "common.h"
+#include "dag.h"
+#include "kthparser.h"
+
+
+#define USAGEMESSAGE "\n\
+Usage: %s [-h] [-n <vertices>] [-d <degree>] [-r <seed>] [-t <threads>]\n\
+\n\
+       -h     help message;\n\
+       -t T   threads of the parallel parser (default: number of cores);\n\
+       -n N   number of vertices (default: 1000000);\n\
+       -d D   predecessors per vertex, at most (default: 4);\n\
+       -r S   seed of the random graph (default: 1).\n"
+
+
+/* The four ways to write the colon */
+static const char *colons[]={ " : ", ": ", " :", ":" };
+
+
+/* A random graph, as lists of predecessors from 1, in ascending
+   order.  The predecessors of vertex v are in edges[offset[v-1]] up
+   to edges[offset[v]]. */
+typedef struct {
+
+  size_t  vertices;
+  size_t *offset;
+  size_t *edges;
+
+} Graph;
+
+static int compare_size(const void *A,const void *B) {
+  size_t a=*(const size_t*)A,b=*(const size_t*)B;
+  return a<b ? -1 : (a>b);
+}
+
+static void make_graph(Graph *g,size_t vertices,size_t degree,unsigned int seed) {
+
+  g->vertices=vertices;
+  g->offset=(size_t*)malloc((vertices+1)*sizeof(size_t));
+  g->edges=(size_t*)malloc((vertices*degree+1)*sizeof(size_t));
+  srand(seed);
+
+  g->offset[0]=0;
+  for(size_t v=1;v<=vertices;v++) {
+    size_t *p=g->edges+g->offset[v-1];
+    size_t  k=0;
+    if (v-1<=degree) {                   /* All the previous vertices */
+      for(size_t u=1;u<v;u++) p[k++]=u;
+    } else {                             /* Sample, without repetitions */
+      for(size_t i=0;i<degree;i++) p[i]=1+(size_t)rand()%(v-1);
+      qsort(p,degree,sizeof(size_t),compare_size);
+      for(size_t i=0;i<degree;i++) if (k==0 || p[k-1]!=p[i]) p[k++]=p[i];
+    }
+    g->offset[v]=g->offset[v-1]+k;
+  }
+}
+
+static void write_graph(const Graph *g,const char *colon,FILE *out) {
+
+  fprintf(out,"c random graph for the parser benchmark\n%lu\n",(unsigned long)g->vertices);
+  for(size_t v=1;v<=g->vertices;v++) {
+    fprintf(out,"%lu%s",(unsigned long)v,colon);
+    for(size_t i=g->offset[v-1];i<g->offset[v];i++)
+      fprintf(out,i==g->offset[v-1] ? "%lu" : " %lu",(unsigned long)g->edges[i]);
+    fputc('\n',out);
+  }
+}
+
+/* Number of differences between the graph and the DAG read */
+static int check_graph(const Graph *g,const DAG *d) {
+
+  int errors=0;
+
+  if (d==NULL) return 1;
+  if (d->size!=g->vertices) return 1;
+  for(Vertex v=0;v<d->size;v++) {
+    size_t k=g->offset[v+1]-g->offset[v];
+    if (d->indegree[v]!=k) { errors++; continue; }
+    for(size_t i=0;i<k;i++)
+      if (d->in[v][i]+1!=g->edges[g->offset[v]+i]) errors++;
+  }
+  if (!isconsistent_DAG(d)) errors++;
+  return errors;
+}
+
+/* A temporary file, open for writing */
+static FILE *tempfile(char *path) {
+  int  fd=mkstemp(path);
+  FILE *f = fd<0 ? NULL : fdopen(fd,"w");
+  if (f==NULL) {
+    fprintf(stderr,"Unable to create a temporary file.\n");
+    exit(EXIT_FAILURE);
+  }
+  return f;
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+
+int main(int argc, char *argv[])
+{
+  int option_code=0;
+  size_t vertices=1000000;
+  size_t degree=4;
+  unsigned int seed=1;
+  unsigned int threads=(unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+  int errors=0;
+
+  while((option_code = getopt(argc,argv,"hn:d:r:t:"))!=-1) {
+    switch (option_code) {
+    case 'h':
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_SUCCESS);
+      break;
+    case 'n':
+      vertices=(size_t)atol(optarg);
+      if (vertices>0) break;
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    case 'd':
+      degree=(size_t)atol(optarg);
+      if (degree>0) break;
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    case 'r':
+      seed=(unsigned int)atol(optarg);
+      break;
+    case 't':
+      threads=(unsigned int)atol(optarg);
+      if (threads>0) break;
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    default:
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    }
+  }
+
+  Graph g;
+  make_graph(&g,vertices,degree,seed);
+  printf("c Graph on %lu vertices and %lu edges\n",
+         (unsigned long)g.vertices,(unsigned long)g.offset[g.vertices]);
+
+  for(size_t i=0;i<sizeof(colons)/sizeof(colons[0]);i++) {
+
+    char path[]="/tmp/kthbenchXXXXXX";
+    char command[64];
+    FILE *f=tempfile(path);
+    write_graph(&g,colons[i],f);
+    long size=ftell(f);
+    fclose(f);
+
+    double start=now();
+    DAG *d=kthparser_file(path);
+    double mapped=now()-start;
+    int e=check_graph(&g,d);
+    if (d) dispose_DAG(d);
+
+    snprintf(command,sizeof(command),"cat %s",path);
+    FILE *pipe=popen(command,"r");
+    start=now();
+    d = pipe ? kthparser(pipe) : NULL;
+    double piped=now()-start;
+    if (pipe) pclose(pipe);
+    e += check_graph(&g,d);
+    if (d) dispose_DAG(d);
+
+    f=fopen(path,"r");
+    start=now();
+    d=kthparser_parallel(f,threads);
+    double parallel=now()-start;
+    fclose(f);
+    e += check_graph(&g,d);
+    if (d) dispose_DAG(d);
+
+    unlink(path);
+    printf("c colon \"%s\"%*s %6.1f MB: mapped %7.3fs, pipe %7.3fs, %u threads %7.3fs (%7.1f MB/s), %s\n",
+           colons[i],(int)(3-strlen(colons[i])),"",size/1e6,
+           mapped,piped,threads,parallel,size/1e6/parallel,
+           e ? "FAILED" : "ok");
+    errors+=e;
+  }
+
+  /* Two graphs in the same file, read one after the other */
+  {
+    char path[]="/tmp/kthbenchXXXXXX";
+    FILE *f=tempfile(path);
+    int e=0;
+    write_graph(&g,colons[0],f);
+    write_graph(&g,colons[3],f);
+    fclose(f);
+    f=fopen(path,"r");
+    for(int k=0;k<2;k++) {
+      DAG *d=kthparser_next(f);
+      e += check_graph(&g,d);
+      if (d) dispose_DAG(d);
+    }
+    if (fgetc(f)!=EOF) e++;
+    fclose(f);
+    printf("c two graphs in the same file, expected parser error:\n");
+    fflush(stdout);
+    f=fopen(path,"r");
+    DAG *d=kthparser_parallel(f,threads);
+    fclose(f);
+    if (d) { dispose_DAG(d); e++; }
+    unlink(path);
+    printf("c two graphs in the same file: %s\n", e ? "FAILED" : "ok");
+    errors+=e;
+  }
+
+  /* A graph with a predecessor out of order near the end */
+  if (g.vertices>2 && g.offset[g.vertices]-g.offset[g.vertices-1]>1) {
+    char path[]="/tmp/kthbenchXXXXXX";
+    FILE *f=tempfile(path);
+    size_t *p=g.edges+g.offset[g.vertices-1];
+    size_t swap=p[0]; p[0]=p[1]; p[1]=swap;
+    write_graph(&g,colons[0],f);
+    p[1]=p[0]; p[0]=swap;
+    fclose(f);
+    printf("c malformed graph, expected parser error:\n");
+    fflush(stdout);
+    f=fopen(path,"r");
+    DAG *d=kthparser_parallel(f,threads);
+    fclose(f);
+    unlink(path);
+    printf("c malformed graph: %s\n", d ? "FAILED" : "ok");
+    if (d) { dispose_DAG(d); errors++; }
+  }
+
+  /* The binary image, loaded by mapping the file */
+  {
+    char path[]="/tmp/kthbenchXXXXXX";
+    char command[64];
+    FILE *f=tempfile(path);
+    int e=0;
+    write_graph(&g,colons[0],f);
+    fclose(f);
+    DAG *d=kthparser_file(path);
+    f=fopen(path,"w");
+    if (d==NULL || !fwrite_DAG(f,d)) e++;
+    long size=ftell(f);
+    fclose(f);
+    if (d) dispose_DAG(d);
+
+    double start=now();
+    d=kthparser_file(path);
+    double mapped=now()-start;
+    e += check_graph(&g,d);
+    if (d) dispose_DAG(d);
+
+    snprintf(command,sizeof(command),"cat %s",path);
+    FILE *pipe=popen(command,"r");
+    start=now();
+    d = pipe ? kthparser(pipe) : NULL;
+    double piped=now()-start;
+    if (pipe) pclose(pipe);
+    e += check_graph(&g,d);
+    if (d) dispose_DAG(d);
+
+    unlink(path);
+    printf("c binary image %6.1f MB: mapped %7.3fs, pipe %7.3fs, %s\n",
+           size/1e6,mapped,piped,e ? "FAILED" : "ok");
+    errors+=e;
+  }
+
+  free(g.offset);
+  free(g.edges);
+  exit(errors ? EXIT_FAILURE : EXIT_SUCCESS);
+}
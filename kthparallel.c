@@ -0,0 +1,246 @@
+/*
+   Description::
+
+   Parallel parser for very large graphs in KTH format.  The text
+   after the number of vertices is split at lines which start a
+   vertex ("N :"), and the pieces are scanned concurrently, each one
+   into its own arrays of edges and of degrees.  The pieces are
+   then checked to follow each other, and the edges are copied in
+   the graph at the offsets given by the prefix sums of the degrees.
+
+   When the text is malformed, or the pieces do not fit together, the
+   text is parsed again by the sequential parser, so that the result
+   and the error messages are exactly the sequential ones.
+
+*/
+
+/* Preamble */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "common.h"
+#include "dag.h"
+#include "kthparser.h"
+
+#define KTH_CHUNK_MIN     0x100000   /* Smallest piece of text for a thread */
+#define KTH_CHUNK_DEGREES 0x400
+
+
+/* Code */
+
+/* A piece of the text, and the scanner which reads it */
+typedef struct {
+
+  const char *begin;
+  const char *end;
+  const char *stop;             /* Where the scanner stopped, NULL on error */
+  Vertex      first;            /* Vertex on the first line, from 1 */
+  KTHScanner  s;
+
+} Chunk;
+
+static inline Boolean isblank_kth(char c) {
+  return c==' ' || c=='\t' || c=='\r' || c=='\f' || c=='\v';
+}
+
+/* The first line from `p' (at the start of a line) which specifies a
+   vertex, or `end'.  The vertex is written in `*v'. */
+static const char *vertexline(const char *p,const char *end,Vertex *v) {
+
+  while(p<end) {
+    const char *q=p;
+    const char *digits;
+    size_t n=0;
+
+    while(q<end && isblank_kth(*q)) q++;
+    for(digits=q; q<end && *q>='0' && *q<='9' && q-digits<18; q++) n = 10*n + (size_t)(*q-'0');
+    if (q>digits && (q==end || *q<'0' || *q>'9')) {
+      while(q<end && isblank_kth(*q)) q++;
+      if (q<end && *q==':') {
+        *v=n;
+        return p;
+      }
+    }
+    q=memchr(p,'\n',end-p);
+    p = q ? q+1 : end;
+  }
+  return end;
+}
+
+static void *scanchunk(void *arg) {
+  Chunk *c=(Chunk*)arg;
+  c->stop = c->s.failed ? NULL : scan_KTHScanner(&c->s,c->begin,c->end);
+  return NULL;
+}
+
+static void disposechunk(Chunk *c) {
+  if (c->s.edges) free(c->s.edges);
+  if (c->s.indegree_allocation>0) free(c->s.indegree);
+}
+
+
+/* Parse a graph in kth format from memory, with several threads
+
+   input: the text, its length, and the number of threads
+
+   output: a DAG object, or NULL if the input is malformed.  The
+   number of characters read is written in `*consumed', if not NULL.
+ */
+DAG *kthparser_buffer_parallel(const char *text,size_t length,size_t *consumed,
+                               unsigned int threads) {
+
+  const char *end=text+length;
+  const char *p=text;
+  KTHScanner  h;
+
+  if (length/KTH_CHUNK_MIN < threads) threads=(unsigned int)(length/KTH_CHUNK_MIN);
+  if (threads<2) return kthparser_buffer(text,length,consumed);
+
+  /* The header, up to the number of vertices */
+  init_KTHScanner(&h);
+  h.quiet=TRUE;
+  while(p<end && h.vertices==0 && !h.failed) {
+    const char *eol=memchr(p,'\n',end-p);
+    const char *next= eol ? eol+1 : end;
+    if (scan_KTHScanner(&h,p,next)==NULL) h.failed=TRUE;
+    p=next;
+  }
+  if (h.failed || h.vertices==0 || h.position>0) {
+    finish_KTHScanner(&h);
+    return kthparser_buffer(text,length,consumed);
+  }
+
+  /* The pieces, which start at a vertex line */
+  Chunk *chunks=(Chunk*)calloc(threads,sizeof(Chunk));
+  pthread_t *tid=(pthread_t*)malloc(threads*sizeof(pthread_t));
+  assert(chunks && tid);
+
+  chunks[0].begin=p;
+  for(unsigned int t=1;t<threads;t++) {
+    const char *q=p+(size_t)(end-p)/threads*t;
+    const char *eol;
+    if (q<=chunks[t-1].begin) q=chunks[t-1].begin+1;
+    eol = q<end ? memchr(q,'\n',end-q) : NULL;
+    chunks[t].begin = eol ? vertexline(eol+1,end,&chunks[t].first) : end;
+    chunks[t-1].end = chunks[t].begin;
+  }
+  chunks[threads-1].end=end;
+
+  for(unsigned int t=0;t<threads;t++) {
+    Chunk *c=chunks+t;
+    init_KTHScanner(&c->s);
+    c->s.quiet    = TRUE;
+    c->s.vertices = h.vertices;
+    if (t>0) {
+      c->s.failed   = (c->first==0 || c->first>h.vertices);
+      c->s.position = c->s.failed ? 0 : c->first-1;
+      c->s.base     = c->s.position;
+      c->s.colon    = TRUE;
+    }
+    c->s.indegree_allocation = KTH_CHUNK_DEGREES;
+    c->s.indegree = (size_t*)calloc(KTH_CHUNK_DEGREES,sizeof(size_t));
+    c->s.edge_allocation = (size_t)(c->end-c->begin)/8+16;
+    c->s.edges = (Vertex*)malloc(c->s.edge_allocation*sizeof(Vertex));
+    assert(c->s.indegree && c->s.edges);
+  }
+
+  for(unsigned int t=1;t<threads;t++) pthread_create(tid+t,NULL,scanchunk,chunks+t);
+  scanchunk(chunks);
+  for(unsigned int t=1;t<threads;t++) pthread_join(tid[t],NULL);
+
+  /* Each piece must continue the previous one, up to the piece with
+     the last vertex, and no vertex may follow it */
+  Vertex      position=0;
+  Boolean     colon=FALSE;
+  const char *stop=NULL;
+  unsigned int last=0;
+
+  for(unsigned int t=0;t<threads;t++) {
+    Chunk *c=chunks+t;
+    if (c->begin==c->end) continue;
+    if (c->stop==NULL) break;
+    if (t>0 && !(position+1==c->first && (colon || position==0))) break;
+    position=c->s.position;
+    colon=c->s.colon;
+    if (islast_KTHScanner(&c->s)) {
+      stop=c->stop;
+      last=t;
+      break;
+    }
+  }
+  for(unsigned int t=last+1;stop && t<threads;t++)
+    if (chunks[t].begin!=chunks[t].end) stop=NULL;
+
+  DAG *dag=NULL;
+  if (stop) {
+    dag=h.dag;
+    h.dag=NULL;
+    for(unsigned int t=0;t<=last;t++) {
+      Chunk *c=chunks+t;
+      if (c->begin==c->end) continue;
+      memcpy(dag->indegree+c->s.base,c->s.indegree,(c->s.position-c->s.base)*sizeof(size_t));
+    }
+    edges_DAG(dag);
+    for(unsigned int t=0;t<=last;t++) {
+      Chunk *c=chunks+t;
+      if (c->begin==c->end) continue;
+      assert(dag->in_offset[c->s.position]-dag->in_offset[c->s.base]==c->s.edge_count);
+      memcpy(dag->in_edges+dag->in_offset[c->s.base],c->s.edges,c->s.edge_count*sizeof(Vertex));
+    }
+    dag_precompute_data(dag);
+    assert(isconsistent_DAG(dag));
+    if (consumed) *consumed=(size_t)(stop-text);
+  }
+
+  for(unsigned int t=0;t<threads;t++) disposechunk(chunks+t);
+  free(chunks);
+  free(tid);
+  finish_KTHScanner(&h);
+  if (dag==NULL) return kthparser_buffer(text,length,consumed);
+  return dag;
+}
+
+
+/* Parse a graph in kth format, with several threads
+
+   input: file stream, and the number of threads
+
+   output: a DAG object, or NULL if the input is malformed
+
+   As for the sequential parser, after the last vertex there may be
+   only blanks and comments.  Streams which are not regular files,
+   and binary images, are read by the sequential parser.
+ */
+DAG *kthparser_parallel(FILE *input,unsigned int threads) {
+
+  struct stat info;
+  off_t offset;
+  int   fd;
+
+  if (threads<2 || isimage_DAG(input)) return kthparser(input);
+
+  offset=ftello(input);
+  fd=fileno(input);
+  if (offset<0 || fd<0 || fstat(fd,&info)!=0 || !S_ISREG(info.st_mode) ||
+      info.st_size<=offset) return kthparser(input);
+
+  void *map=mmap(NULL,(size_t)info.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  if (map==MAP_FAILED) return kthparser(input);
+
+  size_t consumed=0;
+  DAG *dag=kthparser_buffer_parallel((const char*)map+offset,(size_t)(info.st_size-offset),
+                                     &consumed,threads);
+  munmap(map,(size_t)info.st_size);
+
+  fseeko(input,offset+(off_t)consumed,SEEK_SET);
+  return dag;
+}
@@ -6,203 +6,315 @@
 
    Description::
 
-   Implementation of Direct acyclic graph functionality.
+   Parser for graphs in KTH format.  The text is read by a hand
+   written scanner, directly from memory: regular files are mapped,
+   and other streams are read a line at a time.  The predecessors are
+   written in the array of the incoming edges of the graph as soon as
+   they are read, so the graph is built in a single pass.
 
+   The colon after a vertex does not need to be separated by spaces:
+   "2 : 1", "2: 1", "2 :1" and "2:1" are the same.
 
 */
 
 /* Preamble */
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include "common.h"
-#include "dsbasic.h"
 #include "dag.h"
+#include "kthparser.h"
 
-extern void dag_precompute_data(DAG *digraph);
-typedef struct _vl { struct _vl* next; Vertex v; } vl;
+#define PARSERERROR(fmt,...) fprintf(stderr, "c PARSER ERROR:" fmt "\n", __VA_ARGS__)
+#define SCANERROR(s,fmt,...) do { if (!(s)->quiet) PARSERERROR(fmt,__VA_ARGS__); } while(0)
 
-#ifndef NDEBUG
-#define PARSERDEBUG(fmt,...) fprintf(stderr, "c PARSER DEBUG:" fmt "\n", __VA_ARGS__) 
-#else
-#define PARSERDEBUG(fmt,...) 
-#endif
+#define KTH_LINE_SIZE 0x10000
 
-#define PARSERERROR(fmt,...) fprintf(stderr, "c PARSER ERROR:" fmt "\n", __VA_ARGS__) 
 
+void init_KTHScanner(KTHScanner *s) {
+  memset(s,0,sizeof(KTHScanner));
+}
 
-/* Parse a graph in kth format
-   
-   input: file stream
-   
-   output: a DAG object
- */
-DAG *kthparser(FILE *input) {
+static inline Boolean isblank_kth(char c) {
+  return c==' ' || c=='\t' || c=='\r' || c=='\f' || c=='\v';
+}
 
-  DAG *dag=NULL;
-  
-  char buffer[101];
-  int  temp=0;
-
-  size_t vertices=0;
-  Vertex read = 0;
-  Vertex position = 0;
-  Vertex last_predecessor = 0;
-
-  size_t *indegree=NULL;
-  size_t *outdegree=NULL;
-  
-  vl **predecessors=NULL;
-  vl *insertpoint=NULL;
-  
-  while (feof(input)==0) {
-    
-    temp=fscanf(input,"%100s",(char*)&buffer);
-    if (temp==-1) break;
-    
-    if (buffer[0]=='c') { /* Comment line */
-      PARSERDEBUG("%s","comment line");
-      do { temp=getc(input); } while(temp!=-1 && temp!='\n');
-      continue;
+/* Process a number: the number of vertices, a vertex, or one of its
+   predecessors.  Return FALSE on malformed input. */
+static Boolean number(KTHScanner *s,size_t read) {
+
+  if (s->vertices==0) {                      /* This is the vertex number */
+    if (read==0) {
+      SCANERROR(s,"%s","positive number of vertices expected.");
+      return FALSE;
+    }
+    s->vertices = read;
+    s->dag      = new_DAG(read);
+    s->indegree = s->dag->indegree;
+    s->edge_allocation = 2*read;
+    s->edges    = (Vertex*)malloc(s->edge_allocation*sizeof(Vertex));
+    assert(s->edges);
+    return TRUE;
+  }
+
+  if (read>0 && read<s->position) {            /* A predecessor */
+    if (!s->colon) {
+      SCANERROR(s,"expecting \":\" before predecessors for vertex %lu.",s->position);
+      return FALSE;
+    }
+    if (s->last_predecessor >= read) {
+      SCANERROR(s,"Predecessors must be in ascending order. %lu predecessor of %lu",
+                  s->last_predecessor,read);
+      return FALSE;
     }
+    s->last_predecessor = read;
+    if (s->edge_count==s->edge_allocation) {
+      s->edge_allocation *= 2;
+      s->edges=(Vertex*)realloc(s->edges,s->edge_allocation*sizeof(Vertex));
+      assert(s->edges);
+    }
+    s->edges[s->edge_count++] = read-1;        /* Internally vertices are counted from 0 */
+    s->indegree[s->position-1-s->base]++;
+    return TRUE;
+  }
 
-    /* Read the vertex number */
-    temp=sscanf(buffer,"%lu",&read);
-    if (temp==-1 || read==0) break;
-
-    if (vertices==0) { /* This is the vertex number */
-      
-      vertices = read;
-      position = 0;
-      if (read>1) PARSERDEBUG("there are %lu vertices",read);
-      else if (read==1) PARSERDEBUG("there is %u vertex",1);
-
-      indegree = (size_t*)calloc(vertices,sizeof(size_t));
-      outdegree = (size_t*)calloc(vertices,sizeof(size_t));
-      predecessors = (vl**)malloc(vertices*sizeof(vl*));
-      for (Vertex v=0; v < vertices; v++) {
-        predecessors[v] = (vl*)malloc(sizeof(vl));
-        predecessors[v]->v = 0;
-        predecessors[v]->next = NULL;
+  if (read>0 && read==s->position) {
+    SCANERROR(s,"self loop on vertex %lu.",s->position);
+    return FALSE;
+  }
+  if (read==0 || read>s->vertices) {
+    SCANERROR(s,"out of range vertex %lu.",read);
+    return FALSE;
+  }
+  if (s->position>0 && !s->colon) {
+    SCANERROR(s,"expecting \":\" before predecessors for vertex %lu.",s->position);
+    return FALSE;
+  }
+  if (read==s->position+1) {                   /* A vertex specification */
+    s->position++;
+    s->last_predecessor = 0;
+    s->colon = FALSE;
+    if (s->indegree_allocation>0 && s->position-s->base > s->indegree_allocation) {
+      s->indegree=(size_t*)realloc(s->indegree,2*s->indegree_allocation*sizeof(size_t));
+      assert(s->indegree);
+      memset(s->indegree+s->indegree_allocation,0,s->indegree_allocation*sizeof(size_t));
+      s->indegree_allocation *= 2;
+    }
+    return TRUE;
+  }
+  SCANERROR(s,"Vertex %lu missing.",s->position+1);
+  return FALSE;
+}
+
+
+const char *scan_KTHScanner(KTHScanner *s,const char *p,const char *end) {
+
+  while(p<end) {
+
+    char c=*p;
+
+    if (c=='\n') {
+      p++;
+      if (s->multiple && islast_KTHScanner(s)) return p;
+    } else if (isblank_kth(c)) {
+      p++;
+    } else if (c=='c') {                       /* Comment, up to the end of line */
+      const char *eol=memchr(p,'\n',end-p);
+      p = eol ? eol : end;
+    } else if (c==':') {
+      if (s->position==0 || s->colon) {
+        SCANERROR(s,"unexpected \":\" after vertex %lu.",s->position);
+        return NULL;
       }
-    } else if ( read < position ) { /* Still reading vertex specification */
-      
-      if (last_predecessor >= read) {
-        PARSERERROR("Predecessors must be in ascending order. %lu predecessor of %lu",last_predecessor,read);
-        exit(EXIT_FAILURE);
+      s->colon=TRUE;
+      p++;
+    } else if (c>='0' && c<='9') {
+      size_t read=0;
+      while (p<end && *p>='0' && *p<='9') {
+        if (read > (SIZE_MAX-9)/10) {
+          SCANERROR(s,"%s","number too large.");
+          return NULL;
+        }
+        read = 10*read + (size_t)(*p-'0');
+        p++;
       }
-
-      PARSERDEBUG("Edge %lu -> %lu",read,position);
-      last_predecessor = read;
-      
-      indegree[position-1]++;
-      outdegree[read-1]++;
-
-      insertpoint->next=(vl*)malloc(sizeof(vl));
-      insertpoint = insertpoint->next;
-      assert(insertpoint);
-      insertpoint->v = read-1; /* Internally vertices are counted from 0 */
-      insertpoint->next = NULL;
-
-    } else if (read == position ){
-      PARSERERROR("self loop on vertex %lu.",position);
-      exit(EXIT_FAILURE);
- 
-    } else if (read > vertices ){
-      PARSERERROR("out of range vertex %lu.",read);
-      exit(EXIT_FAILURE);
-
-    } else if (read == position+1) { /* This is a vertex specification. Pass the : */
-    
-      PARSERDEBUG("Start reading predecessors of %lu.",read);
-      
-      last_predecessor = 0;
-      position = position +1;
-      insertpoint = predecessors[position-1];
-
-      temp=fscanf(input,"%100s",(char*)&buffer);
-      if (temp==-1 || strcmp(buffer,":")!=0) {
-        PARSERERROR("expecting \":\" before predecessors for vertex %lu.",position);
-        exit(EXIT_FAILURE);
+      if (p<end && *p!='\n' && *p!=':' && !isblank_kth(*p)) {
+        SCANERROR(s,"unexpected character '%c' after %lu.",*p,read);
+        return NULL;
       }
-
+      if (!number(s,read)) return NULL;
     } else {
-      PARSERERROR("Vertex %lu missing.",position+1);
-      exit(EXIT_FAILURE);
+      SCANERROR(s,"unexpected character '%c'.",c);
+      return NULL;
     }
   }
+  return end;
+}
+
 
-  if (vertices==0)
-    PARSERERROR("%s","positive number of vertices expected.");
- 
-  if (position != vertices) {
-    PARSERERROR("unexpected end of file at vertex %lu.",position); 
+DAG *finish_KTHScanner(KTHScanner *s) {
+
+  DAG *dag=NULL;
+
+  if (!s->failed && s->vertices==0) {
+    SCANERROR(s,"%s","positive number of vertices expected.");
+  } else if (!s->failed && !islast_KTHScanner(s)) {
+    SCANERROR(s,"unexpected end of file at vertex %lu.",s->position);
+  } else if (!s->failed) {
+    dag=s->dag;
+    s->dag=NULL;
+    adoptedges_DAG(dag,(Vertex*)realloc(s->edges,(s->edge_count+1)*sizeof(Vertex)));
+    s->edges=NULL;
+    dag_precompute_data(dag);
+    assert(isconsistent_DAG(dag));
   }
 
+  if (s->edges) free(s->edges);
+  if (s->dag)   dispose_DAG(s->dag);
+  if (s->indegree_allocation>0) free(s->indegree);
+  init_KTHScanner(s);
+  return dag;
+}
 
-  /* Build dag data structure */
-  dag=(DAG*)malloc(sizeof(DAG));
-  assert(dag);
-  assert(vertices>0);
 
-  /* Set to null sinks and source vector */
-  dag->pred_bitmasks=NULL;
-  dag->succ_bitmasks=NULL;
-  dag->sources=NULL;
-  dag->sinks=NULL;
+/* Parse one graph from the text, and possibly other graphs after it */
+static DAG *parsebuffer(const char *text,size_t length,size_t *consumed,Boolean multiple) {
 
-  /* Size of the vertex set */
-  dag->size=vertices;
+  KTHScanner s;
+  init_KTHScanner(&s);
+  s.multiple=multiple;
 
-  /* Allocation of degree information */
-  dag->in  = (Vertex**)malloc( dag->size*sizeof(Vertex*) );
-  dag->out = (Vertex**)malloc( dag->size*sizeof(Vertex*) );
+  const char *stop=scan_KTHScanner(&s,text,text+length);
+  if (stop==NULL) s.failed=TRUE;
+  if (consumed) *consumed = stop ? (size_t)(stop-text) : 0;
+  return finish_KTHScanner(&s);
+}
 
-  assert(dag->in );
-  assert(dag->out);
 
-  dag->indegree  = (size_t*)calloc( dag->size,sizeof(size_t) );
-  dag->outdegree = (size_t*)calloc( dag->size,sizeof(size_t) );
+/* Parse a graph in kth format from memory
 
-  assert(dag->indegree );
-  assert(dag->outdegree);
+   input: the text, and its length
 
-  /* Allocation of neighbour informations */
-  for(Vertex v=0;v<dag->size;v++) {
-    dag->in[v]  = (Vertex*)malloc( (indegree[v]) *sizeof(Vertex) );
-    dag->out[v] = (Vertex*)malloc( (outdegree[v])*sizeof(Vertex) );
-    assert(dag->in [v]);
-    assert(dag->out[v]);
-  }
+   output: a DAG object, or NULL if the input is malformed.  The
+   number of characters read is written in `*consumed', if not NULL.
+ */
+DAG *kthparser_buffer(const char *text,size_t length,size_t *consumed) {
+  return parsebuffer(text,length,consumed,FALSE);
+}
 
-  /* Load vertices */
-  Vertex u=0;
-  for (Vertex v=0;v<vertices;v++) {
-    insertpoint = predecessors[v];
-    while(insertpoint->next){
-      u=insertpoint->next->v;
-      insertpoint = insertpoint->next;
-      dag->in[v][ dag->indegree[v]++ ] = u;
-      dag->out[u][ dag->outdegree[u]++ ] = v;
-    }
-  }
 
-  /* Free temporary structures */
-  if (indegree)  free(indegree);
-  if (outdegree) free(outdegree);
-  for (Vertex v=0;v<vertices;v++) {
-    while(predecessors[v]){
-      insertpoint = predecessors[v];
-      predecessors[v] = predecessors[v]->next;
-      free(insertpoint);
+/* Parse a graph from a stream which cannot be mapped in memory, a
+   line at a time, so that nothing after the graph is read when
+   other graphs follow. */
+static DAG *parsestream(FILE *input,Boolean multiple) {
+
+  KTHScanner s;
+  size_t allocation=KTH_LINE_SIZE;
+  char  *line=(char*)malloc(allocation);
+  assert(line);
+  init_KTHScanner(&s);
+  s.multiple=multiple;
+
+  while (!s.failed && fgets(line,allocation,input)) {
+
+    size_t length=strlen(line);
+    while (length+1==allocation && line[length-1]!='\n') {   /* Long line */
+      allocation *= 2;
+      line=(char*)realloc(line,allocation);
+      assert(line);
+      if (fgets(line+length,allocation-length,input)==NULL) break;
+      length += strlen(line+length);
     }
+
+    const char *stop=scan_KTHScanner(&s,line,line+length);
+    if (stop==NULL) s.failed=TRUE;
+    else if (multiple && line[length-1]=='\n' && islast_KTHScanner(&s)) break;
   }
-  free(predecessors);
+  free(line);
+  return finish_KTHScanner(&s);
+}
+
+
+/* Parse one graph from the stream, and possibly other graphs after
+   it */
+static DAG *parse(FILE *input,Boolean multiple) {
+
+  struct stat info;
+  off_t offset;
+  int   fd;
 
-  dag_precompute_data(dag);
-  assert(isconsistent_DAG(dag));
+  if (isimage_DAG(input)) return fread_DAG(input);
+
+  offset=ftello(input);
+  fd=fileno(input);
+
+  if (offset<0 || fd<0 || fstat(fd,&info)!=0 || !S_ISREG(info.st_mode) ||
+      info.st_size<=offset) return parsestream(input,multiple);
+
+  void *map=mmap(NULL,(size_t)info.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  if (map==MAP_FAILED) return parsestream(input,multiple);
+
+  size_t consumed=0;
+  DAG *dag=parsebuffer((const char*)map+offset,(size_t)(info.st_size-offset),&consumed,multiple);
+  munmap(map,(size_t)info.st_size);
+
+  fseeko(input,offset+(off_t)consumed,SEEK_SET);
   return dag;
 }
 
+
+/* Parse a graph in kth format
+
+   input: file stream
+
+   output: a DAG object, or NULL if the input is malformed
+
+   After the last vertex there may be only blanks and comments.  A
+   regular file is mapped in memory.  A binary image of a graph (see
+   fread_DAG) is accepted as well.
+ */
+DAG *kthparser(FILE *input) {
+  return parse(input,FALSE);
+}
+
+
+/* Parse the next graph of a stream of several graphs
+
+   input: file stream
+
+   output: a DAG object, or NULL if the input is malformed
+
+   The parser stops at the end of the line of the last vertex, and
+   the stream is positioned there, so that the next graph can be read.
+ */
+DAG *kthparser_next(FILE *input) {
+  return parse(input,TRUE);
+}
+
+
+/* Parse the graph in kth format in the file at `path', or on the
+   standard input if `path' is "-".  NULL if the file cannot be read,
+   or if the graph is malformed. */
+DAG *kthparser_file(const char *path) {
+
+  if (strcmp(path,"-")==0) return kthparser(stdin);
+
+  FILE *f=fopen(path,"r");
+  if (f==NULL) {
+    PARSERERROR("unable to open \"%s\".",path);
+    return NULL;
+  }
+  DAG *dag=kthparser(f);
+  fclose(f);
+  return dag;
+}
@@ -0,0 +1,84 @@
+/*
+   Description::
+
+   Parsers for graphs in KTH format, sequential and parallel.  The
+   scanner is shared by the two.  Header for kthparser.c and
+   kthparallel.c
+
+*/
+
+
+/* Preamble */
+#ifndef  KTHPARSER_H
+#define  KTHPARSER_H
+
+#include <stdio.h>
+
+#include "common.h"
+#include "dag.h"
+
+
+/* Code */
+
+/* State of the scanner between two pieces of text.  The scanner
+   counts the predecessors of vertex v in indegree[v-1-base], which
+   is either the array of the graph (indegree_allocation is zero) or
+   a private array of the scanner, grown as needed. */
+typedef struct {
+
+  size_t  vertices;          /* Zero until the number is read */
+  Vertex  position;          /* Vertex being specified, from 1 */
+  Vertex  last_predecessor;
+  Boolean colon;             /* The colon after `position' is read */
+
+  DAG    *dag;
+  Vertex *edges;             /* The incoming edges read so far */
+  size_t  edge_count;
+  size_t  edge_allocation;
+
+  size_t *indegree;
+  Vertex  base;
+  size_t  indegree_allocation;
+
+  Boolean quiet;             /* No error messages */
+  Boolean failed;
+  Boolean multiple;          /* Stop after the last vertex, more graphs follow */
+
+} KTHScanner;
+
+/* The last vertex is complete, the rest of the line is its */
+static inline Boolean islast_KTHScanner(const KTHScanner *s) {
+  return s->vertices>0 && s->position==s->vertices && s->colon;
+}
+
+extern void init_KTHScanner(KTHScanner *s);
+
+/* Scan the text from `p' to `end'.  Return `end', or NULL if the
+   text is malformed.  A scanner of `multiple' graphs returns instead
+   the position after the end of line of the last vertex. */
+extern const char *scan_KTHScanner(KTHScanner *s,const char *p,const char *end);
+
+/* The graph, once the whole text has been scanned, or NULL if it is
+   incomplete or malformed.  The scanner is emptied in any case. */
+extern DAG *finish_KTHScanner(KTHScanner *s);
+
+
+/* Input graph in KTH format, or as a binary image (see fread_DAG),
+   NULL if malformed.  After the last vertex there may be only blanks
+   and comments. */
+extern DAG *kthparser(FILE *stream);
+extern DAG *kthparser_file(const char *path);
+extern DAG *kthparser_buffer(const char *text,size_t length,size_t *consumed);
+
+/* The next graph of a stream of several graphs, as the batch mode
+   reads them.  The stream is left after the end of line of the last
+   vertex. */
+extern DAG *kthparser_next(FILE *stream);
+
+/* The same, with the text split among several threads.  The result
+   and the error messages are the ones of the sequential parser. */
+extern DAG *kthparser_parallel(FILE *stream,unsigned int threads);
+extern DAG *kthparser_buffer_parallel(const char *text,size_t length,size_t *consumed,
+                                      unsigned int threads);
+
+#endif /* KTHPARSER_H */
@@ -0,0 +1,426 @@
+/*
+   Description::
+
+   Search context for using the pebbling search as a library.  The
+   context carries the options, the statistics and the result of the
+   search, so that the search procedures do not use global state.
+
+*/
+
+/* Preamble */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "common.h"
+#include "dag.h"
+#include "pebbling.h"
+#include "hashtable.h"
+#include "bfs.h"
+#include "config.h"
+#include "cache.h"
+#include "libpebble.h"
+
+
+/**
+ * Create a search context for a graph. The graph must outlive the
+ * context.
+ *
+ * @param graph the graph to be pebbled.
+ *
+ * @return a context for black pebbling, with the default options and
+ * no bound.
+ */
+PebbleSearch *new_PebbleSearch(const DAG *graph) {
+
+  assert(graph);
+  assert(isconsistent_DAG(graph));
+
+  PebbleSearch *s=(PebbleSearch*)malloc(sizeof(PebbleSearch));
+  assert(s);
+
+  s->graph      = graph;
+  s->variant    = &variant_ops_black;
+  s->bound      = 0;
+  s->persistent = FALSE;
+  s->engine     = SEARCH_EXPLICIT;
+  init_BFSOptions(&s->options);
+  s->options.stats = &s->stats;
+  s->dict       = NULL;
+  s->dict_size  = CONFIG_HASHSIZE;
+
+  s->cache          = NULL;
+  s->canonical      = NULL;
+  s->canonical_done = FALSE;
+
+  s->result     = SEARCH_NOT_RUN;
+  s->pebbling   = NULL;
+  memset(&s->stats,0,sizeof(Statistic));
+
+  s->frontier      = NULL;
+  s->frontier_size = 0;
+
+  return s;
+}
+
+/* The pebblings of the frontier are disposed by their variant */
+static void disposefrontier(PebbleSearch *s) {
+  for(size_t i=0;i<s->frontier_size;i++) s->variant->dispose(s->frontier[i]);
+  free(s->frontier);
+  s->frontier      = NULL;
+  s->frontier_size = 0;
+}
+
+void dispose_PebbleSearch(PebbleSearch *s) {
+
+  if (s==NULL) return;
+  if (s->pebbling) s->variant->dispose(s->pebbling);
+  disposefrontier(s);
+  if (s->dict) disposeDict(s->dict);
+  dispose_CanonicalDAG(s->canonical);
+  free(s);
+}
+
+void setgraph_PebbleSearch(PebbleSearch *s,const DAG *graph) {
+
+  assert(s);
+  assert(graph==NULL || isconsistent_DAG(graph));
+
+  if (s->pebbling) {
+    s->variant->dispose(s->pebbling);
+    s->pebbling=NULL;
+  }
+  disposefrontier(s);
+  dispose_CanonicalDAG(s->canonical);
+  s->canonical      = NULL;
+  s->canonical_done = FALSE;
+  s->graph  = graph;
+  s->result = SEARCH_NOT_RUN;
+}
+
+
+int setoption_PebbleSearch(PebbleSearch *s,SearchOption option,long value) {
+
+  assert(s);
+
+  switch(option) {
+
+  case OPTION_VARIANT:
+    if (value!=VARIANT_BLACK && value!=VARIANT_BLACK_WHITE && value!=VARIANT_REVERSIBLE) return -1;
+    if (s->pebbling) {
+      s->variant->dispose(s->pebbling);
+      s->pebbling=NULL;
+      s->result=SEARCH_NOT_RUN;
+    }
+    disposefrontier(s);
+    if (value==VARIANT_BLACK)            s->variant=&variant_ops_black;
+    else if (value==VARIANT_BLACK_WHITE) s->variant=&variant_ops_bw;
+    else                                 s->variant=&variant_ops_rev;
+    break;
+
+  case OPTION_BOUND:
+    if (value<0 || (unsigned long)value>UINT_MAX) return -1;
+    s->bound=(unsigned int)value;
+    break;
+
+  case OPTION_PERSISTENT:
+    s->persistent = value ? TRUE : FALSE;
+    break;
+
+  case OPTION_ENGINE:
+    if (value!=SEARCH_EXPLICIT && value!=SEARCH_SYMBOLIC && value!=SEARCH_BEAM) return -1;
+    s->engine=(SearchEngine)value;
+    break;
+
+  case OPTION_VISITED:
+    if (value!=VISITED_DICT && value!=VISITED_BITSTATE && value!=VISITED_ZDD) return -1;
+    s->options.visited=(VisitedSet)value;
+    break;
+
+  case OPTION_BITSTATE_MEMORY:
+    if (value<=0) return -1;
+    s->options.bitstate_memory=(size_t)value;
+    break;
+
+  case OPTION_BITSTATE_HASHES:
+    if (value<=0 || (unsigned long)value>UINT_MAX) return -1;
+    s->options.bitstate_hashes=(unsigned int)value;
+    break;
+
+  case OPTION_DICT_SIZE:
+    if (value<16) return -1;
+    if (s->dict && (size_t)value!=s->dict_size) {
+      disposeDict(s->dict);
+      s->dict=NULL;
+    }
+    s->dict_size=(size_t)value;
+    break;
+
+  case OPTION_MAX_MEMORY:
+    if (value<0) return -1;
+    s->options.limits.max_memory=(size_t)value;
+    break;
+
+  case OPTION_MAX_CONFIGURATIONS:
+    if (value<0) return -1;
+    s->options.limits.max_configurations=(Counter)value;
+    break;
+
+  case OPTION_TIME_LIMIT:
+    if (value<0) return -1;
+    s->options.limits.deadline = value ? time(NULL)+(time_t)value : 0;
+    break;
+
+  case OPTION_BEAM_WIDTH:
+    if (value<=0 || (unsigned long)value>UINT_MAX) return -1;
+    s->options.beam_width=(unsigned int)value;
+    break;
+
+  case OPTION_COUNT:
+    s->options.count = value ? TRUE : FALSE;
+    break;
+
+  default:
+    return -1;
+  }
+  return 0;
+}
+
+
+void setreport_PebbleSearch(PebbleSearch *s,
+                            FILE *stream,
+                            volatile sig_atomic_t *flag,
+                            unsigned int interval) {
+  assert(s);
+  s->options.report          = stream;
+  s->options.report_flag     = flag;
+  s->options.report_interval = interval;
+}
+
+
+void setcache_PebbleSearch(PebbleSearch *s,ResultCache *cache) {
+  assert(s);
+  s->cache=cache;
+}
+
+
+void setcheckpoint_PebbleSearch(PebbleSearch *s,
+                                const char *path,
+                                volatile sig_atomic_t *flag,
+                                const char *resume) {
+  assert(s);
+  s->options.checkpoint      = path;
+  s->options.checkpoint_flag = flag;
+  s->options.resume          = resume;
+}
+
+
+/* Look for the result in the cache. Return TRUE on a hit. */
+static Boolean cachedresult(PebbleSearch *s,const CacheQuery *q) {
+
+  Boolean found;
+  int     cost;
+  size_t  length;
+  Vertex *steps;
+
+  if (!lookup_ResultCache(s->cache,s->canonical,q,&found,&cost,&length,&steps))
+    return FALSE;
+
+  if (found) {
+    Pebbling *p=s->variant->create(length);
+    memcpy(p->steps,steps,length*sizeof(Vertex));
+    p->length=length;
+    p->cost=cost;
+    free(steps);
+
+    /* The entry is not trusted blindly */
+    if ((unsigned int)cost > s->bound || !s->variant->isvalid(s->graph,p,s->persistent)) {
+      s->variant->dispose(p);
+      s->cache->hits--;
+      s->cache->misses++;
+      return FALSE;
+    }
+    s->pebbling=p;
+  }
+
+  s->result = found ? SEARCH_FOUND : SEARCH_NOT_FOUND;
+  s->options.error       = NULL;
+  s->options.approximate = FALSE;
+  s->options.limit       = NULL;
+  memset(&s->stats,0,sizeof(Statistic));
+  return TRUE;
+}
+
+
+/**
+ * Search a pebbling of the graph within the bound of the context.
+ * The pebbling of a previous run is discarded.
+ *
+ * @param s the search context.
+ *
+ * @return the outcome of the search, which is also kept in the
+ * context.
+ */
+SearchResult run_PebbleSearch(PebbleSearch *s) {
+
+  assert(s);
+
+  if (s->pebbling) {
+    s->variant->dispose(s->pebbling);
+    s->pebbling=NULL;
+  }
+  disposefrontier(s);
+  memset(&s->options.pebblings,0,sizeof(PebblingCount));
+
+  /* Exact searches only, and the cache has no counts */
+  Boolean usecache = s->cache!=NULL && s->engine!=SEARCH_BEAM && !s->options.count &&
+    (s->engine==SEARCH_SYMBOLIC || s->options.visited!=VISITED_BITSTATE);
+  CacheQuery query;
+
+  if (usecache) {
+    if (!s->canonical_done) {
+      s->canonical=new_CanonicalDAG(s->graph);
+      s->canonical_done=TRUE;
+      if (s->canonical==NULL && s->options.report)
+        fprintf(s->options.report,"c Result cache: no canonical form for the graph, not cached\n");
+    }
+    usecache = (s->canonical!=NULL);
+  }
+  if (usecache) {
+    query.variant    = s->variant->variant;
+    query.bound      = s->bound;
+    query.persistent = s->persistent;
+    if (cachedresult(s,&query)) {
+      s->options.resume=NULL;
+      if (s->options.report)
+        fprintf(s->options.report,"c Result cache hit: %s of cost %u\n",
+                s->variant->type(),s->bound);
+      return s->result;
+    }
+    if (s->options.report)
+      fprintf(s->options.report,"c Result cache miss: %s of cost %u\n",
+              s->variant->type(),s->bound);
+  }
+
+  s->options.dict=NULL;
+  if (s->engine==SEARCH_EXPLICIT && s->options.visited==VISITED_DICT) {
+    if (s->dict==NULL) s->dict=newDict(s->dict_size);
+    s->options.dict=s->dict;
+  }
+
+  if (s->engine==SEARCH_SYMBOLIC)
+    s->pebbling=s->variant->symbolic(s->graph,s->bound,s->persistent,&s->options);
+  else if (s->engine==SEARCH_BEAM)
+    s->pebbling=s->variant->beam(s->graph,s->bound,s->persistent,&s->options);
+  else
+    s->pebbling=s->variant->bfs(s->graph,s->bound,s->persistent,&s->options);
+
+  s->options.resume=NULL;                 /* Only for one run */
+
+  if (s->options.error)    s->result=SEARCH_ERROR;
+  else if (s->pebbling)    s->result=SEARCH_FOUND;
+  else if (s->options.approximate || s->options.limit) s->result=SEARCH_UNKNOWN;
+  else                     s->result=SEARCH_NOT_FOUND;
+
+  if (usecache && (s->result==SEARCH_FOUND || s->result==SEARCH_NOT_FOUND)) {
+    if (!store_ResultCache(s->cache,s->canonical,&query,s->pebbling) && s->options.report)
+      fprintf(s->options.report,"c Result cache: unable to write in %s\n",s->cache->directory);
+  }
+
+  return s->result;
+}
+
+
+/**
+ * Compute the Pareto frontier of cost and length within the bound of
+ * the context, with the explicit search.  The frontier and the
+ * pebbling of a previous run are discarded.  The result cache is not
+ * used.
+ *
+ * @param s the search context.
+ *
+ * @return the outcome of the search.
+ */
+SearchResult frontier_PebbleSearch(PebbleSearch *s) {
+
+  assert(s);
+
+  if (s->pebbling) {
+    s->variant->dispose(s->pebbling);
+    s->pebbling=NULL;
+  }
+  disposefrontier(s);
+
+  s->frontier=s->variant->pareto(s->graph,s->bound,s->persistent,&s->options,&s->frontier_size);
+
+  if (s->options.error)      s->result=SEARCH_ERROR;
+  else if (s->options.limit) s->result=SEARCH_UNKNOWN;
+  else if (s->frontier_size) s->result=SEARCH_FOUND;
+  else                       s->result=SEARCH_NOT_FOUND;
+
+  return s->result;
+}
+
+size_t frontiersize_PebbleSearch(const PebbleSearch *s) {
+  assert(s);
+  return s->frontier_size;
+}
+
+const Pebbling *frontierpoint_PebbleSearch(const PebbleSearch *s,size_t i) {
+  assert(s && i<s->frontier_size);
+  return s->frontier[i];
+}
+
+
+const Pebbling *pebbling_PebbleSearch(const PebbleSearch *s) {
+  assert(s);
+  return s->pebbling;
+}
+
+const Statistic *stats_PebbleSearch(const PebbleSearch *s) {
+  assert(s);
+  return &s->stats;
+}
+
+const char *error_PebbleSearch(const PebbleSearch *s) {
+  assert(s);
+  return s->options.error;
+}
+
+const char *limit_PebbleSearch(const PebbleSearch *s) {
+  assert(s);
+  return s->options.limit;
+}
+
+long depth_PebbleSearch(const PebbleSearch *s) {
+  assert(s);
+  return s->options.depth;
+}
+
+const PebblingCount *count_PebbleSearch(const PebbleSearch *s) {
+  assert(s);
+  return &s->options.pebblings;
+}
+
+
+const char *type_PebbleSearch(const PebbleSearch *s) {
+  assert(s);
+  return s->variant->type();
+}
+
+void fprint_text_PebbleSearch(FILE *outfile,const PebbleSearch *s) {
+  assert(s && s->pebbling);
+  s->variant->fprint_text(outfile,s->graph,s->pebbling);
+}
+
+void fprint_textpoint_PebbleSearch(FILE *outfile,const PebbleSearch *s,size_t i) {
+  assert(s && i<s->frontier_size);
+  s->variant->fprint_text(outfile,s->graph,s->frontier[i]);
+}
+
+Boolean fprint_dot_PebbleSearch(char *dot_path,const PebbleSearch *s) {
+  assert(s && s->pebbling);
+  return s->variant->fprint_dot(dot_path,s->graph,s->pebbling);
+}
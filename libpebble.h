@@ -0,0 +1,177 @@
+/*
+   Description::
+
+   Interface for using the pebbling search as a library.  All the
+   state of a search is in a context object, so that several searches
+   can run at the same time in different threads.  Header for
+   libpebble.c
+
+*/
+
+
+/* Preamble */
+#ifndef  LIBPEBBLE_H
+#define  LIBPEBBLE_H
+
+#include <stdio.h>
+#include <signal.h>
+
+#include "common.h"
+#include "dag.h"
+#include "pebbling.h"
+#include "statistics.h"
+#include "bfs.h"
+#include "config.h"
+#include "cache.h"
+
+
+/* Code */
+
+typedef enum {
+
+  SEARCH_EXPLICIT,        /* Breadth-first search on configurations */
+  SEARCH_SYMBOLIC,        /* Breadth-first search on layers as BDDs */
+  SEARCH_BEAM             /* Heuristic anytime beam search */
+
+} SearchEngine;
+
+typedef enum {
+
+  SEARCH_NOT_RUN,
+  SEARCH_FOUND,           /* A valid pebbling within the bound */
+  SEARCH_NOT_FOUND,       /* There is no pebbling within the bound */
+  SEARCH_UNKNOWN,         /* None found by an approximate search,
+                             or the search exceeded a resource limit */
+  SEARCH_ERROR            /* The search could not be performed */
+
+} SearchResult;
+
+typedef enum {
+
+  OPTION_VARIANT,         /* A PebblingVariant value */
+  OPTION_BOUND,           /* Maximum number of pebbles */
+  OPTION_PERSISTENT,      /* Search for a persistent pebbling */
+  OPTION_ENGINE,          /* A SearchEngine value */
+  OPTION_VISITED,         /* A VisitedSet value */
+  OPTION_BITSTATE_MEMORY, /* Bytes of the bitstate table */
+  OPTION_BITSTATE_HASHES, /* Bits set for each configuration */
+  OPTION_DICT_SIZE,       /* Buckets allocated for the dictionary */
+  OPTION_MAX_MEMORY,      /* Bytes of resident memory, 0 for no limit */
+  OPTION_MAX_CONFIGURATIONS, /* Visited configurations, 0 for no limit */
+  OPTION_TIME_LIMIT,      /* Seconds from now, 0 for no limit */
+  OPTION_BEAM_WIDTH,      /* Initial width of the beam search */
+  OPTION_COUNT            /* Count the shortest pebblings */
+
+} SearchOption;
+
+/* Search context.  The graph is not owned by the context, and must
+   not change while the context uses it.  The pebbling found is owned
+   by the context, and lives until the next run or the disposal of
+   the context.
+
+   The dictionary of visited configurations is allocated at the first
+   run, and then emptied and reused by the next runs, also on other
+   graphs.
+
+   With a result cache, the canonical form of the graph is computed at
+   the first run and kept until the graph changes. */
+typedef struct {
+
+  const DAG   *graph;
+  const VariantOps *variant;
+
+  unsigned int bound;
+  Boolean      persistent;
+  SearchEngine engine;
+  BFSOptions   options;
+  Dict        *dict;
+  size_t       dict_size;
+
+  ResultCache  *cache;
+  CanonicalDAG *canonical;
+  Boolean       canonical_done;
+
+  SearchResult result;
+  Pebbling    *pebbling;
+  Statistic    stats;
+
+  Pebbling   **frontier;         /* Points of the Pareto frontier */
+  size_t       frontier_size;
+
+} PebbleSearch;
+
+extern PebbleSearch *new_PebbleSearch(const DAG *graph);
+extern void          dispose_PebbleSearch(PebbleSearch *s);
+
+/* Use the context, and its preallocated structures, on another graph.
+   The graph may be NULL, to detach the context from a graph about to
+   be disposed. */
+extern void          setgraph_PebbleSearch(PebbleSearch *s,const DAG *graph);
+
+/* Return 0 on success, -1 if the option or its value is invalid. */
+extern int setoption_PebbleSearch(PebbleSearch *s,SearchOption option,long value);
+
+/* Periodic reports of the running statistics go to `stream' when
+   `*flag' is set, and the flag is then cleared.  The final reports
+   and the diagnostics go to `stream' too.  Both may be NULL. */
+extern void setreport_PebbleSearch(PebbleSearch *s,
+                                   FILE *stream,
+                                   volatile sig_atomic_t *flag,
+                                   unsigned int interval);
+
+/* Results are looked up in the cache before the search, and stored
+   after it.  Approximate and heuristic searches do not use the cache.
+   The cache is not owned by the context, and may be NULL. */
+extern void setcache_PebbleSearch(PebbleSearch *s,ResultCache *cache);
+
+/* Explicit searches with the dictionary save their state in the file
+   `path' whenever `*flag' is set.  The next run starts from the state
+   saved in `resume', which must be a checkpoint of the same graph,
+   variant and bound.  Any argument may be NULL. */
+extern void setcheckpoint_PebbleSearch(PebbleSearch *s,
+                                       const char *path,
+                                       volatile sig_atomic_t *flag,
+                                       const char *resume);
+
+/* Search a pebbling within the current bound.  The beam search
+   gives the cheapest pebbling it finds within the bound, which may not
+   be optimal, and SEARCH_UNKNOWN when it finds none.  When counting,
+   the explicit search also counts the pebblings as short as the one
+   found, and the result cache is not used. */
+extern SearchResult run_PebbleSearch(PebbleSearch *s);
+
+/* Pareto frontier of cost and length within the current bound, in a
+   single search: the points are the shortest pebblings of each cost,
+   in order of increasing length and decreasing cost.  The result is
+   SEARCH_FOUND if there is at least one point, and SEARCH_UNKNOWN if
+   the search exceeded a resource limit, so that the frontier may be
+   incomplete.  The points live until the next run. */
+extern SearchResult frontier_PebbleSearch(PebbleSearch *s);
+extern size_t       frontiersize_PebbleSearch(const PebbleSearch *s);
+extern const Pebbling *frontierpoint_PebbleSearch(const PebbleSearch *s,size_t i);
+
+extern const Pebbling  *pebbling_PebbleSearch(const PebbleSearch *s);
+extern const Statistic *stats_PebbleSearch(const PebbleSearch *s);
+extern const char      *error_PebbleSearch(const PebbleSearch *s);
+
+/* After a SEARCH_UNKNOWN result caused by a resource limit, the name
+   of the limit ("time", "memory" or "configurations"), and the depth
+   of the deepest level of the search which was fully explored. */
+extern const char      *limit_PebbleSearch(const PebbleSearch *s);
+extern long             depth_PebbleSearch(const PebbleSearch *s);
+
+/* Number of shortest pebblings within the bound, after a run of the
+   explicit search with OPTION_COUNT.  It is zero if no pebbling has
+   been found, or if a limit stopped the count. */
+extern const PebblingCount *count_PebbleSearch(const PebbleSearch *s);
+
+/* Name of the pebbling variant, and output of the pebbling found */
+extern const char *type_PebbleSearch(const PebbleSearch *s);
+extern void    fprint_text_PebbleSearch(FILE *outfile,const PebbleSearch *s);
+extern void    fprint_textpoint_PebbleSearch(FILE *outfile,const PebbleSearch *s,size_t i);
+extern Boolean fprint_dot_PebbleSearch(char *dot_path,const PebbleSearch *s);
+
+/* The graphs to search are read by the KTH parser of the library,
+   declared in kthparser.h. */
+
+#endif /* LIBPEBBLE_H */
@@ -0,0 +1,223 @@
+/*
+  Benchmark of the topological orders of dag.c for the search.
+
+  Each graph is searched in each order, from one pebble up to the
+  optimal cost, and the configurations processed and visited by the
+  search are compared with the ones of the input order.  The pebbling
+  of each order is lifted to the input graph and validated, and its
+  cost must be the same for all orders.  Besides the graphs given
+  with -G or -i, the default graphs come in their generated order and
+  in a random topological order, as the one of a KTH file written by
+  another program.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "common.h"
+#include "dag.h"
+#include "kthparser.h"
+#include "pebbling.h"
+#include "config.h"
+#include "libpebble.h"
+
+
+#define USAGEMESSAGE "\n\
+Usage: %s [-h] [-V <variant>] [-r <seed>] [-G <family> | -i <input>]\n\
+\n\
+       -h     help message;\n\
+       -V V   pebbling variant: black, bw or rev (default: black);\n\
+       -r S   seed of the random topological orders (default: 1);\n\
+       -G F   benchmark the graph of family F, as in pebble -G;\n\
+       -i F   benchmark the graph in the KTH file F.\n"
+
+#define ORDERS (ORDER_CUTWIDTH+1)
+
+static const char *default_graphs[]={
+  "pyramid:5", "tree:3", "tree:4", "grid:4:4", "grid:5:5", NULL
+};
+
+
+/* The graph relabelled in a random topological order */
+static DAG *shuffle(const DAG *g,BitTuple *seed) {
+
+  size_t  n=g->size;
+  size_t *missing=(size_t*)malloc(n*sizeof(size_t));
+  Vertex *ready=(Vertex*)malloc(n*sizeof(Vertex));
+  Vertex *name=(Vertex*)malloc(n*sizeof(Vertex));
+  Vertex *label=(Vertex*)malloc(n*sizeof(Vertex));
+  size_t  nready=0;
+  assert(missing && ready && name && label);
+
+  for(Vertex v=0;v<n;v++) {
+    missing[v]=g->indegree[v];
+    if (missing[v]==0) ready[nready++]=v;
+  }
+  for(Vertex w=0;w<n;w++) {
+    *seed = *seed*6364136223846793005ULL + 1442695040888963407ULL;
+    size_t k=(size_t)((*seed >> 33) % nready);
+    Vertex v=ready[k];
+    ready[k]=ready[--nready];
+    label[w]=v;
+    name[v]=w;
+    for(size_t i=0;i<g->outdegree[v];i++)
+      if (--missing[g->out[v][i]]==0) ready[nready++]=g->out[v][i];
+  }
+
+  DAG *s=new_DAG(n);
+  for(Vertex w=0;w<n;w++) s->indegree[w]=g->indegree[label[w]];
+  edges_DAG(s);
+  for(Vertex w=0;w<n;w++)
+    for(size_t i=0;i<s->indegree[w];i++) s->in[w][i]=name[g->in[label[w]][i]];
+  dag_precompute_data(s);
+  assert(isconsistent_DAG(s));
+
+  free(missing);
+  free(ready);
+  free(name);
+  free(label);
+  return s;
+}
+
+
+/* Search the graph in each order, and print the table.  Return the
+   number of errors. */
+static int bench(PebbleSearch *s,const DAG *g,const char *name,PebblingVariant variant) {
+
+  const VariantOps *ops = (variant==VARIANT_BLACK) ? &variant_ops_black
+                        : (variant==VARIANT_BLACK_WHITE) ? &variant_ops_bw : &variant_ops_rev;
+  unsigned long long processed[ORDERS];
+  unsigned long long visited[ORDERS];
+  int cost[ORDERS];
+  int errors=0;
+
+  if (g->size>BITTUPLE_SIZE || g->sink_number!=1) {
+    printf("c %-24s skipped: the search needs a single sink and at most %zu vertices\n",
+           name,(size_t)BITTUPLE_SIZE);
+    return 0;
+  }
+
+  for(int o=0;o<ORDERS;o++) {
+    DAGOrder *order=order_DAG(g,(DAGOrderStrategy)o);
+    SearchResult r=SEARCH_NOT_FOUND;
+
+    processed[o]=visited[o]=0;
+    cost[o]=0;
+    setgraph_PebbleSearch(s,order->dag);
+    for(unsigned int b=1;b<=g->size+1 && r==SEARCH_NOT_FOUND;b++) {
+      setoption_PebbleSearch(s,OPTION_BOUND,b);
+      r=run_PebbleSearch(s);
+      processed[o]+=stats_PebbleSearch(s)->processed_T;
+      visited[o]  +=stats_PebbleSearch(s)->first_queuing_T;
+    }
+
+    if (r==SEARCH_FOUND) {
+      const Pebbling *solution=pebbling_PebbleSearch(s);
+      Pebbling *p=ops->create(solution->length);
+      Vertex *lifted=lift_DAGOrder(order,solution->steps,solution->length);
+      memcpy(p->steps,lifted,solution->length*sizeof(Vertex));
+      p->length=solution->length;
+      p->cost=solution->cost;
+      cost[o]=solution->cost;
+      if (!ops->isvalid(g,p,FALSE)) errors++;
+      ops->dispose(p);
+      free(lifted);
+    } else {
+      errors++;
+    }
+    if (cost[o]!=cost[ORDER_INPUT]) errors++;
+
+    printf("c %-24s %-10s sep %3zu cut %3zu cost %3d processed %12llu visited %12llu  %6.1f%%\n",
+           name,name_DAGOrderStrategy((DAGOrderStrategy)o),
+           separation_DAG(order->dag),cutwidth_DAG(order->dag),cost[o],
+           processed[o],visited[o],
+           visited[ORDER_INPUT] ? 100.0*(double)visited[o]/(double)visited[ORDER_INPUT] : 100.0);
+
+    setgraph_PebbleSearch(s,NULL);
+    dispose_DAGOrder(order);
+  }
+  if (errors) printf("c %-24s FAILED\n",name);
+  return errors;
+}
+
+
+int main(int argc, char *argv[])
+{
+  int option_code=0;
+  PebblingVariant variant=VARIANT_BLACK;
+  BitTuple seed=1;
+  const char *family=NULL;
+  const char *input=NULL;
+  int errors=0;
+  char name[100];
+
+  while((option_code = getopt(argc,argv,"hV:r:G:i:"))!=-1) {
+    switch (option_code) {
+    case 'h':
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_SUCCESS);
+      break;
+    case 'V':
+      if      (strcmp(optarg,"black")==0) variant=VARIANT_BLACK;
+      else if (strcmp(optarg,"bw")==0)    variant=VARIANT_BLACK_WHITE;
+      else if (strcmp(optarg,"rev")==0)   variant=VARIANT_REVERSIBLE;
+      else {
+        fprintf(stderr,USAGEMESSAGE,argv[0]);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'r':
+      seed=(BitTuple)strtoull(optarg,NULL,10);
+      break;
+    case 'G':
+      family=optarg;
+      break;
+    case 'i':
+      input=optarg;
+      break;
+    default:
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    }
+  }
+
+  DAG *g=path(1);
+  PebbleSearch *s=new_PebbleSearch(g);
+  setoption_PebbleSearch(s,OPTION_VARIANT,variant);
+  setoption_PebbleSearch(s,OPTION_DICT_SIZE,0xFFFFF);
+  setreport_PebbleSearch(s,NULL,NULL,0);
+
+  if (family || input) {
+    DAG *h = family ? generate_DAG(family) : kthparser_file(input);
+    if (h==NULL) {
+      fprintf(stderr,"c ERROR: can't build the graph \"%s\"\n",family ? family : input);
+      exit(EXIT_FAILURE);
+    }
+    errors+=bench(s,h,family ? family : input,variant);
+    dispose_DAG(h);
+  } else {
+    for(size_t i=0;default_graphs[i];i++) {
+      DAG *h=generate_DAG(default_graphs[i]);
+      assert(h);
+      errors+=bench(s,h,default_graphs[i],variant);
+
+      DAG *shuffled=shuffle(h,&seed);
+      snprintf(name,100,"%s shuffled",default_graphs[i]);
+      errors+=bench(s,shuffled,name,variant);
+      dispose_DAG(shuffled);
+      dispose_DAG(h);
+    }
+  }
+  dispose_PebbleSearch(s);
+  dispose_DAG(g);
+
+  printf("c %s\n",errors ? "FAILED" : "all checks passed");
+  exit(errors ? EXIT_FAILURE : EXIT_SUCCESS);
+}
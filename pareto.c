@@ -0,0 +1,279 @@
+/*
+   Description::
+
+   Pareto frontier of cost and length of the pebblings.  Running the
+   breadth-first search once per bound explores the same
+   configurations again and again.  Here the search is done once, on
+   the configurations labelled with the largest number of pebbles on
+   the path which reached them (the peak).
+
+   Since the configurations are reached in order of length, a new
+   path to a configuration is useful only if its peak is smaller than
+   the peaks of all the previous paths to it.  So the same
+   configuration is expanded once for each smaller peak, and the first
+   final configuration reached with a certain peak gives the shortest
+   pebbling of that cost.
+
+*/
+
+/* Preamble */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+#include "dag.h"
+#include "dsbasic.h"
+#include "hashtable.h"
+#include "pebbling.h"
+#include "statistics.h"
+#include "bfs.h"
+#include "config.h"
+#include "pareto.h"
+
+extern size_t  hashPebbleConfiguration(void *data);
+extern Boolean samePebbleConfiguration(void *A,void *B);
+
+
+/* Code */
+
+/* A path to a configuration, and its peak.  The dictionary keeps, for
+   each configuration, the label with the smallest peak so far. */
+typedef struct {
+
+  PebbleConfiguration *c;
+  unsigned int         peak;
+
+} Label;
+
+static size_t hashLabel(void *data) {
+  return hashPebbleConfiguration(((Label*)data)->c);
+}
+
+static Boolean sameLabel(void *A,void *B) {
+  return samePebbleConfiguration(((Label*)A)->c,((Label*)B)->c);
+}
+
+static Label *newLabel(PebbleConfiguration *c,unsigned int peak) {
+  Label *l=(Label*)malloc(sizeof(Label));
+  assert(l);
+  l->c=c;
+  l->peak=peak;
+  return l;
+}
+
+
+/**
+   Compute the Pareto frontier of cost and length.
+
+   @param g the graph to pebble (with few vertices and a single sink).
+
+   @param upper_bound the maximum number of pebbles.
+
+   @param persistent_pebbling whether the pebbling must leave a black
+   pebble on the sink.
+
+   @param opts the options of the search (NULL for defaults): the
+   statistics, the reports and the resource limits are used as in the
+   breadth-first search.  If a limit is exceeded the points found so
+   far are returned, but there may be shorter pebblings of smaller
+   cost.
+
+   @param count where to write the number of points.
+
+   @return the points of the frontier, as pebblings.
+*/
+Pebbling **pareto_pebbling_strategy(const DAG *g,
+                                    unsigned int upper_bound,
+                                    Boolean persistent_pebbling,
+                                    BFSOptions *opts,
+                                    size_t *count) {
+
+  /* PROLOGUE ----------------------------------- */
+  assert(isconsistent_DAG(g));
+  assert(count);
+
+  BFSOptions default_opts;
+  if (opts==NULL) {
+    init_BFSOptions(&default_opts);
+    opts=&default_opts;
+  }
+  opts->approximate = FALSE;
+  opts->error = NULL;
+  opts->limit = NULL;
+  opts->depth = -1;
+  *count = 0;
+
+  if (g->size > BITTUPLE_SIZE) {
+    opts->error = "the graph is too big for the optimized data structures";
+    return NULL;
+  }
+
+  if (g->sink_number!=1) {
+    opts->error = "the graph has more than one sink vertex";
+    return NULL;
+  }
+
+  if (upper_bound < 1) { return NULL; } /* No pebbling with zero pebbles */
+
+#if (!BLACK_WHITE_PEBBLING && !REVERSIBLE_PEBBLING)
+  persistent_pebbling = 0;
+#endif
+
+  Statistic  local_stats;
+  Statistic *Stat = opts->stats ? opts->stats : &local_stats;
+  STATS_RESET(*Stat);
+  (void)Stat;
+
+  /* END OF PROLOGUE ----------------------------------- */
+
+  Boolean (*isfinal)(const DAG *, const PebbleConfiguration *) =
+    persistent_pebbling ? isfinal_persistent : isfinal_visiting;
+
+  Queue      *Q=newSL();           /* Labels to be expanded */
+  LinkedList *archive=newSL();     /* All the configurations reached */
+  Dict       *D=newDict(CONFIG_HASHSIZE);
+  D->key_function     = hashLabel;
+  D->eq_function      = sameLabel;
+  D->dispose_function = free;
+
+  DictQueryResult res;
+  Label           key;
+
+  Pebbling   **points=NULL;
+  unsigned int bound=upper_bound;  /* Only cheaper pebblings are useful */
+  Counter      processed_count=0,visited_count=1;
+
+  PebbleConfiguration *initial=new_PebbleConfiguration();
+  reset_active_PebbleConfiguration(g,initial);
+#if BLACK_WHITE_PEBBLING || REVERSIBLE_PEBBLING
+  if (persistent_pebbling) {  init_persistent_pebbling(g, initial); }
+#endif
+  enqueue(archive,initial);
+  writeDict(D,&res,newLabel(initial,initial->pebbles));
+  if (initial->pebbles <= bound) enqueue(Q,newLabel(initial,initial->pebbles));
+
+  STATS_SET(*Stat,first_queuing,1);
+  STATS_SET(*Stat,queued,1);
+  STATS_SET(*Stat,dict_size,D->size);
+
+  for(resetSL(Q); !isemptySL(Q); pop(Q)) {
+
+    if (STATS_TIMER_OFF(opts->report_flag)) {
+      STATS_CLOCK_UPDATE(*Stat,opts->report_interval);
+      STATS_REPORT(opts->report,*Stat,
+                   "\nClock %llu: Report for graph on %zu vertices, Pareto frontier up to %u:\n",
+                   STATS_GET(*Stat,clock),
+                   g->size,
+                   upper_bound);
+      STATS_TIMER_RESET(opts->report_flag);
+    }
+
+    if ((processed_count & GOVERNOR_PERIOD)==0 &&
+        (opts->limit=exceeded_ResourceLimits(&opts->limits,visited_count))) {
+      break;
+    }
+
+    Label *l=(Label*)getSL(Q);
+    PebbleConfiguration *ptr=l->c;
+    unsigned int peak=l->peak;
+    free(l);
+    processed_count++;
+    STATS_INC(*Stat,processed);
+
+    if (peak > bound) continue;   /* A cheaper pebbling has been found meanwhile */
+
+    for(BitTuple moves=enabled_PebbleConfiguration(g,ptr,bound); moves; moves &= moves-1) {
+
+      Vertex v=LOWESTBIT(moves);
+      PebbleConfiguration *nptr=next_PebbleConfiguration(v,g,ptr,bound);
+      if (nptr==NULL) continue;
+      STATS_INC(*Stat,offspring);
+
+      unsigned int npeak=MAX(peak,nptr->pebbles);
+
+      key.c=nptr;
+      queryDict(D,&res,&key);
+      STATS_ADD(*Stat,dict_hops,res.hops);
+      STATS_INC(*Stat,dict_queries);
+
+      if (res.value!=NULL && ((Label*)res.value)->peak <= npeak) {
+        STATS_INC(*Stat,suboptimal);    /* Dominated by a shorter path */
+        dispose_PebbleConfiguration(nptr);
+        continue;
+      }
+
+      nptr->previous_configuration = ptr;
+      nptr->last_changed_vertex = v;
+      enqueue(archive,nptr);
+      visited_count++;
+
+      if (res.value==NULL) {
+        unsafe_noquery_writeDict(D,&res,newLabel(nptr,npeak));
+        STATS_INC(*Stat,first_queuing);
+        STATS_INC(*Stat,dict_writes);
+      } else {
+        ((Label*)res.value)->c    = nptr;
+        ((Label*)res.value)->peak = npeak;
+      }
+
+      if (isfinal(g,nptr)) {           /* A new point of the frontier */
+        Pebbling *p;
+        if (persistent_pebbling) {
+          p = finalize_persistent_pebbling(g,nptr);
+        } else {
+#if REVERSIBLE_PEBBLING
+          p = finalize_reversible_pebbling(g,nptr);
+#else
+          p = finalize_pebbling(g,nptr);
+#endif
+        }
+        assert(isvalid_Pebbling(g,p,persistent_pebbling));
+        assert((unsigned int)p->cost==npeak);
+        points=(Pebbling**)realloc(points,(*count+1)*sizeof(Pebbling*));
+        assert(points);
+        points[(*count)++]=p;
+        if (opts->report)
+          fprintf(opts->report,"c Pareto frontier: %s of cost %d and length %zu\n",
+                  pebbling_type(),p->cost,p->length);
+        bound=npeak-1;
+        if (bound==0) break;
+        continue;
+      }
+
+      enqueue(Q,newLabel(nptr,npeak));
+      STATS_INC(*Stat,queued);
+    }
+
+    if (bound==0) break;
+  }
+
+  STATS_REPORT(opts->report,*Stat,"\nFINAL REPORT (clk. %llu): Pareto frontier up to %u:\n\n",
+               STATS_GET(*Stat,clock),
+               upper_bound);
+  if (opts->limit && opts->report)
+    fprintf(opts->report,"c Search stopped: %s limit exceeded, the frontier may be incomplete\n",
+            opts->limit);
+
+  /* Two final configurations at the same depth may give a point and
+     a cheaper one which is not longer */
+  size_t kept=0;
+  for(size_t i=0;i<*count;i++) {
+    Boolean dominated=FALSE;
+    for(size_t j=i+1;j<*count;j++) dominated |= (points[j]->length <= points[i]->length);
+    if (dominated) dispose_Pebbling(points[i]);
+    else points[kept++]=points[i];
+  }
+  *count=kept;
+
+  /* Free the memory of the data structures */
+  for(resetSL(Q); !isemptySL(Q); pop(Q)) free(getSL(Q));
+  disposeSL(Q);
+  disposeDict(D);
+  for(resetSL(archive); !isemptySL(archive); pop(archive))
+    dispose_PebbleConfiguration((PebbleConfiguration*)getSL(archive));
+  disposeSL(archive);
+
+  return points;
+}
@@ -0,0 +1,36 @@
+/*
+   Description::
+
+   Pareto frontier of cost and length of the pebblings, computed by a
+   single breadth-first search. Header for pareto.c
+
+*/
+
+
+/* Preamble */
+#ifndef  PARETO_H
+#define  PARETO_H
+
+#include "common.h"
+#include "variant.h"
+#include "dag.h"
+#include "pebbling.h"
+#include "bfs.h"
+
+
+/* Code */
+
+/* The shortest pebblings for every cost up to the bound.  The points
+   of the frontier are returned in order of increasing length and
+   decreasing cost, and the last one has the smallest cost of all
+   pebblings: for each cost k, the shortest pebbling of cost at most k
+   is the first point of cost at most k.  The number of points is
+   written in `*count', and the array and the pebblings belong to the
+   caller.  NULL and zero points if there is no pebbling. */
+extern Pebbling** pareto_pebbling_strategy(const DAG *digraph,
+                                           unsigned int upper_bound,
+                                           Boolean persistent_pebbling,
+                                           BFSOptions *opts,
+                                           size_t *count);
+
+#endif /* PARETO_H */
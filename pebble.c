@@ -15,29 +15,98 @@
 
 #include "common.h"
 #include "dag.h"
+#include "kthparser.h"
 #include "timedflags.h"
 #include "pebbling.h"
-#include "bfs.h"
+#include "libpebble.h"
+#include "batch.h"
+#include "cache.h"
+#include "daemon.h"
+#include "checkpoint.h"
 #include "config.h"
+#include "decompose.h"
+#include "families.h"
 
 
 #define USAGEMESSAGE "\n\
-Usage: %s [-htZ] -b<int> [-g <dotfile>] [ -p<int> | -2<int> | -i <input> ] [-O <input2> ] \n\
+Usage: %s [-htZzSAP] [-V <variant>] -b<int> [-B<int>] [-C <dir>] [-g <dotfile>] [ -p<int> | -2<int> | -i <input> ] [-O <input2> ] \n\
+          [--checkpoint <file>] [--checkpoint-interval <sec>] [--resume <file>]\n\
+          [--max-memory <MB>] [--max-configurations <int>] [--time-limit <sec>]\n\
+          [--beam-width <int>] [--beam-time <sec>] [--beam-seed] [--count] [--reduce] [--decompose] [--always-search]\n\
+          [--order <strategy>]\n\
+       %s [-tZzSA] [-V <variant>] -b<int> [-B<int>] [-C <dir>] [-j<int>] [-H<int>] [ -M <manifest> | -K <input> ]\n\
+       %s [-C <dir>] [-j<int>] [-H<int>] -D <socket>\n\
 \n\
        -h     help message;\n\
+       -V <variant> pebbling game: black, bw (black/white) or rev (reversible).\n\
+              The default is given by the program name: pebble, bwpebble, revpebble.\n\
        -Z     search for a 'persistent pebbling' (optional, useful for black/white and reversible pebbling).\n\
        -t     find shortest pebbling within space limits, instead of minimizing space (optional).\n\
        -g <dotfile> graphviz depiction of pebbling save on <dotfile>.\n\
+       -z     keep the visited configurations in a ZDD (optional, saves memory on structured graphs).\n\
+       -S     symbolic search, with layers of configurations represented as BDDs (optional).\n\
+       -A     heuristic beam search, which improves its pebbling until it stops (optional).\n\
+              Pebblings found are valid, but may not be optimal.\n\
+       -P     Pareto frontier: the shortest pebbling for each number of pebbles up to\n\
+              the bound, in a single search (optional).\n\
+       -B MB  approximate search with a bitstate table of MB megabytes (optional).\n\
+              Pebblings found are valid, but their absence is not a proof.\n\
+       -C <dir> cache of the results in directory <dir>, shared by isomorphic graphs (optional).\n\
 \n\
+       --checkpoint <file>  save the state of the search in <file> periodically (optional);\n\
+       --checkpoint-interval <sec>  seconds between checkpoints (default: %d);\n\
+       --resume <file>      continue the search saved in <file>, and keep saving it there.\n\
+              Checkpoints are available for the search with the dictionary (no -z, -S, -B).\n\
+\n\
+       --max-memory <MB>         stop the search when the process uses more memory (optional);\n\
+       --max-configurations <N>  stop the search after N visited configurations (optional);\n\
+       --time-limit <sec>        stop the search after <sec> seconds (optional).\n\
+              A stopped search reports the levels fully explored, and the answer is UNKNOWN.\n\
+\n\
+       --beam-width <N>   initial width of the beam search (default: %d);\n\
+       --beam-time <sec>  stop the beam search after <sec> seconds (default: when the\n\
+                          widest beam fails);\n\
+       --beam-seed        run the beam search first, then the exact search only below\n\
+                          the cost of the pebbling it finds.\n\
+\n\
+%s\n\
        -b M   maximum number of pebbles (mandatory);\n\
 \n\
     input graph:\n\
        -p N         pyramid graph of height N;\n\
        -2 N         binary tree height N;\n\
        -c N         chain of length N;\n\
+       -G <family>  graph of one of the families listed below;\n\
        -i <input>   load input file in KTH format.\n\
        -O <input2>  OR product between input graph and <input2>.\n\
 \n\
+    batch mode, one result line per graph:\n\
+       -M <manifest> solve the KTH files listed in <manifest>, one per line;\n\
+       -K <input>    solve the KTH graphs concatenated in <input>;\n\
+       -j N          number of worker threads (default: number of cores);\n\
+       -H N          buckets of the dictionary of each worker (default: %d).\n\
+\n\
+    daemon mode:\n\
+       -D <socket>   answer the queries of pebbleclient on the Unix socket <socket>,\n\
+                     with -j workers and the options -C and -H as in batch mode.\n\
+%s"
+
+#define EXTRAOPTIONSMESSAGE "\
+       --count  count the pebblings as short as the one found, within its cost\n\
+                (optional, explicit search only: no -S, -A, -B, -P and checkpoints).\n\
+\n\
+       --reduce  search on the graph without the vertices which do not change the\n\
+                 cost, and lift the pebbling back (optional, no -g and batch mode).\n\
+       --decompose  split the graph at the vertices through which every path to the sink\n\
+                 passes, and search the parts one after the other (optional, black\n\
+                 pebbling only: no -t, -A, -B, -P, -g, --count, checkpoints and batch mode).\n\
+       --always-search  search even the paths, trees and pyramids of -c, -2, -p and -G,\n\
+                 whose pebblings are otherwise built without search (optional).\n\
+       --order S  search on the graph relabelled in the topological order S, one of\n\
+                 input, dfs, separation, cutwidth (default: input; no -g, --decompose\n\
+                 and batch mode).\n"
+
+#define KTHFORMATMESSAGE "\n\
 KTH input format is a source to sync topologically sorted\n\
 representation of a DAG. N is a *positive* integer, and N indexed\n\
 lines follows, each containing the index of the vertex, and a space\n\
@@ -55,13 +124,29 @@ c\n\
 2  : \n\
 3  : 1  \n\
 4  : 3  \n\
-5  : 2  4\n"
+5  : 2  4\n" DAG_FAMILIES_MESSAGE
 
 
-#if BLACK_WHITE_PEBBLING && REVERSIBLE_PEBBLING
-#error "Invalid compiler options: black/white AND reversible simultaneously."
-#endif
+/*
+ *  Pebbling variant from its name, or from the name of the program.
+ *  Return -1 if the name is unknown.
+ */
+int parse_variant(const char *name,PebblingVariant *variant) {
 
+  const char *base = strrchr(name,'/');
+  base = base ? base+1 : name;
+
+  if (strcmp(base,"black")==0 || strcmp(base,"pebble")==0) {
+    *variant=VARIANT_BLACK;
+  } else if (strcmp(base,"bw")==0 || strcmp(base,"bwpebble")==0) {
+    *variant=VARIANT_BLACK_WHITE;
+  } else if (strcmp(base,"rev")==0 || strcmp(base,"revpebble")==0) {
+    *variant=VARIANT_REVERSIBLE;
+  } else {
+    return -1;
+  }
+  return 0;
+}
 
 /* 
  *  Open the input file. '-' represent standard input.
@@ -96,7 +181,226 @@ FILE *openoutputfile(const char* filename) {
 }
 
 
-extern DAG *kthparser(FILE *stream);
+/*
+ *  Print a pebbling lifted from the reduced graph, as a sequence of
+ *  moves on the original graph: a removal is a negative vertex.
+ */
+void fprint_lifted(FILE *out,const DAG *g,const Vertex *steps,size_t length) {
+
+  Boolean *pebbled=(Boolean*)calloc(g->size,sizeof(Boolean));
+  assert(pebbled);
+
+  fprintf(out,"v");
+  for(size_t i=0;i<length;i++) {
+    fprintf(out,pebbled[steps[i]] ? " -%lu" : " %lu",(unsigned long)steps[i]+1);
+    pebbled[steps[i]]=!pebbled[steps[i]];
+  }
+  fprintf(out,"\n");
+  free(pebbled);
+}
+
+
+/*
+ *  Report the vertices removed by the reduction, and the size of the
+ *  space of configurations before and after it.
+ */
+void print_reduction(const DAGReduction *r,PebblingVariant variant) {
+
+  size_t n=r->original->size;
+  size_t m=r->dag->size;
+  const char *base = (variant==VARIANT_BLACK_WHITE) ? "3" : "2";
+
+  printf("c Reduction: %zu of %zu vertices removed, %zu not ancestors of the sink, "
+         "%zu inside chains\n",n-m,n,r->pruned,r->contracted);
+  printf("c Reduction: at most %s^%zu configurations instead of %s^%zu\n",base,m,base,n);
+}
+
+
+/*
+ *  Report the widths of the topological order of the search, against
+ *  the ones of the input order.
+ */
+void print_order(const DAGOrder *o) {
+
+  printf("c Order: %s, vertex separation %zu (input %zu), cutwidth %zu (input %zu)\n",
+         name_DAGOrderStrategy(o->strategy),
+         separation_DAG(o->dag),separation_DAG(o->original),
+         cutwidth_DAG(o->dag),cutwidth_DAG(o->original));
+}
+
+
+/*
+ *  The moves of a pebbling of the search graph as moves of the input
+ *  graph: back from the topological order, then lifted from the
+ *  reduction.  NULL if the search runs on the input graph.
+ */
+Vertex *lift_pebbling(const DAGOrder *order,const DAGReduction *reduction,
+                      const Vertex *steps,size_t n,size_t *length) {
+
+  Vertex *lifted=NULL;
+
+  *length=n;
+  if (order) {
+    lifted=lift_DAGOrder(order,steps,n);
+    steps=lifted;
+  }
+  if (reduction) {
+    Vertex *original=lift_DAGReduction(reduction,steps,n,length);
+    free(lifted);
+    lifted=original;
+  }
+  return lifted;
+}
+
+
+/*
+ *  Print the Pareto frontier, and the shortest length for each number
+ *  of pebbles.  The points of a reordered or reduced graph are lifted
+ *  to the original one.  Return the exit code.
+ */
+int print_frontier(const PebbleSearch *search,const DAGOrder *order,
+                   const DAGReduction *reduction,const char *graph_name,unsigned int bound) {
+
+  size_t n=frontiersize_PebbleSearch(search);
+  const char *type=type_PebbleSearch(search);
+  SearchResult result=search->result;
+
+  if (result==SEARCH_UNKNOWN)
+    printf("c Search stopped: %s limit exceeded, the frontier may be incomplete.\n",
+           limit_PebbleSearch(search));
+
+  if (n==0 && result==SEARCH_UNKNOWN) {
+    printf("c No %s of cost %u found for %s: this is not a proof.\n",type,bound,graph_name);
+    printf("s UNKNOWN\n");
+    return EXIT_UNKNOWN;
+  }
+  if (n==0) {
+    printf("c %s does not have a %s of cost %u.\n",graph_name,type,bound);
+    printf("s UNSATISFIABLE\n");
+    return EXIT_SATISFIABLE;
+  }
+
+  unsigned int cheapest=(unsigned int)frontierpoint_PebbleSearch(search,n-1)->cost;
+  printf("c Pareto frontier of %s for %s, %zu points:\n",type,graph_name,n);
+  printf("c   pebbles  shortest length\n");
+  for(unsigned int k=cheapest;k<=bound;k++) {
+    size_t i=0;
+    while ((unsigned int)frontierpoint_PebbleSearch(search,i)->cost > k) i++;
+    printf("c   %7u  %15zu\n",k,frontierpoint_PebbleSearch(search,i)->length);
+  }
+  printf("s SATISFIABLE\n");
+  for(size_t i=0;i<n;i++) {
+    printf("c point %zu: cost %d, length %zu\n",i+1,
+           frontierpoint_PebbleSearch(search,i)->cost,
+           frontierpoint_PebbleSearch(search,i)->length);
+    if (order || reduction) {
+      const Pebbling *p=frontierpoint_PebbleSearch(search,i);
+      size_t length;
+      Vertex *lifted=lift_pebbling(order,reduction,p->steps,p->length,&length);
+      fprint_lifted(stdout,reduction ? reduction->original : order->original,lifted,length);
+      free(lifted);
+    } else {
+      fprint_textpoint_PebbleSearch(stdout,search,i);
+    }
+  }
+  return EXIT_UNSATISFIABLE;
+}
+
+
+/*
+ *  Print the parts of the decomposition, and the pebbling combined
+ *  from them, lifted to the original graph if it has been reduced.
+ *  Return the exit code.
+ */
+int print_decomposition(const Decomposition *d,const PebbleSearch *search,
+                        const DAGReduction *reduction,const char *graph_name,unsigned int bound) {
+
+  const char *type=type_PebbleSearch(search);
+  SearchResult result=search->result;
+
+  printf("c Decomposition: %zu parts\n",d->parts);
+  for(size_t i=0;i<d->parts;i++) {
+    Vertex first = (i==0) ? 0 : d->cut[i-1]+1;
+    Vertex last  = d->cut[i];
+    if (reduction) {
+      first=reduction->label[first];
+      last =reduction->label[last];
+    }
+    if (i<d->solved)
+      printf("c   part %zu: vertices %lu to %lu, cost %d\n",i+1,
+             (unsigned long)first+1,(unsigned long)last+1,d->cost[i]);
+    else
+      printf("c   part %zu: vertices %lu to %lu, not solved\n",i+1,
+             (unsigned long)first+1,(unsigned long)last+1);
+  }
+
+  if (result==SEARCH_UNKNOWN) {
+    printf("c Search stopped at part %zu: %s limit exceeded\n",
+           d->solved+1,limit_PebbleSearch(search));
+    printf("c No %s of cost %u found for %s: this is not a proof.\n",type,bound,graph_name);
+    printf("s UNKNOWN\n");
+    return EXIT_UNKNOWN;
+  }
+  if (result!=SEARCH_FOUND) {
+    printf("c %s does not have a %s of cost %u.\n",graph_name,type,bound);
+    printf("s UNSATISFIABLE\n");
+    return EXIT_SATISFIABLE;
+  }
+
+  size_t  length=d->length;
+  Vertex *lifted=d->steps;
+  if (reduction) lifted=lift_DAGReduction(reduction,d->steps,d->length,&length);
+
+  printf("c %s has a %s of cost %d and length %zu.\n",
+         graph_name,type,d->cost[d->parts-1],length);
+  printf("c The pebbling is combined from the parts:\n"
+         "c the cost is optimal, the length may not be the shortest.\n");
+  printf("s SATISFIABLE\n");
+  fprint_lifted(stdout,reduction ? reduction->original : d->graph,lifted,length);
+  if (reduction) free(lifted);
+  return EXIT_UNSATISFIABLE;
+}
+
+
+/*
+ *  Print the pebbling of a path, a tree or a pyramid built by
+ *  families.c.  Return the exit code.
+ */
+int print_family(const FamilyPebbling *f,const char *type,const DAG *g,
+                 const char *graph_name,unsigned int bound) {
+
+  if ((unsigned int)f->cost > bound && f->optimal) {
+    printf("c %s does not have a %s of cost %u.\n",graph_name,type,bound);
+    printf("s UNSATISFIABLE\n");
+    return EXIT_SATISFIABLE;
+  }
+  if ((unsigned int)f->cost > bound) {
+    printf("c The recurrence gives a %s of cost %d for %s.\n",type,f->cost,graph_name);
+    printf("c No %s of cost %u found for %s: this is not a proof.\n",type,bound,graph_name);
+    printf("s UNKNOWN\n");
+    return EXIT_UNKNOWN;
+  }
+
+  printf("c %s has a %s of cost %d and length %zu.\n",graph_name,type,f->cost,f->length);
+  if (f->optimal)
+    printf("c The cost is optimal, the length may not be the shortest.\n");
+  else
+    printf("c The pebbling is built from a recurrence:\n"
+           "c cost and length are upper bounds, and may not be optimal.\n");
+  printf("s SATISFIABLE\n");
+  fprint_lifted(stdout,g,f->steps,f->length);
+  return EXIT_UNSATISFIABLE;
+}
+
+
+/*
+ *  Print the usage message on the standard error.
+ */
+static void usage(const char *argv0) {
+  fprintf(stderr,USAGEMESSAGE,argv0,argv0,argv0,CHECKPOINT_DEFAULT_INTERVAL,BEAM_DEFAULT_WIDTH,
+          EXTRAOPTIONSMESSAGE,BATCH_DEFAULT_DICT_SIZE,KTHFORMATMESSAGE);
+}
+
 
 /**
  *  The example test program creates two pyramid graphs and produces
@@ -112,6 +416,7 @@ int main(int argc, char *argv[])
   int pyramid_height=0;
   int tree_height=0;
   int chain_length=0;
+  char *graph_family=NULL;
   
   FILE *input_file=NULL;
   FILE *input_file_aux=NULL;
@@ -121,21 +426,83 @@ int main(int argc, char *argv[])
   char graph_name[100];
   
   int optimize_time=0;
+  int symbolic_search=0;
+  int beam_search=0;
+  int pareto_frontier=0;
+  int beam_seed=0;
+  int count_pebblings=0;
+  int reduce_graph=0;
+  int decompose_graph=0;
+  int always_search=0;
+  GraphFamily family=FAMILY_NONE;
+  int family_parameter=0;
+  FamilyPebbling *known=NULL;
+  DAGReduction *reduction=NULL;
+  DAGOrderStrategy order_strategy=ORDER_INPUT;
+  DAGOrder *order=NULL;
+  long beam_width=BEAM_DEFAULT_WIDTH;
+  long beam_time=0;
+  PebbleSearch *seeder=NULL;
+  PebbleSearch *answer=NULL;
   int persistent_pebbling=0;
   int option_code=0;
 
   unsigned int cost=0;
 
+  char *checkpoint_file=NULL;
+  char *resume_file=NULL;
+  long  checkpoint_interval=CHECKPOINT_DEFAULT_INTERVAL;
+  CheckpointHeader checkpoint_header;
+
+  long max_memory=0;
+  long long max_configurations=0;
+  long time_limit=0;
+
+  static struct option long_options[] = {
+    {"checkpoint",          required_argument, NULL, 'k'},
+    {"checkpoint-interval", required_argument, NULL, 'I'},
+    {"resume",              required_argument, NULL, 'R'},
+    {"max-memory",          required_argument, NULL, 'm'},
+    {"max-configurations",  required_argument, NULL, 'n'},
+    {"time-limit",          required_argument, NULL, 'T'},
+    {"beam-width",          required_argument, NULL, 'w'},
+    {"beam-time",           required_argument, NULL, 'a'},
+    {"beam-seed",           no_argument,       NULL, 'e'},
+    {"count",               no_argument,       NULL, 'N'},
+    {"reduce",              no_argument,       NULL, 'r'},
+    {"decompose",           no_argument,       NULL, 'd'},
+    {"always-search",       no_argument,       NULL, 'x'},
+    {"order",               required_argument, NULL, 'o'},
+    {NULL, 0, NULL, 0}
+  };
+
+  char *daemon_socket=NULL;
+  FILE *batch_file=NULL;
+  Boolean batch_manifest=FALSE;
+  Boolean usage_error=FALSE;
+  long batch_workers=0;
+  long dict_size=0;
 
-  /* PebbleConfiguration *solution=NULL; */
-  Pebbling *solution=NULL;
+  char *cache_dir=NULL;
+  ResultCache *cache=NULL;
+
+  PebblingVariant variant=VARIANT_BLACK;
+  VisitedSet visited=VISITED_DICT;
+  long bitstate_megabytes=0;
+
+  PebbleSearch *search=NULL;
+  SearchResult result=SEARCH_NOT_RUN;
+  const Pebbling *solution=NULL;
+
+  parse_variant(argv[0],&variant);
 
   /* Parse option to set Pyramid height,
      pebbling upper bound. */
-  while((option_code = getopt(argc,argv,"htZb:p:2:c:i:O:g:"))!=-1) {
+  while((option_code = getopt_long(argc,argv,"htZzSAPV:b:B:C:p:2:c:G:i:O:g:M:K:j:H:D:",
+                                   long_options,NULL))!=-1) {
     switch (option_code) {
     case 'h':
-      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      usage(argv[0]);
       exit(EXIT_SUCCESS);
       break;
     case 'Z':
@@ -144,30 +511,57 @@ int main(int argc, char *argv[])
     case 't':
       optimize_time=1;
       break;
+    case 'V':
+      if (parse_variant(optarg,&variant)==0) break;
+      usage_error=TRUE;
+      break;
+    case 'z':
+      visited=VISITED_ZDD;
+      break;
+    case 'S':
+      symbolic_search=1;
+      break;
+    case 'A':
+      beam_search=1;
+      break;
+    case 'P':
+      pareto_frontier=1;
+      break;
     case 'b':
       pebbling_bound=atoi(optarg);
       if (pebbling_bound>0) break;
-      fprintf(stderr,USAGEMESSAGE,argv[0]);
-      exit(EXIT_FAILURE);
+      usage_error=TRUE;
+      break;
+    case 'B':
+      bitstate_megabytes=atol(optarg);
+      if (bitstate_megabytes>0) {
+        visited=VISITED_BITSTATE;
+        break;
+      }
+      usage_error=TRUE;
+      break;
+    case 'C':
+      cache_dir=optarg;
       break;
     /* Input */
     case 'p':
       pyramid_height=atoi(optarg);
       if (pyramid_height>0) {input_directives++; break;}
-      fprintf(stderr,USAGEMESSAGE,argv[0]);
-      exit(EXIT_FAILURE);
+      usage_error=TRUE;
       break;
     case '2':
       tree_height=atoi(optarg);
       if (tree_height>0) {input_directives++; break;}
-      fprintf(stderr,USAGEMESSAGE,argv[0]);
-      exit(EXIT_FAILURE);
+      usage_error=TRUE;
       break;
     case 'c':
       chain_length=atoi(optarg);
       if (chain_length>0) {input_directives++; break;}
-      fprintf(stderr,USAGEMESSAGE,argv[0]);
-      exit(EXIT_FAILURE);
+      usage_error=TRUE;
+      break;
+    case 'G':
+      graph_family=optarg;
+      input_directives++;
       break;
     case 'i':
       input_file=openinputfile(optarg);
@@ -176,38 +570,215 @@ int main(int argc, char *argv[])
     case 'O':
       input_file_aux=openinputfile(optarg);
       if (input_file!=stdin || input_file_aux!=stdin) break;
-      fprintf(stderr,USAGEMESSAGE,argv[0]);
-      exit(EXIT_FAILURE);
+      usage_error=TRUE;
       break;
       /* Output format */
     case 'g':
       dot_path=optarg;
       break;
+      /* Batch mode */
+    case 'M':
+    case 'K':
+      batch_file=openinputfile(optarg);
+      batch_manifest=(option_code=='M');
+      input_directives++;
+      break;
+    case 'D':
+      daemon_socket=optarg;
+      break;
+      /* Checkpoints */
+    case 'k':
+      checkpoint_file=optarg;
+      break;
+    case 'I':
+      checkpoint_interval=atol(optarg);
+      if (checkpoint_interval>0) break;
+      usage_error=TRUE;
+      break;
+    case 'R':
+      resume_file=optarg;
+      break;
+      /* Beam search */
+    case 'w':
+      beam_width=atol(optarg);
+      if (beam_width>0) break;
+      usage_error=TRUE;
+      break;
+    case 'a':
+      beam_time=atol(optarg);
+      if (beam_time>0) break;
+      usage_error=TRUE;
+      break;
+    case 'e':
+      beam_seed=1;
+      break;
+    case 'r':
+      reduce_graph=1;
+      break;
+    case 'd':
+      decompose_graph=1;
+      break;
+    case 'x':
+      always_search=1;
+      break;
+    case 'o':
+      if (parse_DAGOrderStrategy(optarg,&order_strategy)) break;
+      usage_error=TRUE;
+      break;
+    case 'N':
+      count_pebblings=1;
+      break;
+      /* Resource limits */
+    case 'm':
+      max_memory=atol(optarg);
+      if (max_memory>0) break;
+      usage_error=TRUE;
+      break;
+    case 'n':
+      max_configurations=atoll(optarg);
+      if (max_configurations>0) break;
+      usage_error=TRUE;
+      break;
+    case 'T':
+      time_limit=atol(optarg);
+      if (time_limit>0) break;
+      usage_error=TRUE;
+      break;
+    case 'j':
+      batch_workers=atol(optarg);
+      if (batch_workers>0) break;
+      usage_error=TRUE;
+      break;
+    case 'H':
+      dict_size=atol(optarg);
+      if (dict_size>=16) break;
+      usage_error=TRUE;
+      break;
     case '?':
     default:
-      fprintf(stderr,USAGEMESSAGE,argv[0]);
-      exit(EXIT_FAILURE);
+      usage_error=TRUE;
     }
   }
 
-  /* Test for valid command line */
-  if (pebbling_bound==0) {
-      fprintf(stderr,USAGEMESSAGE,argv[0]);
+  /* Test for valid command line: the daemon reads the bounds and the
+     graphs from the queries, the other modes need a bound and at most
+     one input */
+  if (usage_error || (daemon_socket && input_directives > 0) ||
+      (!daemon_socket && (pebbling_bound==0 || input_directives > 1))) {
+    usage(argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  /* Daemon mode, the queries carry the bound */
+  if (daemon_socket) {
+    DaemonOptions daemon_options;
+    init_DaemonOptions(&daemon_options);
+    if (cache_dir && (cache=new_ResultCache(cache_dir))==NULL) {
+      fprintf(stderr, "c ERROR: unable to use the cache directory \"%s\"\n",cache_dir);
       exit(EXIT_FAILURE);
+    }
+    dispose_ResultCache(cache);
+    daemon_options.cache_dir = cache_dir;
+    daemon_options.dict_size = dict_size>0 ? (size_t)dict_size : BATCH_DEFAULT_DICT_SIZE;
+    daemon_options.workers   = batch_workers>0 ? (unsigned int)batch_workers
+                                                : (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+    exit(pebble_daemon(daemon_socket,&daemon_options)==0 ? EXIT_SUCCESS : EXIT_FAILURE);
   }
 
-  /* Only one input */
-  if (input_directives > 1) {
-    fprintf(stderr,USAGEMESSAGE,argv[0]);
+  /* Options which do not work together.  The beam search minimizes
+     the pebbles with no other engine; the frontier, the count and the
+     checkpoints are made by their own explicit search; the reduction,
+     the decomposition and the order are for a single graph, and their
+     pebblings are printed on the original graph only as text; the
+     decomposition is exact for black pebbling only. */
+  const char *conflict=NULL;
+  if (resume_file && checkpoint_file==NULL) checkpoint_file=resume_file;
+
+  if ((beam_search || beam_seed) && (optimize_time || symbolic_search || visited!=VISITED_DICT))
+    conflict="the beam search is not available with -t, -S, -z and -B";
+  else if (beam_search && beam_seed)
+    conflict="--beam-seed is for the exact search, not for -A";
+  else if (pareto_frontier && (optimize_time || symbolic_search || visited!=VISITED_DICT ||
+                               beam_search || beam_seed || batch_file || dot_path ||
+                               checkpoint_file))
+    conflict="-P is not available with -t, -S, -z, -B, -A, -g, "
+             "the batch mode, the beam search and the checkpoints";
+  else if (count_pebblings && (symbolic_search || visited==VISITED_BITSTATE || beam_search ||
+                               beam_seed || pareto_frontier || batch_file || checkpoint_file))
+    conflict="--count is not available with -S, -B, -A, -P, "
+             "the batch mode, the beam search and the checkpoints";
+  else if (reduce_graph && (batch_file || dot_path))
+    conflict="--reduce is not available with -g and the batch mode";
+  else if (decompose_graph && (variant!=VARIANT_BLACK || optimize_time || beam_search || beam_seed ||
+                               visited==VISITED_BITSTATE || pareto_frontier || count_pebblings ||
+                               batch_file || dot_path || checkpoint_file))
+    conflict="--decompose is for black pebbling, and not available with -t, -A, -B, -P, -g, "
+             "--count, the batch mode, the beam search and the checkpoints";
+  else if (order_strategy!=ORDER_INPUT && (batch_file || dot_path || decompose_graph))
+    conflict="--order is not available with -g, --decompose and the batch mode";
+  else if (checkpoint_file && (symbolic_search || beam_search || beam_seed || visited!=VISITED_DICT))
+    conflict="checkpoints are not available with -S, -z, -B and the beam search";
+
+  if (conflict) {
+    fprintf(stderr,"c ERROR: %s\n",conflict);
     exit(EXIT_FAILURE);
-  } 
+  }
+
   if (input_directives == 0) input_file = stdin;
 
+  if (cache_dir) {
+    cache=new_ResultCache(cache_dir);
+    if (cache==NULL) {
+      fprintf(stderr, "c ERROR: unable to use the cache directory \"%s\"\n",cache_dir);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  /* Batch mode */
+  if (batch_file) {
+    BatchOptions batch_options;
+    init_BatchOptions(&batch_options);
+    batch_options.variant    = variant;
+    batch_options.engine     = symbolic_search ? SEARCH_SYMBOLIC
+                             : beam_search     ? SEARCH_BEAM : SEARCH_EXPLICIT;
+    batch_options.beam_width = (unsigned int)beam_width;
+    batch_options.visited    = visited;
+    if (visited==VISITED_BITSTATE)
+      batch_options.bitstate_memory = (size_t)bitstate_megabytes << 20;
+    if (dict_size>0)
+      batch_options.dict_size = (size_t)dict_size;
+    batch_options.bound      = pebbling_bound;
+    batch_options.persistent = persistent_pebbling;
+    batch_options.shortest   = optimize_time;
+    batch_options.cache_dir  = cache_dir;
+    batch_options.workers    = batch_workers>0 ? (unsigned int)batch_workers
+                                               : (unsigned int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    dispose_ResultCache(cache);
+    size_t failures=batch_pebbling(batch_file,batch_manifest,&batch_options,stdout);
+    if (batch_file!=stdin) fclose(batch_file);
+    exit(failures ? EXIT_FAILURE : EXIT_SUCCESS);
+  }
+
+
+  /* Checkpoints */
+  if (resume_file) {
+    if (!peek_CheckpointHeader(resume_file,&checkpoint_header)) {
+      fprintf(stderr,"c ERROR: \"%s\" is not a valid checkpoint\n",resume_file);
+      exit(EXIT_FAILURE);
+    }
+    if (checkpoint_header.bound > (unsigned int)pebbling_bound) {
+      fprintf(stderr,"c ERROR: the checkpoint is for a search with %u pebbles\n",
+              checkpoint_header.bound);
+      exit(EXIT_FAILURE);
+    }
+  }
 
   /* Timer for reporting progress */
 #if PRINT_STATS_INTERVAL > 0
   install_timed_flags(PRINT_STATS_INTERVAL);
 #endif
+  if (checkpoint_file) install_checkpoint_flag((unsigned int)checkpoint_interval);
   
   /* Produce or read input graph */
   DAG *C=NULL;
@@ -215,20 +786,43 @@ int main(int argc, char *argv[])
   
     C=pyramid(pyramid_height);
     snprintf(graph_name, 100, "Pyramid of height %d",pyramid_height);
+    family=FAMILY_PYRAMID;
+    family_parameter=pyramid_height;
   
   } else if (tree_height>0) {
     
     C=tree(tree_height);
     snprintf(graph_name, 100, "Tree of height %d",tree_height);
+    family=FAMILY_TREE;
+    family_parameter=tree_height;
   
   } else if (chain_length>0) {
     
     C=path(chain_length);
     snprintf(graph_name, 100, "Chain of height %d",chain_length);
+    family=FAMILY_PATH;
+    family_parameter=chain_length;
+
+  } else if (graph_family) {
+
+    C=generate_DAG(graph_family);
+    if (C==NULL) {
+      fprintf(stderr, "c ERROR: unknown graph family \"%s\"\n",graph_family);
+      exit(EXIT_FAILURE);
+    }
+    if (C->sink_number>1 && !reduce_graph) {
+      fprintf(stderr, "c ERROR: the graph \"%s\" has %zu sinks, and the search needs one: "
+              "use -G %s+sink to add a vertex after all of them\n",
+              graph_family,C->sink_number,graph_family);
+      exit(EXIT_FAILURE);
+    }
+    snprintf(graph_name, 100, "Graph %s",graph_family);
+    family=parse_GraphFamily(graph_family,&family_parameter);
 
   } else {
     C=kthparser(input_file);
     fclose(input_file);
+    if (C==NULL) exit(EXIT_FAILURE);
     snprintf(graph_name, 100, "Input graph");
   }
 
@@ -236,10 +830,22 @@ int main(int argc, char *argv[])
   if (input_file_aux) {
     DAG *OUTER=C;
     DAG *INNER=kthparser(input_file_aux);
+    fclose(input_file_aux);
+    if (INNER==NULL) exit(EXIT_FAILURE);
+    /* The search works on at most BITTUPLE_SIZE vertices, and a larger
+       product is built only when the reduction may shrink it */
+    ProductDAG *product=new_ProductDAG(OUTER,INNER);
+    if (product->size > BITTUPLE_SIZE && !reduce_graph) {
+      fprintf(stderr,"c ERROR: the OR product has %zu vertices, "
+              "the search works on graphs of at most %zu vertices\n",
+              product->size,(size_t)BITTUPLE_SIZE);
+      exit(EXIT_FAILURE);
+    }
+    dispose_ProductDAG(product);
     C = orproduct(OUTER,INNER);
+    family=FAMILY_NONE;
     dispose_DAG(OUTER);
     dispose_DAG(INNER);
-    fclose(input_file_aux);
     snprintf(graph_name, 100, "OR product graph");
   }
 
@@ -248,37 +854,280 @@ int main(int argc, char *argv[])
   printf("c c %s\n",graph_name);
   fprint_DAG(stdout,C,"c ");
   printf("c =====input ends=======\n");
-  
-  /* Search space interval*/
-  cost= optimize_time ? pebbling_bound : 1;
+
+  /* The search runs on the reduced graph.  The contraction of the
+     chains keeps the cost of black pebbling only, and changes the
+     length of the pebblings, so it is skipped when the length
+     matters. */
+  DAG *S=C;
+  if (reduce_graph) {
+    reduction=reduce_DAG(C,variant==VARIANT_BLACK &&
+                         !optimize_time && !pareto_frontier && !count_pebblings);
+    S=reduction->dag;
+    print_reduction(reduction,variant);
+  }
+
+  /* The search runs on the graph relabelled in the topological order,
+     if the search can run on it at all */
+  if (order_strategy!=ORDER_INPUT && S->size<=BITTUPLE_SIZE) {
+    order=order_DAG(S,order_strategy);
+    print_order(order);
+    S=order->dag;
+  }
+
+  /* Search context */
+  search=new_PebbleSearch(S);
+  setoption_PebbleSearch(search,OPTION_VARIANT,variant);
+  if (dict_size>0) setoption_PebbleSearch(search,OPTION_DICT_SIZE,dict_size);
+  setoption_PebbleSearch(search,OPTION_PERSISTENT,persistent_pebbling);
+  setoption_PebbleSearch(search,OPTION_ENGINE,symbolic_search ? SEARCH_SYMBOLIC
+                                              : beam_search     ? SEARCH_BEAM : SEARCH_EXPLICIT);
+  setoption_PebbleSearch(search,OPTION_BEAM_WIDTH,beam_width);
+  setoption_PebbleSearch(search,OPTION_VISITED,visited);
+  setoption_PebbleSearch(search,OPTION_COUNT,count_pebblings);
+  setcache_PebbleSearch(search,cache);
+  setcheckpoint_PebbleSearch(search,checkpoint_file,&checkpoint_flag,resume_file);
+  if (visited==VISITED_BITSTATE)
+    setoption_PebbleSearch(search,OPTION_BITSTATE_MEMORY,bitstate_megabytes << 20);
+  setoption_PebbleSearch(search,OPTION_MAX_MEMORY,max_memory << 20);
+  setoption_PebbleSearch(search,OPTION_MAX_CONFIGURATIONS,(long)max_configurations);
+  setoption_PebbleSearch(search,OPTION_TIME_LIMIT,time_limit);   /* For all the bounds */
+  if (beam_search && beam_time>0 && (time_limit==0 || beam_time<time_limit))
+    setoption_PebbleSearch(search,OPTION_TIME_LIMIT,beam_time);
+#if PRINT_STATS_INTERVAL > 0
+  setreport_PebbleSearch(search,stderr,&print_running_stats_flag,PRINT_STATS_INTERVAL);
+#else
+  setreport_PebbleSearch(search,stderr,NULL,0);
+#endif
+
+  /* Pareto frontier of cost and length, in a single search */
+  if (pareto_frontier) {
+    setoption_PebbleSearch(search,OPTION_BOUND,pebbling_bound);
+    result=frontier_PebbleSearch(search);
+    if (result==SEARCH_ERROR) {
+      fprintf(stderr,"Error in search procedure: %s.\n",error_PebbleSearch(search));
+      exit(EXIT_FAILURE);
+    }
+    int exit_code=print_frontier(search,order,reduction,graph_name,(unsigned int)pebbling_bound);
+    dispose_PebbleSearch(search);
+    dispose_DAGOrder(order);
+    dispose_DAGReduction(reduction);
+    dispose_ResultCache(cache);
+    dispose_DAG(C);
+    exit(exit_code);
+  }
+
+  /* The pebblings of paths, trees and pyramids are built without
+     search.  The black ones are optimal, the reversible ones are just
+     upper bounds from the recurrences in families.c.  When the graph
+     is small enough their cost only bounds the search, whose pebbling
+     is printed, as it may be shorter. */
+  if (family!=FAMILY_NONE && !always_search && !optimize_time && !beam_search && !beam_seed &&
+      !count_pebblings && !decompose_graph && !dot_path && !checkpoint_file)
+    known=new_FamilyPebbling(family,family_parameter,variant,persistent_pebbling);
+
+  if (known && (known->optimal || C->size > BITTUPLE_SIZE)) {
+    int exit_code=print_family(known,type_PebbleSearch(search),C,graph_name,
+                               (unsigned int)pebbling_bound);
+    dispose_FamilyPebbling(known);
+    dispose_PebbleSearch(search);
+    dispose_DAGOrder(order);
+    dispose_DAGReduction(reduction);
+    dispose_ResultCache(cache);
+    dispose_DAG(C);
+    exit(exit_code);
+  }
+  if (known && known->cost <= pebbling_bound) {
+    pebbling_bound=known->cost;
+    printf("c Recurrence: %s of cost %d, the search does not go beyond it\n",
+           type_PebbleSearch(search),known->cost);
+  } else if (known) {
+    dispose_FamilyPebbling(known);
+    known=NULL;
+  }
+
+  /* Series decomposition, one search per part */
+  if (decompose_graph) {
+    Decomposition *decomposition=new_Decomposition(S);
+    setoption_PebbleSearch(search,OPTION_BOUND,pebbling_bound);
+    result=run_Decomposition(decomposition,search);
+    if (result==SEARCH_ERROR) {
+      fprintf(stderr,"Error in search procedure: %s.\n",error_PebbleSearch(search));
+      exit(EXIT_FAILURE);
+    }
+    int exit_code=print_decomposition(decomposition,search,reduction,graph_name,
+                                      (unsigned int)pebbling_bound);
+    dispose_Decomposition(decomposition);
+    dispose_PebbleSearch(search);
+    dispose_DAGOrder(order);
+    dispose_DAGReduction(reduction);
+    dispose_ResultCache(cache);
+    dispose_DAG(C);
+    exit(exit_code);
+  }
+
+  /* Search space interval, the smaller bounds of a resumed search
+     have been already ruled out */
+  cost= (optimize_time || beam_search) ? pebbling_bound : 1;
+  if (resume_file) {
+    cost=checkpoint_header.bound;
+    printf("c Resuming the search with %u pebbles from %s\n",cost,resume_file);
+  }
+
+  /* The pebbling of the beam search is an upper bound, and the exact
+     search has to look only below it */
+  if (beam_seed) {
+    seeder=new_PebbleSearch(S);
+    setoption_PebbleSearch(seeder,OPTION_VARIANT,variant);
+    setoption_PebbleSearch(seeder,OPTION_PERSISTENT,persistent_pebbling);
+    setoption_PebbleSearch(seeder,OPTION_ENGINE,SEARCH_BEAM);
+    setoption_PebbleSearch(seeder,OPTION_BEAM_WIDTH,beam_width);
+    setoption_PebbleSearch(seeder,OPTION_BOUND,pebbling_bound);
+    setoption_PebbleSearch(seeder,OPTION_MAX_MEMORY,max_memory << 20);
+    setoption_PebbleSearch(seeder,OPTION_TIME_LIMIT,
+                           (beam_time>0 && (time_limit==0 || beam_time<time_limit)) ? beam_time : time_limit);
+    setreport_PebbleSearch(seeder,stderr,NULL,0);
+    if (run_PebbleSearch(seeder)==SEARCH_FOUND) {
+      pebbling_bound=pebbling_PebbleSearch(seeder)->cost-1;
+      printf("c Beam search: %s of cost %d, the exact search looks for a cheaper one\n",
+             type_PebbleSearch(seeder),pebbling_PebbleSearch(seeder)->cost);
+    } else {
+      printf("c Beam search: no %s of cost %d found\n",type_PebbleSearch(seeder),pebbling_bound);
+    }
+  }
 
   while ( (cost <= pebbling_bound) && !solution ) {
-    solution=bfs_pebbling_strategy(C,cost,persistent_pebbling);
-    if (!solution) printf("c There is no %s of cost %d\n",pebbling_type(),cost);    
+    setoption_PebbleSearch(search,OPTION_BOUND,cost);
+    result=run_PebbleSearch(search);
+    if (result==SEARCH_ERROR) {
+      fprintf(stderr,"Error in search procedure: %s.\n",error_PebbleSearch(search));
+      exit(EXIT_FAILURE);
+    }
+    solution=pebbling_PebbleSearch(search);
+    if (limit_PebbleSearch(search)) break;  /* The larger bounds would not fit either */
+    if (beam_search) {
+      if (!solution) printf("c No %s of cost %d found by the beam search (not a proof)\n",
+                            type_PebbleSearch(search),cost);
+    } else if (search->options.approximate) {
+      printf("c Bitstate search at cost %d: omission probability per state %.3g, "
+             "expected omitted states %.3g\n",
+             cost,
+             search->options.omission_probability,
+             search->options.expected_omissions);
+      if (!solution) printf("c No %s of cost %d found (not a proof)\n",type_PebbleSearch(search),cost);
+    } else {
+      if (!solution) printf("c There is no %s of cost %d\n",type_PebbleSearch(search),cost);
+    }
     cost++;
   }
 
+  /* No cheaper pebbling than the one of the beam search */
+  answer=search;
+  if (!solution && seeder && pebbling_PebbleSearch(seeder)) {
+    answer=seeder;
+    solution=pebbling_PebbleSearch(seeder);
+    if (result==SEARCH_UNKNOWN)
+      printf("c The exact search stopped: the pebbling of the beam search may not be optimal.\n");
+    else
+      printf("c The pebbling of the beam search is optimal.\n");
+    result=SEARCH_FOUND;
+  }
+
+  /* The search stopped, or missed the pebbling of the recurrence */
+  if (!solution && known) {
+    if (result==SEARCH_UNKNOWN)
+      printf("c The search stopped: the pebbling of the recurrence may not be optimal.\n");
+    else
+      printf("c The search found nothing: the pebbling of the recurrence may not be optimal.\n");
+    known->optimal=FALSE;
+    int exit_code=print_family(known,type_PebbleSearch(search),C,graph_name,
+                               (unsigned int)known->cost);
+    dispose_FamilyPebbling(known);
+    dispose_PebbleSearch(search);
+    dispose_ResultCache(cache);
+    dispose_DAGOrder(order);
+    dispose_DAGReduction(reduction);
+    dispose_DAG(C);
+    exit(exit_code);
+  }
+  dispose_FamilyPebbling(known);
+
   /* Output solution */
   if (solution) {
 
+    size_t  length;
+    Vertex *lifted=lift_pebbling(order,reduction,solution->steps,solution->length,&length);
+
     printf("c %s has a %s of cost %u and length %u.\n",
-           graph_name,pebbling_type(),solution->cost,(unsigned int)solution->length);
+           graph_name,type_PebbleSearch(answer),solution->cost,(unsigned int)length);
+    if (count_pebblings) {
+      const PebblingCount *count=count_PebbleSearch(search);
+      if (count->residue==0 && !count->overflow)
+        printf("c Count of the shortest %ss stopped: %s limit exceeded.\n",
+               type_PebbleSearch(search),limit_PebbleSearch(search));
+      else if (count->overflow)
+        printf("c Shortest %ss of cost at most %d: about %.6g (%llu modulo 2^64).\n",
+               type_PebbleSearch(search),cost-1,count->estimate,count->residue);
+      else
+        printf("c Shortest %ss of cost at most %d: %llu.\n",
+               type_PebbleSearch(search),cost-1,count->residue);
+    }
+    if (beam_search) {
+      printf("c The pebbling has been found by a heuristic beam search:\n"
+             "c cost and length are upper bounds, and may not be optimal.\n");
+    } else if (answer==search && search->options.approximate) {
+      printf("c The pebbling has been validated, but found by an approximate search:\n"
+             "c cost and length are upper bounds, and may not be optimal.\n");
+    }
+    if (reduction && reduction->contracted>0) {
+      printf("c The pebbling is lifted from the reduced graph:\n"
+             "c the cost is optimal, the length may not be the shortest.\n");
+    }
     printf("s SATISFIABLE\n");
-    fprint_text_Pebbling(stdout,C,solution);
+    if (lifted) {
+      fprint_lifted(stdout,C,lifted,length);
+      free(lifted);
+    } else {
+      fprint_text_PebbleSearch(stdout,answer);
+    }
 
     if (dot_path!=NULL) {
 
         if (mkdir(dot_path,S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH)==0) {
-          fprint_dot_Pebbling(dot_path, C, solution);
+          if (!fprint_dot_PebbleSearch(dot_path, answer))
+            fprintf(stderr,"Can't write the dot files.");
         } else {
           fprintf(stderr,"Can't make the output directory for the dot files.");          
         }
     }
     
+  } else if (result==SEARCH_UNKNOWN && beam_search) {
+
+    printf("c No %s of cost %u found for %s by beam search: this is not a proof.\n",
+           type_PebbleSearch(search),pebbling_bound,graph_name);
+    printf("s UNKNOWN\n");
+
+  } else if (result==SEARCH_UNKNOWN && limit_PebbleSearch(search)) {
+
+    printf("c Search stopped at cost %u: %s limit exceeded; "
+           "deepest level fully explored: %ld\n",
+           cost,limit_PebbleSearch(search),depth_PebbleSearch(search));
+    printf("c No %s of cost %u found for %s: this is not a proof.\n",
+           type_PebbleSearch(search),cost,graph_name);
+    printf("s UNKNOWN\n");
+
+  } else if (result==SEARCH_UNKNOWN) {
+
+    printf("c No %s of cost %u found for %s by bitstate search: this is not a proof.\n",
+           type_PebbleSearch(search),pebbling_bound,graph_name);
+    printf("c Expected number of configurations wrongly considered visited: %.3g\n",
+           search->options.expected_omissions);
+    printf("s UNKNOWN\n");
+
   } else {
     
     printf("c %s does not have a %s of cost %u.\n",
-           graph_name,pebbling_type(),pebbling_bound);
+           graph_name,type_PebbleSearch(search),pebbling_bound);
     printf("s UNSATISFIABLE\n");
   }
 
@@ -286,14 +1135,25 @@ int main(int argc, char *argv[])
 
   int exit_code=EXIT_SUCCESS;
   
-  dispose_DAG(C);
-
   if (solution) {
-    dispose_Pebbling(solution);
     exit_code=EXIT_UNSATISFIABLE;
+  } else if (result==SEARCH_UNKNOWN) {
+    exit_code=EXIT_UNKNOWN;
   } else {
     exit_code=EXIT_SATISFIABLE;
   }
 
+  if (cache) {
+    fprintf(stderr,"c Result cache: %llu hits, %llu misses, %llu stored\n",
+            cache->hits,cache->misses,cache->stores);
+  }
+
+  dispose_PebbleSearch(search);
+  dispose_PebbleSearch(seeder);
+  dispose_ResultCache(cache);
+  dispose_DAGOrder(order);
+  dispose_DAGReduction(reduction);
+  dispose_DAG(C);
+
   exit(exit_code);
 }
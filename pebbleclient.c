@@ -0,0 +1,163 @@
+/*
+   Description::
+
+   Client of the pebbling daemon: send a graph and a query to the
+   daemon, and print its answer.
+
+*/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "common.h"
+
+
+#define USAGEMESSAGE "\n\
+Usage: %s -s <socket> [-tZS] [-V <variant>] -b<int> [-i <input>]\n\
+       %s -s <socket> -x\n\
+\n\
+       -h     help message;\n\
+       -s <socket> Unix socket of the daemon (started with pebble -D <socket>);\n\
+       -V <variant> pebbling game: black (default), bw (black/white) or rev (reversible).\n\
+       -Z     search for a 'persistent pebbling';\n\
+       -t     find shortest pebbling within space limits, instead of minimizing space;\n\
+       -S     symbolic search;\n\
+       -b M   maximum number of pebbles;\n\
+       -i <input>   input file in KTH format (default: standard input);\n\
+       -x     stop the daemon.\n\
+\n\
+The answer of the daemon is printed on standard output, and the exit\n\
+code is the same as pebble.\n"
+
+
+static void sendall(int fd,const char *data,size_t length) {
+
+  while (length>0) {
+    ssize_t w=write(fd,data,length);
+    if (w<0 && errno==EINTR) continue;
+    if (w<=0) {
+      perror("c ERROR: unable to send the request");
+      exit(EXIT_FAILURE);
+    }
+    data   += w;
+    length -= (size_t)w;
+  }
+}
+
+
+int main(int argc, char *argv[])
+{
+  char *socket_path=NULL;
+  const char *variant="black";
+  int   bound=0;
+  char  flags[4]="";
+  char  flag;
+  int   stop=0;
+  FILE *input=stdin;
+  int   option_code;
+
+  while((option_code = getopt(argc,argv,"hs:V:tZSb:i:x"))!=-1) {
+    switch (option_code) {
+    case 's':
+      socket_path=optarg;
+      break;
+    case 'V':
+      if (strcmp(optarg,"black")==0 || strcmp(optarg,"bw")==0 || strcmp(optarg,"rev")==0) {
+        variant=optarg;
+        break;
+      }
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    case 't':
+    case 'Z':
+    case 'S':
+      flag=(char)option_code;
+      if (!strchr(flags,flag)) strncat(flags,&flag,1);
+      break;
+    case 'b':
+      bound=atoi(optarg);
+      if (bound>0) break;
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    case 'i':
+      if (strcmp(optarg,"-")==0) break;
+      input=fopen(optarg,"r");
+      if (input) break;
+      fprintf(stderr, "c ERROR: unable to open input file \"%s\"\n",optarg);
+      exit(EXIT_FAILURE);
+      break;
+    case 'x':
+      stop=1;
+      break;
+    case 'h':
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0]);
+      exit(EXIT_SUCCESS);
+      break;
+    case '?':
+    default:
+      fprintf(stderr,USAGEMESSAGE,argv[0],argv[0]);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (socket_path==NULL || (!stop && bound==0)) {
+    fprintf(stderr,USAGEMESSAGE,argv[0],argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+  struct sockaddr_un address;
+  if (strlen(socket_path) >= sizeof(address.sun_path)) {
+    fprintf(stderr,"c ERROR: socket path \"%s\" too long\n",socket_path);
+    exit(EXIT_FAILURE);
+  }
+  memset(&address,0,sizeof(address));
+  address.sun_family=AF_UNIX;
+  strcpy(address.sun_path,socket_path);
+
+  int fd=socket(AF_UNIX,SOCK_STREAM,0);
+  if (fd<0 || connect(fd,(struct sockaddr*)&address,sizeof(address))!=0) {
+    fprintf(stderr,"c ERROR: unable to connect to the daemon on \"%s\"\n",socket_path);
+    exit(EXIT_FAILURE);
+  }
+
+  /* Request */
+  char buffer[65536];
+  if (stop) {
+    sendall(fd,"x\n",2);
+  } else {
+    int len=snprintf(buffer,sizeof(buffer),"q %s %d %s\n",variant,bound,flags[0] ? flags : "-");
+    sendall(fd,buffer,(size_t)len);
+    size_t r;
+    while ((r=fread(buffer,1,sizeof(buffer),input))>0) sendall(fd,buffer,r);
+    if (input!=stdin) fclose(input);
+  }
+  shutdown(fd,SHUT_WR);
+
+  /* Answer */
+  int exit_code=EXIT_FAILURE;
+  FILE *answer=fdopen(fd,"r");
+  if (answer==NULL) {
+    perror("c ERROR: unable to read the answer");
+    exit(EXIT_FAILURE);
+  }
+  while (fgets(buffer,sizeof(buffer),answer)) {
+    fputs(buffer,stdout);
+    if (strcmp(buffer,"s SATISFIABLE\n")==0)   exit_code=EXIT_UNSATISFIABLE;
+    if (strcmp(buffer,"s UNSATISFIABLE\n")==0) exit_code=EXIT_SATISFIABLE;
+    if (strcmp(buffer,"c daemon stopping\n")==0) exit_code=EXIT_SUCCESS;
+  }
+  fclose(answer);
+
+  exit(exit_code);
+}
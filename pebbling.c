@@ -28,8 +28,7 @@ FILE *openstepfile(const char* filename) {
   
   f = fopen(filename,"w");
   if (f==NULL) {
-    fprintf(stderr, "c ERROR: unable to open output file \"%s\"",filename);
-    exit(EXIT_FAILURE);
+    fprintf(stderr, "c ERROR: unable to open output file \"%s\"\n",filename);
     }
   return f;
 }
@@ -124,8 +123,10 @@ PebbleConfiguration *new_PebbleConfiguration(void) {
   ptr->black_pebbled=0;
 
   ptr->used_pebbles = 0;
+  ptr->active_vertices = 0;     /* see reset_active_PebbleConfiguration */
   
   ptr->sink_touched =FALSE;
+  ptr->references   =0;
 
   ptr->pebbles=0;
 
@@ -157,8 +158,10 @@ PebbleConfiguration *copy_PebbleConfiguration(const PebbleConfiguration *src) {
   dst->black_pebbled=src->black_pebbled;
 
   dst->used_pebbles = src->used_pebbles;
+  dst->active_vertices = src->active_vertices;
   
   dst->sink_touched=src->sink_touched;
+  dst->references  =0;
 
   dst->pebbles=src->pebbles;
 
@@ -239,10 +242,67 @@ if (ptr->white_pebbled & (BITTUPLE_UNIT << graph->sinks[0])) {
       return FALSE;
   }
 
+  /* The mask of active vertices must be up to date */
+  BitTuple pebbled = ptr->black_pebbled;
+#if BLACK_WHITE_PEBBLING
+  pebbled |= ptr->white_pebbled;
+#endif
+  for(Vertex v=0; v<graph->size; v++) {
+    if (GETBIT(ptr->active_vertices,v) !=
+        ((pebbled & graph->pred_bitmasks[v]) == graph->pred_bitmasks[v]))
+      return FALSE;
+  }
+  if (BITTUPLE_SIZE > graph->size &&
+      (ptr->active_vertices & ~((BITTUPLE_UNIT << graph->size) -1)))
+    return FALSE;
+
   return TRUE;
 }
 
 
+/* Compute from scratch the mask of active vertices.  It must be
+   called on configurations which are not obtained by moves, before
+   any other operation. */
+void reset_active_PebbleConfiguration(const DAG *graph,PebbleConfiguration *ptr) {
+
+  assert(isconsistent_DAG(graph));
+  assert(ptr);
+
+  BitTuple pebbled = ptr->black_pebbled;
+#if BLACK_WHITE_PEBBLING
+  pebbled |= ptr->white_pebbled;
+#endif
+  ptr->active_vertices = 0;
+  for(Vertex v=0; v<graph->size; v++) {
+    if ((pebbled & graph->pred_bitmasks[v]) == graph->pred_bitmasks[v])
+      SETBIT(ptr->active_vertices,v);
+  }
+}
+
+
+/* A move on v changes only the status of the successors of v.  When
+   a pebble is removed they all become inactive, when it is placed we
+   check them one by one. */
+static inline void update_active(const Vertex v,const DAG *g,PebbleConfiguration *const c) {
+
+  BitTuple succ = g->succ_bitmasks[v];
+  BitTuple pebbled = c->black_pebbled;
+#if BLACK_WHITE_PEBBLING
+  pebbled |= c->white_pebbled;
+#endif
+
+  if (!GETBIT(pebbled,v)) {
+    c->active_vertices &= ~succ;
+    return;
+  }
+  for(; succ; succ &= succ-1) {
+    Vertex w = LOWESTBIT(succ);
+    if ((pebbled & g->pred_bitmasks[w]) == g->pred_bitmasks[w])
+      SETBIT(c->active_vertices,w);
+  }
+}
+
+
 inline int configurationcost(const DAG *g,const PebbleConfiguration *c) {
 
   assert(isconsistent_DAG(g));
@@ -264,6 +324,50 @@ inline int configurationcost(const DAG *g,const PebbleConfiguration *c) {
 }
 
 
+/* A black (or reversible) configuration is packed in a single word
+   when there is a spare bit for the sink status, otherwise the sink
+   status goes in the second word.
+
+   A black-white configuration always needs two words, one for each
+   color.  No vertex can have both a black and a white pebble, so we
+   use both bits on the sink to represent an empty sink which has been
+   touched.
+*/
+unsigned int packedwidth_PebbleConfiguration(const DAG *g) {
+
+  assert(isconsistent_DAG(g));
+
+#if BLACK_WHITE_PEBBLING
+  return 2;
+#else
+  return (g->size < BITTUPLE_SIZE) ? 1 : 2;
+#endif
+}
+
+void pack_PebbleConfiguration(const DAG *g,const PebbleConfiguration *c,BitTuple *key) {
+
+  assert(isconsistent_DAG(g));
+  assert(isconsistent_PebbleConfiguration(g,c));
+  assert(key);
+
+#if BLACK_WHITE_PEBBLING
+  key[0] = c->black_pebbled;
+  key[1] = c->white_pebbled;
+  if (c->sink_touched && !ispebbled(g->sinks[0],g,c)) {
+    SETBIT(key[0],g->sinks[0]);
+    SETBIT(key[1],g->sinks[0]);
+  }
+#else
+  key[0] = c->black_pebbled;
+  if (g->size < BITTUPLE_SIZE) {
+    if (c->sink_touched) SETBIT(key[0],g->size);
+  } else {
+    key[1] = c->sink_touched ? BITTUPLE_UNIT : BITTUPLE_ZERO;
+  }
+#endif
+}
+
+
 /* ------------------------------ Manipulation of pebble status -----------------------------*/
 
 inline void deleteblack(const Vertex v,const DAG *g,PebbleConfiguration *const c) {
@@ -282,6 +386,7 @@ inline void deleteblack(const Vertex v,const DAG *g,PebbleConfiguration *const c
 #if REVERSIBLE_PEBBLING
   c->used_pebbles |= g->pred_bitmasks[v];
 #endif
+  update_active(v,g,c);
 }
 
 /* Determines if a vertex is black pebbled according to a specific
@@ -311,6 +416,7 @@ inline void placeblack(const Vertex v,const DAG *g,PebbleConfiguration *const c)
     c->sink_touched = TRUE;
     SETBIT(c->used_pebbles,v);
   }
+  update_active(v,g,c);
 }
 
 
@@ -328,6 +434,7 @@ inline void deletewhite(const Vertex v,const DAG *g,PebbleConfiguration *const c
   RESETBIT(c->used_pebbles,v);
   c->pebbles       -= 1;
   c->used_pebbles |= g->pred_bitmasks[v];
+  update_active(v,g,c);
 }
 
 
@@ -356,6 +463,7 @@ inline void placewhite(const Vertex v,const DAG *g,PebbleConfiguration *const c)
     c->sink_touched=TRUE;
     SETBIT(c->used_pebbles,v);
   }
+  update_active(v,g,c);
 }
 
 #endif /* BLACK_WHITE_PEBBLING */
@@ -386,13 +494,7 @@ inline Boolean isactive(const Vertex v,const DAG *g,const PebbleConfiguration *c
   assert(isconsistent_PebbleConfiguration(g,c));
   assert(v<g->size);
 
-#if BLACK_WHITE_PEBBLING
-  return (((c->white_pebbled | c->black_pebbled) & g->pred_bitmasks[v])
-          == g->pred_bitmasks[v])?TRUE:FALSE;
-#else
-  return ((c->black_pebbled & g->pred_bitmasks[v])
-          == g->pred_bitmasks[v])?TRUE:FALSE;
-#endif
+  return GETBIT(c->active_vertices,v);
 }
 
 
@@ -427,6 +529,7 @@ void    init_persistent_pebbling(const DAG *g, PebbleConfiguration *const c) {
   c->pebbles       += 1;
   c->sink_touched = TRUE;
   SETBIT(c->used_pebbles,g->sinks[0]);
+  update_active(g->sinks[0],g,c);
 }
 
 
@@ -502,8 +605,9 @@ void fprint_dot_PebbleConfiguration(FILE *outfile,const DAG *g, const PebbleConf
 }
 
 
-/* Print a pebbling, using dot tool */
-void fprint_dot_Pebbling(char *dot_path,const DAG *g, const Pebbling *ptr) {
+/* Print a pebbling, using dot tool. Return FALSE if some file could
+   not be written. */
+Boolean fprint_dot_Pebbling(char *dot_path,const DAG *g, const Pebbling *ptr) {
 
   PebbleConfiguration conf;
   int step=0;
@@ -511,6 +615,7 @@ void fprint_dot_Pebbling(char *dot_path,const DAG *g, const Pebbling *ptr) {
   FILE *F=NULL;
     
   conf.sink_touched=FALSE;
+  conf.references=0;
 
 #if BLACK_WHITE_PEBBLING
   conf.white_pebbled = 0;
@@ -521,9 +626,11 @@ void fprint_dot_Pebbling(char *dot_path,const DAG *g, const Pebbling *ptr) {
   conf.pebbles = 0;
   conf.previous_configuration = NULL;
   conf.last_changed_vertex = 0;
+  reset_active_PebbleConfiguration(g,&conf);
 
   snprintf(filenamebuffer,100,"%s/%05d.dot",dot_path,step);
   F = openstepfile(filenamebuffer);
+  if (F==NULL) return FALSE;
   fprint_dot_PebbleConfiguration(F,g,&conf,"X",NULL);
   fclose(F);
 
@@ -534,7 +641,7 @@ void fprint_dot_Pebbling(char *dot_path,const DAG *g, const Pebbling *ptr) {
     step++;
     snprintf(filenamebuffer,100,"%s/%05d.dot",dot_path,step);
     F = openstepfile(filenamebuffer);
-  
+    if (F==NULL) return FALSE;
 
     /* The logical sequence of tests ensure correctness of the moves,
        assuming the pebbling is legal */
@@ -570,14 +677,86 @@ void fprint_dot_Pebbling(char *dot_path,const DAG *g, const Pebbling *ptr) {
     fclose(F);
 #endif
   }
+  return TRUE;
 }
 
+/**
+ * Replay a pebbling from the empty configuration, and check that
+ * all moves are legal, that the final configuration is correct and
+ * that the cost is the one declared.
+ *
+ * @param g the graph
+ * @param ptr the pebbling to be checked
+ * @param persistent whether the pebbling must leave only a black
+ * pebble on the sink.
+ *
+ * @return TRUE if the pebbling is valid.
+ */
+Boolean isvalid_Pebbling(const DAG *g,const Pebbling *ptr,Boolean persistent) {
+
+  assert(isconsistent_DAG(g));
+  assert(ptr);
+
+  PebbleConfiguration *conf=new_PebbleConfiguration();
+  Boolean valid=TRUE;
+  reset_active_PebbleConfiguration(g,conf);
+  int cost=0;
+  Vertex v;
+
+  for (size_t i=0; valid && i < ptr->length; ++i) {
+    v=ptr->steps[i];
+
+    if (v >= g->size) { valid=FALSE; continue; }
+
+    /* Deletions */
+    if (isblack(v,g,conf)) {
+#if REVERSIBLE_PEBBLING
+      if (!isactive(v,g,conf)) { valid=FALSE; continue; }
+#endif
+      deleteblack(v,g,conf);
+    }
+#if BLACK_WHITE_PEBBLING
+    else if (iswhite(v,g,conf)) {
+      if (!isactive(v,g,conf)) { valid=FALSE; continue; }
+      deletewhite(v,g,conf);
+    }
+#endif
+    /* Placements */
+    else if (isactive(v,g,conf)) {
+      placeblack(v,g,conf);
+    }
+#if BLACK_WHITE_PEBBLING
+    else {
+      placewhite(v,g,conf);
+    }
+#else
+    else { valid=FALSE; continue; }
+#endif
+
+    cost = MAX(cost,(int)conf->pebbles);
+  }
+
+  if (!conf->sink_touched) valid=FALSE;
+#if BLACK_WHITE_PEBBLING
+  if (conf->white_pebbled) valid=FALSE;
+#endif
+  if (persistent) {
+    if (conf->pebbles!=1 || !isblack(g->sinks[0],g,conf)) valid=FALSE;
+  }
+  if (cost!=ptr->cost) valid=FALSE;
+
+  dispose_PebbleConfiguration(conf);
+  return valid;
+}
+
+
 /* Print a pebbling, using dot tool */
 void fprint_text_Pebbling(FILE *outfile,const DAG *g, const Pebbling *ptr) {
 
   PebbleConfiguration conf;
   
   conf.sink_touched=FALSE;
+  conf.references=0;
 #if BLACK_WHITE_PEBBLING
   conf.white_pebbled = 0;
 #endif
@@ -586,6 +765,7 @@ void fprint_text_Pebbling(FILE *outfile,const DAG *g, const Pebbling *ptr) {
   conf.pebbles = 0;
   conf.previous_configuration = NULL;
   conf.last_changed_vertex = 0;
+  reset_active_PebbleConfiguration(g,&conf);
 
   Vertex v;
   fprintf(outfile,"v");
@@ -716,15 +896,51 @@ static inline Boolean delete_black_heuristics_cut(const Vertex v,const DAG *g,co
 
 
 
+/* Removals need an active vertex only for white pebbles, and for
+   black pebbles in reversible pebbling.  Placements need a free
+   pebble, and an active vertex unless the pebble is white. */
+BitTuple enabled_PebbleConfiguration(const DAG *g,
+                                     const PebbleConfiguration *c,
+                                     unsigned int max_pebbles) {
+
+  assert(isconsistent_PebbleConfiguration(g,c));
+
+  BitTuple moves;
+  BitTuple pebbled = c->black_pebbled;
+
+#if REVERSIBLE_PEBBLING
+  moves = c->black_pebbled & c->active_vertices;
+#else
+  moves = c->black_pebbled;
+#endif
+
+#if BLACK_WHITE_PEBBLING
+  pebbled |= c->white_pebbled;
+  moves   |= c->white_pebbled & c->active_vertices;
+#endif
+
+  if (c->pebbles < max_pebbles) {
+#if BLACK_WHITE_PEBBLING
+    BitTuple all = (g->size < BITTUPLE_SIZE) ? (BITTUPLE_UNIT << g->size) - 1 : BITTUPLE_FULL;
+    moves |= all & ~pebbled;
+#else
+    moves |= c->active_vertices & ~pebbled;
+#endif
+  }
+  return moves;
+}
+
+
 /* Each pebble configuration has a number of neightbours less than or
    equal to the number of vertices.  For each vertex you can either
    add a pebble (if possible) or remove one (if present).  The
    possible move is unique for every vertex.
 */
-PebbleConfiguration *next_PebbleConfiguration(const Vertex v,
-                                              const DAG *g,
-                                              const PebbleConfiguration *old,
-                                              unsigned int max_pebbles) {
+static inline PebbleConfiguration *nextconfiguration(const Vertex v,
+                                                     const DAG *g,
+                                                     const PebbleConfiguration *old,
+                                                     unsigned int max_pebbles,
+                                                     Boolean cuts) {
 
   PebbleConfiguration *nconf=NULL;
 
@@ -736,7 +952,7 @@ PebbleConfiguration *next_PebbleConfiguration(const Vertex v,
   if ( isblack(v,g,old) ) {
 #endif
 
-    if (delete_black_heuristics_cut(v,g,old)) return NULL;
+    if (cuts && delete_black_heuristics_cut(v,g,old)) return NULL;
 
     /* Delete BLACK */
     nconf=copy_PebbleConfiguration(old);
@@ -750,7 +966,7 @@ PebbleConfiguration *next_PebbleConfiguration(const Vertex v,
   
   if ( iswhite(v,g,old) && isactive(v,g,old) ) { /* Delete WHITE */
 
-    if (delete_white_heuristics_cut(v,g,old)) return NULL;
+    if (cuts && delete_white_heuristics_cut(v,g,old)) return NULL;
 
     nconf=copy_PebbleConfiguration(old);
     deletewhite(v,g,nconf);
@@ -763,7 +979,7 @@ PebbleConfiguration *next_PebbleConfiguration(const Vertex v,
   if ( !ispebbled(v,g,old) && isactive(v,g,old) ) { /* Place BLACK */
 
     if (old->pebbles >= max_pebbles) return NULL;
-    if (place_black_heuristics_cut(v,g,old)) return NULL;
+    if (cuts && place_black_heuristics_cut(v,g,old)) return NULL;
 
     nconf=copy_PebbleConfiguration(old);
 
@@ -777,7 +993,7 @@ PebbleConfiguration *next_PebbleConfiguration(const Vertex v,
   if ( !ispebbled(v,g,old) && !isactive(v,g,old)) { /* Place WHITE */
 
     if (old->pebbles >= max_pebbles) return NULL;
-    if (place_white_heuristics_cut(v,g,old)) return NULL;
+    if (cuts && place_white_heuristics_cut(v,g,old)) return NULL;
 
 
     nconf=copy_PebbleConfiguration(old);
@@ -792,4 +1008,18 @@ PebbleConfiguration *next_PebbleConfiguration(const Vertex v,
   return NULL;
 }
 
+PebbleConfiguration *next_PebbleConfiguration(const Vertex v,
+                                              const DAG *g,
+                                              const PebbleConfiguration *old,
+                                              unsigned int max_pebbles) {
+  return nextconfiguration(v,g,old,max_pebbles,TRUE);
+}
+
+PebbleConfiguration *nextall_PebbleConfiguration(const Vertex v,
+                                                 const DAG *g,
+                                                 const PebbleConfiguration *old,
+                                                 unsigned int max_pebbles) {
+  return nextconfiguration(v,g,old,max_pebbles,FALSE);
+}
+
 
@@ -17,6 +17,7 @@
 
 #include <stdlib.h>
 #include "common.h"
+#include "variant.h"
 #include "dag.h"
 
 
@@ -41,9 +42,16 @@ typedef struct _PebbleConfiguration {
 
 
   BitTuple used_pebbles;     /* Pebbles used at least once */
+
+  BitTuple active_vertices;  /* Vertices with all predecessors pebbled,
+                                updated incrementally at each move */
   
   Boolean sink_touched;
 
+  /* When configurations are not owned by a dictionary, they are freed
+     when no queued configuration refers to them anymore. */
+  unsigned char references;
+
   unsigned int pebbles;  /* Number of pebbles in the pebbling */
 
   
@@ -73,11 +81,13 @@ typedef struct {
 extern Pebbling*  new_Pebbling(size_t length);
 extern Pebbling*  copy_Pebbling(const Pebbling *src);
 extern void       dispose_Pebbling(Pebbling*);
+extern Boolean    isvalid_Pebbling(const DAG *g,const Pebbling *ptr,Boolean persistent);
 
 extern PebbleConfiguration*  new_PebbleConfiguration();
 extern PebbleConfiguration* copy_PebbleConfiguration(const PebbleConfiguration *src);
 extern void              dispose_PebbleConfiguration(PebbleConfiguration *ptr);
 extern Boolean      isconsistent_PebbleConfiguration(const DAG *graph,const PebbleConfiguration *ptr);
+extern void     reset_active_PebbleConfiguration(const DAG *graph,PebbleConfiguration *ptr);
 
 extern Boolean isfinal_persistent(const DAG *g,const PebbleConfiguration *c);
 extern Boolean isfinal_visiting(const DAG *g,const PebbleConfiguration *c);
@@ -86,6 +96,13 @@ extern void    init_persistent_pebbling(const DAG *g,PebbleConfiguration *const
 
 extern int     configurationcost(const DAG *g,const PebbleConfiguration *c);
 
+/* Configurations packed in one or two BitTuple words, as keys for
+   sets of configurations (e.g. the concurrent set in cfgset.h). Two
+   configurations have the same key iff they are the same for the
+   search, i.e. same pebbles and same sink status. */
+extern unsigned int packedwidth_PebbleConfiguration(const DAG *g);
+extern void         pack_PebbleConfiguration(const DAG *g,const PebbleConfiguration *c,BitTuple *key);
+
 /* Vertices operations */
 
 #if BLACK_WHITE_PEBBLING
@@ -105,6 +122,16 @@ extern Boolean isused(const Vertex v, const DAG *g, const PebbleConfiguration *c
 
 
 
+/**
+   Vertices on which next_PebbleConfiguration may produce a move,
+   before its heuristic cuts.  It is computed with a few bit
+   operations from the mask of active vertices.
+*/
+extern BitTuple enabled_PebbleConfiguration(const DAG *g,
+                                            const PebbleConfiguration *c,
+                                            unsigned int max_pebbles);
+
+
 /**
    Produce a neighbor configuration 
    
@@ -127,8 +154,20 @@ extern PebbleConfiguration *next_PebbleConfiguration(const Vertex v,
                                                      unsigned int max_pebbles);
 
 
+/**
+   Same as next_PebbleConfiguration, without the heuristic cuts: every
+   legal move is produced.  The cuts depend on the path to the
+   configuration, so the searches which need all the shortest
+   pebblings (e.g. to count them) use this one.
+*/
+extern PebbleConfiguration *nextall_PebbleConfiguration(const Vertex v,
+                                                        const DAG *g,
+                                                        const PebbleConfiguration *old,
+                                                        unsigned int max_pebbles);
+
+
 /* Pretty Print functions */
-extern void fprint_dot_Pebbling(char *dot_path,const DAG *g, const Pebbling *ptr);
+extern Boolean fprint_dot_Pebbling(char *dot_path,const DAG *g, const Pebbling *ptr);
 extern void fprint_text_Pebbling(FILE *outfile,const DAG *g, const Pebbling *ptr);
 
 
@@ -0,0 +1,201 @@
+/*
+  Correctness check and benchmark for the OR product of dag.c.
+
+  The product built by orproduct is compared with its definition: the
+  predecessors of (i,j) are the (i,j') for j' predecessor of j, and
+  the (i',s) for i' predecessor of i and s sink of the inner graph.
+  The successors, and on products of at most BITTUPLE_SIZE vertices
+  the bitmasks of the search, are computed here from the two factors
+  and compared with the ones of the graph.  Then the product of two
+  large graphs is built and timed.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+
+#include "common.h"
+#include "dag.h"
+
+
+#define USAGEMESSAGE "\n\
+Usage: %s [-h] [-G <family> -O <family>]\n\
+\n\
+       -h     help message;\n\
+       -G F   outer graph of the product which is timed (default: pyramid:100);\n\
+       -O F   inner graph of the product which is timed (default: tree:6).\n\
+\n\
+The families are the ones of pebble -G.\n"
+
+static const char *factors[]={
+  "path:1", "path:3", "tree:2", "pyramid:2", "pyramid:3", "grid:2:3",
+  "butterfly:1", "butterfly:2", "random:12:1:1,1,1", NULL
+};
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static Boolean isedge(const DAG *g,Vertex u,Vertex v) {
+  for(size_t i=0;i<g->indegree[v];i++)
+    if (g->in[v][i]==u) return TRUE;
+  return FALSE;
+}
+
+static Boolean issink(const DAG *g,Vertex v) {
+  return g->outdegree[v]==0;
+}
+
+
+/* The successors of (xo,xi), in increasing order: the inner
+   successors, or every vertex of the copies of the outer successors
+   when xi is an inner sink */
+static size_t successors(const DAG *outer,const DAG *inner,Vertex v,Vertex *buffer) {
+
+  size_t Si=inner->size;
+  Vertex xo=v/Si, xi=v%Si;
+  size_t n=0;
+
+  for(size_t i=0;i<inner->outdegree[xi];i++)
+    buffer[n++]=xo*Si+inner->out[xi][i];
+  if (inner->outdegree[xi]==0)
+    for(size_t i=0;i<outer->outdegree[xo];i++)
+      for(Vertex yi=0;yi<Si;yi++)
+        buffer[n++]=outer->out[xo][i]*Si+yi;
+  return n;
+}
+
+static BitTuple predmask(const DAG *outer,const DAG *inner,Vertex v) {
+
+  size_t Si=inner->size;
+  Vertex xo=v/Si, xi=v%Si;
+  BitTuple sinks=BITTUPLE_ZERO;
+  BitTuple mask=BITTUPLE_ZERO;
+
+  for(size_t j=0;j<inner->sink_number;j++) sinks |= BITTUPLE_UNIT << inner->sinks[j];
+  for(size_t i=0;i<inner->indegree[xi];i++) mask |= BITTUPLE_UNIT << (xo*Si+inner->in[xi][i]);
+  for(size_t i=0;i<outer->indegree[xo];i++) mask |= sinks << (outer->in[xo][i]*Si);
+  return mask;
+}
+
+static BitTuple succmask(const DAG *outer,const DAG *inner,Vertex v) {
+
+  size_t Si=inner->size;
+  Vertex xo=v/Si, xi=v%Si;
+  BitTuple copy= (Si==BITTUPLE_SIZE) ? ~BITTUPLE_ZERO : (BITTUPLE_UNIT << Si)-1;
+  BitTuple mask=BITTUPLE_ZERO;
+
+  for(size_t i=0;i<inner->outdegree[xi];i++) mask |= BITTUPLE_UNIT << (xo*Si+inner->out[xi][i]);
+  if (inner->outdegree[xi]==0)
+    for(size_t i=0;i<outer->outdegree[xo];i++) mask |= copy << (outer->out[xo][i]*Si);
+  return mask;
+}
+
+
+/* Compare the product with its definition.  Return the number of
+   errors. */
+static int check(const DAG *outer,const DAG *inner) {
+
+  DAG *p=orproduct(outer,inner);
+  size_t Si=inner->size;
+  Vertex *buffer=(Vertex*)malloc(p->size*sizeof(Vertex));
+  int errors=0;
+  assert(buffer);
+
+  if (p->size!=outer->size*Si) errors++;
+
+  for(Vertex v=0;v<p->size && errors==0;v++) {
+    size_t indegree=0;
+    for(Vertex u=0;u<p->size;u++) {
+      Boolean edge = (u/Si==v/Si && isedge(inner,u%Si,v%Si)) ||
+                     (isedge(outer,u/Si,v/Si) && issink(inner,u%Si));
+      if (edge) indegree++;
+      if (edge!=isedge(p,u,v)) errors++;
+    }
+    if (indegree!=p->indegree[v]) errors++;
+
+    size_t n=successors(outer,inner,v,buffer);
+    if (n!=p->outdegree[v] || memcmp(buffer,p->out[v],n*sizeof(Vertex))!=0) errors++;
+
+    if (p->size<=BITTUPLE_SIZE &&
+        (p->pred_bitmasks[v]!=predmask(outer,inner,v) ||
+         p->succ_bitmasks[v]!=succmask(outer,inner,v))) errors++;
+  }
+
+  free(buffer);
+  dispose_DAG(p);
+  return errors;
+}
+
+
+int main(int argc, char *argv[])
+{
+  int option_code=0;
+  const char *outer_family="pyramid:100";
+  const char *inner_family="tree:6";
+  int errors=0;
+  int checked=0;
+
+  while((option_code = getopt(argc,argv,"hG:O:"))!=-1) {
+    switch (option_code) {
+    case 'h':
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_SUCCESS);
+      break;
+    case 'G':
+      outer_family=optarg;
+      break;
+    case 'O':
+      inner_family=optarg;
+      break;
+    default:
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_FAILURE);
+      break;
+    }
+  }
+
+  /* Every pair of small graphs */
+  for(size_t i=0;factors[i];i++) {
+    DAG *outer=generate_DAG(factors[i]);
+    assert(outer);
+    for(size_t j=0;factors[j];j++) {
+      DAG *inner=generate_DAG(factors[j]);
+      assert(inner);
+      int e=check(outer,inner);
+      if (e) printf("c %s x %s: FAILED\n",factors[i],factors[j]);
+      errors+=e;
+      checked++;
+      dispose_DAG(inner);
+    }
+    dispose_DAG(outer);
+  }
+  printf("c %d products of small graphs: %s\n",checked,errors ? "FAILED" : "ok");
+
+  /* A large product, timed */
+  DAG *outer=generate_DAG(outer_family);
+  DAG *inner=generate_DAG(inner_family);
+  if (outer==NULL || inner==NULL) {
+    fprintf(stderr,"c ERROR: can't build the graph \"%s\"\n",outer ? inner_family : outer_family);
+    exit(EXIT_FAILURE);
+  }
+  double start=now();
+  DAG *p=orproduct(outer,inner);
+  double elapsed=now()-start;
+  printf("c %s x %s: %zu vertices, %zu edges, built in %.3fs\n",
+         outer_family,inner_family,p->size,p->in_offset[p->size],elapsed);
+  dispose_DAG(p);
+  dispose_DAG(outer);
+  dispose_DAG(inner);
+
+  printf("c %s\n",errors ? "FAILED" : "all checks passed");
+  exit(errors ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -6,6 +6,8 @@
   that bound.
 */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -14,20 +16,23 @@
 
 #include "common.h"
 #include "dag.h"
+#include "kthparser.h"
 #include "config.h"
 
 
 #define USAGEMESSAGE "\n\
-Usage: %s [-h] -b<int> [ -p<int> | -2<int> | -c<int> | -i <input> ]\n\
+Usage: %s [-h] -b<int> [-j<int>] [ -p<int> | -2<int> | -c<int> | -G <family> | -i <input> ]\n\
 \n\
        -h     help message;\n\
 \n\
        -b M   maximum number of pebbles (mandatory);\n\
+       -j T   threads which parse the input file (default: number of cores);\n\
 \n\
     input graph:\n\
        -p N         pyramid graph of height N;\n\
        -2 N         binary tree height N;\n\
        -c N         chain of length N;\n\
+       -G <family>  graph of one of the families listed below;\n\
        -i <input>   load input file in KTH format.\n\
 \n\
 KTH input format is a source to sync topologically sorted\n\
@@ -47,7 +52,7 @@ c\n\
 2  : \n\
 3  : 1  \n\
 4  : 3  \n\
-5  : 2  4\n"
+5  : 2  4\n" DAG_FAMILIES_MESSAGE
 
 
 /* 
@@ -83,8 +88,6 @@ FILE *openoutputfile(const char* filename) {
 }
 
 
-extern DAG *kthparser(FILE *stream);
-
 /**
  *  The example test program creates two pyramid graphs and produces
  *  the OR-product graph of them.  Then it prints the DOT
@@ -99,6 +102,8 @@ int main(int argc, char *argv[])
   int pyramid_height=0;
   int tree_height=0;
   int chain_length=0;
+  char *graph_family=NULL;
+  long parser_threads=0;
   
   FILE *input_file=NULL;
 
@@ -109,7 +114,7 @@ int main(int argc, char *argv[])
 
   /* Parse option to set Pyramid height,
      pebbling upper bound. */
-  while((option_code = getopt(argc,argv,"hb:p:2:c:f:i:g:"))!=-1) {
+  while((option_code = getopt(argc,argv,"hb:j:p:2:c:G:i:"))!=-1) {
     switch (option_code) {
     case 'h':
       fprintf(stderr,USAGEMESSAGE,argv[0]);
@@ -121,6 +126,12 @@ int main(int argc, char *argv[])
       fprintf(stderr,USAGEMESSAGE,argv[0]);
       exit(EXIT_FAILURE);
       break;
+    case 'j':
+      parser_threads=atol(optarg);
+      if (parser_threads>0) break;
+      fprintf(stderr,USAGEMESSAGE,argv[0]);
+      exit(EXIT_FAILURE);
+      break;
     /* Input */
     case 'p':
       pyramid_height=atoi(optarg);
@@ -140,6 +151,10 @@ int main(int argc, char *argv[])
       fprintf(stderr,USAGEMESSAGE,argv[0]);
       exit(EXIT_FAILURE);
       break;
+    case 'G':
+      graph_family=optarg;
+      input_directives++;
+      break;
     case 'i':
       input_file=openinputfile(optarg);
       input_directives++;
@@ -182,9 +197,21 @@ int main(int argc, char *argv[])
     C=path(chain_length);
     snprintf(graph_name, 100, "Chain of height %d",chain_length);
 
+  } else if (graph_family) {
+
+    C=generate_DAG(graph_family);
+    if (C==NULL) {
+      fprintf(stderr, "c ERROR: unknown graph family \"%s\"\n",graph_family);
+      exit(EXIT_FAILURE);
+    }
+    snprintf(graph_name, 100, "Graph %s",graph_family);
+
   } else {
-    C=kthparser(input_file);
+    C=kthparser_parallel(input_file,
+                         parser_threads>0 ? (unsigned int)parser_threads
+                                          : (unsigned int)sysconf(_SC_NPROCESSORS_ONLN));
     fclose(input_file);
+    if (C==NULL) exit(EXIT_FAILURE);
     snprintf(graph_name, 100, "Input graph");
   }
 
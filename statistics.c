@@ -42,6 +42,8 @@ void statistics_make_report(FILE *stream,Statistic *const s) {
   tmp_clock = s->clock;
   if (tmp_clock==0) tmp_clock=1;
 
+  if (stream==NULL) goto reset;
+
   /*             "[   Queued]  = 000000000000000  |  000000000000000"  */
   fprintf(stream,"                    PER SECOND  |            TOTAL\n"
                  "              ------------------------------------\n");
@@ -55,7 +57,7 @@ void statistics_make_report(FILE *stream,Statistic *const s) {
   fprintf(stream,"[  Delayed]  = %15llu  |  %15llu\n",
           s->delayed_T/tmp_clock,s->delayed_T);
 
-  fprintf(stderr,"\n");
+  fprintf(stream,"\n");
 
   fprintf(stream,"[Processed]  = %15llu  |  %15llu\n",
           s->processed_T/tmp_clock,s->processed_T);
@@ -68,7 +70,7 @@ void statistics_make_report(FILE *stream,Statistic *const s) {
   fprintf(stream,"[    Final]  = %15llu  |  %15llu\n",
           s->final_T/tmp_clock,s->final_T);
 
-  fprintf(stderr,"\n");
+  fprintf(stream,"\n");
 
   fprintf(stream,"[Offspring]  = %15llu  |  %15llu\n",
           s->offspring_T/tmp_clock,s->offspring_T);
@@ -76,7 +78,7 @@ void statistics_make_report(FILE *stream,Statistic *const s) {
     fprintf(stream,"[Avg.Neig.]  = %15llu\n\n"  ,s->offspring_T/s->processed_T);
   }
 
-  fprintf(stderr,"\n");
+  fprintf(stream,"\n");
 
   fprintf(stream,"[D.Queries]  = %15llu  |  %15llu\n",
           s->dict_queries_T/tmp_clock,s->dict_queries_T);
@@ -89,6 +91,17 @@ void statistics_make_report(FILE *stream,Statistic *const s) {
     fprintf(stream,"[Avg. Hops]  = %15llu vs %llu\n\n",s->dict_hops_T/s->dict_queries_T,s->first_queuing_T/s->dict_size);
   }
 
+  if (s->zdd_nodes || s->visited_memory) {
+    if (!(s->dict_queries_T && s->dict_size)) fprintf(stream,"\n");
+    if (s->zdd_nodes) {
+      fprintf(stream,"[ZDD Nodes]  = %15llu\n",s->zdd_nodes);
+    }
+    if (s->visited_memory) {
+      fprintf(stream,"[Visit.Mem]  = %15llu KB\n",s->visited_memory >> 10);
+    }
+  }
+
+ reset:
   /* Reset partial counters */
   s->processed            = 0;
   s->queued               = 0;
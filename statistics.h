@@ -18,8 +18,8 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "common.h"
-#include "timedflags.h"
 /* Code */
 
 
@@ -66,35 +66,44 @@ typedef struct {
 
   Counter dict_size;
 
+  /* Visited set */
+  Counter zdd_nodes;                     /* Nodes in the ZDD, if used */
+  Counter visited_memory;                /* Bytes used by the visited configurations */
+
 } Statistic;
 
+/* The partial counters are added to the totals, and then reset.  The
+   report is printed only if the stream is not NULL. */
 extern void statistics_make_report(FILE *stream,Statistic *const s);
 
+/* Statistics live in the search context, and the reports go to the
+   stream of the context (if any).  A report is due when the context
+   flag is set, e.g. by the timer in timedflags.c. */
 #if PRINT_STATS_INTERVAL > 0
 
-#define STATS_REPORT(S,fmt,...) {fprintf(stderr,fmt,__VA_ARGS__); statistics_make_report(stderr,&(S));}
-#define STATS_CREATE(s) Statistic s={0, 0,0,0,0,0, 0,0,0,0,0, 0,0,0,0,0, 0,0,0,0,0, 0,0,0,0, 0,0,0,0, 0}
+#define STATS_REPORT(stream,S,fmt,...) { if (stream) fprintf(stream,fmt,__VA_ARGS__); statistics_make_report(stream,&(S)); }
+#define STATS_RESET(s) { memset(&(s),0,sizeof(Statistic)); }
 #define STATS_INC(s,n) { (s).n++; }
 #define STATS_SET(s,n,v) { (s).n=(v); }
 #define STATS_ADD(s,n,v) { (s).n+=(v); }
 #define STATS_GET(s,n)   ((s).n)
 
-#define STATS_TIMER_OFF  print_running_stats_flag
-#define STATS_TIMER_RESET()  { print_running_stats_flag=0; }
-#define STATS_CLOCK_UPDATE(s) { (s).clock+=timedflags_clock_freq; }
+#define STATS_TIMER_OFF(flag)    ((flag) && *(flag))
+#define STATS_TIMER_RESET(flag)  { *(flag)=0; }
+#define STATS_CLOCK_UPDATE(s,interval) { (s).clock+=(interval); }
   
 #else
 
-#define STATS_REPORT(S,fmt,...) {}
-#define STATS_CREATE(s) { }
+#define STATS_REPORT(stream,S,fmt,...) {}
+#define STATS_RESET(s) { }
 #define STATS_INC(s,n) { }
 #define STATS_SET(s,n,v) { }
 #define STATS_ADD(s,n,v) { }
 #define STATS_GET(s,n) { }
 
-#define STATS_TIMER_OFF  0
-#define STATS_TIMER_RESET()  { }
-#define STATS_CLOCK_UPDATE(s) { }
+#define STATS_TIMER_OFF(flag)  0
+#define STATS_TIMER_RESET(flag)  { }
+#define STATS_CLOCK_UPDATE(s,interval) { }
   
 #endif
 
@@ -0,0 +1,541 @@
+/*
+   Description::
+
+   Symbolic breadth-first search for pebblings.  Instead of expanding
+   the configurations one by one, a whole layer of the search is
+   represented as a BDD over the pebbles on the vertices, and the next
+   layer is computed as the image of the move relation.  On regular
+   graphs the layers have a compact representation even when they are
+   too large to be enumerated.
+
+*/
+
+/* Preamble */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+#include "dag.h"
+#include "pebbling.h"
+#include "bdd.h"
+#include "bfs.h"
+#include "symbolic.h"
+
+
+#define SYMBOLIC_INITIAL_NODES 0x100000
+
+
+/*
+ * Variables of the BDDs: one for each vertex with a black pebble (and
+ * one for each vertex with a white pebble, interleaved), plus one for
+ * whether the sink has been touched, which is the last variable.
+ */
+#if BLACK_WHITE_PEBBLING
+#define BLACKVAR(v)      (2*(v))
+#define WHITEVAR(v)      (2*(v)+1)
+#define TOUCHVAR(g)      (2*(g)->size)
+#else
+#define BLACKVAR(v)      (v)
+#define TOUCHVAR(g)      ((g)->size)
+#endif
+#define VARIABLES(g)     (TOUCHVAR(g)+1)
+
+#define ASSIGNMENT_WORDS 3
+
+
+typedef struct {
+
+  const DAG    *g;
+  BDD          *m;
+  unsigned int  bound;
+
+  BNode        *active;      /* All predecessors of a vertex pebbled */
+  BNode         atmost;      /* At most `bound' pebbles */
+  BNode         final;       /* Final configurations */
+
+} Symbolic;
+
+
+/* Code */
+
+/* Is vertex v pebbled, as a BDD */
+static BNode pebbled(Symbolic *S,Vertex v) {
+#if BLACK_WHITE_PEBBLING
+  return orBDD(S->m,varBDD(S->m,BLACKVAR(v)),varBDD(S->m,WHITEVAR(v)));
+#else
+  return varBDD(S->m,BLACKVAR(v));
+#endif
+}
+
+
+/* At most k pebbles on vertices v, v+1, ...  The BDD is built bottom
+   up, since the variables of v come before the ones of v+1. */
+static BNode atmost(Symbolic *S,Vertex v,int k,BNode *memo) {
+
+  const DAG *g=S->g;
+  if (k<0) return BDD_FALSE;
+  if (v==g->size) return BDD_TRUE;
+
+  BNode *r=memo + v*(S->bound+1) + k;
+  if (*r!=BDD_FALSE) return *r;
+
+  BNode empty = atmost(S,v+1,k  ,memo);
+  BNode full  = atmost(S,v+1,k-1,memo);
+#if BLACK_WHITE_PEBBLING
+  empty = getnodeBDD(S->m,WHITEVAR(v),empty,full);
+#endif
+  *r = getnodeBDD(S->m,BLACKVAR(v),empty,full);
+  return *r;
+}
+
+
+/* Assignment of the variables for a configuration */
+static void encode(const DAG *g,const PebbleConfiguration *c,BitTuple *assignment) {
+
+  memset(assignment,0,ASSIGNMENT_WORDS*sizeof(BitTuple));
+  for(Vertex v=0;v<g->size;v++) {
+    unsigned int var;
+    if (isblack(v,g,c)) {
+      var=BLACKVAR(v);
+      SETBIT(assignment[var / BITTUPLE_SIZE],var % BITTUPLE_SIZE);
+    }
+#if BLACK_WHITE_PEBBLING
+    if (iswhite(v,g,c)) {
+      var=WHITEVAR(v);
+      SETBIT(assignment[var / BITTUPLE_SIZE],var % BITTUPLE_SIZE);
+    }
+#endif
+  }
+  if (c->sink_touched) {
+    unsigned int var=TOUCHVAR(g);
+    SETBIT(assignment[var / BITTUPLE_SIZE],var % BITTUPLE_SIZE);
+  }
+}
+
+static void decode(const DAG *g,const BitTuple *assignment,PebbleConfiguration *c) {
+
+  c->black_pebbled = 0;
+#if BLACK_WHITE_PEBBLING
+  c->white_pebbled = 0;
+#endif
+  c->pebbles = 0;
+  for(Vertex v=0;v<g->size;v++) {
+    unsigned int var=BLACKVAR(v);
+    if (GETBIT(assignment[var / BITTUPLE_SIZE],var % BITTUPLE_SIZE)) {
+      SETBIT(c->black_pebbled,v);
+      c->pebbles++;
+    }
+#if BLACK_WHITE_PEBBLING
+    var=WHITEVAR(v);
+    if (GETBIT(assignment[var / BITTUPLE_SIZE],var % BITTUPLE_SIZE)) {
+      SETBIT(c->white_pebbled,v);
+      c->pebbles++;
+    }
+#endif
+  }
+  unsigned int var=TOUCHVAR(g);
+  c->sink_touched = GETBIT(assignment[var / BITTUPLE_SIZE],var % BITTUPLE_SIZE);
+}
+
+/* The BDD with the single configuration c */
+static BNode state(Symbolic *S,const PebbleConfiguration *c) {
+
+  BitTuple a[ASSIGNMENT_WORDS];
+  BNode r=BDD_TRUE;
+
+  encode(S->g,c,a);
+  for(unsigned int var=VARIABLES(S->g); var-- > 0; ) {
+    if (GETBIT(a[var / BITTUPLE_SIZE],var % BITTUPLE_SIZE))
+      r=getnodeBDD(S->m,var,BDD_FALSE,r);
+    else
+      r=getnodeBDD(S->m,var,r,BDD_FALSE);
+  }
+  return r;
+}
+
+
+/*
+   The configurations reachable in one move from the layer F.  For
+   each vertex there is a single sensible move, as in
+   next_PebbleConfiguration, but without its heuristic cuts, which
+   depend on the path to a configuration.  The bound on the number of
+   pebbles is enforced by the caller.
+ */
+static BNode image(Symbolic *S,BNode F) {
+
+  const DAG *g=S->g;
+  BDD       *m=S->m;
+  BNode      img=BDD_FALSE;
+  BNode      x;
+
+  for(Vertex v=0;v<g->size;v++) {
+
+    /* Placement of a pebble on an empty vertex */
+    BNode empty=restrictBDD(m,F,BLACKVAR(v),FALSE);
+#if BLACK_WHITE_PEBBLING
+    empty=restrictBDD(m,empty,WHITEVAR(v),FALSE);
+#endif
+    if (v==g->sinks[0]) {
+      empty=existsBDD(m,empty,TOUCHVAR(g));
+      empty=andBDD(m,empty,varBDD(m,TOUCHVAR(g)));
+    }
+
+    x=andBDD(m,empty,S->active[v]);
+    x=andBDD(m,x,varBDD(m,BLACKVAR(v)));
+#if BLACK_WHITE_PEBBLING
+    x=andBDD(m,x,nvarBDD(m,WHITEVAR(v)));
+#endif
+    img=orBDD(m,img,x);
+
+#if BLACK_WHITE_PEBBLING
+    x=andBDD(m,empty,notBDD(m,S->active[v]));
+    x=andBDD(m,x,varBDD(m,WHITEVAR(v)));
+    x=andBDD(m,x,nvarBDD(m,BLACKVAR(v)));
+    img=orBDD(m,img,x);
+#endif
+
+    /* Removal of a black pebble */
+    x=restrictBDD(m,F,BLACKVAR(v),TRUE);
+#if REVERSIBLE_PEBBLING
+    x=andBDD(m,x,S->active[v]);
+#endif
+    x=andBDD(m,x,nvarBDD(m,BLACKVAR(v)));
+    img=orBDD(m,img,x);
+
+#if BLACK_WHITE_PEBBLING
+    /* Removal of a white pebble */
+    x=restrictBDD(m,F,WHITEVAR(v),TRUE);
+    x=andBDD(m,x,S->active[v]);
+    x=andBDD(m,x,nvarBDD(m,WHITEVAR(v)));
+    img=orBDD(m,img,x);
+#endif
+  }
+  return img;
+}
+
+
+/*
+   The move on vertex v from configuration p, on explicit
+   configurations.  Return FALSE if there is no such move.
+ */
+static Boolean move(Symbolic *S,const PebbleConfiguration *p,Vertex v,PebbleConfiguration *q) {
+
+  const DAG *g=S->g;
+
+  *q=*p;
+  Boolean active=isactive(v,g,p);
+
+#if REVERSIBLE_PEBBLING
+  if (isblack(v,g,p) && !active) return FALSE;
+#endif
+  if (isblack(v,g,p)) {
+    RESETBIT(q->black_pebbled,v);
+    q->pebbles--;
+    return TRUE;
+  }
+#if BLACK_WHITE_PEBBLING
+  if (iswhite(v,g,p)) {
+    if (!active) return FALSE;
+    RESETBIT(q->white_pebbled,v);
+    q->pebbles--;
+    return TRUE;
+  }
+#endif
+  if (p->pebbles >= S->bound) return FALSE;
+  if (active) {
+    SETBIT(q->black_pebbled,v);
+  } else {
+#if BLACK_WHITE_PEBBLING
+    SETBIT(q->white_pebbled,v);
+#else
+    return FALSE;
+#endif
+  }
+  q->pebbles++;
+  if (v==g->sinks[0]) q->sink_touched=TRUE;
+  return TRUE;
+}
+
+static Boolean sameconfiguration(const PebbleConfiguration *a,const PebbleConfiguration *b) {
+#if BLACK_WHITE_PEBBLING
+  if (a->white_pebbled != b->white_pebbled) return FALSE;
+#endif
+  return a->black_pebbled==b->black_pebbled && a->sink_touched==b->sink_touched;
+}
+
+
+/*
+   A configuration in layer L from which c is reached by a move on
+   some vertex (backward image of a single configuration).  The
+   candidates differ from c only on the pebbles of the vertex, and on
+   whether the sink is touched.
+ */
+static PebbleConfiguration *predecessor(Symbolic *S,BNode L,const PebbleConfiguration *c) {
+
+  const DAG *g=S->g;
+  PebbleConfiguration cand[4],q;
+  BitTuple a[ASSIGNMENT_WORDS];
+  int n;
+
+  for(Vertex v=0;v<g->size;v++) {
+
+    n=0;
+    cand[n]=*c; cand[n].black_pebbled ^= (BITTUPLE_UNIT << v); n++;
+#if BLACK_WHITE_PEBBLING
+    cand[n]=*c; cand[n].white_pebbled ^= (BITTUPLE_UNIT << v); n++;
+#endif
+    if (v==g->sinks[0] && c->sink_touched) {
+      for(int i=n-1;i>=0;i--) { cand[n]=cand[i]; cand[n].sink_touched=FALSE; n++; }
+    }
+
+    for(int i=0;i<n;i++) {
+      BitTuple pebbles=cand[i].black_pebbled;
+#if BLACK_WHITE_PEBBLING
+      if (cand[i].black_pebbled & cand[i].white_pebbled) continue;
+      pebbles |= cand[i].white_pebbled;
+#endif
+      if (GETBIT(pebbles,g->sinks[0]) && !cand[i].sink_touched) continue;
+      cand[i].pebbles = 0;
+      for(Vertex u=0;u<g->size;u++) if (GETBIT(pebbles,u)) cand[i].pebbles++;
+      reset_active_PebbleConfiguration(g,&cand[i]);
+      encode(g,&cand[i],a);
+      if (!evalBDD(S->m,L,a)) continue;
+      if (!move(S,&cand[i],v,&q) || !sameconfiguration(&q,c)) continue;
+
+      PebbleConfiguration *p=new_PebbleConfiguration();
+      *p=cand[i];
+      p->previous_configuration=NULL;
+      p->used_pebbles=0;
+      p->references=0;
+      ((PebbleConfiguration*)c)->previous_configuration=p;
+      ((PebbleConfiguration*)c)->last_changed_vertex=v;
+      return p;
+    }
+  }
+  return NULL;
+}
+
+
+/**
+   Explore the space of pebbling strategies, symbolically.
+
+   The search proceeds as the one in bfs_pebbling_strategy, with the
+   same initial and final configurations, but each layer of the search
+   is a BDD.  The next layer contains the configurations reachable in
+   one move, with at most `upper_bound' pebbles, and never reached
+   before.  The search stops as soon as a layer contains a final
+   configuration.  A witness path is recovered backward, from a final
+   configuration, through the previous layers.
+
+   Since the moves are not restricted by the heuristics of the
+   explicit search, the pebbling found is the shortest among the ones
+   within the bound on the number of pebbles.
+
+   @param DAG the graph to pebble (with few vertices and a single
+   sink).
+
+   @param upper_bound: the maximum number of pebbles in the
+   configurations.
+
+   @param persisten_pebbling: whether we look for a persistent
+   pebbling.
+
+   @param opts: where the summary is reported, and where errors are
+   recorded.  May be NULL.
+
+   @return a pebbling, or NULL if there is none within the bound.
+*/
+Pebbling *symbolic_pebbling_strategy(const DAG *g,
+                                     unsigned int upper_bound,
+                                     Boolean persistent_pebbling,
+                                     BFSOptions *opts) {
+
+  /* PROLOGUE ----------------------------------- */
+  assert(isconsistent_DAG(g));
+
+  BFSOptions default_opts;
+  if (opts==NULL) {
+    init_BFSOptions(&default_opts);
+    opts=&default_opts;
+  }
+  opts->approximate = FALSE;
+  opts->error = NULL;
+  opts->limit = NULL;
+  opts->depth = -1;
+
+  if (g->size > BITTUPLE_SIZE) {
+    opts->error = "the graph is too big for the optimized data structures";
+    return NULL;
+  }
+
+  if (g->sink_number!=1) {
+    opts->error = "the graph has more than one sink vertex";
+    return NULL;
+  }
+
+  if (upper_bound < 1) { return NULL; } /* No pebbling with zero pebbles */
+
+#if (!BLACK_WHITE_PEBBLING && !REVERSIBLE_PEBBLING)
+  persistent_pebbling = 0;
+#endif
+
+  /* END OF PROLOGUE ----------------------------------- */
+
+  Symbolic S;
+  S.g      = g;
+  S.bound  = upper_bound;
+  S.m      = newBDD(VARIABLES(g),SYMBOLIC_INITIAL_NODES);
+  S.active = (BNode*)malloc(g->size*sizeof(BNode));
+  assert(S.active);
+
+  BDD *m=S.m;
+
+  for(Vertex v=0;v<g->size;v++) {
+    S.active[v]=BDD_TRUE;
+    for(Vertex u=0;u<g->size;u++)
+      if (GETBIT(g->pred_bitmasks[v],u)) S.active[v]=andBDD(m,S.active[v],pebbled(&S,u));
+  }
+
+  BNode *memo=(BNode*)calloc(g->size*(upper_bound+1),sizeof(BNode));
+  assert(memo);
+  S.atmost=atmost(&S,0,upper_bound,memo);
+  free(memo);
+
+  /* Final configurations */
+  S.final = BDD_TRUE;
+  if (!persistent_pebbling) S.final=varBDD(m,TOUCHVAR(g));
+  for(Vertex v=0;v<g->size;v++) {
+#if BLACK_WHITE_PEBBLING
+    S.final=andBDD(m,S.final,nvarBDD(m,WHITEVAR(v)));
+#elif REVERSIBLE_PEBBLING
+    if (persistent_pebbling) S.final=andBDD(m,S.final,nvarBDD(m,BLACKVAR(v)));
+#endif
+  }
+
+  /* Initial configuration */
+  PebbleConfiguration *initial=new_PebbleConfiguration();
+  reset_active_PebbleConfiguration(g,initial);
+#if BLACK_WHITE_PEBBLING || REVERSIBLE_PEBBLING
+  if (persistent_pebbling) {  init_persistent_pebbling(g, initial); }
+#endif
+
+  size_t  allocated=64;
+  BNode  *layers=(BNode*)malloc(allocated*sizeof(BNode));
+  BNode   reached;
+  BNode   hit=BDD_FALSE;
+  size_t  depth=0;
+  size_t  threshold=2*m->size;
+  double  largest=1.0;
+  double  visited=1.0;
+
+  assert(layers);
+  layers[0] = reached = state(&S,initial);
+  if (initial->pebbles > upper_bound) layers[0]=reached=BDD_FALSE;
+
+  /* The search, layer by layer */
+  while(layers[depth]!=BDD_FALSE) {
+
+    hit=andBDD(m,layers[depth],S.final);
+    if (hit!=BDD_FALSE) break;
+
+    /* The limits are checked between two layers */
+    opts->limit=exceeded_ResourceLimits(&opts->limits,(Counter)visited);
+    if (opts->limit) break;
+
+    BNode next=image(&S,layers[depth]);
+    next=andBDD(m,next,S.atmost);
+    next=andBDD(m,next,notBDD(m,reached));
+    reached=orBDD(m,reached,next);
+
+    if (++depth == allocated) {
+      allocated *= 2;
+      layers=(BNode*)realloc(layers,allocated*sizeof(BNode));
+      assert(layers);
+    }
+    layers[depth]=next;
+
+    if (next!=BDD_FALSE) {
+      double size=satcountBDD(m,next);
+      if (size > largest) largest=size;
+      visited += size;
+    }
+
+    /* Garbage collection, between two layers */
+    if (m->size > threshold) {
+      size_t count=depth+1+3+g->size;
+      BNode **roots=(BNode**)malloc(count*sizeof(BNode*));
+      size_t i=0;
+      assert(roots);
+      for(size_t l=0;l<=depth;l++) roots[i++]=layers+l;
+      roots[i++]=&reached;
+      roots[i++]=&S.atmost;
+      roots[i++]=&S.final;
+      for(Vertex v=0;v<g->size;v++) roots[i++]=S.active+v;
+      assert(i==count);
+      collectBDD(m,roots,count);
+      free(roots);
+      threshold = 2*m->size > SYMBOLIC_INITIAL_NODES ? 2*m->size : SYMBOLIC_INITIAL_NODES;
+    }
+  }
+
+#if PRINT_STATS_INTERVAL > 0
+  if (opts->report)
+    fprintf(opts->report,
+          "\nSYMBOLIC SEARCH: upper bound=%u, %zu layers, largest layer %.0f configurations,\n"
+          "%zu BDD nodes (peak), %llu garbage collections\n",
+          upper_bound,depth+1,largest,m->peak,m->collections);
+#endif
+
+  opts->depth=(long)depth-1;
+  if (opts->limit && opts->report)
+    fprintf(opts->report,"c Search stopped: %s limit exceeded, "
+            "levels up to %ld fully explored\n",opts->limit,opts->depth);
+
+  /* Witness path, from a final configuration back to the initial one */
+  Pebbling *solution=NULL;
+
+  if (hit!=BDD_FALSE) {
+
+    BitTuple a[ASSIGNMENT_WORDS];
+    memset(a,0,sizeof(a));
+    anysatBDD(m,hit,a);
+
+    PebbleConfiguration *final=new_PebbleConfiguration();
+    PebbleConfiguration *ptr=final;
+    decode(g,a,final);
+    reset_active_PebbleConfiguration(g,final);
+
+    for(size_t l=depth;l>0;l--) {
+      ptr=predecessor(&S,layers[l-1],ptr);
+      assert(ptr);
+    }
+    assert(sameconfiguration(ptr,initial));
+
+    if (persistent_pebbling) {
+      solution = finalize_persistent_pebbling(g,final);
+    } else {
+#if REVERSIBLE_PEBBLING
+      solution = finalize_reversible_pebbling(g,final);
+#else
+      solution = finalize_pebbling(g,final);
+#endif
+    }
+    assert(isvalid_Pebbling(g,solution,persistent_pebbling));
+
+    while(final) {
+      ptr=final->previous_configuration;
+      dispose_PebbleConfiguration(final);
+      final=ptr;
+    }
+  }
+
+  /* Free the memory of the data structures */
+  dispose_PebbleConfiguration(initial);
+  free(layers);
+  free(S.active);
+  disposeBDD(m);
+
+  return solution;
+}
@@ -0,0 +1,28 @@
+/*
+   Description::
+
+   Symbolic breadth-first search for pebblings, where each layer of
+   configurations is a BDD. Header for symbolic.c
+
+*/
+
+
+/* Preamble */
+#ifndef  SYMBOLIC_H
+#define  SYMBOLIC_H
+
+#include "common.h"
+#include "variant.h"
+#include "dag.h"
+#include "pebbling.h"
+#include "bfs.h"
+
+
+/* Code */
+
+extern Pebbling* symbolic_pebbling_strategy(const DAG *digraph,
+                                            unsigned int upper_bound,
+                                            Boolean persistent_pebbling,
+                                            BFSOptions *opts);
+
+#endif /* SYMBOLIC_H */
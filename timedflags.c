@@ -23,21 +23,57 @@
 
 /* Flags */
 volatile sig_atomic_t print_running_stats_flag=0;
+volatile sig_atomic_t checkpoint_flag=0;
 unsigned int timedflags_clock_freq;
 
+/* The timer ticks at the greatest common divisor of the intervals,
+   and each flag is raised every so many ticks */
+static unsigned int checkpoint_interval=0;
+static volatile sig_atomic_t stats_ticks=0,stats_count=0;
+static volatile sig_atomic_t checkpoint_ticks=0,checkpoint_count=0;
+
 
 void timed_flags_handler(int sig) {
-  print_running_stats_flag=1;
+  if (stats_ticks>0 && ++stats_count >= stats_ticks) {
+    print_running_stats_flag=1;
+    stats_count=0;
+  }
+  if (checkpoint_ticks>0 && ++checkpoint_count >= checkpoint_ticks) {
+    checkpoint_flag=1;
+    checkpoint_count=0;
+  }
 }
 
 
-void install_timed_flags(unsigned int freq){
+static unsigned int gcd(unsigned int a,unsigned int b) {
+  while (b) { unsigned int r=a%b; a=b; b=r; }
+  return a;
+}
+
+static void install_timer(void) {
   struct itimerval t;
+  unsigned int tick=gcd(timedflags_clock_freq,checkpoint_interval);
+  if (tick==0) return;
+  stats_count=0;
+  stats_ticks=timedflags_clock_freq/tick;
+  checkpoint_count=0;
+  checkpoint_ticks=checkpoint_interval/tick;
   signal(SIGALRM,timed_flags_handler);
-  t.it_interval.tv_sec=freq;
+  t.it_interval.tv_sec=tick;
   t.it_interval.tv_usec=0;
-  t.it_value.tv_sec=freq;
+  t.it_value.tv_sec=tick;
   t.it_value.tv_usec=0;
   setitimer(ITIMER_REAL,&t,NULL);
+}
+
+
+void install_timed_flags(unsigned int freq){
   timedflags_clock_freq=freq;
+  install_timer();
+}
+
+
+void install_checkpoint_flag(unsigned int seconds) {
+  checkpoint_interval=seconds;
+  install_timer();
 }
@@ -17,12 +17,17 @@
 
 /* Flags */
 extern volatile sig_atomic_t print_running_stats_flag;
+extern volatile sig_atomic_t checkpoint_flag;
 
 extern unsigned int timedflags_clock_freq;
 
 /* Flags installer */
 extern void install_timed_flags(unsigned int freq);
 
+/* Raise checkpoint_flag every `seconds' seconds, on the same timer
+   as the other flags */
+extern void install_checkpoint_flag(unsigned int seconds);
+
 #endif /* TIMEDFLAGS_H */
 
 
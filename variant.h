@@ -0,0 +1,93 @@
+/*
+   Description::
+
+   The code for the pebbling variants (bfs.c, symbolic.c, pebbling.c,
+   config.c) is compiled once per variant, with the macros
+   BLACK_WHITE_PEBBLING and REVERSIBLE_PEBBLING fixed, so that each
+   instance is specialised as before.  To link the three instances in
+   the same program, PEBBLING_VARIANT is set to the name of the
+   variant (black, bw, rev) and appended to the external symbols of
+   the variant code.
+
+*/
+
+
+/* Preamble */
+#ifndef  VARIANT_H
+#define  VARIANT_H
+
+#if BLACK_WHITE_PEBBLING && REVERSIBLE_PEBBLING
+#error "Invalid compiler options: black/white AND reversible simultaneously."
+#endif
+
+#ifdef PEBBLING_VARIANT
+
+#define VARIANT_SYMBOL(name)         VARIANT_SYMBOL_(name,PEBBLING_VARIANT)
+#define VARIANT_SYMBOL_(name,suffix)  VARIANT_SYMBOL__(name,suffix)
+#define VARIANT_SYMBOL__(name,suffix) name##_##suffix
+
+#define VARIANT_STRING(suffix)  VARIANT_STRING_(suffix)
+#define VARIANT_STRING_(suffix) #suffix
+
+/* bfs.c */
+#define CheckRuntimeConsistency           VARIANT_SYMBOL(CheckRuntimeConsistency)
+#define bfs_pebbling_strategy             VARIANT_SYMBOL(bfs_pebbling_strategy)
+#define finalize_pebbling                 VARIANT_SYMBOL(finalize_pebbling)
+#define finalize_persistent_pebbling      VARIANT_SYMBOL(finalize_persistent_pebbling)
+#define finalize_reversible_pebbling      VARIANT_SYMBOL(finalize_reversible_pebbling)
+#define freePebbleConfiguration           VARIANT_SYMBOL(freePebbleConfiguration)
+#define hashPebbleConfiguration           VARIANT_SYMBOL(hashPebbleConfiguration)
+#define samePebbleConfiguration           VARIANT_SYMBOL(samePebbleConfiguration)
+
+/* pareto.c */
+#define pareto_pebbling_strategy          VARIANT_SYMBOL(pareto_pebbling_strategy)
+/* beam.c */
+#define beam_pebbling_strategy            VARIANT_SYMBOL(beam_pebbling_strategy)
+/* symbolic.c */
+#define symbolic_pebbling_strategy        VARIANT_SYMBOL(symbolic_pebbling_strategy)
+
+/* pebbling.c */
+#define openstepfile                      VARIANT_SYMBOL(openstepfile)
+#define new_Pebbling                      VARIANT_SYMBOL(new_Pebbling)
+#define copy_Pebbling                     VARIANT_SYMBOL(copy_Pebbling)
+#define dispose_Pebbling                  VARIANT_SYMBOL(dispose_Pebbling)
+#define isvalid_Pebbling                  VARIANT_SYMBOL(isvalid_Pebbling)
+#define new_PebbleConfiguration           VARIANT_SYMBOL(new_PebbleConfiguration)
+#define copy_PebbleConfiguration          VARIANT_SYMBOL(copy_PebbleConfiguration)
+#define dispose_PebbleConfiguration       VARIANT_SYMBOL(dispose_PebbleConfiguration)
+#define isconsistent_PebbleConfiguration  VARIANT_SYMBOL(isconsistent_PebbleConfiguration)
+#define reset_active_PebbleConfiguration  VARIANT_SYMBOL(reset_active_PebbleConfiguration)
+#define isfinal_persistent                VARIANT_SYMBOL(isfinal_persistent)
+#define isfinal_visiting                  VARIANT_SYMBOL(isfinal_visiting)
+#define init_persistent_pebbling          VARIANT_SYMBOL(init_persistent_pebbling)
+#define configurationcost                 VARIANT_SYMBOL(configurationcost)
+#define packedwidth_PebbleConfiguration   VARIANT_SYMBOL(packedwidth_PebbleConfiguration)
+#define pack_PebbleConfiguration          VARIANT_SYMBOL(pack_PebbleConfiguration)
+#define iswhite                           VARIANT_SYMBOL(iswhite)
+#define placewhite                        VARIANT_SYMBOL(placewhite)
+#define deletewhite                       VARIANT_SYMBOL(deletewhite)
+#define isblack                           VARIANT_SYMBOL(isblack)
+#define placeblack                        VARIANT_SYMBOL(placeblack)
+#define deleteblack                       VARIANT_SYMBOL(deleteblack)
+#define ispebbled                         VARIANT_SYMBOL(ispebbled)
+#define isactive                          VARIANT_SYMBOL(isactive)
+#define isused                            VARIANT_SYMBOL(isused)
+#define enabled_PebbleConfiguration       VARIANT_SYMBOL(enabled_PebbleConfiguration)
+#define next_PebbleConfiguration          VARIANT_SYMBOL(next_PebbleConfiguration)
+#define nextall_PebbleConfiguration       VARIANT_SYMBOL(nextall_PebbleConfiguration)
+#define fprint_dot_PebbleConfiguration    VARIANT_SYMBOL(fprint_dot_PebbleConfiguration)
+#define print_dot_PebbleConfiguration     VARIANT_SYMBOL(print_dot_PebbleConfiguration)
+#define fprint_dot_Pebbling               VARIANT_SYMBOL(fprint_dot_Pebbling)
+#define fprint_text_Pebbling              VARIANT_SYMBOL(fprint_text_Pebbling)
+
+/* config.c */
+#define pebbling_type                     VARIANT_SYMBOL(pebbling_type)
+#define pebbling_Type                     VARIANT_SYMBOL(pebbling_Type)
+
+#else
+
+#define VARIANT_SYMBOL(name) name
+
+#endif /* PEBBLING_VARIANT */
+
+#endif /* VARIANT_H */
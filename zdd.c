@@ -0,0 +1,299 @@
+/*
+   Description::
+
+   Zero-suppressed decision diagrams (Minato), with a unique table and
+   an operation cache.  Only the few operations needed to keep a set
+   of visited configurations are implemented: membership, union, and
+   the construction of a family with a single set.
+
+*/
+
+/* Preamble */
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "common.h"
+#include "zdd.h"
+
+
+/* Terminals are below every variable */
+#define ZDD_TERMINAL_VAR  UINT_MAX
+
+/* Operations in the cache */
+#define ZDD_OP_NONE   0
+#define ZDD_OP_UNION  1
+
+#define ZDD_CACHE_SIZE  0x40000
+#define ZDD_MIN_ALLOCATION 0x400
+
+
+/* Code */
+
+static inline size_t hash_triple(unsigned int x,ZNode y,ZNode z) {
+  BitTuple h = ((BitTuple)x << 32) ^ ((BitTuple)y * 0x9E3779B97F4A7C15ULL) ^ z;
+  h ^= h >> 31; h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 29;
+  return (size_t)h;
+}
+
+static inline Boolean isterminal(ZNode f) {
+  return f==ZDD_EMPTY || f==ZDD_BASE;
+}
+
+
+/* Rebuild the unique table, with at least one bucket per node slot. */
+static void rehash(ZDD *z) {
+
+  size_t buckets=ZDD_MIN_ALLOCATION;
+  while(buckets < z->allocation) buckets <<= 1;
+
+  free(z->buckets);
+  z->buckets = (ZNode*)calloc(buckets,sizeof(ZNode));
+  assert(z->buckets);
+  z->buckets_mask = buckets-1;
+
+  /* ZDD_EMPTY terminates the chains */
+  for(ZNode f=2;f<z->size;f++) {
+    ZDDNode *n=z->nodes+f;
+    size_t   b=hash_triple(n->var,n->lo,n->hi) & z->buckets_mask;
+    n->next = z->buckets[b];
+    z->buckets[b] = f;
+  }
+}
+
+
+ZDD *newZDD(size_t allocation) {
+
+  ZDD *z=(ZDD*)malloc(sizeof(ZDD));
+  assert(z);
+
+  if (allocation < ZDD_MIN_ALLOCATION) allocation=ZDD_MIN_ALLOCATION;
+  z->allocation = allocation;
+  z->nodes      = (ZDDNode*)malloc(allocation*sizeof(ZDDNode));
+  assert(z->nodes);
+
+  z->nodes[ZDD_EMPTY].var = ZDD_TERMINAL_VAR;
+  z->nodes[ZDD_EMPTY].lo  = z->nodes[ZDD_EMPTY].hi = z->nodes[ZDD_EMPTY].next = ZDD_EMPTY;
+  z->nodes[ZDD_BASE].var  = ZDD_TERMINAL_VAR;
+  z->nodes[ZDD_BASE].lo   = z->nodes[ZDD_BASE].hi  = z->nodes[ZDD_BASE].next  = ZDD_EMPTY;
+  z->size = 2;
+
+  z->buckets = NULL;
+  rehash(z);
+
+  z->cache_mask = ZDD_CACHE_SIZE - 1;
+  z->cache      = (ZDDCacheEntry*)calloc(ZDD_CACHE_SIZE,sizeof(ZDDCacheEntry));
+  assert(z->cache);
+
+  z->root          = ZDD_EMPTY;
+  z->cache_lookups = 0;
+  z->cache_hits    = 0;
+  z->collections   = 0;
+
+  return z;
+}
+
+void disposeZDD(ZDD *z) {
+  assert(z);
+  free(z->nodes);
+  free(z->buckets);
+  free(z->cache);
+  free(z);
+}
+
+
+/* Nodes are ordered, irredundant (no node with hi==ZDD_EMPTY) and
+   unique. */
+Boolean isconsistentZDD(ZDD *z) {
+
+  if (z->size > z->allocation) return FALSE;
+  if (z->root >= z->size) return FALSE;
+
+  for(ZNode f=2;f<z->size;f++) {
+    ZDDNode *n=z->nodes+f;
+    if (n->lo >= f || n->hi >= f) return FALSE;
+    if (n->hi == ZDD_EMPTY) return FALSE;
+    if (n->var >= z->nodes[n->lo].var) return FALSE;
+    if (n->var >= z->nodes[n->hi].var) return FALSE;
+
+    /* It must be the node found in the unique table */
+    ZNode g=z->buckets[hash_triple(n->var,n->lo,n->hi) & z->buckets_mask];
+    while(g!=ZDD_EMPTY &&
+          (z->nodes[g].var!=n->var || z->nodes[g].lo!=n->lo || z->nodes[g].hi!=n->hi))
+      g=z->nodes[g].next;
+    if (g!=f) return FALSE;
+  }
+  return TRUE;
+}
+
+
+/* The node for (var ? hi : lo), with zero suppression. */
+ZNode getnodeZDD(ZDD *z,unsigned int var,ZNode lo,ZNode hi) {
+
+  assert(var < z->nodes[lo].var);
+  assert(var < z->nodes[hi].var);
+
+  if (hi==ZDD_EMPTY) return lo;
+
+  size_t b=hash_triple(var,lo,hi) & z->buckets_mask;
+  for(ZNode f=z->buckets[b]; f!=ZDD_EMPTY; f=z->nodes[f].next) {
+    ZDDNode *n=z->nodes+f;
+    if (n->var==var && n->lo==lo && n->hi==hi) return f;
+  }
+
+  if (z->size == z->allocation) {
+    z->allocation *= 2;
+    z->nodes = (ZDDNode*)realloc(z->nodes,z->allocation*sizeof(ZDDNode));
+    assert(z->nodes);
+    rehash(z);
+    b=hash_triple(var,lo,hi) & z->buckets_mask;
+  }
+
+  ZNode f=(ZNode)z->size++;
+  z->nodes[f].var  = var;
+  z->nodes[f].lo   = lo;
+  z->nodes[f].hi   = hi;
+  z->nodes[f].next = z->buckets[b];
+  z->buckets[b]    = f;
+  return f;
+}
+
+
+/* Family of all sets in a or in b */
+ZNode unionZDD(ZDD *z,ZNode a,ZNode b) {
+
+  if (a==ZDD_EMPTY) return b;
+  if (b==ZDD_EMPTY || a==b) return a;
+  if (a > b) { ZNode t=a; a=b; b=t; }
+
+  ZDDCacheEntry *e=z->cache + (hash_triple(ZDD_OP_UNION,a,b) & z->cache_mask);
+  z->cache_lookups++;
+  if (e->op==ZDD_OP_UNION && e->a==a && e->b==b) {
+    z->cache_hits++;
+    return e->result;
+  }
+
+  /* The node array may move during the recursion */
+  ZDDNode na=z->nodes[a];
+  ZDDNode nb=z->nodes[b];
+  ZNode   r;
+
+  if (na.var < nb.var) {
+    r=getnodeZDD(z,na.var,unionZDD(z,na.lo,b),na.hi);
+  } else if (na.var > nb.var) {
+    r=getnodeZDD(z,nb.var,unionZDD(z,a,nb.lo),nb.hi);
+  } else {
+    ZNode lo=unionZDD(z,na.lo,nb.lo);
+    ZNode hi=unionZDD(z,na.hi,nb.hi);
+    r=getnodeZDD(z,na.var,lo,hi);
+  }
+
+  e=z->cache + (hash_triple(ZDD_OP_UNION,a,b) & z->cache_mask);
+  e->op=ZDD_OP_UNION; e->a=a; e->b=b; e->result=r;
+  return r;
+}
+
+
+/* The family containing just the set of variables set in key. */
+ZNode singletonZDD(ZDD *z,const BitTuple *key,unsigned int width) {
+
+  ZNode r=ZDD_BASE;
+
+  for(unsigned int var=width*BITTUPLE_SIZE; var-- > 0; ) {
+    if (GETBIT(key[var / BITTUPLE_SIZE],var % BITTUPLE_SIZE))
+      r=getnodeZDD(z,var,ZDD_EMPTY,r);
+  }
+  return r;
+}
+
+
+/* Is the set of variables set in key a member of the family f? */
+Boolean memberZDD(const ZDD *z,ZNode f,const BitTuple *key,unsigned int width) {
+
+  for(unsigned int var=0; var < width*BITTUPLE_SIZE; var++) {
+    if (!GETBIT(key[var / BITTUPLE_SIZE],var % BITTUPLE_SIZE)) continue;
+    while(z->nodes[f].var < var) f=z->nodes[f].lo;
+    if (z->nodes[f].var != var) return FALSE;
+    f=z->nodes[f].hi;
+  }
+  while(!isterminal(f)) f=z->nodes[f].lo;
+  return f==ZDD_BASE;
+}
+
+
+/*
+   Keep only the nodes reachable from the root.  Since children come
+   before their parents, compaction preserves that order.
+ */
+static void mark(ZDD *z,ZNode f,ZNode *forward) {
+  while(!forward[f]) {
+    forward[f]=1;
+    mark(z,z->nodes[f].hi,forward);
+    f=z->nodes[f].lo;
+  }
+}
+
+void collectZDD(ZDD *z) {
+
+  ZNode *forward=(ZNode*)calloc(z->size,sizeof(ZNode));
+  assert(forward);
+
+  forward[ZDD_EMPTY]=forward[ZDD_BASE]=1;
+  mark(z,z->root,forward);
+
+  forward[ZDD_EMPTY]=ZDD_EMPTY;
+  forward[ZDD_BASE] =ZDD_BASE;
+
+  ZNode live=2;
+  for(ZNode f=2;f<z->size;f++) {
+    if (!forward[f]) continue;
+    z->nodes[live].var = z->nodes[f].var;
+    z->nodes[live].lo  = forward[z->nodes[f].lo];
+    z->nodes[live].hi  = forward[z->nodes[f].hi];
+    forward[f]=live++;
+  }
+  z->root=forward[z->root];
+  z->size=live;
+  free(forward);
+
+  rehash(z);
+  memset(z->cache,0,(z->cache_mask+1)*sizeof(ZDDCacheEntry));
+  z->collections++;
+}
+
+
+/*
+   Check if the key is in the family at the root, and add it anyway.
+   Garbage is collected when the node array is full, and the array
+   grows only if most of its nodes are alive.
+ */
+Boolean testandsetZDD(ZDD *z,const BitTuple *key,unsigned int width) {
+
+  assert(z);
+  assert(key);
+
+  if (memberZDD(z,z->root,key,width)) return TRUE;
+
+  if (z->size + 2*width*BITTUPLE_SIZE >= z->allocation) {
+    collectZDD(z);
+    if (2*z->size >= z->allocation) {
+      z->allocation *= 2;
+      z->nodes = (ZDDNode*)realloc(z->nodes,z->allocation*sizeof(ZDDNode));
+      assert(z->nodes);
+      rehash(z);
+    }
+  }
+
+  z->root=unionZDD(z,z->root,singletonZDD(z,key,width));
+  return FALSE;
+}
+
+
+/* Memory of the nodes in use, without the free part of the node
+   array, the unique table and the cache, which are allocated in
+   advance */
+size_t memoryZDD(const ZDD *z) {
+  return z->size * (sizeof(ZDDNode) + sizeof(ZNode));
+}
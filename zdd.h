@@ -0,0 +1,89 @@
+/*
+   Description::
+
+   Zero-suppressed decision diagrams, used to keep a compact set of
+   visited configurations. Header for zdd.c
+
+*/
+
+
+/* Preamble */
+#ifndef  ZDD_H
+#define  ZDD_H
+
+#include <stdlib.h>
+#include "common.h"
+
+/* Code */
+
+/* A ZDD represents a family of sets of variables.  Here a set of
+   variables is a packed configuration (see pack_PebbleConfiguration),
+   where variable i is bit i of the key, and the family is the set of
+   visited configurations.
+
+   Nodes are numbered, and the two terminals are node 0 (the empty
+   family) and node 1 (the family with only the empty set).  Nodes are
+   shared through a unique table, and the results of operations are
+   memoized in a lossy cache.  A node is always created after its
+   children, so it has a larger number. */
+typedef unsigned int ZNode;
+
+#define ZDD_EMPTY  0
+#define ZDD_BASE   1
+
+typedef struct {
+
+  unsigned int var;             /* Variable tested in the node */
+  ZNode        lo;              /* Sets without the variable */
+  ZNode        hi;              /* Sets with the variable */
+  ZNode        next;            /* Chain in the unique table */
+
+} ZDDNode;
+
+typedef struct {
+
+  unsigned int op;
+  ZNode        a;
+  ZNode        b;
+  ZNode        result;
+
+} ZDDCacheEntry;
+
+/* Nodes not reachable from the root are collected when the node
+   array gets full. */
+typedef struct {
+
+  size_t   allocation;          /* Capacity of the node array */
+  size_t   size;                /* Nodes in use, terminals included */
+  ZDDNode *nodes;
+
+  size_t   buckets_mask;        /* Unique table */
+  ZNode   *buckets;
+
+  size_t         cache_mask;    /* Operation cache */
+  ZDDCacheEntry *cache;
+
+  ZNode    root;                /* The family of visited sets */
+
+  Counter  cache_lookups;
+  Counter  cache_hits;
+  Counter  collections;
+
+} ZDD;
+
+extern ZDD    *newZDD(size_t allocation);
+extern void    disposeZDD(ZDD *z);
+
+extern Boolean isconsistentZDD(ZDD *z);
+
+extern ZNode   getnodeZDD(ZDD *z,unsigned int var,ZNode lo,ZNode hi);
+extern ZNode   unionZDD(ZDD *z,ZNode a,ZNode b);
+extern ZNode   singletonZDD(ZDD *z,const BitTuple *key,unsigned int width);
+extern Boolean memberZDD(const ZDD *z,ZNode f,const BitTuple *key,unsigned int width);
+
+extern Boolean testandsetZDD(ZDD *z,const BitTuple *key,unsigned int width);
+
+extern void    collectZDD(ZDD *z);
+extern size_t  memoryZDD(const ZDD *z);
+
+#endif /* ZDD_H */